@@ -16,6 +16,7 @@
 #endif
 #include "operon/algorithms/gp.hpp"
 #include "operon/core/format.hpp"
+#include "operon/core/metrics.hpp"
 #include "operon/core/version.hpp"
 #include "operon/core/problem.hpp"
 #include "operon/interpreter/interpreter.hpp"
@@ -41,6 +42,7 @@ auto main(int argc, char** argv) -> int
     config.Generations = result["generations"].as<size_t>();
     config.PopulationSize = result["population-size"].as<size_t>();
     config.PoolSize = result["pool-size"].as<size_t>();
+    config.UseNodeArena = result["node-arena"].as<bool>();
     config.Evaluations = result["evaluations"].as<size_t>();
     config.Iterations = result["iterations"].as<size_t>();
     config.CrossoverProbability = result["crossover-probability"].as<Operon::Scalar>();
@@ -212,6 +214,35 @@ auto main(int argc, char** argv) -> int
 
         evaluator.SetLocalOptimizationIterations(config.Iterations);
         evaluator.SetBudget(config.Evaluations);
+        evaluator.SetBatchedOptimization(result["batch-optimization"].as<size_t>());
+        evaluator.SetDagEvaluation(result["dag-evaluation"].as<size_t>());
+        evaluator.SetVariableProjection(result["variable-projection"].as<bool>());
+        evaluator.SetRowChunks(result["row-chunks"].as<size_t>());
+        auto const subsampleMode = result["subsample-mode"].as<std::string>() == "stratified" ? Operon::Evaluator::SubsampleMode::Stratified : Operon::Evaluator::SubsampleMode::Random;
+        evaluator.SetOptimizationSubsample(result["optimization-subsample"].as<size_t>(), subsampleMode, result["subsample-seed"].as<uint64_t>());
+
+        // the caches (and the evaluators wrapping them) only exist when they are enabled
+        std::unique_ptr<Operon::FitnessCache> cache;
+        std::unique_ptr<Operon::CachedEvaluator> cachedEvaluator;
+        Operon::EvaluatorBase* cached = &evaluator;
+        if (auto const capacity = result["fitness-cache"].as<size_t>(); capacity > 0) {
+            cache = std::make_unique<Operon::FitnessCache>(capacity);
+            cachedEvaluator = std::make_unique<Operon::CachedEvaluator>(problem, evaluator, *cache);
+            cached = cachedEvaluator.get();
+        }
+
+        std::unique_ptr<Operon::FitnessCache> semanticCache;
+        std::unique_ptr<Operon::SemanticCachedEvaluator> semanticEvaluator;
+        if (auto const capacity = result["semantic-cache"].as<size_t>(); capacity > 0) {
+            auto const policy = result["semantic-policy"].as<std::string>() == "reject" ? Operon::SemanticCachedEvaluator::Policy::Reject : Operon::SemanticCachedEvaluator::Policy::Inherit;
+            if (policy == Operon::SemanticCachedEvaluator::Policy::Inherit && config.Iterations > 0) {
+                fmt::print(stderr, "error: the semantic policy inherit requires --iterations 0 (the inherited fitness belongs to the optimized coefficients of another tree)\n");
+                return EXIT_FAILURE;
+            }
+            semanticCache = std::make_unique<Operon::FitnessCache>(capacity);
+            semanticEvaluator = std::make_unique<Operon::SemanticCachedEvaluator>(problem, interpreter, *cached, *semanticCache, policy);
+        }
+        Operon::EvaluatorBase& eval = semanticEvaluator ? *semanticEvaluator : *cached;
 
         EXPECT(problem.TrainingRange().Size() > 0);
 
@@ -220,7 +251,7 @@ auto main(int argc, char** argv) -> int
         auto femaleSelector = Operon::ParseSelector(result["female-selector"].as<std::string>(), comp);
         auto maleSelector = Operon::ParseSelector(result["male-selector"].as<std::string>(), comp);
 
-        auto generator = Operon::ParseGenerator(result["offspring-generator"].as<std::string>(), evaluator, crossover, mutator, *femaleSelector, *maleSelector);
+        auto generator = Operon::ParseGenerator(result["offspring-generator"].as<std::string>(), eval, crossover, mutator, *femaleSelector, *maleSelector);
         auto reinserter = Operon::ParseReinserter(result["reinserter"].as<std::string>(), comp);
 
         Operon::RandomGenerator random(config.Seed);
@@ -237,6 +268,15 @@ auto main(int argc, char** argv) -> int
 
         Operon::GeneticProgrammingAlgorithm gp { problem, config, treeInitializer, *coeffInitializer, *generator, *reinserter };
 
+        std::unique_ptr<Operon::CheckpointWriter> checkpointWriter;
+        if (result.count("checkpoint") > 0) {
+            checkpointWriter = std::make_unique<Operon::CheckpointWriter>(result["checkpoint"].as<std::string>(), result["checkpoint-interval"].as<size_t>());
+            gp.SetCheckpointWriter(checkpointWriter.get());
+        }
+        if (result.count("resume") > 0) {
+            gp.Restore(Operon::Checkpoint::Load(result["resume"].as<std::string>()), random);
+        }
+
         auto targetValues = problem.TargetValues();
         auto targetTrain = targetValues.subspan(trainingRange.Start(), trainingRange.Size());
         auto targetTest = targetValues.subspan(testRange.Start(), testRange.Size());
@@ -253,6 +293,7 @@ auto main(int argc, char** argv) -> int
 
         tf::Executor exe(threads);
 
+        Operon::Metrics::Snapshot lastMetrics;
         auto report = [&]() {
             auto const& pop = gp.Parents();
             auto const& off = gp.Offspring();
@@ -347,6 +388,16 @@ auto main(int argc, char** argv) -> int
             auto t1 = std::chrono::high_resolution_clock::now();
             auto elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()) / 1e6;
 
+            // per-generation activity from the metrics registry
+            auto const metrics = Operon::Metrics::Collect();
+            auto const delta = metrics - lastMetrics;
+            lastMetrics = metrics;
+            auto const& latency = delta[Operon::Metrics::Histogram::EvaluationLatency];
+            // accuracy of the cost model over the whole run: spread of the time per unit of predicted cost (1 is perfect)
+            auto const& costRatio = metrics[Operon::Metrics::Histogram::CostRatio];
+            auto const costSpread = costRatio.Count > 0 ? costRatio.Quantile(0.9) / std::max(costRatio.Quantile(0.1), 1.0) : 0.0;
+            constexpr double nsPerUs { 1e3 };
+
             using T = std::tuple<std::string, double, std::string>;
             auto const* format = ":>#8.3g";
             std::array stats {
@@ -360,8 +411,14 @@ auto main(int argc, char** argv) -> int
                 T{ "avg_fit", avgQuality, format },
                 T{ "avg_len", avgLength, format },
                 T{ "eval_cnt", evaluator.CallCount , ":>" },
+                T{ "cache_hit", cache ? cache->HitRate() : 0.0, format },
+                T{ "sem_hit", semanticCache ? semanticCache->HitRate() : 0.0, format },
                 T{ "res_eval", evaluator.ResidualEvaluations, ":>" },
                 T{ "jac_eval", evaluator.JacobianEvaluations, ":>" },
+                T{ "lat_p50", latency.Quantile(0.5) / nsPerUs, format },
+                T{ "lat_p99", latency.Quantile(0.99) / nsPerUs, format },
+                T{ "cost_spread", costSpread, format },
+                T{ "lm_iter", static_cast<double>(delta[Operon::Metrics::Counter::LocalOptimizationIterations]), ":>" },
                 T{ "seed", config.Seed, ":>" },
                 T{ "elapsed", elapsed, ":>"},
             };
@@ -369,6 +426,9 @@ auto main(int argc, char** argv) -> int
         };
 
         gp.Run(executor, random, report);
+        if (checkpointWriter && !checkpointWriter->Error().empty()) {
+            fmt::print(stderr, "warning: {}\n", checkpointWriter->Error());
+        }
         fmt::print("{}\n", Operon::InfixFormatter::Format(best.Genotype, problem.GetDataset(), 6));
     } catch (std::exception& e) {
         fmt::print(stderr, "error: {}\n", e.what());
@@ -16,6 +16,7 @@
 #endif
 #include "operon/algorithms/nsga2.hpp"
 #include "operon/core/format.hpp"
+#include "operon/core/metrics.hpp"
 #include "operon/core/version.hpp"
 #include "operon/core/problem.hpp"
 #include "operon/interpreter/interpreter.hpp"
@@ -42,6 +43,7 @@ auto main(int argc, char** argv) -> int
     config.Generations = result["generations"].as<size_t>();
     config.PopulationSize = result["population-size"].as<size_t>();
     config.PoolSize = result["pool-size"].as<size_t>();
+    config.UseNodeArena = result["node-arena"].as<bool>();
     config.Epsilon = result["epsilon"].as<Operon::Scalar>();
     config.Evaluations = result["evaluations"].as<size_t>();
     config.Iterations = result["iterations"].as<size_t>();
@@ -209,19 +211,13 @@ auto main(int argc, char** argv) -> int
 
         auto const& [error, scale] = Operon::ParseErrorMetric(result["error-metric"].as<std::string>());
         Operon::Interpreter interpreter;
-        Operon::Evaluator errorEvaluator(problem, interpreter, *error, scale);
-        errorEvaluator.SetLocalOptimizationIterations(config.Iterations);
-        errorEvaluator.SetBudget(config.Evaluations);
-        Operon::LengthEvaluator lengthEvaluator(problem, maxLength);
-        //Operon::ShapeEvaluator shapeEvaluator(problem);
-        //Operon::DiversityEvaluator divEvaluator(problem, Operon::HashMode::Strict);
-
-        Operon::MultiEvaluator evaluator(problem);
+        // the error and the length objectives are computed from a single evaluation of each individual
+        Operon::FusedEvaluator evaluator(problem, interpreter, scale);
+        evaluator.SetLocalOptimizationIterations(config.Iterations);
         evaluator.SetBudget(config.Evaluations);
-        evaluator.Add(errorEvaluator);
-        evaluator.Add(lengthEvaluator);
-        //evaluator.Add(shapeEvaluator);
-        //evaluator.Add(divEvaluator);
+        evaluator.Add(*error);
+        evaluator.Add(Operon::FusedEvaluator::Structure::Length, Operon::Scalar{1} / static_cast<Operon::Scalar>(maxLength));
+        //evaluator.Add(Operon::FusedEvaluator::Structure::VisitationLength);
 
         EXPECT(problem.TrainingRange().Size() > 0);
 
@@ -247,6 +243,15 @@ auto main(int argc, char** argv) -> int
         Operon::RankIntersectSorter sorter;
         Operon::NSGA2 gp { problem, config, treeInitializer, *coeffInitializer, *generator, *reinserter, sorter };
 
+        std::unique_ptr<Operon::CheckpointWriter> checkpointWriter;
+        if (result.count("checkpoint") > 0) {
+            checkpointWriter = std::make_unique<Operon::CheckpointWriter>(result["checkpoint"].as<std::string>(), result["checkpoint-interval"].as<size_t>());
+            gp.SetCheckpointWriter(checkpointWriter.get());
+        }
+        if (result.count("resume") > 0) {
+            gp.Restore(Operon::Checkpoint::Load(result["resume"].as<std::string>()), random);
+        }
+
         auto targetValues = problem.TargetValues();
         auto targetTrain = targetValues.subspan(trainingRange.Start(), trainingRange.Size());
         auto targetTest = targetValues.subspan(testRange.Start(), testRange.Size());
@@ -265,6 +270,7 @@ auto main(int argc, char** argv) -> int
 
         tf::Executor exe(threads);
 
+        Operon::Metrics::Snapshot lastMetrics;
         auto report = [&]() {
             auto const& pop = gp.Parents();
             auto const& off = gp.Offspring();
@@ -359,6 +365,16 @@ auto main(int argc, char** argv) -> int
             auto t1 = std::chrono::high_resolution_clock::now();
             auto elapsed = static_cast<double>(std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count()) / 1e6;
 
+            // per-generation activity from the metrics registry
+            auto const metrics = Operon::Metrics::Collect();
+            auto const delta = metrics - lastMetrics;
+            lastMetrics = metrics;
+            auto const& latency = delta[Operon::Metrics::Histogram::EvaluationLatency];
+            // accuracy of the cost model over the whole run: spread of the time per unit of predicted cost (1 is perfect)
+            auto const& costRatio = metrics[Operon::Metrics::Histogram::CostRatio];
+            auto const costSpread = costRatio.Count > 0 ? costRatio.Quantile(0.9) / std::max(costRatio.Quantile(0.1), 1.0) : 0.0;
+            constexpr double nsPerUs { 1e3 };
+
             using T = std::tuple<std::string, double, std::string>;
             auto const* format = ":>#8.3g"; // see https://fmt.dev/latest/syntax.html
             std::array stats {
@@ -374,6 +390,10 @@ auto main(int argc, char** argv) -> int
                 T{ "eval_cnt", evaluator.CallCount , ":>" },
                 T{ "res_eval", evaluator.ResidualEvaluations, ":>" },
                 T{ "jac_eval", evaluator.JacobianEvaluations, ":>" },
+                T{ "lat_p50", latency.Quantile(0.5) / nsPerUs, format },
+                T{ "lat_p99", latency.Quantile(0.99) / nsPerUs, format },
+                T{ "cost_spread", costSpread, format },
+                T{ "lm_iter", static_cast<double>(delta[Operon::Metrics::Counter::LocalOptimizationIterations]), ":>" },
                 T{ "seed", config.Seed, ":>" },
                 T{ "elapsed", elapsed, ":>"},
             };
@@ -381,6 +401,9 @@ auto main(int argc, char** argv) -> int
         };
 
         gp.Run(executor, random, report);
+        if (checkpointWriter && !checkpointWriter->Error().empty()) {
+            fmt::print(stderr, "warning: {}\n", checkpointWriter->Error());
+        }
         fmt::print("{}\n", Operon::InfixFormatter::Format(best.Genotype, problem.GetDataset(), 6));
     } catch (std::exception& e) {
         fmt::print(stderr, "error: {}\n", e.what());
@@ -158,10 +158,21 @@ auto InitOptions(std::string const& name, std::string const& desc, int width) ->
         ("error-metric", "The error metric used for calculating fitness", cxxopts::value<std::string>()->default_value("r2"))
         ("population-size", "Population size", cxxopts::value<size_t>()->default_value("1000"))
         ("pool-size", "Recombination pool size (how many generated offspring per generation)", cxxopts::value<size_t>()->default_value("1000"))
+        ("node-arena", "Store the genotypes of the population contiguously in a double-buffered node arena", cxxopts::value<bool>()->default_value("false"))
         ("seed", "Random number seed", cxxopts::value<Operon::RandomGenerator::result_type>()->default_value("0"))
         ("generations", "Number of generations", cxxopts::value<size_t>()->default_value("1000"))
         ("evaluations", "Evaluation budget", cxxopts::value<size_t>()->default_value("1000000"))
         ("iterations", "Local optimization iterations", cxxopts::value<size_t>()->default_value("0"))
+        ("variable-projection", "Solve the linear coefficients by least squares and optimize only the nonlinear ones iteratively", cxxopts::value<bool>()->default_value("false"))
+        ("optimization-subsample", "Number of training rows sampled for the local optimization of each individual (0 = all rows)", cxxopts::value<size_t>()->default_value("0"))
+        ("subsample-mode", "Row sampling mode for the local optimization (random, stratified)", cxxopts::value<std::string>()->default_value("random"))
+        ("subsample-seed", "Seed for the row sampling, making the subset a function of the individual (0 = use the evaluation random stream)", cxxopts::value<uint64_t>()->default_value("0"))
+        ("row-chunks", "Number of training rows per residual block evaluated in parallel by the Ceres optimizer (0 = a single block)", cxxopts::value<size_t>()->default_value("0"))
+        ("batch-optimization", "Number of individuals whose coefficients are optimized together by the batched Levenberg-Marquardt solver (0 = disabled)", cxxopts::value<size_t>()->default_value("0"))
+        ("dag-evaluation", "Number of individuals evaluated together on a genotype DAG, sharing their common subtrees (0 = disabled)", cxxopts::value<size_t>()->default_value("0"))
+        ("fitness-cache", "Capacity of the fitness cache used to skip the evaluation of duplicate individuals (0 = disabled)", cxxopts::value<size_t>()->default_value("0"))
+        ("semantic-cache", "Capacity of the semantic cache used to skip the evaluation of behaviourally duplicate individuals (0 = disabled)", cxxopts::value<size_t>()->default_value("0"))
+        ("semantic-policy", "What behaviourally duplicate individuals get: the known fitness (inherit, requires --iterations 0) or the worst fitness (reject)", cxxopts::value<std::string>()->default_value("reject"))
         ("selection-pressure", "Selection pressure", cxxopts::value<size_t>()->default_value("100"))
         ("maxlength", "Maximum length", cxxopts::value<size_t>()->default_value("50"))
         ("maxdepth", "Maximum depth", cxxopts::value<size_t>()->default_value("10"))
@@ -178,6 +189,9 @@ auto InitOptions(std::string const& name, std::string const& desc, int width) ->
         ("symbolic", "Operate in symbolic mode - no coefficient tuning or coefficient mutation", cxxopts::value<bool>()->default_value("false"))
         ("show-primitives", "Display the primitive set used by the algorithm")
         ("threads", "Number of threads to use for parallelism", cxxopts::value<size_t>()->default_value("0"))
+        ("checkpoint", "File where the state of the run is saved periodically", cxxopts::value<std::string>())
+        ("checkpoint-interval", "Number of generations between checkpoints", cxxopts::value<size_t>()->default_value("10"))
+        ("resume", "Continue the run saved in the given checkpoint file (the caches must be enabled as in the saved run)", cxxopts::value<std::string>())
         ("timelimit", "Time limit after which the algorithm will terminate", cxxopts::value<size_t>()->default_value(std::to_string(std::numeric_limits<size_t>::max())))
         ("debug", "Debug mode (more information displayed)")
         ("help", "Print help")
@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_CHECKPOINT_HPP
+#define OPERON_CHECKPOINT_HPP
+
+#include <cstddef>                       // for size_t, byte
+#include <mutex>                         // for mutex
+#include <operon/operon_export.hpp>      // for OPERON_EXPORT
+#include <string>                        // for string
+#include <vector>                        // for vector
+#include "operon/algorithms/config.hpp"  // for GeneticAlgorithmConfig
+#include "operon/core/individual.hpp"    // for Individual
+#include "operon/core/types.hpp"         // for Span, Vector, RandomGenerator
+#include "operon/operators/fitness_cache.hpp" // for FitnessCache
+
+namespace Operon {
+
+// the state of an evolutionary algorithm at the end of a generation, sufficient to continue the run
+// with the same outcome (given the same operators and data, and unless the time limit or the evaluation budget
+// is reached in a different place)
+struct OPERON_EXPORT Checkpoint {
+    using RandomState = Operon::RandomGenerator::state_type;
+
+    GeneticAlgorithmConfig Config{};
+    size_t Generation{0};
+    size_t Start{0}; // the generation at which the interrupted call to Run started (the generation limit is relative to it)
+
+    RandomState Random{};           // the generator passed to Run
+    std::vector<RandomState> Rngs;  // the per-individual generators
+
+    // evaluator counters
+    size_t ResidualEvaluations{0};
+    size_t JacobianEvaluations{0};
+    size_t CallCount{0};
+
+    Operon::Vector<Individual> Individuals; // parents followed by offspring
+    Operon::Vector<Individual> Best;        // best front (NSGA2)
+
+    // the contents of the fitness caches of the evaluator (see EvaluatorBase::Caches), without which a continued run
+    // would evaluate the individuals that the original run finds in its caches
+    std::vector<FitnessCache::State> Caches;
+
+    // compact binary format in native byte order; Deserialize throws std::runtime_error on malformed input
+    [[nodiscard]] auto Serialize() const -> std::vector<std::byte>;
+    static auto Deserialize(Operon::Span<std::byte const> bytes) -> Checkpoint;
+
+    auto Save(std::string const& path) const -> void;
+    static auto Load(std::string const& path) -> Checkpoint;
+};
+
+// writes the checkpoints of a run to a file every `interval` generations
+// the algorithms hand the checkpoints over to a background task, so Write may be called concurrently: the file is
+// replaced atomically (by renaming a temporary file) and a checkpoint older than the last one written is discarded
+class OPERON_EXPORT CheckpointWriter {
+public:
+    explicit CheckpointWriter(std::string path, size_t interval = 1)
+        : path_(std::move(path))
+        , interval_(interval)
+    {
+    }
+
+    [[nodiscard]] auto Path() const -> std::string const& { return path_; }
+    [[nodiscard]] auto Interval() const -> size_t { return interval_; }
+    [[nodiscard]] auto Due(size_t generation) const -> bool { return interval_ > 0 && generation % interval_ == 0; }
+
+    // returns false if the checkpoint could not be saved (see Error), the previous checkpoint file is then kept
+    auto Write(Checkpoint const& checkpoint) -> bool;
+
+    // the generation of the last checkpoint written
+    [[nodiscard]] auto Written() const -> size_t
+    {
+        std::lock_guard lock(mutex_);
+        return written_;
+    }
+
+    // the reason of the last failed write
+    [[nodiscard]] auto Error() const -> std::string
+    {
+        std::lock_guard lock(mutex_);
+        return error_;
+    }
+
+private:
+    std::string path_;
+    size_t interval_;
+    mutable std::mutex mutex_;
+    size_t written_{0};
+    bool any_{false};
+    std::string error_;
+};
+
+} // namespace Operon
+
+#endif
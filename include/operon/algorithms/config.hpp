@@ -18,6 +18,7 @@ struct GeneticAlgorithmConfig {
     double CrossoverProbability;
     double MutationProbability;
     double Epsilon;     // used when comparing fitness values
+    bool UseNodeArena { false }; // store the genotypes of the population in a node arena (see NodeArena)
 };
 } // namespace Operon
 
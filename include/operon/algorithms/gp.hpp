@@ -6,18 +6,23 @@
 
 #include <cstddef>                         // for size_t
 #include <functional>                      // for reference_wrapper, function
+#include <memory>                          // for unique_ptr
 #include <nonstd/span.hpp>                 // for span<>::pointer
 #include <operon/operon_export.hpp>        // for OPERON_EXPORT
 #include <thread>                          // for thread
 #include <utility>                         // for move
+#include <vector>                          // for vector
+#include "operon/algorithms/checkpoint.hpp" // for Checkpoint, CheckpointWriter
 #include "operon/algorithms/config.hpp"    // for GeneticAlgorithmConfig
 #include "operon/core/individual.hpp"      // for Individual
+#include "operon/core/node_arena.hpp"      // for NodeArena
+#include "operon/core/range.hpp"           // for Range
 #include "operon/core/types.hpp"           // for Span, Vector, RandomGenerator
 #include "operon/operators/evaluator.hpp"  // for EvaluatorBase
 #include "operon/operators/generator.hpp"  // for OffspringGeneratorBase
 
 // forward declaration
-namespace tf { class Executor; }
+namespace tf { class Executor; class Taskflow; }
 
 namespace Operon {
 
@@ -35,28 +40,35 @@ class OPERON_EXPORT GeneticProgrammingAlgorithm {
     std::reference_wrapper<const OffspringGeneratorBase> generator_;
     std::reference_wrapper<const ReinserterBase> reinserter_;
 
+    std::unique_ptr<NodeArena> arena_; // only with GeneticAlgorithmConfig::UseNodeArena, outlives the individuals
     Operon::Vector<Individual> individuals_;
     Operon::Span<Individual> parents_;
     Operon::Span<Individual> offspring_;
 
     size_t generation_{0};
+    bool initialized_{false}; // whether the parents were initialized and evaluated by a previous call to Run
+
+    std::vector<Operon::RandomGenerator> rngs_; // per-individual random generators of the current run
+    size_t start_{0};       // the generation at which the current run started
+    bool restored_{false};  // whether the next call to Run continues from a checkpoint
+    CheckpointWriter* checkpoint_{nullptr};
+
+    struct RunState; // the task graph and the scratch state of its tasks (see TaskGraph)
+    std::unique_ptr<RunState> run_;
 
 public:
-    explicit GeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator, ReinserterBase const& reinserter)
-        : problem_(problem)
-        , config_(config)
-        , treeInit_(treeInit)
-        , coeffInit_(coeffInit)
-        , generator_(generator)
-        , reinserter_(reinserter)
-        , individuals_(config.PopulationSize + config.PoolSize)
-        , parents_(individuals_.data(), config.PopulationSize)
-        , offspring_(individuals_.data() + config.PopulationSize, config.PoolSize)
-    {
-    }
+    explicit GeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator, ReinserterBase const& reinserter);
+
+    ~GeneticProgrammingAlgorithm();
+    GeneticProgrammingAlgorithm(GeneticProgrammingAlgorithm&& other) noexcept;
+    GeneticProgrammingAlgorithm(GeneticProgrammingAlgorithm const&) = delete;
+    auto operator=(GeneticProgrammingAlgorithm&&) -> GeneticProgrammingAlgorithm& = delete;
+    auto operator=(GeneticProgrammingAlgorithm const&) -> GeneticProgrammingAlgorithm& = delete;
 
     [[nodiscard]] auto Parents() const -> Operon::Span<Individual const> { return { parents_.data(), parents_.size() }; }
+    [[nodiscard]] auto Parents() -> Operon::Span<Individual> { return parents_; } // e.g. for migration from the report callback
     [[nodiscard]] auto Offspring() const -> Operon::Span<Individual const> { return { offspring_.data(), offspring_.size() }; }
+    [[nodiscard]] auto Arena() const -> NodeArena const* { return arena_.get(); } // null unless UseNodeArena is set
 
     [[nodiscard]] auto GetProblem() const -> const Problem& { return problem_.get(); }
     [[nodiscard]] auto GetConfig() const -> const GeneticAlgorithmConfig& { return config_.get(); }
@@ -71,9 +83,29 @@ public:
     auto Reset() -> void
     {
         generation_ = 0;
+        initialized_ = false;
+        restored_ = false;
         generator_.get().Evaluator().Reset();
     }
 
+    // notify the algorithm that the training data has changed (e.g. rows were appended and the training window moved)
+    // the fitness of the current parents is updated with respect to the new training range and a subsequent call to
+    // Run resumes evolution from the current population instead of reinitializing it
+    auto DataChanged(tf::Executor& /*executor*/, Operon::RandomGenerator& /*rng*/, Range /*previous training range*/) -> void;
+
+    // save the state of the run every few generations; the file is written by a background task on the executor
+    auto SetCheckpointWriter(CheckpointWriter* writer) -> void { checkpoint_ = writer; }
+    [[nodiscard]] auto Snapshot(Operon::RandomGenerator const& random) const -> Checkpoint;
+    // continue an interrupted run: the next call to Run resumes from the checkpoint, and `random` is set to
+    // the state of the generator passed to the interrupted run (which should be passed to Run again)
+    auto Restore(Checkpoint const& checkpoint, Operon::RandomGenerator& random) -> void;
+
+    // the task graph executed by Run, e.g. to compose it with the graphs of other algorithms (see
+    // IslandGeneticProgrammingAlgorithm): each execution performs one run, until the termination criterion is met
+    // the graph is owned by the algorithm and replaced by the next call; the executor and the random generator must
+    // outlive it
+    auto TaskGraph(tf::Executor& /*executor*/, Operon::RandomGenerator& /*rng*/, std::function<void()> /*report*/ = nullptr) -> tf::Taskflow&;
+
     auto Run(tf::Executor& /*executor*/, Operon::RandomGenerator&/*rng*/, std::function<void()> /*report*/ = nullptr) -> void;
     auto Run(Operon::RandomGenerator& /*rng*/, std::function<void()> /*report*/ = nullptr, size_t /*threads*/= 0) -> void;
 };
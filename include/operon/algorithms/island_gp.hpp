@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_ISLAND_GP_HPP
+#define OPERON_ISLAND_GP_HPP
+
+#include <cstddef>                           // for size_t
+#include <functional>                        // for reference_wrapper, function
+#include <operon/operon_export.hpp>          // for OPERON_EXPORT
+#include <vector>                            // for vector
+#include "operon/algorithms/config.hpp"      // for GeneticAlgorithmConfig
+#include "operon/algorithms/gp.hpp"          // for GeneticProgrammingAlgorithm
+#include "operon/algorithms/island_model.hpp" // for MigrationConfig
+#include "operon/core/individual.hpp"        // for Individual, ComparisonCallback
+#include "operon/core/types.hpp"             // for Span, RandomGenerator
+
+// forward declaration
+namespace tf { class Executor; }
+
+namespace Operon {
+
+class Problem;
+class ReinserterBase;
+struct CoefficientInitializerBase;
+struct TreeInitializerBase;
+
+// multiple GP subpopulations (islands) evolving inside a single process on a shared executor
+// - each island is a GeneticProgrammingAlgorithm with its own parents/offspring buffers and PopulationSize individuals
+// - each island needs its own offspring generator (the selectors keep a view of their island's population);
+//   sharing the evaluator between the generators makes the evaluation budget global
+// - the islands run concurrently for MigrationConfig::Interval generations, after which the best (or random)
+//   individuals migrate according to the topology; capacity and length limits of the config do not apply here
+// - the report callback is invoked after the initialization and after each migration step
+class OPERON_EXPORT IslandGeneticProgrammingAlgorithm {
+    std::reference_wrapper<const Problem> problem_;
+    std::reference_wrapper<const GeneticAlgorithmConfig> config_;
+    MigrationConfig migration_;
+    ComparisonCallback comp_;
+
+    std::vector<GeneticAlgorithmConfig> configs_; // per-island copies, the generation and time limits are set for each epoch
+    std::vector<GeneticProgrammingAlgorithm> islands_;
+
+    size_t generation_{0};
+
+    auto Migrate(Operon::RandomGenerator& random) -> void;
+
+public:
+    IslandGeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, MigrationConfig migration,
+        TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit,
+        std::vector<std::reference_wrapper<OffspringGeneratorBase const>> const& generators, ReinserterBase const& reinserter,
+        ComparisonCallback comp);
+
+    [[nodiscard]] auto Islands() const -> Operon::Span<GeneticProgrammingAlgorithm const> { return { islands_.data(), islands_.size() }; }
+    [[nodiscard]] auto Islands() -> Operon::Span<GeneticProgrammingAlgorithm> { return { islands_.data(), islands_.size() }; }
+
+    [[nodiscard]] auto GetProblem() const -> const Problem& { return problem_.get(); }
+    [[nodiscard]] auto GetConfig() const -> const GeneticAlgorithmConfig& { return config_.get(); }
+    [[nodiscard]] auto GetMigrationConfig() const -> MigrationConfig const& { return migration_; }
+
+    [[nodiscard]] auto Generation() const -> size_t { return generation_; }
+
+    // the best individual over all islands
+    [[nodiscard]] auto Best() const -> Individual const&;
+
+    auto Reset() -> void
+    {
+        generation_ = 0;
+        for (auto& island : islands_) { island.Reset(); }
+    }
+
+    auto Run(tf::Executor& /*executor*/, Operon::RandomGenerator&/*rng*/, std::function<void()> /*report*/ = nullptr) -> void;
+    auto Run(Operon::RandomGenerator& /*rng*/, std::function<void()> /*report*/ = nullptr, size_t /*threads*/= 0) -> void;
+};
+} // namespace Operon
+
+#endif
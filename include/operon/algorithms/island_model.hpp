@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_ISLAND_MODEL_HPP
+#define OPERON_ISLAND_MODEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <operon/operon_export.hpp>
+#include <vector>
+
+#include "operon/core/individual.hpp"
+#include "operon/core/node.hpp"
+#include "operon/core/types.hpp"
+
+namespace Operon {
+
+enum class MigrationTopology : int {
+    Ring,    // island i sends to island (i + 1) % n
+    Random,  // each migration targets a random other island
+    Complete // each migration targets every other island
+};
+
+enum class MigrationPolicy : int {
+    Best,  // emigrants: the best individuals, immigrants: replace the worst individuals
+    Random // emigrants: uniformly sampled, immigrants: replace uniformly sampled individuals
+};
+
+struct MigrationConfig {
+    size_t Islands { 2 };         // number of islands (processes)
+    size_t Interval { 10 };       // migrate every Interval generations
+    size_t Migrants { 1 };        // number of individuals sent to each target island
+    size_t Capacity { 64 };       // capacity (in individuals) of each island's inbox
+    size_t MaxLength { 128 };     // maximum tree length that can be migrated
+    size_t MaxObjectives { 2 };   // maximum number of objectives that can be migrated
+    MigrationTopology Topology { MigrationTopology::Ring };
+    MigrationPolicy Emigration { MigrationPolicy::Best };
+    MigrationPolicy Immigration { MigrationPolicy::Best };
+};
+
+// migration steps shared by the multi-process IslandModel and the in-process IslandGeneticProgrammingAlgorithm
+// the islands receiving the emigrants of the given island
+OPERON_EXPORT auto MigrationTargets(Operon::RandomGenerator& random, MigrationTopology topology, size_t island, size_t islands) -> std::vector<size_t>;
+// the indices of (at most) count individuals leaving the population
+OPERON_EXPORT auto SelectEmigrants(Operon::RandomGenerator& random, Operon::Span<Individual const> population, MigrationPolicy policy, ComparisonCallback const& comp, size_t count) -> std::vector<size_t>;
+// the indices of (at most) count individuals replaced by immigrants
+OPERON_EXPORT auto SelectReplaced(Operon::RandomGenerator& random, Operon::Span<Individual const> population, MigrationPolicy policy, ComparisonCallback const& comp, size_t count) -> std::vector<size_t>;
+
+// compact node representation used to transfer trees between processes (postfix order)
+struct PackedNode {
+    Operon::Hash HashValue;
+    Operon::Scalar Value;
+    NodeType Type;
+    uint16_t Arity;
+    bool Optimize;
+
+    PackedNode() = default;
+
+    explicit PackedNode(Node const& node)
+        : HashValue(node.HashValue)
+        , Value(node.Value)
+        , Type(node.Type)
+        , Arity(node.Arity)
+        , Optimize(node.Optimize)
+    {
+    }
+
+    [[nodiscard]] auto Unpack() const -> Node
+    {
+        Node node(Type, HashValue);
+        node.Value = Value;
+        node.Arity = Arity;
+        node.Optimize = Optimize;
+        return node;
+    }
+};
+
+// multi-producer multi-consumer bounded queues (one inbox per island plus one for the parent process)
+// living in a POSIX shared memory segment; writers never block: a migrant is dropped when the inbox is full
+// a writer reserves a slot before copying the migrant into it and publishes the slot afterwards: if its process dies in
+// between, the readers of the inbox stop at the reserved slot, i.e. the inbox delivers nothing anymore and its writers
+// drop their migrants once it is full. the slot can only be released (see Recover) when no writer is left running
+class OPERON_EXPORT MigrationChannel {
+public:
+    explicit MigrationChannel(MigrationConfig const& config);
+    ~MigrationChannel();
+
+    MigrationChannel(MigrationChannel const&) = delete;
+    MigrationChannel(MigrationChannel&&) = delete;
+    auto operator=(MigrationChannel const&) -> MigrationChannel& = delete;
+    auto operator=(MigrationChannel&&) -> MigrationChannel& = delete;
+
+    // returns false if the inbox is full or the individual does not fit in a slot
+    auto Send(size_t inbox, Individual const& individual) -> bool;
+    // returns false if the inbox is empty
+    auto Receive(size_t inbox, Individual& individual) -> bool;
+    // skips the slots at the head of the inbox which were reserved but never published, so that Receive gets to the
+    // migrants behind them; returns the number of skipped slots
+    // only valid once all the processes which may send to the inbox have terminated
+    auto Recover(size_t inbox) -> size_t;
+
+    [[nodiscard]] auto Inboxes() const -> size_t { return inboxes_; }
+    [[nodiscard]] auto Config() const -> MigrationConfig const& { return config_; }
+
+private:
+    [[nodiscard]] auto Slot(size_t inbox, size_t index) const -> std::byte*;
+
+    MigrationConfig config_;
+    size_t inboxes_;
+    size_t slotBytes_;
+    size_t inboxBytes_;
+    size_t size_;
+    std::byte* data_;
+};
+
+// performs the migration step for one island; meant to be called from the algorithm's report callback
+class OPERON_EXPORT Migrator {
+public:
+    Migrator(MigrationChannel& channel, size_t island, ComparisonCallback comp)
+        : channel_(channel)
+        , island_(island)
+        , comp_(std::move(comp))
+    {
+    }
+
+    // exchanges individuals with the neighbouring islands if the generation is a migration generation
+    // returns the number of immigrants integrated into the population
+    auto operator()(Operon::RandomGenerator& random, Operon::Span<Individual> population, size_t generation) const -> size_t;
+
+    // sends an individual (e.g. the final best solution) to the parent process
+    auto Submit(Individual const& individual) const -> bool;
+
+    [[nodiscard]] auto Island() const -> size_t { return island_; }
+
+private:
+    std::reference_wrapper<MigrationChannel> channel_;
+    size_t island_;
+    ComparisonCallback comp_;
+};
+
+// runs one evolutionary algorithm per island, each in its own process
+// the island callback receives the island index and a migrator; it should construct its own executor
+// (threads do not survive fork) and call the migrator from the algorithm's report callback
+class OPERON_EXPORT IslandModel {
+public:
+    using IslandCallback = std::function<int(size_t, Migrator const&)>;
+
+    IslandModel(MigrationConfig config, ComparisonCallback comp)
+        : config_(config)
+        , comp_(std::move(comp))
+    {
+    }
+
+    // returns the exit status of each island (-1 if the island process terminated abnormally)
+    auto Run(IslandCallback const& island) -> std::vector<int>;
+
+    // individuals submitted by the islands during the last run
+    [[nodiscard]] auto Results() const -> Operon::Vector<Individual> const& { return results_; }
+    [[nodiscard]] auto Config() const -> MigrationConfig const& { return config_; }
+
+private:
+    MigrationConfig config_;
+    ComparisonCallback comp_;
+    Operon::Vector<Individual> results_;
+};
+
+} // namespace Operon
+
+#endif
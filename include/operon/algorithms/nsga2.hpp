@@ -5,19 +5,24 @@
 #define OPERON_NSGA2_HPP
 
 #include <functional>                      // for reference_wrapper, function
+#include <memory>                          // for unique_ptr
 #include <nonstd/span.hpp>                 // for span<>::pointer
 #include <operon/operon_export.hpp>        // for OPERON_EXPORT
 #include <thread>                          // for thread
 #include <utility>                         // for move
 #include <vector>                          // for vector
+#include "operon/algorithms/checkpoint.hpp" // for Checkpoint, CheckpointWriter
 #include "operon/algorithms/config.hpp"    // for GeneticAlgorithmConfig
 #include "operon/core/individual.hpp"      // for Individual
+#include "operon/core/node_arena.hpp"      // for NodeArena
+#include "operon/core/range.hpp"           // for Range
 #include "operon/core/types.hpp"           // for Span, Vector, RandomGenerator
+#include "operon/operators/crowding.hpp"   // for CrowdingSorter
 #include "operon/operators/evaluator.hpp"  // for EvaluatorBase
 #include "operon/operators/generator.hpp"  // for OffspringGeneratorBase
 
 // forward declaration
-namespace tf { class Executor; }
+namespace tf { class Executor; class Subflow; }
 
 namespace Operon {
 
@@ -35,20 +40,25 @@ class OPERON_EXPORT NSGA2 {
     std::reference_wrapper<const CoefficientInitializerBase> coeffInit_;
     std::reference_wrapper<const OffspringGeneratorBase> generator_;
     std::reference_wrapper<const ReinserterBase> reinserter_;
-    std::reference_wrapper<const NondominatedSorterBase> sorter_;
 
+    std::unique_ptr<NodeArena> arena_; // only with GeneticAlgorithmConfig::UseNodeArena, outlives the individuals
     Operon::Vector<Individual> individuals_;
     Operon::Span<Individual> parents_;
     Operon::Span<Individual> offspring_;
 
     size_t generation_{0};
-    std::vector<std::vector<size_t>> fronts_;
+    bool initialized_{false}; // whether the parents were initialized and evaluated by a previous call to Run
+
+    std::vector<Operon::RandomGenerator> rngs_; // per-individual random generators of the current run
+    size_t start_{0};       // the generation at which the current run started
+    bool restored_{false};  // whether the next call to Run continues from a checkpoint
+    CheckpointWriter* checkpoint_{nullptr};
+    CrowdingSorter ranking_; // non-dominated sorting and crowding distance
 
     // best pareto front
     Operon::Vector<Individual> best_;
 
-    auto UpdateDistance(Operon::Span<Individual> pop) -> void;
-    auto Sort(Operon::Span<Individual> pop) -> void;
+    auto Sort(tf::Subflow& subflow, Operon::Span<Individual> pop) -> void;
 
 public:
     explicit NSGA2(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator, ReinserterBase const& reinserter, NondominatedSorterBase const& sorter)
@@ -58,15 +68,18 @@ public:
         , coeffInit_(coeffInit)
         , generator_(generator)
         , reinserter_(reinserter)
-        , sorter_(sorter)
+        , arena_(config.UseNodeArena ? std::make_unique<NodeArena>() : nullptr)
         , individuals_(config.PopulationSize + config.PoolSize)
         , parents_(individuals_.data(), config.PopulationSize)
         , offspring_(individuals_.data() + config.PopulationSize, config.PoolSize)
+        , ranking_(sorter, static_cast<Operon::Scalar>(config.Epsilon))
     {
     }
 
     [[nodiscard]] auto Parents() const -> Operon::Span<Individual const> { return { parents_.data(), parents_.size() }; }
+    [[nodiscard]] auto Parents() -> Operon::Span<Individual> { return parents_; } // e.g. for migration from the report callback
     [[nodiscard]] auto Offspring() const -> Operon::Span<Individual const> { return { offspring_.data(), offspring_.size() }; }
+    [[nodiscard]] auto Arena() const -> NodeArena const* { return arena_.get(); } // null unless UseNodeArena is set
     [[nodiscard]] auto Best() const -> Operon::Span<Individual const> { return { best_.data(), best_.size() }; }
 
     [[nodiscard]] auto GetProblem() const -> const Problem& { return problem_.get(); }
@@ -82,9 +95,23 @@ public:
     auto Reset() -> void
     {
         generation_ = 0;
+        initialized_ = false;
+        restored_ = false;
         GetGenerator().Evaluator().Reset();
     }
 
+    // notify the algorithm that the training data has changed (e.g. rows were appended and the training window moved)
+    // the fitness of the current parents is updated with respect to the new training range and a subsequent call to
+    // Run resumes evolution from the current population instead of reinitializing it
+    auto DataChanged(tf::Executor& /*executor*/, Operon::RandomGenerator& /*rng*/, Range /*previous training range*/) -> void;
+
+    // save the state of the run every few generations; the file is written by a background task on the executor
+    auto SetCheckpointWriter(CheckpointWriter* writer) -> void { checkpoint_ = writer; }
+    [[nodiscard]] auto Snapshot(Operon::RandomGenerator const& random) const -> Checkpoint;
+    // continue an interrupted run: the next call to Run resumes from the checkpoint, and `random` is set to
+    // the state of the generator passed to the interrupted run (which should be passed to Run again)
+    auto Restore(Checkpoint const& checkpoint, Operon::RandomGenerator& random) -> void;
+
     auto Run(tf::Executor& /*executor*/, Operon::RandomGenerator&/*rng*/, std::function<void()> /*report*/ = nullptr) -> void;
     auto Run(Operon::RandomGenerator& /*rng*/, std::function<void()> /*report*/ = nullptr, size_t /*threads*/= 0) -> void;
 };
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_SCHEDULER_HPP
+#define OPERON_SCHEDULER_HPP
+
+#include <cstddef>                         // for size_t
+#include <cstdint>                         // for uint8_t
+#include <operon/operon_export.hpp>        // for OPERON_EXPORT
+#include <vector>                          // for vector
+#include "operon/core/individual.hpp"      // for Individual
+#include "operon/core/range.hpp"           // for Range
+#include "operon/core/types.hpp"           // for Span, RandomGenerator
+
+// forward declaration
+namespace tf { class Executor; }
+
+namespace Operon {
+
+struct EvaluatorBase;
+
+// splits the evaluation of a population into chunks of similar predicted cost (see EvaluatorBase::Cost)
+// - the individuals are packed longest-processing-time first: by decreasing cost, each into the chunk with the
+//   smallest total so far; the chunks are ordered by decreasing total, so the most expensive work starts first
+// - the time spent on each group of individuals is recorded against its predicted cost (Metrics::Histogram::CostRatio),
+//   a narrow distribution means that the cost model is accurate
+class OPERON_EXPORT CostScheduler {
+public:
+    static constexpr size_t DefaultChunksPerWorker { 4 };
+
+    explicit CostScheduler(size_t chunksPerWorker = DefaultChunksPerWorker)
+        : chunksPerWorker_(chunksPerWorker)
+    {
+    }
+
+    auto Plan(EvaluatorBase const& evaluator, Operon::Span<Individual const> pop, size_t workers) -> void;
+
+    // the same, but only the individuals at the given positions are scheduled (e.g. the offspring that were produced)
+    auto Plan(EvaluatorBase const& evaluator, Operon::Span<Individual const> pop, Operon::Span<size_t const> items, size_t workers) -> void;
+
+    [[nodiscard]] auto Chunks() const -> size_t { return offsets_.empty() ? 0 : offsets_.size() - 1; }
+    [[nodiscard]] auto Chunk(size_t k) const -> Operon::Span<size_t const> { return { order_.data() + offsets_[k], offsets_[k + 1] - offsets_[k] }; }
+    [[nodiscard]] auto Cost(size_t i) const -> double { return costs_[i]; }
+
+    // evaluates the individuals of a chunk in groups of the evaluator's batch size
+    // (each individual uses its own random generator, like the unscheduled evaluation)
+    // the evaluation budget is checked before each group: once it is exhausted, the remaining individuals of the chunk
+    // are not evaluated, they get the worst possible fitness and Evaluated(i) returns false for them
+    auto Evaluate(size_t chunk, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::Span<Operon::RandomGenerator> rngs, Operon::Span<Operon::Scalar> buf) -> void;
+
+    // whether individual i was evaluated since the last call to Plan
+    [[nodiscard]] auto Evaluated(size_t i) const -> bool { return evaluated_[i] != 0; }
+
+    // updates the fitness of the individuals of a chunk after the training data has changed (see EvaluatorBase::Update)
+    auto Update(size_t chunk, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::Span<Operon::RandomGenerator> rngs, Range previous, Operon::Span<Operon::Scalar> buf) const -> void;
+
+private:
+    size_t chunksPerWorker_;
+    std::vector<double> costs_;   // predicted cost of each individual
+    std::vector<size_t> order_;   // the individuals grouped by chunk
+    std::vector<size_t> offsets_; // chunk k is order_[offsets_[k]..offsets_[k+1])
+    std::vector<uint8_t> evaluated_; // one flag per individual, written by the chunk that owns it
+};
+
+// updates the fitness of a population after the training data has changed (see EvaluatorBase::Update): the evaluator
+// is prepared and the individuals are updated in chunks of balanced cost, each with a random generator drawn from `random`
+OPERON_EXPORT auto UpdatePopulation(tf::Executor& executor, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::RandomGenerator& random, Range previous) -> void;
+
+} // namespace Operon
+
+#endif
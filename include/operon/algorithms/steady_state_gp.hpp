@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_STEADY_STATE_GP_HPP
+#define OPERON_STEADY_STATE_GP_HPP
+
+#include <atomic>                          // for atomic
+#include <cstddef>                         // for size_t
+#include <functional>                      // for reference_wrapper, function
+#include <memory>                          // for unique_ptr
+#include <mutex>                           // for mutex
+#include <shared_mutex>                    // for shared_mutex
+#include <operon/operon_export.hpp>        // for OPERON_EXPORT
+#include "operon/algorithms/config.hpp"    // for GeneticAlgorithmConfig
+#include "operon/core/individual.hpp"      // for Individual
+#include "operon/core/types.hpp"           // for Span, Vector, RandomGenerator
+#include "operon/operators/generator.hpp"  // for OffspringGeneratorBase
+
+// forward declaration
+namespace tf { class Executor; }
+
+namespace Operon {
+
+class Problem;
+struct CoefficientInitializerBase;
+struct TreeInitializerBase;
+
+// steady-state GP without generational barriers: every worker continuously selects parents, produces and evaluates
+// a child and inserts it into the shared population, so that slow evaluations never stall the other workers
+// - the crossover, mutator and evaluator are taken from the generator; parents are chosen by tournament on the
+//   first objective (the generator's selectors keep a span to the population and cannot follow concurrent updates)
+// - the primary fitness of each slot is mirrored in an atomic, so selection and victim search are lock-free;
+//   the genotype of a slot is guarded by its own mutex, held only while copying a parent or replacing the slot
+// - a child replaces the victim only if it is better, which implicitly keeps the best individual
+// - a generation corresponds to PoolSize produced children: the report callback is invoked at these boundaries
+//   while insertions are paused, such that it observes a consistent population
+class OPERON_EXPORT SteadyStateGeneticProgrammingAlgorithm {
+public:
+    enum class Replacement {
+        Worst,     // the worst individual of the population
+        Tournament // the worst individual of a random tournament
+    };
+
+private:
+    std::reference_wrapper<const Problem> problem_;
+    std::reference_wrapper<const GeneticAlgorithmConfig> config_;
+
+    std::reference_wrapper<const TreeInitializerBase> treeInit_;
+    std::reference_wrapper<const CoefficientInitializerBase> coeffInit_;
+    std::reference_wrapper<const OffspringGeneratorBase> generator_;
+
+    Operon::Vector<Individual> individuals_;
+    std::unique_ptr<std::atomic<Operon::Scalar>[]> quality_; // NOLINT
+    std::unique_ptr<std::mutex[]> locks_; // NOLINT
+    std::shared_mutex barrier_; // shared by inserting workers, exclusive while reporting
+
+    Replacement replacement_ { Replacement::Worst };
+    size_t selectionSize_ { 5 };   // NOLINT
+    size_t replacementSize_ { 5 }; // NOLINT
+
+    std::atomic<size_t> generation_{0};
+    std::atomic<size_t> produced_{0}; // children produced during the current call to Run
+    std::atomic<size_t> inserted_{0}; // children accepted into the population
+    bool initialized_{false};
+
+    auto Select(Operon::RandomGenerator& random) const -> size_t;
+    auto Victim(Operon::RandomGenerator& random) const -> size_t;
+    // the child is swapped with the victim, so the caller gets back the storage of the replaced individual
+    auto Insert(Operon::RandomGenerator& random, Individual& child) -> bool;
+
+public:
+    explicit SteadyStateGeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator);
+
+    [[nodiscard]] auto Parents() const -> Operon::Span<Individual const> { return { individuals_.data(), individuals_.size() }; }
+    [[nodiscard]] auto Parents() -> Operon::Span<Individual> { return { individuals_.data(), individuals_.size() }; }
+
+    [[nodiscard]] auto GetProblem() const -> const Problem& { return problem_.get(); }
+    [[nodiscard]] auto GetConfig() const -> const GeneticAlgorithmConfig& { return config_.get(); }
+
+    [[nodiscard]] auto GetTreeInitializer() const -> TreeInitializerBase const& { return treeInit_.get(); }
+    [[nodiscard]] auto GetCoefficientInitializer() const -> CoefficientInitializerBase const& { return coeffInit_.get(); }
+    [[nodiscard]] auto GetGenerator() const -> const OffspringGeneratorBase& { return generator_.get(); }
+
+    [[nodiscard]] auto Generation() const -> size_t { return generation_; }
+    [[nodiscard]] auto Inserted() const -> size_t { return inserted_; }
+
+    auto SetSelectionSize(size_t size) -> void { selectionSize_ = size; }
+    auto SetReplacement(Replacement replacement, size_t size = 5) -> void // NOLINT
+    {
+        replacement_ = replacement;
+        replacementSize_ = size;
+    }
+
+    auto Reset() -> void
+    {
+        generation_ = 0;
+        inserted_ = 0;
+        initialized_ = false;
+        generator_.get().Evaluator().Reset();
+    }
+
+    auto Run(tf::Executor& /*executor*/, Operon::RandomGenerator&/*rng*/, std::function<void()> /*report*/ = nullptr) -> void;
+    auto Run(Operon::RandomGenerator& /*rng*/, std::function<void()> /*report*/ = nullptr, size_t /*threads*/= 0) -> void;
+};
+} // namespace Operon
+
+#endif
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_ARENA_HPP
+#define OPERON_ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "operon/core/types.hpp"
+#include "operon/operon_export.hpp"
+
+namespace Operon {
+
+// monotonic bump allocator for short-lived scratch memory (e.g. the temporaries of a single evaluation)
+// memory is only reclaimed by rewinding to a marker or by resetting the arena; after a reset, the blocks
+// allocated so far are coalesced into one, such that a steady state workload does not allocate anymore
+class OPERON_EXPORT MonotonicArena {
+public:
+    static constexpr size_t DefaultBlockSize = 1UL << 16U; // 64 KiB
+    static constexpr size_t Alignment = 64;
+
+    struct Marker {
+        size_t Block;
+        size_t Offset;
+    };
+
+    explicit MonotonicArena(size_t initialSize = DefaultBlockSize);
+    ~MonotonicArena();
+
+    MonotonicArena(MonotonicArena const&) = delete;
+    MonotonicArena(MonotonicArena&&) = delete;
+    auto operator=(MonotonicArena const&) -> MonotonicArena& = delete;
+    auto operator=(MonotonicArena&&) -> MonotonicArena& = delete;
+
+    // default-initialized storage for n objects of type T (no destructors are run)
+    template <typename T>
+    auto Allocate(size_t n) -> Operon::Span<T>
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "The arena does not run destructors.");
+        static_assert(alignof(T) <= Alignment, "Over-aligned types are not supported.");
+        auto* ptr = static_cast<T*>(AllocateBytes(n * sizeof(T), alignof(T)));
+        if constexpr (!std::is_trivially_default_constructible_v<T>) {
+            std::uninitialized_default_construct_n(ptr, n);
+        }
+        return { ptr, n };
+    }
+
+    auto AllocateBytes(size_t bytes, size_t alignment) -> void*
+    {
+        auto& block = blocks_[current_];
+        auto const offset = (offset_ + alignment - 1) & ~(alignment - 1);
+        if (offset + bytes <= block.Size) {
+            offset_ = offset + bytes;
+            return block.Data + offset; // NOLINT
+        }
+        return AllocateSlow(bytes, alignment);
+    }
+
+    [[nodiscard]] auto Mark() const -> Marker { return { current_, offset_ }; }
+    auto Rewind(Marker marker) -> void
+    {
+        current_ = marker.Block;
+        offset_ = marker.Offset;
+    }
+
+    // releases everything; called once per individual by the evaluators
+    auto Reset() -> void;
+
+    [[nodiscard]] auto Capacity() const -> size_t;
+    [[nodiscard]] auto Blocks() const -> size_t { return blocks_.size(); }
+    [[nodiscard]] auto UpstreamAllocations() const -> size_t { return upstream_; }
+
+    // one arena per thread (i.e. per executor worker)
+    static auto ThreadLocal() -> MonotonicArena&;
+
+private:
+    struct Block {
+        std::byte* Data;
+        size_t Size;
+    };
+
+    auto AllocateSlow(size_t bytes, size_t alignment) -> void*;
+    auto NewBlock(size_t size) -> Block;
+
+    std::vector<Block> blocks_;
+    size_t current_ { 0 };
+    size_t offset_ { 0 };
+    size_t upstream_ { 0 }; // number of blocks requested from the system allocator
+};
+
+// rewinds the arena when going out of scope; the outermost scope resets it
+class ArenaScope {
+public:
+    explicit ArenaScope(MonotonicArena& arena)
+        : arena_(arena)
+        , marker_(arena.Mark())
+    {
+    }
+
+    ArenaScope()
+        : ArenaScope(MonotonicArena::ThreadLocal())
+    {
+    }
+
+    ~ArenaScope()
+    {
+        if (marker_.Block == 0 && marker_.Offset == 0) {
+            arena_.Reset();
+        } else {
+            arena_.Rewind(marker_);
+        }
+    }
+
+    ArenaScope(ArenaScope const&) = delete;
+    ArenaScope(ArenaScope&&) = delete;
+    auto operator=(ArenaScope const&) -> ArenaScope& = delete;
+    auto operator=(ArenaScope&&) -> ArenaScope& = delete;
+
+    [[nodiscard]] auto Arena() const -> MonotonicArena& { return arena_; }
+
+private:
+    MonotonicArena& arena_;
+    MonotonicArena::Marker marker_;
+};
+
+} // namespace Operon
+
+#endif
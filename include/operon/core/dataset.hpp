@@ -6,6 +6,7 @@
 
 #include <Eigen/Core>
 
+#include <cstdint>
 #include <optional>
 
 #include "operon/operon_export.hpp"
@@ -22,15 +23,20 @@ class OPERON_EXPORT Dataset {
 public:
     // some useful aliases
     using Matrix = Eigen::Array<Operon::Scalar, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor>;
-    using Map = Eigen::Map<Matrix const>;
+    // the map is strided so that it can view only the first Rows() rows of a buffer with spare capacity (see AppendRows)
+    using Stride = Eigen::OuterStride<>;
+    using Map = Eigen::Map<Matrix const, Eigen::Unaligned, Stride>;
 
 private:
     std::vector<Variable> variables_;
     Matrix values_;
     Map map_;
+    uint64_t version_ { NextVersion() };
 
     Dataset();
 
+    static auto NextVersion() -> uint64_t;
+
     // read data from a csv file and return a map (view of the data)
     auto ReadCsv(std::string const& path, bool hasHeader) -> Matrix;
 
@@ -44,7 +50,7 @@ public:
     Dataset(Dataset const& rhs)
         : variables_(rhs.variables_)
         , values_(rhs.values_)
-        , map_(values_.data(), values_.rows(), values_.cols())
+        , map_(rhs.IsView() ? rhs.map_.data() : values_.data(), rhs.map_.rows(), rhs.map_.cols(), Stride(rhs.map_.outerStride()))
     {
     }
 
@@ -57,7 +63,7 @@ public:
 
     Dataset(std::vector<Variable> vars, std::vector<std::vector<Operon::Scalar>> const& vals)
         : variables_(std::move(vars))
-        , map_(nullptr, static_cast<Eigen::Index>(vals[0].size()), static_cast<Eigen::Index>(vals.size()))
+        , map_(nullptr, static_cast<Eigen::Index>(vals[0].size()), static_cast<Eigen::Index>(vals.size()), Stride(static_cast<Eigen::Index>(vals[0].size())))
     {
         values_ = Matrix(map_.rows(), map_.cols());
 
@@ -65,7 +71,7 @@ public:
             auto m = Eigen::Map<Eigen::Matrix<Operon::Scalar, Eigen::Dynamic, 1, Eigen::ColMajor> const>(vals[static_cast<size_t>(i)].data(), map_.rows());
             values_.col(i) = m;
         }
-        new (&map_) Map(values_.data(), values_.rows(), values_.cols()); // we use placement new (no allocation)
+        new (&map_) Map(values_.data(), values_.rows(), values_.cols(), Stride(values_.rows())); // we use placement new (no allocation)
     }
 
     explicit Dataset(std::vector<std::vector<Operon::Scalar>> const& vals);
@@ -88,7 +94,7 @@ public:
         if (this != &rhs) {
             variables_ = std::move(rhs.variables_);
             values_ = std::move(rhs.values_);
-            new (&map_) Map(rhs.map_.data(), rhs.map_.rows(), rhs.map_.cols()); // we use placement new (no allocation)
+            new (&map_) Map(rhs.map_.data(), rhs.map_.rows(), rhs.map_.cols(), Stride(rhs.map_.outerStride())); // we use placement new (no allocation)
         }
         return *this;
     }
@@ -96,8 +102,10 @@ public:
     void Swap(Dataset& rhs) noexcept
     {
         variables_.swap(rhs.variables_);
-        values_.swap(rhs.values_);
-        new (&map_) Map(values_.data(), values_.rows(), values_.cols()); // we use placement new (no allocation)
+        values_.swap(rhs.values_); // swaps the underlying pointers, so the maps remain valid and only need to be exchanged
+        Map tmp(map_);
+        new (&map_) Map(rhs.map_); // we use placement new (no allocation)
+        new (&rhs.map_) Map(tmp);
     }
 
     auto operator==(Dataset const& rhs) const noexcept -> bool
@@ -107,18 +115,23 @@ public:
             Cols() == rhs.Cols() &&
             variables_.size() == rhs.variables_.size() &&
             std::equal(variables_.begin(), variables_.end(), rhs.variables_.begin()) &&
-            values_.isApprox(rhs.values_);
+            Values().isApprox(rhs.Values());
     }
 
     // check if we own the data or if we are a view over someone else's data
     [[nodiscard]] auto IsView() const noexcept -> bool { return values_.data() != map_.data(); }
 
     [[nodiscard]] auto Rows() const -> size_t { return static_cast<size_t>(map_.rows()); }
+    [[nodiscard]] auto Capacity() const -> size_t { return static_cast<size_t>(values_.rows()); }
     [[nodiscard]] auto Cols() const -> size_t { return static_cast<size_t>(map_.cols()); }
     [[nodiscard]] auto Dimensions() const -> std::pair<size_t, size_t> { return { Rows(), Cols() }; }
 
     [[nodiscard]] auto Values() const -> Eigen::Ref<Matrix const> { return map_; }
 
+    // changes whenever the contents or the storage of the dataset change (and is never shared by two datasets),
+    // so that data derived from it (e.g. cached cost functions) can tell whether it is still valid
+    [[nodiscard]] auto Version() const -> uint64_t { return version_; }
+
     auto VariableNames() -> std::vector<std::string>;
     void SetVariableNames(std::vector<std::string> const& names);
 
@@ -138,6 +151,19 @@ public:
 
     void PermuteRows(std::vector<Eigen::Index> const& indices);
 
+    // append rows at the end of the dataset (the columns of `rows` must follow the column order of the dataset)
+    // storage grows geometrically so that repeated appends have amortized constant cost per row
+    void AppendRows(Eigen::Ref<Matrix const> rows);
+    void AppendRows(std::vector<std::vector<Operon::Scalar>> const& cols);
+
+    // make room for at least `rows` rows without changing the contents of the dataset
+    void Reserve(size_t rows);
+
+    // returns a new dataset (with the same variables) containing only the given rows, in the given order
+    [[nodiscard]] auto Subset(Operon::Span<size_t const> rows) const -> Dataset;
+    // the same, but writes into an existing dataset whose storage is reused when it is large enough
+    void Subset(Operon::Span<size_t const> rows, Dataset& subset) const;
+
     // standardize column i using mean and stddev calculated over the specified range
     void Standardize(size_t i, Range range);
 };
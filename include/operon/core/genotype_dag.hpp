@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_GENOTYPE_DAG_HPP
+#define OPERON_GENOTYPE_DAG_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <robin_hood.h>
+#include <vector>
+
+#include "operon/core/node.hpp"
+#include "operon/core/tree.hpp"
+#include "operon/core/types.hpp"
+#include "operon/operon_export.hpp"
+
+namespace Operon {
+
+// hash-consed storage for the genotypes of a population: identical subtrees (by strict hash) are stored only once,
+// as vertices of a directed acyclic graph, and a genotype is just the id of its root vertex
+// - every vertex counts its references (from parent vertices and from roots), the vertices which are no longer
+//   referenced are released recursively
+// - a vertex is always created after its children, so the vertex ids are a topological order (the interpreter
+//   relies on it to evaluate every vertex once, see GenericInterpreter::Evaluate); the ids of released vertices are
+//   not reused until Compact is called
+// - the children of a commutative symbol keep the order of the first tree in which the subtree was inserted
+// the algorithms keep their genotypes in the individuals: the dag is used for evaluation only (see
+// Evaluator::SetDagEvaluation), callers wanting shared storage insert the genotypes themselves
+class OPERON_EXPORT GenotypeDag {
+public:
+    using Id = uint32_t;
+
+    struct Vertex {
+        Node Symbol;       // the subtree root (its length, depth etc. refer to the tree it was first inserted from)
+        size_t Children;   // offset of the child ids (Symbol.Arity of them) in the child array
+        size_t References; // zero for released vertices
+    };
+
+    // interns the tree (a copy of it is hashed in strict mode, the tree's own hash values are left as they are) and
+    // returns its root vertex with an additional reference
+    auto Insert(Tree const& tree) -> Id;
+
+    // drops one reference of the vertex, releasing it (and recursively its children) when no references remain
+    auto Release(Id id) -> void;
+
+    // the tree rooted at the vertex
+    [[nodiscard]] auto Materialize(Id id) const -> Tree;
+
+    // renumbers the live vertices, preserving their order, and updates the given roots accordingly
+    // (the other ids held by the caller become invalid)
+    auto Compact(Operon::Span<Id> roots) -> void;
+    auto Clear() -> void;
+
+    [[nodiscard]] auto Vertices() const -> Operon::Span<Vertex const> { return vertices_; }
+    [[nodiscard]] auto Children(Id id) const -> Operon::Span<Id const> { auto const& v = vertices_[id]; return { children_.data() + v.Children, v.Symbol.Arity }; }
+    [[nodiscard]] auto IsLive(Id id) const -> bool { return vertices_[id].References > 0; }
+
+    [[nodiscard]] auto Size() const -> size_t { return live_; }                           // number of live vertices
+    [[nodiscard]] auto Released() const -> size_t { return vertices_.size() - live_; }    // vertices waiting for Compact
+    [[nodiscard]] auto Find(Operon::Hash hash) const -> std::optional<Id>
+    {
+        auto it = index_.find(hash);
+        return it == index_.end() ? std::nullopt : std::optional<Id> { it->second };
+    }
+
+private:
+    auto Intern(Tree const& tree, size_t i) -> Id;
+
+    std::vector<Vertex> vertices_;
+    std::vector<Id> children_;
+    std::vector<Id> stack_; // scratch space for Intern and Release
+    Tree scratch_;          // the hashed copy of the tree being inserted
+    robin_hood::unordered_flat_map<Operon::Hash, Id> index_;
+    size_t live_ { 0 };
+};
+
+} // namespace Operon
+
+#endif
@@ -10,6 +10,11 @@
 #include <cstddef>
 #include <functional>
 
+#include "operon/operon_export.hpp"
+
+// forward declaration
+namespace tf { class Executor; class Subflow; class Task; }
+
 namespace Operon {
 
 struct LexicographicalComparison; // fwd def
@@ -29,6 +34,7 @@ struct Individual {
         : Individual(1)
     {
     }
+    // Individual(0) leaves the fitness empty, e.g. for a child whose fitness is moved in from the evaluator
     explicit Individual(size_t nObj)
         : Fitness(nObj, 0.0)
     {
@@ -91,6 +97,11 @@ struct CrowdedComparison {
 
 using ComparisonCallback = std::function<bool(Individual const&, Individual const&)>;
 
+// hashes the genotypes of a population in parallel (see Tree::Hash)
+// the subflow version appends the hashing task to the subflow and returns it
+OPERON_EXPORT auto HashPopulation(tf::Subflow& subflow, Operon::Span<Individual const> pop, Operon::HashMode mode) -> tf::Task;
+OPERON_EXPORT auto HashPopulation(tf::Executor& executor, Operon::Span<Individual const> pop, Operon::HashMode mode) -> void;
+
 } // namespace Operon
 
 #endif
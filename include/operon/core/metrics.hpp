@@ -0,0 +1,150 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_METRICS_HPP
+#define OPERON_METRICS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "operon/operon_export.hpp"
+
+// low-overhead runtime metrics: every thread records into its own counters and histograms,
+// which are only aggregated when a snapshot is requested (e.g. once per generation)
+namespace Operon::Metrics {
+
+enum class Counter : size_t {
+    Evaluations,                 // evaluator calls
+    NodeRows,                    // tree nodes x data rows processed by the evaluator
+    LocalOptimizationIterations, // nonlinear least squares iterations
+    GeneratorAttempts,           // offspring generator calls (including rejected offspring)
+    ArenaAllocations,            // blocks requested by the scratch memory arenas
+    Count
+};
+
+enum class Histogram : size_t {
+    EvaluationLatency, // nanoseconds per evaluator call
+    SelectionTime,     // nanoseconds per selection
+    ReinsertionTime,   // nanoseconds per reinsertion step
+    CostRatio,         // picoseconds of evaluation time per unit of predicted cost (see EvaluatorBase::Cost)
+    Count
+};
+
+constexpr auto CounterCount = static_cast<size_t>(Counter::Count);
+constexpr auto HistogramCount = static_cast<size_t>(Histogram::Count);
+
+[[nodiscard]] OPERON_EXPORT auto Name(Counter counter) -> std::string_view;
+[[nodiscard]] OPERON_EXPORT auto Name(Histogram histogram) -> std::string_view;
+
+// log-linear bucketing (as in HDR histograms): a value is binned by its most significant bit
+// and the SubBits bits that follow, which bounds the relative error to 2^-SubBits
+struct Buckets {
+    static constexpr size_t SubBits = 4;
+    static constexpr size_t SubBuckets = 1UL << SubBits;
+    static constexpr size_t Count = (64 - SubBits + 1) * SubBuckets;
+
+    static auto Index(uint64_t value) noexcept -> size_t
+    {
+        if (value < SubBuckets) {
+            return value;
+        }
+        auto const shift = MostSignificantBit(value) - SubBits;
+        return (shift + 1) * SubBuckets + ((value >> shift) & (SubBuckets - 1));
+    }
+
+    static auto LowerBound(size_t index) noexcept -> uint64_t
+    {
+        if (index < SubBuckets) {
+            return index;
+        }
+        auto const shift = index / SubBuckets - 1;
+        return (SubBuckets + index % SubBuckets) << shift;
+    }
+
+    static auto UpperBound(size_t index) noexcept -> uint64_t
+    {
+        return index + 1 < Count ? LowerBound(index + 1) - 1 : UINT64_MAX;
+    }
+
+private:
+    static auto MostSignificantBit(uint64_t value) noexcept -> size_t
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - static_cast<size_t>(__builtin_clzll(value));
+#else
+        size_t msb = 0;
+        while (value >>= 1U) { ++msb; }
+        return msb;
+#endif
+    }
+};
+
+struct OPERON_EXPORT HistogramSnapshot {
+    std::array<uint64_t, Buckets::Count> Values {};
+    uint64_t Count { 0 };
+    uint64_t Sum { 0 };
+
+    [[nodiscard]] auto Mean() const -> double;
+    [[nodiscard]] auto Quantile(double q) const -> double; // q in [0, 1]
+    [[nodiscard]] auto Max() const -> double;
+};
+
+struct OPERON_EXPORT Snapshot {
+    std::array<uint64_t, CounterCount> Counters {};
+    std::array<HistogramSnapshot, HistogramCount> Histograms {};
+
+    [[nodiscard]] auto operator[](Counter c) const -> uint64_t { return Counters[static_cast<size_t>(c)]; }
+    [[nodiscard]] auto operator[](Histogram h) const -> HistogramSnapshot const& { return Histograms[static_cast<size_t>(h)]; }
+
+    // difference between two snapshots, e.g. the activity of a single generation
+    [[nodiscard]] auto operator-(Snapshot const& other) const -> Snapshot;
+};
+
+OPERON_EXPORT auto Enabled() noexcept -> bool;
+OPERON_EXPORT auto SetEnabled(bool enabled) noexcept -> void;
+
+OPERON_EXPORT auto Add(Counter counter, uint64_t value = 1) noexcept -> void;
+OPERON_EXPORT auto Record(Histogram histogram, uint64_t value) noexcept -> void;
+
+// aggregates the metrics of all threads (including the ones that have already exited)
+OPERON_EXPORT auto Collect() -> Snapshot;
+// subsequent snapshots only report the activity after this call
+OPERON_EXPORT auto Reset() -> void;
+
+// records the lifetime of the object (in nanoseconds) into the given histogram
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Histogram histogram) noexcept
+        : histogram_(histogram)
+        , enabled_(Enabled())
+    {
+        if (enabled_) {
+            start_ = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        if (enabled_) {
+            auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_);
+            Record(histogram_, static_cast<uint64_t>(elapsed.count()));
+        }
+    }
+
+    ScopedTimer(ScopedTimer const&) = delete;
+    ScopedTimer(ScopedTimer&&) = delete;
+    auto operator=(ScopedTimer const&) -> ScopedTimer& = delete;
+    auto operator=(ScopedTimer&&) -> ScopedTimer& = delete;
+
+private:
+    Histogram histogram_;
+    bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+} // namespace Operon::Metrics
+
+#endif
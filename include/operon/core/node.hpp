@@ -6,6 +6,9 @@
 
 #include "operon/operon_export.hpp"
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
 #include <type_traits>
 #include "types.hpp"
 #include <bitset>
@@ -190,6 +193,83 @@ struct Node {
     [[nodiscard]] inline auto IsSquare() const -> bool { return Is<NodeType::Square>(); }
     [[nodiscard]] inline auto IsDynamic() const -> bool { return Is<NodeType::Dynamic>(); }
 };
+
+// the part of a node needed by the inner loops of the interpreter (at most 16 bytes instead of the 48 of a Node)
+// the hashes and the remaining structural fields (depth, level, parent) stay in the Node
+struct CompactNode {
+    Operon::Scalar Value;
+    uint16_t Arity;
+    uint16_t Length;
+    uint8_t Type; // index of the node type (see NodeTypes::GetIndex)
+    bool Optimize;
+
+    CompactNode() = default;
+
+    explicit CompactNode(Node const& node) noexcept
+        : Value(node.Value)
+        , Arity(node.Arity)
+        , Length(node.Length)
+        , Type(static_cast<uint8_t>(NodeTypes::GetIndex(node.Type)))
+        , Optimize(node.Optimize)
+    {
+    }
+
+    [[nodiscard]] inline auto GetType() const -> NodeType { return static_cast<NodeType>(1U << Type); }
+    [[nodiscard]] inline auto IsLeaf() const noexcept -> bool { return Arity == 0; }
+    [[nodiscard]] inline auto IsConstant() const -> bool { return GetType() == NodeType::Constant; }
+    [[nodiscard]] inline auto IsVariable() const -> bool { return GetType() == NodeType::Variable; }
+};
+static_assert(sizeof(CompactNode) <= 16); // NOLINT
+static_assert(std::is_trivially_copyable_v<CompactNode>);
+
+namespace detail {
+    // the storage of the node vectors (see std::allocator<Operon::Node> below): on the heap, unless a node arena
+    // is packing a population on the calling thread (see NodeArena)
+    OPERON_EXPORT auto AllocateNodes(size_t n) -> Node*;
+    OPERON_EXPORT auto DeallocateNodes(Node* p) noexcept -> void;
+} // namespace detail
 } // namespace Operon
+
+// the node vectors (e.g. the storage of a tree) stay plain std::vector<Node>s with a stateless allocator, so that
+// trees keep their size and are moved and swapped without copying; the nodes can nevertheless be placed in the node
+// arena of a population, which is done only by NodeArena::Pack for the genotypes of the arena's owner
+namespace std {
+template <>
+class allocator<Operon::Node> { // NOLINT
+public:
+    using value_type = Operon::Node; // NOLINT
+    using pointer = Operon::Node*; // NOLINT
+    using const_pointer = Operon::Node const*; // NOLINT
+    using reference = Operon::Node&; // NOLINT
+    using const_reference = Operon::Node const&; // NOLINT
+    using size_type = std::size_t; // NOLINT
+    using difference_type = std::ptrdiff_t; // NOLINT
+    using propagate_on_container_move_assignment = std::true_type; // NOLINT
+    using is_always_equal = std::true_type; // NOLINT
+
+    template <typename U>
+    struct rebind { // NOLINT
+        using other = std::allocator<U>; // NOLINT
+    };
+
+    allocator() noexcept = default;
+    template <typename U>
+    allocator(std::allocator<U> const& /*unused*/) noexcept { } // NOLINT
+
+    [[nodiscard]] auto allocate(std::size_t n) -> Operon::Node* { return Operon::detail::AllocateNodes(n); } // NOLINT
+    [[nodiscard]] auto allocate(std::size_t n, void const* /*hint*/) -> Operon::Node* { return Operon::detail::AllocateNodes(n); } // NOLINT
+    auto deallocate(Operon::Node* p, std::size_t /*n*/) noexcept -> void { Operon::detail::DeallocateNodes(p); } // NOLINT
+
+    [[nodiscard]] auto max_size() const noexcept -> std::size_t { return std::numeric_limits<std::size_t>::max() / (2 * sizeof(Operon::Node)); } // NOLINT
+
+    template <typename U, typename... Args>
+    auto construct(U* p, Args&&... args) -> void { ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...); } // NOLINT
+    template <typename U>
+    auto destroy(U* p) -> void { p->~U(); } // NOLINT
+
+    friend auto operator==(allocator const& /*lhs*/, allocator const& /*rhs*/) noexcept -> bool { return true; }
+    friend auto operator!=(allocator const& /*lhs*/, allocator const& /*rhs*/) noexcept -> bool { return false; }
+};
+} // namespace std
 #endif
 
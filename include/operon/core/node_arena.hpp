@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_NODE_ARENA_HPP
+#define OPERON_NODE_ARENA_HPP
+
+#include <array>
+#include <cstddef>
+
+#include "operon/core/individual.hpp"
+#include "operon/core/node.hpp"
+#include "operon/core/types.hpp"
+#include "operon/operon_export.hpp"
+
+namespace Operon {
+
+// contiguous storage for the genotypes of a population owned by an algorithm (see GeneticAlgorithmConfig::UseNodeArena),
+// made of two buffers used in turns
+// - Pack copies the genotypes back to back into the other buffer, which becomes the active one; the previous buffer
+//   holds nothing anymore afterwards and is reused (grown if needed) by the next Pack
+// - in between, a child written into a packed genotype (e.g. an offspring slot) reuses its storage when it fits,
+//   otherwise it goes to the heap like any other tree until it is packed
+// - the trees are plain std::vector<Node>s (see std::allocator<Operon::Node>): copies of a packed tree are allocated on
+//   the heap, but its storage must not be moved or swapped into a tree which outlives the next Pack without being
+//   packed itself (e.g. the thread-local broods of the generators, see Stored)
+// the arena must outlive the individuals it packed
+class OPERON_EXPORT NodeArena {
+public:
+    NodeArena() = default;
+    ~NodeArena();
+
+    NodeArena(NodeArena const&) = delete;
+    NodeArena(NodeArena&&) = delete;
+    auto operator=(NodeArena const&) -> NodeArena& = delete;
+    auto operator=(NodeArena&&) -> NodeArena& = delete;
+
+    auto Pack(Operon::Span<Individual> pop) -> void;
+
+    // whether the nodes are stored in a node arena (i.e. they belong to a packed population)
+    [[nodiscard]] static auto Stored(Operon::Vector<Node> const& nodes) noexcept -> bool;
+
+    // whether the nodes are stored in the active buffer
+    [[nodiscard]] auto Owns(Node const* p) const noexcept -> bool { return buffers_[active_].Contains(p); }
+
+    [[nodiscard]] auto Capacity() const -> size_t { return buffers_[0].Capacity + buffers_[1].Capacity; } // in bytes
+    [[nodiscard]] auto Used() const -> size_t { return buffers_[active_].Used; } // in bytes
+    [[nodiscard]] auto Reallocations() const -> size_t { return reallocations_; }
+
+private:
+    friend auto detail::AllocateNodes(size_t n) -> Node*;
+
+    auto Allocate(size_t n) -> Node*;
+
+    struct Buffer {
+        std::byte* Data { nullptr };
+        size_t Capacity { 0 };
+        size_t Used { 0 };
+
+        [[nodiscard]] auto Contains(void const* p) const noexcept -> bool
+        {
+            auto const* b = static_cast<std::byte const*>(p);
+            return b != nullptr && Data != nullptr && b >= Data && b < Data + Capacity; // NOLINT
+        }
+    };
+
+    std::array<Buffer, 2> buffers_;
+    size_t active_ { 0 };
+    size_t reallocations_ { 0 };
+};
+
+} // namespace Operon
+
+#endif
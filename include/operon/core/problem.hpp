@@ -56,6 +56,27 @@ public:
         return *this;
     }
 
+    // sliding-window training: the training range spans (at most) the `size` most recent rows of the dataset
+    // a size of zero disables the window and the training range is left as-is
+    auto TrainingWindow(size_t size) -> Problem& {
+        window_ = size;
+        if (window_ > 0) {
+            SlideTrainingWindow();
+        }
+        return *this;
+    }
+
+    // move the training window to the end of the dataset (typically after rows were appended)
+    // returns the previous training range, so that the caller can determine the added and evicted rows
+    auto SlideTrainingWindow() -> Range {
+        auto previous = training_;
+        if (window_ > 0) {
+            auto const end = dataset_.Rows();
+            training_ = Range{end - std::min(window_, end), end};
+        }
+        return previous;
+    }
+
     auto TestRange(Range range) -> Problem& {
         test_ = range;
         return *this;
@@ -92,6 +113,7 @@ public:
     }
 
     [[nodiscard]] auto TrainingRange() const -> Range { return training_; }
+    [[nodiscard]] auto TrainingWindow() const -> size_t { return window_; }
     [[nodiscard]] auto TestRange() const -> Range { return test_; }
     [[nodiscard]] auto ValidationRange() const -> Range { return validation_; }
 
@@ -123,6 +145,7 @@ private:
     Range training_;
     Range test_;
     Range validation_;
+    size_t window_{0};
     Variable target_;
     std::vector<Variable> inputVariables_;
 };
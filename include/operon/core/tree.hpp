@@ -80,6 +80,19 @@ private:
 
 class OPERON_EXPORT Tree { // NOLINT
 public:
+    // what the calculated hash values of the nodes are valid for: the mode of the last hashing (none if the nodes may have
+    // changed since), except for the nodes [EditBegin, EditEnd) and their ancestors which were edited in the meantime
+    // - the tree forgets the mode whenever it hands out mutable access to its nodes, so an operator editing them keeps
+    //   the state it had before (or inherits the state of the tree it copied the nodes from) and records its edit, see
+    //   SetHashState, Edited and UpdateNodes(begin, end, replaced)
+    struct HashState {
+        std::optional<Operon::HashMode> Mode;
+        size_t EditBegin { 0 };
+        size_t EditEnd { 0 };
+
+        [[nodiscard]] auto Clean() const -> bool { return Mode.has_value() && EditBegin == EditEnd; }
+    };
+
     Tree() = default;
     Tree(std::initializer_list<Node> list)
         : nodes_(list)
@@ -91,10 +104,12 @@ public:
     }
     Tree(Tree const& rhs) // NOLINT
         : nodes_(rhs.nodes_)
+        , hashState_(rhs.hashState_)
     {
     }
     Tree(Tree&& rhs) noexcept
         : nodes_(std::move(rhs.nodes_))
+        , hashState_(rhs.hashState_)
     {
     }
 
@@ -110,9 +125,14 @@ public:
     friend void Swap(Tree& lhs, Tree& rhs) noexcept
     {
         std::swap(lhs.nodes_, rhs.nodes_);
+        std::swap(lhs.hashState_, rhs.hashState_);
     }
 
     auto UpdateNodes() -> Tree&;
+    // same as UpdateNodes, after a local edit: the nodes [begin, end) form a complete subtree which took the place of
+    // a subtree of `replaced` nodes; only the new subtree and its ancestors are recomputed, while the parent indices
+    // of the other nodes behind the edit are shifted in place (the nodes in front of it are not touched)
+    auto UpdateNodes(size_t begin, size_t end, size_t replaced) -> Tree&;
     auto Sort() -> Tree&;
     auto Reduce() -> Tree&;
     auto Simplify() -> Tree&;
@@ -120,6 +140,21 @@ public:
     // performs hashing in a manner similar to Merkle trees
     // aggregating hash values from the leafs towards the root node
     [[nodiscard]] auto Hash(Operon::HashMode mode) const -> Tree const&;
+    // incremental version: rehashes the nodes [begin, end) and then their ancestors, while the hash values of all the
+    // other nodes are reused as they are; they must therefore be valid for the same mode, which is the case for nodes
+    // copied by a variation operator from parents hashed with that mode (as long as their coefficients did not change)
+    // - after crossover, only the ancestors of the swapped-in subtree need rehashing, e.g. Hash(mode, i, i + 1) for its root i
+    // - after a mutation which created new nodes, [begin, end) is the mutated subtree
+    [[nodiscard]] auto Hash(Operon::HashMode mode, size_t begin, size_t end) const -> Tree const&;
+    // rehashes what changed since the tree was last hashed with the mode (with the incremental version, see HashState),
+    // or the whole tree when its hash values are not valid for the mode
+    [[nodiscard]] auto Rehash(Operon::HashMode mode) const -> Tree const&;
+
+    [[nodiscard]] auto GetHashState() const -> HashState const& { return hashState_; }
+    auto SetHashState(HashState state) -> Tree& { hashState_ = state; return *this; }
+    // records that the nodes [begin, end) were changed in place (e.g. by a point mutation); for edits which change the
+    // number of nodes, UpdateNodes(begin, end, replaced) records the edit itself
+    auto Edited(size_t begin, size_t end) -> Tree&;
 
     [[nodiscard]] auto Subtree(size_t i) const -> Tree {
         EXPECT(i < Length());
@@ -136,19 +171,21 @@ public:
         }
     }
 
-    auto Nodes() & -> Operon::Vector<Node>& { return nodes_; }
-    auto Nodes() && -> Operon::Vector<Node>&& { return std::move(nodes_); }
+    auto Nodes() & -> Operon::Vector<Node>& { hashState_ = {}; return nodes_; }
+    auto Nodes() && -> Operon::Vector<Node>&& { hashState_ = {}; return std::move(nodes_); }
     [[nodiscard]] auto Nodes() const& -> Operon::Vector<Node> const& { return nodes_; }
 
-    [[nodiscard]] inline auto CoefficientsCount() const
+    [[nodiscard]] inline auto CoefficientsCount() const -> size_t
     {
-        return std::count_if(nodes_.cbegin(), nodes_.cend(), [](auto const& s) { return s.IsLeaf(); });
+        return static_cast<size_t>(std::count_if(nodes_.cbegin(), nodes_.cend(), [](auto const& s) { return s.Optimize; }));
     }
 
     void SetCoefficients(Operon::Span<Operon::Scalar const> coefficients);
     [[nodiscard]] auto GetCoefficients() const -> std::vector<Operon::Scalar>;
+    // writes the coefficients into a caller-provided buffer of size CoefficientsCount()
+    void GetCoefficients(Operon::Span<Operon::Scalar> coefficients) const;
 
-    inline auto operator[](size_t i) noexcept -> Node& { return nodes_[i]; }
+    inline auto operator[](size_t i) noexcept -> Node& { hashState_ = {}; return nodes_[i]; }
     inline auto operator[](size_t i) const noexcept -> Node const& { return nodes_[i]; }
 
     [[nodiscard]] auto Length() const noexcept -> size_t { return nodes_.size(); }
@@ -158,11 +195,12 @@ public:
 
     [[nodiscard]] auto HashValue() const -> Operon::Hash { return nodes_.empty() ? 0 : nodes_.back().CalculatedHashValue; }
 
-    auto Children(size_t i) -> SubtreeIterator<Tree> { return SubtreeIterator(*this, i); }
+    auto Children(size_t i) -> SubtreeIterator<Tree> { hashState_ = {}; return SubtreeIterator(*this, i); }
     [[nodiscard]] auto Children(size_t i) const -> SubtreeIterator<Tree const> { return SubtreeIterator(*this, i); }
 
 private:
     Operon::Vector<Node> nodes_;
+    mutable HashState hashState_;
 };
 } // namespace Operon
 #endif // TREE_H
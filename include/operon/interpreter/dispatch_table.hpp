@@ -36,8 +36,8 @@ namespace detail {
     // 1) improved performance: the naive method accumulates into the result for each argument, leading to unnecessary assignments
     // 2) minimizing the number of intermediate steps which might improve floating point accuracy of some operations
     //    if arity > 4, one accumulation is performed every 4 args
-    template<NodeType Type, typename T>
-    inline void DispatchOpNary(Operon::Vector<Array<T>>& m, Operon::Vector<Node> const& nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
+    template<NodeType Type, typename T, typename N = Node>
+    inline void DispatchOpNary(Operon::Span<Array<T>> m, Operon::Span<N const> nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
     {
         static_assert(Type < NodeType::Aq);
         auto result = Ref<T>(m[parentIndex]);
@@ -91,15 +91,15 @@ namespace detail {
         }
     }
 
-    template<NodeType Type, typename T>
-    inline void DispatchOpUnary(Operon::Vector<Array<T>>& m, Operon::Vector<Node> const& /*unused*/, size_t i, Operon::Range /* not used here - provided for dynamic symbols */)
+    template<NodeType Type, typename T, typename N = Node>
+    inline void DispatchOpUnary(Operon::Span<Array<T>> m, Operon::Span<N const> /*unused*/, size_t i, Operon::Range /* not used here - provided for dynamic symbols */)
     {
         static_assert(Type < NodeType::Dynamic && Type > NodeType::Pow);
         Function<Type>{}(Ref<T>(m[i]), Ref<T>(m[i-1]));
     }
 
-    template<NodeType Type, typename T>
-    inline void DispatchOpBinary(Operon::Vector<Array<T>>& m, Operon::Vector<Node> const& nodes, size_t i, Operon::Range /* not used here - provided for dynamic symbols */)
+    template<NodeType Type, typename T, typename N = Node>
+    inline void DispatchOpBinary(Operon::Span<Array<T>> m, Operon::Span<N const> nodes, size_t i, Operon::Range /* not used here - provided for dynamic symbols */)
     {
         static_assert(Type < NodeType::Abs && Type > NodeType::Fmax);
         auto j = i - 1;
@@ -107,8 +107,8 @@ namespace detail {
         Function<Type>{}(Ref<T>(m[i]), Ref<T>(m[j]), Ref<T>(m[k]));
     }
 
-    template<NodeType Type, typename T>
-    inline void DispatchOpSimpleUnaryOrBinary(Operon::Vector<Array<T>>& m, Operon::Vector<Node> const& nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
+    template<NodeType Type, typename T, typename N = Node>
+    inline void DispatchOpSimpleUnaryOrBinary(Operon::Span<Array<T>> m, Operon::Span<N const> nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
     {
         auto r = Ref<T>(m[parentIndex]);
         size_t i = parentIndex - 1;
@@ -124,8 +124,8 @@ namespace detail {
         }
     }
 
-    template<NodeType Type, typename T>
-    inline void DispatchOpSimpleNary(Operon::Vector<Array<T>>& m, Operon::Vector<Node> const& nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
+    template<NodeType Type, typename T, typename N = Node>
+    inline void DispatchOpSimpleNary(Operon::Span<Array<T>> m, Operon::Span<N const> nodes, size_t parentIndex, Operon::Range /* not used here - provided for dynamic symbols */)
     {
         auto r = Ref<T>(m[parentIndex]);
         size_t arity = nodes[parentIndex].Arity;
@@ -166,50 +166,71 @@ namespace detail {
         static constexpr int64_t value = FindIdx(std::index_sequence_for<T...>{});
     };
 
-    template<typename T>
-    using Callable = typename std::function<void(Operon::Vector<Array<T>>&, Operon::Vector<Node> const&, size_t, Operon::Range)>;
+    // the callables receive the nodes of the tree (N = Node); the interpreter prefers the ones which also accept
+    // the compact nodes (N = CompactNode) of its inner loop, which is the case for all the built-in symbols
+    template<typename T, typename N = Node>
+    using Callable = typename std::function<void(Operon::Span<Array<T>>, Operon::Span<N const>, size_t, Operon::Range)>;
+
+    template<typename F, typename N, typename... Ts>
+    inline constexpr bool IsCallable = (std::is_invocable_r_v<void, F, Operon::Span<detail::Array<Ts>>, Operon::Span<N const>, size_t, Operon::Range> && ...);
 
-    template<NodeType Type, typename T>
-    static constexpr auto MakeCall() -> Callable<T>
+    template<NodeType Type, typename T, typename N>
+    static constexpr auto MakeCall() -> Callable<T, N>
     {
         if constexpr (Type < NodeType::Aq) { // nary: add, sub, mul, div, fmin, fmax
-            return Callable<T>(detail::DispatchOpNary<Type, T>);
+            return Callable<T, N>(detail::DispatchOpNary<Type, T, N>);
         } else if constexpr (Type < NodeType::Abs) { // binary: aq, pow
-            return Callable<T>(detail::DispatchOpBinary<Type, T>);
+            return Callable<T, N>(detail::DispatchOpBinary<Type, T, N>);
         } else if constexpr (Type < NodeType::Dynamic) { // unary: exp, log, sin, cos, tan, tanh, sqrt, cbrt, square
-            return Callable<T>(detail::DispatchOpUnary<Type, T>);
+            return Callable<T, N>(detail::DispatchOpUnary<Type, T, N>);
         }
     }
 
-    template<NodeType Type, typename... Ts, std::enable_if_t<sizeof...(Ts) != 0, bool> = true>
+    template<NodeType Type, typename N, typename... Ts, std::enable_if_t<sizeof...(Ts) != 0, bool> = true>
     static constexpr auto MakeTuple()
     {
-        return std::make_tuple(MakeCall<Type, Ts>()...);
+        return std::make_tuple(MakeCall<Type, Ts, N>()...);
     };
 
-    template<typename F, typename... Ts, std::enable_if_t<sizeof...(Ts) != 0 && (std::is_invocable_r_v<void, F, detail::Array<Ts>&, Vector<Node> const&, size_t, Operon::Range> && ...), bool> = true>
+    template<typename N, typename F, typename... Ts, std::enable_if_t<sizeof...(Ts) != 0 && IsCallable<F, N, Ts...>, bool> = true>
     static constexpr auto MakeTuple(F&& f)
     {
-        return std::make_tuple(Callable<Ts>(std::forward<F&&>(f))...);
+        return std::make_tuple(Callable<Ts, N>(std::forward<F&&>(f))...);
     }
 } // namespace detail
 
 template<typename... Ts>
 struct DispatchTable {
-    template<typename T>
-    using Callable = detail::Callable<T>;
+    template<typename T, typename N = Node>
+    using Callable = detail::Callable<T, N>;
 
-    using Tuple    = std::tuple<Callable<Ts>...>;
-    using Map      = robin_hood::unordered_flat_map<Operon::Hash, Tuple>;
+    template<typename N = Node>
+    using Tuple    = std::tuple<Callable<Ts, N>...>;
+
+    template<typename N = Node>
+    using Map      = robin_hood::unordered_flat_map<Operon::Hash, Tuple<N>>;
 
 private:
-    Map map_;
+    Map<Node> map_;
+    Map<CompactNode> compact_; // the subset of map_ which can be called with compact nodes
 
     template<std::size_t... Is>
     void InitMap(std::index_sequence<Is...> /*unused*/)
     {
         auto f = [](auto i) { return static_cast<NodeType>(1U << i); };
-        (map_.insert({ Node(f(Is)).HashValue, detail::MakeTuple<f(Is), Ts...>() }), ...);
+        (map_.insert({ Node(f(Is)).HashValue, detail::MakeTuple<f(Is), Node, Ts...>() }), ...);
+        (compact_.insert({ Node(f(Is)).HashValue, detail::MakeTuple<f(Is), CompactNode, Ts...>() }), ...);
+    }
+
+    template<typename N>
+    [[nodiscard]] auto GetMap() const -> Map<N> const&
+    {
+        static_assert(std::is_same_v<N, Node> || std::is_same_v<N, CompactNode>, "The callables accept either Node or CompactNode.");
+        if constexpr (std::is_same_v<N, Node>) {
+            return map_;
+        } else {
+            return compact_;
+        }
     }
 
 public:
@@ -223,51 +244,80 @@ public:
     auto operator=(DispatchTable const& other) -> DispatchTable& {
         if (this != &other) {
             map_ = other.map_;
+            compact_ = other.compact_;
         }
         return *this;
     }
 
     auto operator=(DispatchTable&& other) noexcept -> DispatchTable& {
         map_ = std::move(other.map_);
+        compact_ = std::move(other.compact_);
         return *this;
     }
 
-    DispatchTable(DispatchTable const& other) : map_(other.map_) { }
-    DispatchTable(DispatchTable &&other) noexcept : map_(std::move(other.map_)) { }
+    DispatchTable(DispatchTable const& other) : map_(other.map_), compact_(other.compact_) { }
+    DispatchTable(DispatchTable &&other) noexcept : map_(std::move(other.map_)), compact_(std::move(other.compact_)) { }
 
-    template<typename T>
-    inline auto Get(Operon::Hash const h) -> Callable<T>&
+    // the returned callable may be overwritten, so the interpreter stops using the compact version of a node callable
+    template<typename T, typename N = Node>
+    inline auto Get(Operon::Hash const h) -> Callable<T, N>&
     {
-        return const_cast<Callable<T>&>(const_cast<DispatchTable<Ts...> const*>(*this)->Get(h)); // NOLINT
+        if constexpr (std::is_same_v<N, Node>) {
+            if (map_.contains(h)) { compact_.erase(h); }
+        }
+        return const_cast<Callable<T, N>&>(const_cast<DispatchTable<Ts...> const*>(this)->template Get<T, N>(h)); // NOLINT
     }
 
-    template<typename T>
-    [[nodiscard]] inline auto Get(Operon::Hash const h) const -> Callable<T> const&
+    template<typename T, typename N = Node>
+    [[nodiscard]] inline auto Get(Operon::Hash const h) const -> Callable<T, N> const&
     {
-        constexpr int64_t idx = detail::tuple_index<Callable<T>, Tuple>::value;
+        constexpr int64_t idx = detail::tuple_index<Callable<T, N>, Tuple<N>>::value;
         static_assert(idx >= 0, "Tuple does not contain type T");
-        if (auto it = map_.find(h); it != map_.end()) {
+        auto const& map = GetMap<N>();
+        if (auto it = map.find(h); it != map.end()) {
             return std::get<static_cast<size_t>(idx)>(it->second);
         }
         throw std::runtime_error(fmt::format("Hash value {} is not in the map\n", h));
     }
 
+    // f must accept the nodes of the tree; if it also accepts the compact nodes (e.g. a generic lambda which only
+    // reads the arity and length), the interpreter calls it with those
     template<typename F>
     void RegisterCallable(Operon::Hash hash, F&& f) {
-        map_[hash] = detail::MakeTuple<F, Ts...>(std::forward<F&&>(f));
+        static_assert(detail::IsCallable<F, Node, Ts...>, "The callable must accept a span of nodes.");
+        if constexpr (detail::IsCallable<F, CompactNode, Ts...>) {
+            compact_[hash] = detail::MakeTuple<CompactNode, F, Ts...>(f);
+        } else {
+            compact_.erase(hash);
+        }
+        map_[hash] = detail::MakeTuple<Node, F, Ts...>(std::forward<F&&>(f));
     }
 
-    template<typename T>
-    [[nodiscard]] inline auto TryGet(Operon::Hash const h) const noexcept -> std::optional<Callable<T>>
+    template<typename T, typename N = Node>
+    [[nodiscard]] inline auto TryGet(Operon::Hash const h) const noexcept -> std::optional<Callable<T, N>>
     {
-        constexpr int64_t idx = detail::tuple_index<Callable<T>, Tuple>::value;
+        constexpr int64_t idx = detail::tuple_index<Callable<T, N>, Tuple<N>>::value;
         static_assert(idx >= 0, "Tuple does not contain type T");
-        if (auto it = map_.find(h); it != map_.end()) {
+        auto const& map = GetMap<N>();
+        if (auto it = map.find(h); it != map.end()) {
             return { std::get<static_cast<size_t>(idx)>(it->second) };
         }
         return {};
     }
 
+    // non-owning lookup, returns nullptr if the hash is not in the map
+    template<typename T, typename N = Node>
+    [[nodiscard]] inline auto Find(Operon::Hash const h) const noexcept -> Callable<T, N> const*
+    {
+        constexpr int64_t idx = detail::tuple_index<Callable<T, N>, Tuple<N>>::value;
+        static_assert(idx >= 0, "Tuple does not contain type T");
+        auto const& map = GetMap<N>();
+        if (auto it = map.find(h); it != map.end()) {
+            return &std::get<static_cast<size_t>(idx)>(it->second);
+        }
+        return nullptr;
+    }
+
     [[nodiscard]] auto Contains(Operon::Hash hash) const noexcept -> bool { return map_.contains(hash); }
 };
 
@@ -8,8 +8,10 @@
 #include <optional>
 #include <utility>
 
+#include "operon/core/arena.hpp"
 #include "operon/core/dataset.hpp"
 #include "operon/core/dual.hpp"
+#include "operon/core/genotype_dag.hpp"
 #include "operon/core/tree.hpp"
 #include "operon/core/types.hpp"
 #include "dispatch_table.hpp"
@@ -57,40 +59,60 @@ struct GenericInterpreter {
 
     template <typename T>
     void Evaluate(Tree const& tree, Dataset const& dataset, Range const range, Operon::Span<T> result, T const* const parameters = nullptr) const noexcept
+    {
+        Evaluate<T>(Operon::Span<Node const>(tree.Nodes()), dataset, range, result, parameters);
+    }
+
+    // evaluate a tree given by its nodes in postfix order
+    template <typename T>
+    auto Evaluate(Operon::Span<Node const> nodes, Dataset const& dataset, Range const range, T const* const parameters = nullptr) const noexcept -> Operon::Vector<T>
+    {
+        Operon::Vector<T> result(range.Size());
+        Evaluate<T>(nodes, dataset, range, Operon::Span<T>(result), parameters);
+        return result;
+    }
+
+    template <typename T>
+    void Evaluate(Operon::Span<Node const> nodes, Dataset const& dataset, Range const range, Operon::Span<T> result, T const* const parameters = nullptr) const noexcept
     {
         using Callable = typename DTable::template Callable<T>;
-        const auto& nodes = tree.Nodes();
+        using CompactCallable = typename DTable::template Callable<T, CompactNode>;
         EXPECT(!nodes.empty());
 
+        // the intermediate buffers are scratch memory drawn from the current thread's arena
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+
         constexpr int S = static_cast<Eigen::Index>(detail::BatchSize<T>::Value);
-        Operon::Vector<detail::Array<T>> m(nodes.size());
+        auto m = arena.template Allocate<detail::Array<T>>(nodes.size());
         Eigen::Map<Eigen::Array<T, -1, 1>> res(result.data(), result.size(), 1);
 
         struct NodeMeta {
             T Param;
-            Eigen::Map<Eigen::Array<Operon::Scalar, -1, 1> const> Values;
-            std::optional<Callable const> Func;
-
-            NodeMeta(T param, decltype(Values) values, decltype(Func) func)
-                : Param(param), Values(values), Func(func)
-            {
-            }
+            Operon::Scalar const* Values;
+            CompactCallable const* Compact;
+            Callable const* Func; // only if there is no compact callable
         };
 
-        Operon::Vector<NodeMeta> meta; meta.reserve(nodes.size());
+        auto meta = arena.template Allocate<NodeMeta>(nodes.size());
+
+        // the row loop below only touches the compact nodes, the full nodes (hashes etc.) are only read here
+        auto code = arena.template Allocate<CompactNode>(nodes.size());
 
         size_t idx = 0;
         for (size_t i = 0; i < nodes.size(); ++i) {
             auto const& n = nodes[i];
+            code[i] = CompactNode(n);
 
             const auto *ptr = n.IsVariable() ? dataset.GetValues(n.HashValue).subspan(range.Start(), range.Size()).data() : nullptr;
-            const auto sz = ptr ? range.Size() : 0UL;
-            meta.emplace_back(
+            const auto *compact = ftable_.template Find<T, CompactNode>(n.HashValue);
+            meta[i] = NodeMeta {
                 (parameters && n.Optimize) ? parameters[idx++] : T{n.Value},
-                decltype(NodeMeta::Values)(ptr, static_cast<int64_t>(sz)),
-                ftable_.template TryGet<T>(n.HashValue)
-            );
-            if (n.IsConstant()) { m[i].setConstant(meta.back().Param); }
+                ptr,
+                compact,
+                compact == nullptr ? ftable_.template Find<T>(n.HashValue) : nullptr
+            };
+            if (n.IsConstant()) { m[i].setConstant(meta[i].Param); }
         }
 
         int numRows = static_cast<int>(range.Size());
@@ -98,13 +120,15 @@ struct GenericInterpreter {
             auto remainingRows = std::min(S, numRows - row);
             Operon::Range rg(range.Start() + row, range.Start() + row + remainingRows);
 
-            for (size_t i = 0; i < nodes.size(); ++i) {
-                auto const& s = nodes[i];
-                auto const& [ param, values, func ] = meta[i];
-                if (func) {
-                    std::invoke(func.value(), m, nodes, i, rg);
-                } else if (s.IsVariable()) {
-                    m[i].segment(0, remainingRows) = meta[i].Param * values.segment(row, remainingRows).template cast<T>();
+            for (size_t i = 0; i < code.size(); ++i) {
+                auto const& [ param, values, compact, func ] = meta[i];
+                if (compact != nullptr) {
+                    std::invoke(*compact, m, Operon::Span<CompactNode const>(code), i, rg);
+                } else if (func != nullptr) {
+                    std::invoke(*func, m, nodes, i, rg);
+                } else if (values != nullptr) { // variable
+                    Eigen::Map<Eigen::Array<Operon::Scalar, -1, 1> const> v(values + row, remainingRows); // NOLINT
+                    m[i].segment(0, remainingRows) = param * v.template cast<T>();
                 }
             }
             // the final result is found in the last section of the buffer corresponding to the root node
@@ -112,6 +136,104 @@ struct GenericInterpreter {
         }
     }
 
+    // evaluate the genotypes stored in a dag, given by their root vertices; root k is written to
+    // result[k * range.Size(), (k + 1) * range.Size())
+    // every live vertex of the dag is computed once per row block, in topological (id) order: the arguments of a
+    // vertex are copied into the slots in front of it, which then look like the postfix children of a node (with
+    // leaf arguments), such that the dispatch table can be used as it is
+    template <typename T>
+    void Evaluate(GenotypeDag const& dag, Operon::Span<GenotypeDag::Id const> roots, Dataset const& dataset, Range const range, Operon::Span<T> result) const noexcept
+    {
+        using Callable = typename DTable::template Callable<T>;
+        using CompactCallable = typename DTable::template Callable<T, CompactNode>;
+        EXPECT(result.size() == roots.size() * range.Size());
+
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+
+        auto const vertices = dag.Vertices();
+        auto const n = vertices.size();
+
+        // vertex v occupies the slots [offsets[v], offsets[v + 1]): its arguments followed by itself
+        auto offsets = arena.template Allocate<size_t>(n + 1);
+        offsets[0] = 0;
+        for (size_t v = 0; v < n; ++v) {
+            offsets[v + 1] = offsets[v] + (vertices[v].References > 0 ? vertices[v].Symbol.Arity + 1UL : 0UL);
+        }
+        auto slot = [&](size_t v) { return offsets[v + 1] - 1; };
+
+        constexpr int S = static_cast<Eigen::Index>(detail::BatchSize<T>::Value);
+        auto m = arena.template Allocate<detail::Array<T>>(offsets[n]);
+        auto code = arena.template Allocate<CompactNode>(offsets[n]);
+
+        struct VertexMeta {
+            T Param;
+            Operon::Scalar const* Values;
+            CompactCallable const* Compact;
+            Callable const* Func; // only if there is no compact callable
+        };
+        auto meta = arena.template Allocate<VertexMeta>(n);
+        Operon::Span<Node> full; // the same slots with full nodes, only filled for the vertices without compact callable
+
+        for (size_t v = 0; v < n; ++v) {
+            auto const& vertex = vertices[v];
+            if (vertex.References == 0) {
+                continue;
+            }
+            auto const& s = vertex.Symbol;
+            auto const k = offsets[v];
+            std::fill_n(code.begin() + static_cast<int64_t>(k), s.Arity, CompactNode{});
+            code[k + s.Arity] = CompactNode(s);
+            code[k + s.Arity].Length = s.Arity;
+
+            const auto *ptr = s.IsVariable() ? dataset.GetValues(s.HashValue).subspan(range.Start(), range.Size()).data() : nullptr;
+            const auto *compact = ftable_.template Find<T, CompactNode>(s.HashValue);
+            const auto *func = compact == nullptr ? ftable_.template Find<T>(s.HashValue) : nullptr;
+            meta[v] = VertexMeta { T{s.Value}, ptr, compact, func };
+            if (func != nullptr) {
+                if (full.empty()) { full = arena.template Allocate<Node>(offsets[n]); }
+                std::fill_n(full.begin() + static_cast<int64_t>(k), s.Arity, Node(NodeType::Constant));
+                full[k + s.Arity] = s;
+                full[k + s.Arity].Length = s.Arity;
+            }
+            if (s.IsConstant()) { m[slot(v)].setConstant(meta[v].Param); }
+        }
+
+        int numRows = static_cast<int>(range.Size());
+        for (int row = 0; row < numRows; row += S) {
+            auto remainingRows = std::min(S, numRows - row);
+            Operon::Range rg(range.Start() + row, range.Start() + row + remainingRows);
+
+            for (size_t v = 0; v < n; ++v) {
+                if (vertices[v].References == 0) {
+                    continue;
+                }
+                auto const& [ param, values, compact, func ] = meta[v];
+                auto const k = offsets[v];
+                if (compact != nullptr || func != nullptr) {
+                    auto const children = dag.Children(static_cast<GenotypeDag::Id>(v));
+                    auto const arity = children.size();
+                    for (size_t j = 0; j < arity; ++j) {
+                        m[k + arity - 1 - j] = m[slot(children[j])];
+                    }
+                    if (compact != nullptr) {
+                        std::invoke(*compact, m.subspan(k, arity + 1), Operon::Span<CompactNode const>(code.subspan(k, arity + 1)), arity, rg);
+                    } else {
+                        std::invoke(*func, m.subspan(k, arity + 1), Operon::Span<Node const>(full.subspan(k, arity + 1)), arity, rg);
+                    }
+                } else if (values != nullptr) { // variable
+                    Eigen::Map<Eigen::Array<Operon::Scalar, -1, 1> const> x(values + row, remainingRows); // NOLINT
+                    m[k].segment(0, remainingRows) = param * x.template cast<T>();
+                }
+            }
+
+            for (size_t q = 0; q < roots.size(); ++q) {
+                Eigen::Map<Eigen::Array<T, -1, 1>> res(result.data() + q * range.Size() + row, remainingRows); // NOLINT
+                res = m[slot(roots[q])].segment(0, remainingRows);
+            }
+        }
+    }
+
     auto GetDispatchTable() -> DTable& { return ftable_; }
     [[nodiscard]] auto GetDispatchTable() const -> DTable const& { return ftable_; }
 
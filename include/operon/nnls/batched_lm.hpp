@@ -0,0 +1,275 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_NNLS_BATCHED_LM_HPP
+#define OPERON_NNLS_BATCHED_LM_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <Eigen/Core>
+
+#include "operon/core/arena.hpp"
+#include "operon/core/contracts.hpp"
+#include "nnls.hpp"
+
+namespace Operon {
+
+// Levenberg-Marquardt solver advancing the coefficients of a group of trees in lockstep
+// - the residuals and jacobians are computed per tree (autodiff, like the tiny solver)
+// - the damped normal equations of all the problems are stored in a structure-of-arrays layout
+//   (the problem index is the innermost dimension) and solved together with a batched Cholesky
+//   factorization whose inner loops run over the problems and are vectorized by the compiler
+// - problems with fewer parameters are padded with identity rows, converged problems are masked
+//   out of the function evaluations and contribute a zero step to the batched solve
+struct BatchedLevenbergMarquardt {
+    struct Options {
+        Operon::Scalar GradientTolerance { 1e-10F };
+        Operon::Scalar ParameterTolerance { 1e-8F };
+        Operon::Scalar InitialDamping { 1e-4F };
+        Operon::Scalar MinDiagonal { 1e-6F };
+        Operon::Scalar MaxDiagonal { 1e32F };
+    };
+
+    BatchedLevenbergMarquardt(Interpreter const& interpreter, Dataset const& dataset, Operon::Span<Operon::Scalar const> target, Range range)
+        : interpreter_(interpreter)
+        , dataset_(dataset)
+        , target_(target)
+        , range_(range)
+    {
+        EXPECT(target.size() == range.Size());
+    }
+
+    auto GetOptions() -> Options& { return options_; }
+    [[nodiscard]] auto GetOptions() const -> Options const& { return options_; }
+
+    // optimizes the coefficients of the given trees, writing back the coefficients of the problems whose cost decreased
+    auto Optimize(Operon::Span<Tree* const> trees, size_t iterations, Operon::Span<OptimizerSummary> summaries) const -> void
+    {
+        EXPECT(summaries.size() == trees.size());
+
+        using Vec = Eigen::Matrix<Operon::Scalar, -1, 1>;
+        using Mat = Eigen::Matrix<Operon::Scalar, -1, -1>;
+        using Map = Eigen::Map<Vec>;
+        using CostFunction = TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor>;
+
+        auto const nb = trees.size();
+        auto const nr = range_.Size();
+        size_t np { 0 };
+        for (auto const* t : trees) { np = std::max(np, t->CoefficientsCount()); }
+
+        std::fill(summaries.begin(), summaries.end(), OptimizerSummary {});
+        if (np == 0 || nr == 0) {
+            return;
+        }
+
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+
+        // per-problem state
+        auto x = arena.Allocate<Operon::Scalar>(nb * np);
+        auto xn = arena.Allocate<Operon::Scalar>(np);
+        auto cost = arena.Allocate<Operon::Scalar>(nb);
+        auto damping = arena.Allocate<Operon::Scalar>(nb);
+        auto factor = arena.Allocate<Operon::Scalar>(nb);
+        auto active = arena.Allocate<Operon::Scalar>(nb); // 1 if the problem is still iterating, 0 otherwise
+
+        // batched linear system (SoA layout, element (i, j) of problem b is at (i * np + j) * nb + b)
+        auto jtj = arena.Allocate<Operon::Scalar>(np * np * nb);
+        auto lhs = arena.Allocate<Operon::Scalar>(np * np * nb);
+        auto grad = arena.Allocate<Operon::Scalar>(np * nb);
+        auto step = arena.Allocate<Operon::Scalar>(np * nb);
+        auto pad = arena.Allocate<Operon::Scalar>(np * nb); // 1 for the padding parameters of a problem
+
+        // temporaries reused by the residual and jacobian evaluations
+        auto residual = arena.Allocate<Operon::Scalar>(nr);
+        auto jacobian = arena.Allocate<Operon::Scalar>(nr * np);
+
+        auto at = [nb, np](size_t i, size_t j) { return (i * np + j) * nb; };
+
+        // evaluates the residuals (and optionally the jacobian) of problem b at the given point, returns the cost
+        auto evaluate = [&](size_t b, Operon::Scalar const* point, bool withJacobian) {
+            ResidualEvaluator re(interpreter_.get(), *trees[b], dataset_.get(), target_, range_);
+            CostFunction cf(re);
+            cf.Evaluate(point, residual.data(), withJacobian ? jacobian.data() : nullptr);
+            ++summaries[b].FunctionEvaluations;
+            summaries[b].JacobianEvaluations += static_cast<int>(withJacobian);
+            auto r = Map(residual.data(), static_cast<Eigen::Index>(nr));
+            return Operon::Scalar { 0.5 } * r.squaredNorm();
+        };
+
+        // stores the normal equations of problem b (computed from the current residual and jacobian) into the batch
+        auto scatter = [&](size_t b) {
+            auto const p = static_cast<Eigen::Index>(trees[b]->CoefficientsCount());
+            Eigen::Map<Mat> j(jacobian.data(), static_cast<Eigen::Index>(nr), p);
+            Mat a = j.transpose() * j;
+            Vec g = j.transpose() * Map(residual.data(), static_cast<Eigen::Index>(nr));
+            for (Eigen::Index r = 0; r < p; ++r) {
+                for (Eigen::Index c = 0; c < p; ++c) {
+                    jtj[at(r, c) + b] = a(r, c);
+                }
+                grad[r * nb + b] = g(r);
+            }
+        };
+
+        // initialization
+        std::fill(jtj.begin(), jtj.end(), Operon::Scalar { 0 });
+        std::fill(grad.begin(), grad.end(), Operon::Scalar { 0 });
+        for (size_t b = 0; b < nb; ++b) {
+            auto const p = trees[b]->CoefficientsCount();
+            trees[b]->GetCoefficients(x.subspan(b * np, p));
+            std::fill(x.begin() + static_cast<std::ptrdiff_t>(b * np + p), x.begin() + static_cast<std::ptrdiff_t>((b + 1) * np), Operon::Scalar { 0 });
+            for (size_t i = 0; i < np; ++i) {
+                pad[i * nb + b] = i < p ? 0 : 1;
+            }
+            damping[b] = options_.InitialDamping;
+            factor[b] = 2;
+            active[b] = 0;
+            if (p == 0) {
+                continue;
+            }
+            cost[b] = evaluate(b, x.data() + b * np, /*withJacobian=*/true);
+            summaries[b].InitialCost = summaries[b].FinalCost = cost[b];
+            if (std::isfinite(cost[b])) {
+                scatter(b);
+                active[b] = 1;
+            }
+        }
+
+        for (size_t it = 0; it < iterations; ++it) {
+            if (std::none_of(active.begin(), active.end(), [](auto v) { return v > 0; })) {
+                break;
+            }
+
+            // assemble the damped systems (J^T J + u * D) * dx = -J^T r
+            for (size_t i = 0; i < np; ++i) {
+                for (size_t j = 0; j < np; ++j) {
+                    auto const* src = jtj.data() + at(i, j);
+                    auto* dst = lhs.data() + at(i, j);
+                    for (size_t b = 0; b < nb; ++b) { dst[b] = src[b]; }
+                }
+                auto* d = lhs.data() + at(i, i);
+                auto const* ps = pad.data() + i * nb;
+                auto* rhs = step.data() + i * nb;
+                auto const* g = grad.data() + i * nb;
+                for (size_t b = 0; b < nb; ++b) {
+                    d[b] += damping[b] * std::clamp(d[b], options_.MinDiagonal, options_.MaxDiagonal) + ps[b];
+                    rhs[b] = active[b] > 0 ? -g[b] : Operon::Scalar { 0 };
+                }
+            }
+
+            // batched Cholesky factorization (in place, lower triangle)
+            for (size_t k = 0; k < np; ++k) {
+                auto* dk = lhs.data() + at(k, k);
+                for (size_t m = 0; m < k; ++m) {
+                    auto const* lkm = lhs.data() + at(k, m);
+                    for (size_t b = 0; b < nb; ++b) { dk[b] -= lkm[b] * lkm[b]; }
+                }
+                for (size_t b = 0; b < nb; ++b) { dk[b] = std::sqrt(std::max(dk[b], std::numeric_limits<Operon::Scalar>::min())); }
+                for (size_t i = k + 1; i < np; ++i) {
+                    auto* lik = lhs.data() + at(i, k);
+                    for (size_t m = 0; m < k; ++m) {
+                        auto const* lim = lhs.data() + at(i, m);
+                        auto const* lkm = lhs.data() + at(k, m);
+                        for (size_t b = 0; b < nb; ++b) { lik[b] -= lim[b] * lkm[b]; }
+                    }
+                    for (size_t b = 0; b < nb; ++b) { lik[b] /= dk[b]; }
+                }
+            }
+
+            // forward substitution L * y = rhs
+            for (size_t i = 0; i < np; ++i) {
+                auto* yi = step.data() + i * nb;
+                for (size_t m = 0; m < i; ++m) {
+                    auto const* lim = lhs.data() + at(i, m);
+                    auto const* ym = step.data() + m * nb;
+                    for (size_t b = 0; b < nb; ++b) { yi[b] -= lim[b] * ym[b]; }
+                }
+                auto const* lii = lhs.data() + at(i, i);
+                for (size_t b = 0; b < nb; ++b) { yi[b] /= lii[b]; }
+            }
+
+            // backward substitution L^T * dx = y
+            for (size_t i = np; i-- > 0;) {
+                auto* xi = step.data() + i * nb;
+                for (size_t m = i + 1; m < np; ++m) {
+                    auto const* lmi = lhs.data() + at(m, i);
+                    auto const* xm = step.data() + m * nb;
+                    for (size_t b = 0; b < nb; ++b) { xi[b] -= lmi[b] * xm[b]; }
+                }
+                auto const* lii = lhs.data() + at(i, i);
+                for (size_t b = 0; b < nb; ++b) { xi[b] /= lii[b]; }
+            }
+
+            // evaluate the steps of the active problems and update their trust regions
+            for (size_t b = 0; b < nb; ++b) {
+                if (active[b] == 0) {
+                    continue;
+                }
+                ++summaries[b].Iterations;
+                auto const p = trees[b]->CoefficientsCount();
+
+                Operon::Scalar stepNorm { 0 };
+                Operon::Scalar pointNorm { 0 };
+                Operon::Scalar predicted { 0 }; // cost decrease predicted by the linear model: -(dx^T g + 0.5 * dx^T J^T J dx)
+                for (size_t i = 0; i < p; ++i) {
+                    auto const dxi = step[i * nb + b];
+                    Operon::Scalar jdx { 0 };
+                    for (size_t j = 0; j < p; ++j) { jdx += jtj[at(i, j) + b] * step[j * nb + b]; }
+                    predicted -= dxi * (grad[i * nb + b] + Operon::Scalar { 0.5 } * jdx);
+                    stepNorm += dxi * dxi;
+                    pointNorm += x[b * np + i] * x[b * np + i];
+                    xn[i] = x[b * np + i] + dxi;
+                }
+
+                if (std::sqrt(stepNorm) <= options_.ParameterTolerance * (std::sqrt(pointNorm) + options_.ParameterTolerance)) {
+                    active[b] = 0;
+                    continue;
+                }
+
+                auto const candidate = evaluate(b, xn.data(), /*withJacobian=*/false);
+                auto const rho = (cost[b] - candidate) / predicted;
+
+                if (std::isfinite(candidate) && predicted > 0 && rho > 0) {
+                    std::copy_n(xn.data(), p, x.data() + b * np);
+                    cost[b] = evaluate(b, xn.data(), /*withJacobian=*/true);
+                    scatter(b);
+                    auto const t = 2 * rho - 1;
+                    damping[b] *= std::max(Operon::Scalar { 1 } / 3, 1 - t * t * t);
+                    factor[b] = 2;
+                } else {
+                    damping[b] *= factor[b];
+                    factor[b] *= 2;
+                }
+
+                Operon::Scalar gmax { 0 };
+                for (size_t i = 0; i < p; ++i) { gmax = std::max(gmax, std::abs(grad[i * nb + b])); }
+                if (gmax < options_.GradientTolerance || !std::isfinite(damping[b])) {
+                    active[b] = 0;
+                }
+            }
+        }
+
+        for (size_t b = 0; b < nb; ++b) {
+            auto& s = summaries[b];
+            if (trees[b]->CoefficientsCount() == 0) {
+                continue;
+            }
+            s.FinalCost = cost[b];
+            s.Success = s.FinalCost < s.InitialCost;
+            if (s.Success) {
+                trees[b]->SetCoefficients(x.subspan(b * np, trees[b]->CoefficientsCount()));
+            }
+        }
+    }
+
+private:
+    std::reference_wrapper<Interpreter const> interpreter_;
+    std::reference_wrapper<Dataset const> dataset_;
+    Operon::Span<Operon::Scalar const> target_;
+    Range range_;
+    Options options_;
+};
+
+} // namespace Operon
+
+#endif
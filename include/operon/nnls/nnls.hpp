@@ -6,12 +6,20 @@
 
 #include <unsupported/Eigen/LevenbergMarquardt>
 
+#include "operon/core/arena.hpp"
 #include "operon/core/dual.hpp"
 #include "residual_evaluator.hpp"
+#include "symbolic_cost_function.hpp"
 #include "tiny_cost_function.hpp"
 #include "operon/ceres/tiny_solver.h"
 
 #if defined(HAVE_CERES)
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
 #include "dynamic_cost_function.hpp"
 #endif
 
@@ -19,8 +27,11 @@ namespace Operon {
 
 enum class OptimizerType : int { TINY, EIGEN,
     CERES };
+// SYMBOLIC evaluates the partial derivative trees of the model with the scalar interpreter,
+// falling back to AUTODIFF for trees containing non-differentiable symbols
 enum class DerivativeMethod : int { NUMERIC,
-    AUTODIFF };
+    AUTODIFF,
+    SYMBOLIC };
 
 struct OptimizerSummary {
     double InitialCost;
@@ -59,16 +70,31 @@ struct NonlinearLeastSquaresOptimizer : public OptimizerBase {
     template <DerivativeMethod D = DerivativeMethod::AUTODIFF>
     auto Optimize(Operon::Span<const Operon::Scalar> const target, Range range, size_t iterations, bool writeCoefficients = true, bool /*unused*/ = false /* not used */) -> OptimizerSummary
     {
-        static_assert(D == DerivativeMethod::AUTODIFF, "The tiny optimizer only supports autodiff.");
+        static_assert(D != DerivativeMethod::NUMERIC, "The tiny optimizer does not support numeric differentiation.");
+        if constexpr (D == DerivativeMethod::SYMBOLIC) {
+            SymbolicCostFunction<Eigen::ColMajor> cf(GetInterpreter(), GetTree(), GetDataset(), target, range);
+            if (cf.IsDifferentiable()) {
+                return Solve(cf, iterations, writeCoefficients);
+            }
+        }
         ResidualEvaluator re(GetInterpreter(), GetTree(), GetDataset(), target, range);
         Operon::TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor> cf(re);
-        ceres::TinySolver<decltype(cf)> solver;
+        return Solve(cf, iterations, writeCoefficients);
+    }
+
+private:
+    template <typename CostFunction>
+    auto Solve(CostFunction& cf, size_t iterations, bool writeCoefficients) -> OptimizerSummary
+    {
+        ceres::TinySolver<CostFunction> solver;
         solver.options.max_num_iterations = static_cast<int>(iterations);
 
         auto& tree = GetTree();
-        auto x0 = tree.GetCoefficients();
+        ArenaScope scope;
+        auto x0 = scope.Arena().Allocate<Operon::Scalar>(tree.CoefficientsCount());
+        tree.GetCoefficients(x0);
         if (!x0.empty()) {
-            decltype(solver)::Parameters params = Eigen::Map<Eigen::Matrix<Operon::Scalar, Eigen::Dynamic, 1>>(x0.data(), x0.size()).cast<typename decltype(cf)::Scalar>();
+            typename decltype(solver)::Parameters params = Eigen::Map<Eigen::Matrix<Operon::Scalar, Eigen::Dynamic, 1>>(x0.data(), x0.size()).template cast<typename CostFunction::Scalar>();
             solver.Solve(cf, &params);
             if (writeCoefficients) {
                 tree.SetCoefficients({ params.data(), x0.size() });
@@ -94,14 +120,29 @@ struct NonlinearLeastSquaresOptimizer<OptimizerType::EIGEN> : public OptimizerBa
     template <DerivativeMethod D = DerivativeMethod::AUTODIFF>
     auto Optimize(Operon::Span<const Operon::Scalar> const target, Range range, size_t iterations, bool writeCoefficients = true, bool /*unused*/ = false) -> OptimizerSummary
     {
-        static_assert(D == DerivativeMethod::AUTODIFF, "Eigen::LevenbergMarquardt only supports autodiff.");
+        static_assert(D != DerivativeMethod::NUMERIC, "Eigen::LevenbergMarquardt does not support numeric differentiation.");
+        if constexpr (D == DerivativeMethod::SYMBOLIC) {
+            SymbolicCostFunction<Eigen::ColMajor> cf(GetInterpreter(), GetTree(), GetDataset(), target, range);
+            if (cf.IsDifferentiable()) {
+                return Solve(cf, iterations, writeCoefficients);
+            }
+        }
         ResidualEvaluator re(GetInterpreter(), GetTree(), GetDataset(), target, range);
         Operon::TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor> cf(re);
-        Eigen::LevenbergMarquardt<decltype(cf)> lm(cf);
+        return Solve(cf, iterations, writeCoefficients);
+    }
+
+private:
+    template <typename CostFunction>
+    auto Solve(CostFunction& cf, size_t iterations, bool writeCoefficients) -> OptimizerSummary
+    {
+        Eigen::LevenbergMarquardt<CostFunction> lm(cf);
         lm.setMaxfev(static_cast<int>(iterations+1));
 
         auto& tree = GetTree();
-        auto coeff = tree.GetCoefficients();
+        ArenaScope scope;
+        auto coeff = scope.Arena().Allocate<Operon::Scalar>(tree.CoefficientsCount());
+        tree.GetCoefficients(coeff);
 
         Eigen::ComputationInfo info{};
         if (!coeff.empty()) {
@@ -125,6 +166,135 @@ struct NonlinearLeastSquaresOptimizer<OptimizerType::EIGEN> : public OptimizerBa
 };
 
 #if HAVE_CERES
+// the residuals of a tree split into blocks over consecutive row chunks of the range, which ceres can evaluate in parallel
+// - the cost functions depend only on the shape of the tree (the structure and the values of the nodes that are not optimized)
+//   since all the coefficients are supplied by the solver, so the blocks own a copy of the tree and can be reused for other trees
+//   of the same shape, as long as the dataset and the target values outlive them
+// - the blocks only match the version of the dataset they were created for (see Dataset::Version), since appending rows or
+//   modifying the values may move the storage the cost functions refer to
+struct CeresResidualBlocks {
+    Tree Shape;
+    Operon::Range Rows;
+    size_t ChunkSize;
+    DerivativeMethod Method;
+    Dataset const* Data;
+    uint64_t Version;
+    Operon::Scalar const* Target;
+    std::vector<std::unique_ptr<ceres::CostFunction>> Functions;
+
+    template <DerivativeMethod D>
+    static auto Create(Interpreter const& interpreter, Tree const& tree, Dataset const& dataset, Operon::Span<const Operon::Scalar> target, Operon::Range range, size_t chunkSize) -> std::shared_ptr<CeresResidualBlocks>
+    {
+        auto blocks = std::make_shared<CeresResidualBlocks>(CeresResidualBlocks { tree, range, chunkSize, D, &dataset, dataset.Version(), target.data(), {} });
+        auto const& shape = blocks->Shape; // the cost functions refer to the copy
+        auto const size = chunkSize == 0 ? range.Size() : chunkSize;
+        for (size_t offset = 0; offset < range.Size(); offset += size) {
+            auto const rows = std::min(size, range.Size() - offset);
+            auto const chunk = target.subspan(offset, rows);
+            Operon::Range const rg { range.Start() + offset, range.Start() + offset + rows };
+            blocks->Functions.emplace_back(CreateFunction<D>(interpreter, shape, dataset, chunk, rg));
+        }
+        return blocks;
+    }
+
+    // structurally identical trees share the residual blocks
+    [[nodiscard]] static auto ShapeHash(Tree const& tree) -> Operon::Hash
+    {
+        Operon::Hash h { 0 };
+        auto combine = [&](Operon::Hash v) { h ^= v + 0x9e3779b97f4a7c15UL + (h << 6U) + (h >> 2U); }; // NOLINT
+        for (auto const& n : tree.Nodes()) {
+            combine(n.HashValue);
+            combine(n.Arity);
+            if (!n.Optimize) { combine(std::hash<Operon::Scalar>{}(n.Value)); }
+        }
+        return h;
+    }
+
+    [[nodiscard]] auto Matches(Tree const& tree, Dataset const& dataset, Operon::Span<const Operon::Scalar> target, Operon::Range range, size_t chunkSize, DerivativeMethod method) const -> bool
+    {
+        auto const& u = Shape.Nodes();
+        auto const& v = tree.Nodes();
+        return Data == &dataset && Version == dataset.Version() && Target == target.data() && Rows.Bounds() == range.Bounds() && ChunkSize == chunkSize && Method == method
+            && std::equal(u.begin(), u.end(), v.begin(), v.end(), [](auto const& a, auto const& b) {
+                   return a.HashValue == b.HashValue && a.Arity == b.Arity && a.Optimize == b.Optimize && (a.Optimize || a.Value == b.Value);
+               });
+    }
+
+private:
+    template <DerivativeMethod D>
+    static auto CreateFunction(Interpreter const& interpreter, Tree const& tree, Dataset const& dataset, Operon::Span<const Operon::Scalar> target, Operon::Range range) -> ceres::CostFunction*
+    {
+        if constexpr (D == DerivativeMethod::SYMBOLIC) {
+            SymbolicCostFunction<Eigen::RowMajor> f(interpreter, tree, dataset, target, range);
+            if (f.IsDifferentiable()) {
+                return new Operon::DynamicCostFunction<decltype(f)>(f); // NOLINT
+            }
+        }
+        if constexpr (D == DerivativeMethod::NUMERIC) {
+            auto* eval = new ResidualEvaluator(interpreter, tree, dataset, target, range); // NOLINT
+            auto* costFunction = new ceres::DynamicNumericDiffCostFunction(eval); // NOLINT
+            costFunction->AddParameterBlock(static_cast<int>(tree.CoefficientsCount()));
+            costFunction->SetNumResiduals(static_cast<int>(target.size()));
+            return costFunction;
+        } else {
+            ResidualEvaluator re(interpreter, tree, dataset, target, range);
+            TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::RowMajor> f(re);
+            return new Operon::DynamicCostFunction<decltype(f)>(f); // NOLINT
+        }
+    }
+};
+
+// bounded thread-safe cache of residual blocks keyed by tree shape; when full, the cache is cleared
+// (blocks still in use by an optimizer are kept alive by their shared pointers)
+// it is also cleared when it sees a different dataset or a new version of the dataset, whose blocks can no longer match
+class CeresCostFunctionCache {
+public:
+    static constexpr size_t DefaultCapacity = 1024;
+
+    explicit CeresCostFunctionCache(size_t capacity = DefaultCapacity)
+        : capacity_(capacity)
+    {
+    }
+
+    template <DerivativeMethod D>
+    auto Get(Interpreter const& interpreter, Tree const& tree, Dataset const& dataset, Operon::Span<const Operon::Scalar> target, Range range, size_t chunkSize) -> std::shared_ptr<CeresResidualBlocks const>
+    {
+        auto const key = CeresResidualBlocks::ShapeHash(tree);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto [first, last] = map_.equal_range(key);
+            for (auto it = first; it != last; ++it) {
+                if (it->second->Matches(tree, dataset, target, range, chunkSize, D)) {
+                    ++hits_;
+                    return it->second;
+                }
+            }
+        }
+        auto blocks = CeresResidualBlocks::Create<D>(interpreter, tree, dataset, target, range, chunkSize);
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++misses_;
+        if (map_.size() >= capacity_ || data_ != &dataset || version_ != dataset.Version()) {
+            map_.clear();
+            data_ = &dataset;
+            version_ = dataset.Version();
+        }
+        map_.emplace(key, blocks);
+        return blocks;
+    }
+
+    [[nodiscard]] auto Hits() const -> size_t { return hits_; }
+    [[nodiscard]] auto Misses() const -> size_t { return misses_; }
+
+private:
+    size_t capacity_;
+    std::mutex mutex_;
+    std::unordered_multimap<Operon::Hash, std::shared_ptr<CeresResidualBlocks const>> map_;
+    Dataset const* data_ { nullptr };
+    uint64_t version_ { 0 };
+    std::atomic<size_t> hits_ { 0 };
+    std::atomic<size_t> misses_ { 0 };
+};
+
 template <>
 struct NonlinearLeastSquaresOptimizer<OptimizerType::CERES> : public OptimizerBase {
     NonlinearLeastSquaresOptimizer(Interpreter const& interpreter, Tree& tree, Dataset const& dataset)
@@ -132,11 +302,24 @@ struct NonlinearLeastSquaresOptimizer<OptimizerType::CERES> : public OptimizerBa
     {
     }
 
+    // split the range into residual blocks of (at most) `rows` rows each, evaluated in parallel on `threads` threads
+    // (a chunk size of zero means a single residual block over the whole range)
+    auto SetRowChunks(size_t rows, size_t threads = std::thread::hardware_concurrency()) -> void
+    {
+        chunkSize_ = rows;
+        threads_ = std::max(threads, size_t { 1 });
+    }
+
+    // look up the cost functions in the cache instead of creating them on every call
+    auto SetCostFunctionCache(CeresCostFunctionCache* cache) -> void { cache_ = cache; }
+
     template <DerivativeMethod D = DerivativeMethod::AUTODIFF>
     auto Optimize(Operon::Span<const Operon::Scalar> const target, Range range, size_t iterations, bool writeCoefficients = true, bool report = false) -> OptimizerSummary
     {
         auto& tree = GetTree();
-        auto coef = tree.GetCoefficients();
+        ArenaScope scope;
+        auto coef = scope.Arena().Allocate<Operon::Scalar>(tree.CoefficientsCount());
+        tree.GetCoefficients(coef);
 
         auto const& interpreter = GetInterpreter();
         auto const& dataset = GetDataset();
@@ -153,28 +336,24 @@ struct NonlinearLeastSquaresOptimizer<OptimizerType::CERES> : public OptimizerBa
             fmt::print("\n");
         }
 
-        ceres::DynamicCostFunction* costFunction = nullptr;
-        if constexpr (D == DerivativeMethod::AUTODIFF) {
-            ResidualEvaluator re(interpreter, tree, dataset, target, range);
-            TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::RowMajor> f(re);
-            costFunction = new Operon::DynamicCostFunction<decltype(f)>(f);
-        } else {
-            auto* eval = new ResidualEvaluator(interpreter, tree, dataset, target, range); // NOLINT
-            costFunction = new ceres::DynamicNumericDiffCostFunction(eval);
-            costFunction->AddParameterBlock(static_cast<int>(coef.size()));
-            costFunction->SetNumResiduals(static_cast<int>(target.size()));
-        }
+        std::shared_ptr<CeresResidualBlocks const> blocks = cache_ != nullptr
+            ? cache_->Get<D>(interpreter, tree, dataset, target, range, chunkSize_)
+            : CeresResidualBlocks::Create<D>(interpreter, tree, dataset, target, range, chunkSize_);
 
         auto sz = static_cast<Eigen::Index>(coef.size());
         Eigen::MatrixXd params = Eigen::Map<Eigen::Matrix<Operon::Scalar, -1, 1>>(coef.data(), sz).template cast<double>();
-        ceres::Problem problem;
-        problem.AddResidualBlock(costFunction, nullptr, params.data());
+        ceres::Problem::Options problemOptions;
+        problemOptions.cost_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP; // the blocks own the cost functions
+        ceres::Problem problem(problemOptions);
+        for (auto const& f : blocks->Functions) {
+            problem.AddResidualBlock(f.get(), nullptr, params.data());
+        }
 
         ceres::Solver::Options options;
         options.max_num_iterations = static_cast<int>(iterations - 1); // workaround since for some reason ceres sometimes does 1 more iteration
         options.linear_solver_type = ceres::DENSE_QR;
         options.minimizer_progress_to_stdout = report;
-        options.num_threads = 1;
+        options.num_threads = static_cast<int>(threads_);
         options.logging_type = ceres::LoggingType::SILENT;
 
         ceres::Solver::Summary summary;
@@ -201,6 +380,11 @@ struct NonlinearLeastSquaresOptimizer<OptimizerType::CERES> : public OptimizerBa
         sum.Success = sum.InitialCost > sum.FinalCost;
         return sum;
     }
+
+private:
+    size_t chunkSize_ { 0 };
+    size_t threads_ { 1 };
+    CeresCostFunctionCache* cache_ { nullptr };
 };
 #endif
 
@@ -16,7 +16,7 @@ struct ResidualEvaluator {
         , dataset_(dataset)
         , range_(range)
         , target_(targetValues)
-        , numParameters_(tree_.get().GetCoefficients().size())
+        , numParameters_(tree_.get().CoefficientsCount())
     {
     }
 
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_NNLS_SYMBOLIC_COST_FUNCTION_HPP
+#define OPERON_NNLS_SYMBOLIC_COST_FUNCTION_HPP
+
+#include <Eigen/Core>
+#include <Eigen/QR>
+
+#include "operon/core/arena.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/derivative.hpp"
+#include "residual_evaluator.hpp"
+
+namespace Operon {
+
+// cost function providing the same interface as TinyCostFunction, where the jacobian columns are obtained by
+// evaluating the symbolic partial derivatives of the tree with the scalar interpreter (instead of dual numbers)
+// - columns corresponding to the same derivative tree are evaluated once and copied
+// - trees that are not differentiable symbolically (see SymbolicDerivative) should be handled by autodiff
+template <int StorageOrder = Eigen::RowMajor>
+struct SymbolicCostFunction {
+    static constexpr int Storage = StorageOrder;
+    using Scalar = Operon::Scalar;
+
+    enum {
+        NUM_RESIDUALS = Eigen::Dynamic,  // NOLINT
+        NUM_PARAMETERS = Eigen::Dynamic, // NOLINT
+    };
+
+    SymbolicCostFunction(Interpreter const& interpreter, Tree const& tree, Dataset const& dataset, Operon::Span<Operon::Scalar const> targetValues, Range range)
+        : residual_(interpreter, tree, dataset, targetValues, range)
+        , derivative_(tree)
+        , dataset_(dataset)
+        , range_(range)
+    {
+    }
+
+    [[nodiscard]] auto IsDifferentiable() const -> bool { return derivative_.IsDifferentiable(); }
+
+    auto Evaluate(Scalar const* parameters, Scalar* residuals, Scalar* jacobian) const -> bool
+    {
+        EXPECT(parameters != nullptr);
+        EXPECT(residuals != nullptr || jacobian != nullptr);
+        ENSURE(IsDifferentiable());
+
+        if (residuals != nullptr && !residual_(parameters, residuals)) {
+            return false;
+        }
+        if (jacobian == nullptr) {
+            return true;
+        }
+
+        auto const nr = static_cast<size_t>(NumResiduals());
+        auto const np = static_cast<size_t>(NumParameters());
+        Eigen::Map<Eigen::Matrix<Scalar, -1, -1, StorageOrder>> jmap(jacobian, static_cast<Eigen::Index>(nr), static_cast<Eigen::Index>(np));
+
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+        auto const& derivatives = derivative_.Derivatives();
+        // the jacobian column where each derivative tree was first written
+        auto first = arena.Allocate<size_t>(derivatives.size());
+        std::fill(first.begin(), first.end(), SymbolicDerivative::Zero);
+        auto buffer = arena.Allocate<Scalar>(StorageOrder == Eigen::ColMajor ? 0 : nr);
+
+        auto const& interpreter = residual_.GetInterpreter();
+        for (size_t i = 0; i < np; ++i) {
+            auto const k = derivative_.Column(i);
+            auto col = jmap.col(static_cast<Eigen::Index>(i));
+            if (k == SymbolicDerivative::Zero) {
+                col.setZero();
+                continue;
+            }
+            if (first[k] != SymbolicDerivative::Zero) {
+                col = jmap.col(static_cast<Eigen::Index>(first[k]));
+                continue;
+            }
+            auto const indices = derivative_.Parameters(k);
+            auto coeff = arena.Allocate<Scalar>(indices.size());
+            std::transform(indices.begin(), indices.end(), coeff.begin(), [&](auto j) { return parameters[j]; });
+
+            if constexpr (StorageOrder == Eigen::ColMajor) {
+                interpreter.Evaluate<Scalar>(derivatives[k], dataset_.get(), range_, { col.data(), nr }, coeff.data());
+            } else {
+                interpreter.Evaluate<Scalar>(derivatives[k], dataset_.get(), range_, buffer, coeff.data());
+                col = Eigen::Map<Eigen::Matrix<Scalar, -1, 1> const>(buffer.data(), static_cast<Eigen::Index>(nr));
+            }
+            first[k] = i;
+        }
+        return true;
+    }
+
+    // ceres solver - jacobian must be in row-major format
+    // ceres tiny solver - jacobian must be in col-major format
+    auto operator()(Scalar const* parameters, Scalar* residuals, Scalar* jacobian) const -> bool
+    {
+        return Evaluate(parameters, residuals, jacobian);
+    }
+
+    [[nodiscard]] auto NumResiduals() const -> int { return static_cast<int>(residual_.NumResiduals()); }
+    [[nodiscard]] auto NumParameters() const -> int { return static_cast<int>(residual_.NumParameters()); }
+
+    // required by Eigen::LevenbergMarquardt
+    using JacobianType = Eigen::Matrix<Operon::Scalar, -1, -1>;
+    using QRSolver     = Eigen::ColPivHouseholderQR<JacobianType>;
+
+    auto operator()(Eigen::Matrix<Scalar, -1, 1> const& input, Eigen::Matrix<Scalar, -1, 1> &residual) -> int
+    {
+        Evaluate(input.data(), residual.data(), nullptr);
+        return 0;
+    }
+
+    auto df(Eigen::Matrix<Scalar, -1, 1> const& input, Eigen::Matrix<Scalar, -1, -1> &jacobian) -> int // NOLINT
+    {
+        static_assert(StorageOrder == Eigen::ColMajor, "Eigen::LevenbergMarquardt requires the Jacobian to be stored in column-major format.");
+        Evaluate(input.data(), nullptr, jacobian.data());
+        return 0;
+    }
+
+    [[nodiscard]] auto values() const -> int { return NumResiduals(); }  // NOLINT
+    [[nodiscard]] auto inputs() const -> int { return NumParameters(); } // NOLINT
+
+private:
+    ResidualEvaluator residual_;
+    SymbolicDerivative derivative_;
+    std::reference_wrapper<Dataset const> dataset_;
+    Range range_;
+};
+} // namespace Operon
+
+#endif
@@ -5,6 +5,7 @@
 #define OPERON_NNLS_TINY_OPTIMIZER
 
 #include <Eigen/Core>
+#include "operon/core/arena.hpp"
 #include "operon/interpreter/interpreter.hpp"
 
 namespace Operon {
@@ -29,12 +30,13 @@ namespace detail {
             return function(parameters, residuals);
         }
 
-        std::vector<Dual> inputs(function.NumParameters());
+        ArenaScope scope;
+        auto inputs = scope.Arena().template Allocate<Dual>(function.NumParameters());
         for (size_t i = 0; i < inputs.size(); ++i) {
             inputs[i].a = parameters[i];
             inputs[i].v.setZero();
         }
-        std::vector<Dual> outputs(function.NumResiduals());
+        auto outputs = scope.Arena().template Allocate<Dual>(function.NumResiduals());
 
         static auto constexpr D{Dual::DIMENSION};
         Eigen::Map<Eigen::Matrix<Scalar, -1, -1, JacobianLayout>> jmap(jacobian, outputs.size(), inputs.size());
@@ -57,7 +59,7 @@ namespace detail {
             // fill in the jacobian trying to exploit its layout for efficiency
             if constexpr (JacobianLayout == Eigen::ColMajor) {
                 for (int i = s; i < r; ++i) {
-                    std::transform(outputs.cbegin(), outputs.cend(), jmap.col(i).data(), [&](auto const& jet) { return jet.v[i - s]; });
+                    std::transform(outputs.begin(), outputs.end(), jmap.col(i).data(), [&](auto const& jet) { return jet.v[i - s]; });
                 }
             } else {
                 for (auto i = 0; i < outputs.size(); ++i) {
@@ -66,7 +68,7 @@ namespace detail {
             }
         }
         if (residuals != nullptr) {
-            std::transform(std::cbegin(outputs), std::cend(outputs), residuals, [](auto const& jet) { return jet.a; });
+            std::transform(outputs.begin(), outputs.end(), residuals, [](auto const& jet) { return jet.a; });
         }
         return true;
     }
@@ -0,0 +1,236 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_NNLS_VARIABLE_PROJECTION_HPP
+#define OPERON_NNLS_VARIABLE_PROJECTION_HPP
+
+#include <algorithm>
+#include <Eigen/QR>
+#include <vector>
+
+#include "operon/core/arena.hpp"
+#include "nnls.hpp"
+
+namespace Operon {
+
+// a coefficient that enters the tree output linearly: a constant or weighted variable leaf
+// reachable from the root only through additions and subtractions
+struct LinearTerm {
+    size_t Node;        // index of the leaf in the postfix representation
+    size_t Coefficient; // index of the coefficient (in the order of Tree::GetCoefficients)
+    Operon::Scalar Sign; // -1 if the term is subtracted from the output
+};
+
+inline auto FindLinearTerms(Tree const& tree) -> std::vector<LinearTerm>
+{
+    auto const& nodes = tree.Nodes();
+    std::vector<LinearTerm> terms;
+    if (nodes.empty()) {
+        return terms;
+    }
+
+    std::vector<size_t> coefficient(nodes.size());
+    size_t idx = 0;
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        coefficient[i] = idx;
+        idx += static_cast<size_t>(nodes[i].Optimize);
+    }
+
+    // the children of an n-ary node are found at i-1, then i-1-(length+1), etc (postfix order)
+    std::vector<std::pair<size_t, Operon::Scalar>> stack { { nodes.size() - 1, Operon::Scalar { 1 } } };
+    while (!stack.empty()) {
+        auto [i, sign] = stack.back();
+        stack.pop_back();
+        auto const& n = nodes[i];
+        if (n.IsLeaf()) {
+            if (n.Optimize) {
+                terms.push_back({ i, coefficient[i], sign });
+            }
+            continue;
+        }
+        if (n.Type != NodeType::Add && n.Type != NodeType::Sub) {
+            continue;
+        }
+        auto j = i - 1;
+        for (size_t k = 0; k < n.Arity; ++k) {
+            // sub(x) = -x, sub(x1, x2, ..., xn) = x1 - x2 - ... - xn
+            auto const negate = n.Type == NodeType::Sub && (n.Arity == 1 || k > 0);
+            stack.emplace_back(j, negate ? -sign : sign);
+            j -= nodes[j].Length + 1;
+        }
+    }
+    return terms;
+}
+
+// residuals of the nonlinear coefficients after the linear ones are eliminated:
+// with f(x) = Phi * a + g(x; theta), the optimal a for a given theta gives the reduced residual
+// r(theta) = P * (g(theta) - y), where P = I - Q * Q^T projects onto the orthogonal complement of span(Phi)
+// (Phi does not depend on theta because the linear terms are leaves, so Q is computed only once)
+struct ProjectedResidualEvaluator {
+    ProjectedResidualEvaluator(Interpreter const& interpreter, Tree const& tree, Dataset const& dataset, Operon::Span<Operon::Scalar const> targetValues, Range range,
+        Operon::Span<size_t const> nonlinear, Operon::Span<Operon::Scalar const> basis, size_t rank)
+        : interpreter_(interpreter)
+        , tree_(tree)
+        , dataset_(dataset)
+        , range_(range)
+        , target_(targetValues)
+        , nonlinear_(nonlinear)
+        , basis_(basis)
+        , rank_(rank)
+    {
+    }
+
+    template <typename T>
+    auto operator()(T const* parameters, T* residuals) const -> bool
+    {
+        auto const& tree = tree_.get();
+        ArenaScope scope;
+        // the linear coefficients are zeroed so that the tree computes g(theta)
+        auto full = scope.Arena().template Allocate<T>(tree.CoefficientsCount());
+        std::fill(full.begin(), full.end(), T { 0 });
+        for (size_t k = 0; k < nonlinear_.size(); ++k) {
+            full[nonlinear_[k]] = parameters[k];
+        }
+
+        auto const n = target_.size();
+        Operon::Span<T> result(residuals, n);
+        interpreter_.get().template Evaluate<T>(tree, dataset_.get(), range_, result, full.data());
+        for (size_t i = 0; i < n; ++i) {
+            residuals[i] -= T { target_[i] };
+        }
+        for (size_t c = 0; c < rank_; ++c) {
+            auto const* q = basis_.data() + c * n;
+            T s { 0 };
+            for (size_t i = 0; i < n; ++i) { s += q[i] * residuals[i]; }
+            for (size_t i = 0; i < n; ++i) { residuals[i] -= q[i] * s; }
+        }
+        return true;
+    }
+
+    [[nodiscard]] auto NumParameters() const -> size_t { return nonlinear_.size(); }
+    [[nodiscard]] auto NumResiduals() const -> size_t { return target_.size(); }
+
+private:
+    std::reference_wrapper<Interpreter const> interpreter_;
+    std::reference_wrapper<Tree const> tree_;
+    std::reference_wrapper<Dataset const> dataset_;
+    Range range_;
+    Operon::Span<Operon::Scalar const> target_;
+    Operon::Span<size_t const> nonlinear_;
+    Operon::Span<Operon::Scalar const> basis_; // orthonormal basis of span(Phi), column-major
+    size_t rank_;
+};
+
+// variable projection: the linear coefficients are solved in closed form by dense linear least squares
+// (a generalization of the linear scaling done by FitLeastSquares) and only the remaining nonlinear
+// coefficients are optimized iteratively (with the tiny solver) on the reduced problem
+struct VariableProjectionOptimizer : public OptimizerBase {
+    VariableProjectionOptimizer(Interpreter const& interpreter, Tree& tree, Dataset const& dataset)
+        : OptimizerBase(interpreter, tree, dataset)
+    {
+    }
+
+    auto Optimize(Operon::Span<Operon::Scalar const> const target, Range range, size_t iterations, bool writeCoefficients = true) -> OptimizerSummary
+    {
+        using Matrix = Eigen::Matrix<Operon::Scalar, -1, -1>;
+        using Vector = Eigen::Matrix<Operon::Scalar, -1, 1>;
+
+        auto& tree = GetTree();
+        auto const& dataset = GetDataset();
+        auto const& interpreter = GetInterpreter();
+        auto const np = tree.CoefficientsCount();
+        auto const nr = static_cast<Eigen::Index>(target.size());
+
+        OptimizerSummary sum {};
+        if (np == 0) {
+            return sum;
+        }
+
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+        auto coeff = arena.Allocate<Operon::Scalar>(np);
+        tree.GetCoefficients(coeff);
+
+        Eigen::Map<Vector const> y(target.data(), nr);
+        auto residual = arena.Allocate<Operon::Scalar>(target.size());
+        Eigen::Map<Vector> r(residual.data(), nr);
+
+        ResidualEvaluator re(interpreter, tree, dataset, target, range);
+        re(coeff.data(), residual.data());
+        sum.InitialCost = 0.5 * r.squaredNorm();
+        ++sum.FunctionEvaluations;
+
+        // design matrix of the linear terms
+        auto const terms = FindLinearTerms(tree);
+        auto const& nodes = tree.Nodes();
+        auto const nl = static_cast<Eigen::Index>(terms.size());
+        Matrix phi(nr, nl);
+        for (Eigen::Index j = 0; j < nl; ++j) {
+            auto const& [node, _, sign] = terms[j];
+            if (nodes[node].IsVariable()) {
+                phi.col(j) = sign * Eigen::Map<Vector const>(dataset.GetValues(nodes[node].HashValue).subspan(range.Start(), range.Size()).data(), nr);
+            } else {
+                phi.col(j).setConstant(sign);
+            }
+        }
+        Eigen::ColPivHouseholderQR<Matrix> qr(phi);
+        auto const rank = static_cast<size_t>(nl > 0 ? qr.rank() : 0);
+        auto basis = arena.Allocate<Operon::Scalar>(target.size() * rank);
+        if (rank > 0) {
+            // thin Q, without forming the full nr x nr matrix
+            Eigen::Map<Matrix>(basis.data(), nr, static_cast<Eigen::Index>(rank)) = qr.householderQ() * Matrix::Identity(nr, static_cast<Eigen::Index>(rank));
+        }
+
+        // the remaining coefficients are nonlinear
+        auto isLinear = arena.Allocate<bool>(np);
+        std::fill(isLinear.begin(), isLinear.end(), false);
+        for (auto const& t : terms) { isLinear[t.Coefficient] = true; }
+        auto const nn = static_cast<size_t>(std::count(isLinear.begin(), isLinear.end(), false));
+        auto nonlinear = arena.Allocate<size_t>(nn);
+        for (size_t i = 0, k = 0; i < np; ++i) {
+            if (!isLinear[i]) { nonlinear[k++] = i; }
+        }
+
+        ProjectedResidualEvaluator pre(interpreter, tree, dataset, target, range, nonlinear, basis, rank);
+        auto theta = arena.Allocate<Operon::Scalar>(nn);
+        for (size_t k = 0; k < nn; ++k) { theta[k] = coeff[nonlinear[k]]; }
+
+        if (nn > 0 && iterations > 0) {
+            Operon::TinyCostFunction<ProjectedResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor> cf(pre);
+            ceres::TinySolver<decltype(cf)> solver;
+            solver.options.max_num_iterations = static_cast<int>(iterations);
+            typename decltype(solver)::Parameters params = Eigen::Map<Vector>(theta.data(), static_cast<Eigen::Index>(nn)).template cast<typename decltype(cf)::Scalar>();
+            solver.Solve(cf, &params);
+            std::copy_n(params.data(), nn, theta.begin());
+            sum.Iterations = solver.summary.iterations;
+            sum.FunctionEvaluations += solver.summary.iterations;
+            sum.JacobianEvaluations += solver.summary.iterations;
+        }
+
+        // solve the linear coefficients for the final nonlinear ones: Phi * a = y - g(theta)
+        auto candidate = arena.Allocate<Operon::Scalar>(np);
+        std::fill(candidate.begin(), candidate.end(), Operon::Scalar { 0 });
+        for (size_t k = 0; k < nn; ++k) { candidate[nonlinear[k]] = theta[k]; }
+        if (nl > 0) {
+            interpreter.Evaluate<Operon::Scalar>(tree, dataset, range, residual, candidate.data());
+            Vector a = qr.solve(y - r);
+            for (Eigen::Index j = 0; j < nl; ++j) {
+                candidate[terms[j].Coefficient] = a(j);
+            }
+            ++sum.FunctionEvaluations;
+        }
+
+        re(candidate.data(), residual.data());
+        ++sum.FunctionEvaluations;
+        sum.FinalCost = 0.5 * r.squaredNorm();
+        sum.Success = std::isfinite(sum.FinalCost) && sum.FinalCost < sum.InitialCost;
+        if (writeCoefficients && sum.Success) {
+            tree.SetCoefficients(candidate);
+        }
+        return sum;
+    }
+};
+
+} // namespace Operon
+
+#endif
@@ -4,14 +4,23 @@
 #ifndef OPERON_CROSSOVER_HPP
 #define OPERON_CROSSOVER_HPP
 
+#include <utility>
 #include <vector>
 
+#include "operon/core/contracts.hpp"
 #include "operon/core/operator.hpp"
 #include "operon/core/tree.hpp"
 
 namespace Operon {
 // crossover takes two parent trees and returns a child
 struct CrossoverBase : public OperatorBase<Tree, const Tree&, const Tree&> {
+    using OperatorBase::operator();
+
+    // writes the child into a caller-provided tree, such that its storage can be reused (e.g. a buffer kept by each thread)
+    virtual auto operator()(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs, Tree& child) const -> void
+    {
+        child = (*this)(random, lhs, rhs);
+    }
 };
 
 class OPERON_EXPORT SubtreeCrossover : public CrossoverBase {
@@ -23,20 +32,38 @@ public:
     {
     }
     auto operator()(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs) const -> Tree override;
+    auto operator()(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs, Tree& child) const -> void override;
     auto FindCompatibleSwapLocations(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs) const -> std::pair<size_t, size_t>;
 
-    static inline auto Cross(const Tree& lhs, const Tree& rhs, /* index of subtree 1 */ size_t i, /* index of subtree 2 */ size_t j) -> Tree
+    static inline auto Cross(const Tree& lhs, const Tree& rhs, /* index of subtree 1 */ size_t i, /* index of subtree 2 */ size_t j, Tree& child) -> void
     {
+        EXPECT(&child != &lhs && &child != &rhs);
         auto const& left = lhs.Nodes();
         auto const& right = rhs.Nodes();
-        Operon::Vector<Node> nodes;
+        auto& nodes = child.Nodes();
         using signed_t = std::make_signed<size_t>::type; // NOLINT
+        nodes.clear();
         nodes.reserve(right[j].Length - left[i].Length + left.size());
-        std::copy_n(left.begin(), i - left[i].Length, back_inserter(nodes));
-        std::copy_n(right.begin() + static_cast<signed_t>(j) - right[j].Length, right[j].Length + 1, back_inserter(nodes));
-        std::copy_n(left.begin() + static_cast<signed_t>(i) + 1, left.size() - (i + 1), back_inserter(nodes));
+        nodes.insert(nodes.end(), left.begin(), left.begin() + static_cast<signed_t>(i - left[i].Length));
+        nodes.insert(nodes.end(), right.begin() + static_cast<signed_t>(j - right[j].Length), right.begin() + static_cast<signed_t>(j + 1));
+        nodes.insert(nodes.end(), left.begin() + static_cast<signed_t>(i + 1), left.end());
+
+        auto const begin = i - left[i].Length;
+        auto const end = begin + right[j].Length + 1;
+        child.UpdateNodes(begin, end, left[i].Length + 1U);
 
-        auto child = Tree(nodes).UpdateNodes();
+        // the child keeps the hash values of its parents when they are valid for the same mode, then only the ancestors
+        // of the swapped-in subtree need rehashing
+        auto const& a = lhs.GetHashState();
+        auto const& b = rhs.GetHashState();
+        child.SetHashState(a.Clean() && b.Clean() && a.Mode == b.Mode ? Tree::HashState { a.Mode } : Tree::HashState {});
+        child.Edited(end - 1, end);
+    }
+
+    static inline auto Cross(const Tree& lhs, const Tree& rhs, /* index of subtree 1 */ size_t i, /* index of subtree 2 */ size_t j) -> Tree
+    {
+        Tree child;
+        Cross(lhs, rhs, i, j, child);
         return child;
     }
 
@@ -0,0 +1,67 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_OPERATORS_CROWDING_HPP
+#define OPERON_OPERATORS_CROWDING_HPP
+
+#include <cstddef>                                   // for size_t
+#include <cstdint>                                   // for uint8_t
+#include <functional>                                // for reference_wrapper
+#include <vector>                                    // for vector
+#include "operon/core/individual.hpp"                // for Individual
+#include "operon/core/types.hpp"                     // for Span, Scalar
+#include "operon/operators/non_dominated_sorter.hpp" // for NondominatedSorterBase
+#include "operon/operon_export.hpp"                  // for OPERON_EXPORT
+
+// forward declaration
+namespace tf { class Executor; class Subflow; class Task; }
+
+namespace Operon {
+
+// the NSGA2 survival step: ranks a population in place by non-domination and crowding distance
+// - the population is sorted lexicographically in parallel; in this order, the fitness vectors equal (within eps) to
+//   the first one of their run are duplicates, which are moved behind the unique individuals and form the last front
+// - the unique individuals keep their lexicographical order when they are handed to the non-dominated sorter
+// - the crowding distance is computed per front (the fronts in parallel) from one argsort per objective over a
+//   contiguous row-major copy of the objectives
+// after sorting, pop[Fronts()[i][j]] belongs to front i and has Rank == i
+class OPERON_EXPORT CrowdingSorter {
+public:
+    explicit CrowdingSorter(NondominatedSorterBase const& sorter, Operon::Scalar eps = 0)
+        : sorter_(sorter)
+        , eps_(eps)
+    {
+    }
+
+    // appends the sorting tasks to the subflow and returns the last one; the population must not change until it completes
+    auto Sort(tf::Subflow& subflow, Operon::Span<Individual> pop) -> tf::Task;
+    auto Sort(tf::Executor& executor, Operon::Span<Individual> pop) -> void;
+
+    [[nodiscard]] auto Fronts() const -> NondominatedSorterBase::Result const& { return fronts_; }
+    [[nodiscard]] auto Epsilon() const -> Operon::Scalar { return eps_; }
+    auto SetEpsilon(Operon::Scalar eps) -> void { eps_ = eps; }
+
+private:
+    auto Load(Operon::Span<Individual const> pop, size_t i) -> void;
+    auto Deduplicate() -> void;
+    auto Rank(Operon::Span<Individual const> pop) -> void;
+    auto Crowding(Operon::Span<Individual> pop, size_t front) const -> void;
+
+    [[nodiscard]] auto Objective(size_t i, size_t obj) const -> Operon::Scalar { return objectives_[i * m_ + obj]; }
+
+    std::reference_wrapper<NondominatedSorterBase const> sorter_;
+    Operon::Scalar eps_;
+
+    size_t m_{0};
+    std::vector<Operon::Scalar> objectives_; // n x m, row-major
+    std::vector<uint8_t> duplicate_;         // per individual
+    std::vector<size_t> order_;              // the unique individuals followed by the duplicates
+    size_t unique_{0};
+    Operon::Vector<Individual> buffer_;      // scratch space for the permutation
+    std::vector<Operon::Scalar> scratch_;
+    NondominatedSorterBase::Result fronts_;
+};
+
+} // namespace Operon
+
+#endif
@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_DERIVATIVE_HPP
+#define OPERON_DERIVATIVE_HPP
+
+#include <limits>
+#include <vector>
+
+#include "operon/core/tree.hpp"
+#include "operon/core/types.hpp"
+#include "operon/operon_export.hpp"
+
+namespace Operon {
+
+// symbolic partial derivatives of a tree with respect to its coefficients (the nodes marked for optimization)
+// - each derivative is itself a tree that can be evaluated with the plain scalar interpreter
+// - the derivative trees contain copies of the primal subexpressions; the coefficient leaves in these copies keep
+//   their Optimize flag and are mapped back to the original coefficients (see Parameters below)
+// - derivatives of identical subtrees are generated only once and structurally identical derivative trees
+//   (detected via their CalculatedHashValue) are shared between coefficients
+// - Fmin, Fmax and dynamic symbols are not differentiable, in which case IsDifferentiable() returns false
+class OPERON_EXPORT SymbolicDerivative {
+public:
+    static constexpr size_t Zero = std::numeric_limits<size_t>::max(); // the partial derivative is identically zero
+
+    explicit SymbolicDerivative(Tree const& tree);
+
+    [[nodiscard]] auto IsDifferentiable() const -> bool { return differentiable_; }
+    [[nodiscard]] auto CoefficientsCount() const -> size_t { return columns_.size(); }
+
+    // the unique derivative trees
+    [[nodiscard]] auto Derivatives() const -> std::vector<Tree> const& { return derivatives_; }
+
+    // for the k-th derivative tree, the index of the original coefficient feeding each of its Optimize nodes
+    [[nodiscard]] auto Parameters(size_t k) const -> Operon::Span<size_t const> { return parameters_[k]; }
+
+    // the index of the derivative tree corresponding to the i-th coefficient, or Zero
+    [[nodiscard]] auto Column(size_t i) const -> size_t { return columns_[i]; }
+
+private:
+    std::vector<Tree> derivatives_;
+    std::vector<std::vector<size_t>> parameters_;
+    std::vector<size_t> columns_;
+    bool differentiable_ { true };
+};
+
+} // namespace Operon
+
+#endif
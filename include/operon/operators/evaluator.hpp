@@ -4,19 +4,61 @@
 #ifndef OPERON_EVALUATOR_HPP
 #define OPERON_EVALUATOR_HPP
 
+#include <algorithm>
 #include <atomic>
+#include <cmath>
+#include <memory>
+#include <optional>
+#include <thread>
 #include <utility>
 
 #include "operon/collections/projection.hpp"
+#include "operon/core/arena.hpp"
 #include "operon/core/individual.hpp"
 #include "operon/core/operator.hpp"
 #include "operon/core/problem.hpp"
 #include "operon/core/types.hpp"
+#include "operon/operators/fitness_cache.hpp"
 #include "operon/interpreter/interpreter.hpp"
 #include "operon/operon_export.hpp"
 
 namespace Operon {
 
+class CeresCostFunctionCache;
+
+// sufficient statistics of (estimated, target) pairs accumulated in a single streaming pass,
+// from which the built-in error metrics can be derived without revisiting the data
+struct PredictionStatistics {
+    double Count { 0 };
+    double MeanX { 0 };
+    double MeanY { 0 };
+    double M2X { 0 }; // sum of squared deviations from the mean
+    double M2Y { 0 };
+    double CXY { 0 }; // sum of co-deviations
+    double SSE { 0 }; // sum of squared errors
+    double SAE { 0 }; // sum of absolute errors
+
+    inline auto operator()(double x, double y) noexcept -> void
+    {
+        Count += 1;
+        auto const dx = x - MeanX;
+        auto const dy = y - MeanY;
+        MeanX += dx / Count;
+        MeanY += dy / Count;
+        M2X += dx * (x - MeanX);
+        M2Y += dy * (y - MeanY);
+        CXY += dx * (y - MeanY);
+        auto const e = x - y;
+        SSE += e * e;
+        SAE += std::abs(e);
+    }
+
+    [[nodiscard]] auto VarianceX() const noexcept -> double { return M2X / Count; }
+    [[nodiscard]] auto VarianceY() const noexcept -> double { return M2Y / Count; }
+    [[nodiscard]] auto Covariance() const noexcept -> double { return CXY / Count; }
+    [[nodiscard]] auto Correlation() const noexcept -> double { return CXY / std::sqrt(M2X * M2Y); }
+};
+
 struct OPERON_EXPORT ErrorMetric {
     using Iterator = Operon::Span<Operon::Scalar const>::iterator;
     using ProjIterator = ProjectionIterator<Iterator>;
@@ -30,36 +72,56 @@ struct OPERON_EXPORT ErrorMetric {
     virtual auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double = 0;
     virtual auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double = 0;
     virtual ~ErrorMetric() = default;
+
+    // metrics of the form g(mean(f(e))) are decomposable: their value over a range can be updated
+    // when rows are added or removed, using the mean term g^-1(value) over each part
+    [[nodiscard]] virtual auto Decomposable() const noexcept -> bool { return false; }
+    [[nodiscard]] virtual auto ToMean(double value) const noexcept -> double { return value; }
+    [[nodiscard]] virtual auto FromMean(double mean) const noexcept -> double { return mean; }
+
+    // the metric value derived from streaming statistics, if the metric supports it
+    [[nodiscard]] virtual auto FromStatistics(PredictionStatistics const& /*stats*/) const noexcept -> std::optional<double> { return std::nullopt; }
 };
 
 struct OPERON_EXPORT MSE : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto Decomposable() const noexcept -> bool override { return true; }
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override { return stats.SSE / stats.Count; }
 };
 
 struct OPERON_EXPORT NMSE : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override;
 };
 
 struct OPERON_EXPORT RMSE : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto Decomposable() const noexcept -> bool override { return true; }
+    [[nodiscard]] auto ToMean(double value) const noexcept -> double override { return value * value; }
+    [[nodiscard]] auto FromMean(double mean) const noexcept -> double override { return std::sqrt(mean); }
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override { return std::sqrt(stats.SSE / stats.Count); }
 };
 
 struct OPERON_EXPORT MAE : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto Decomposable() const noexcept -> bool override { return true; }
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override { return stats.SAE / stats.Count; }
 };
 
 struct OPERON_EXPORT R2 : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override;
 };
 
 struct OPERON_EXPORT C2 : public ErrorMetric {
     auto operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double override;
     auto operator()(Iterator beg1, Iterator end1, Iterator beg2) const noexcept -> double override;
+    [[nodiscard]] auto FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double> override;
 };
 
 auto OPERON_EXPORT FitLeastSquares(Operon::Span<float const> estimated, Operon::Span<float const> target) noexcept -> std::pair<double, double>;
@@ -84,6 +146,50 @@ struct EvaluatorBase : public OperatorBase<Operon::Vector<Operon::Scalar>, Indiv
     {
     }
 
+    // the same, but the work can be spawned as tasks of the subflow (they are joined when the calling task finishes)
+    virtual void Prepare(tf::Subflow& /*subflow*/, Operon::Span<Individual const> pop) const
+    {
+        Prepare(pop);
+    }
+
+    // called when the training data has changed (rows were appended and/or the training window moved)
+    // `previous` is the training range that was used to compute the current fitness of the individual
+    // the default implementation simply re-evaluates the individual on the current training range
+    virtual auto Update(Operon::RandomGenerator& random, Individual& ind, Range /*previous*/, Operon::Span<Operon::Scalar> buf) const -> ReturnType
+    {
+        return (*this)(random, ind, buf);
+    }
+
+    // evaluates a group of individuals, assigning their fitness (rngs[i] is the random generator of individual i)
+    // evaluators able to share work across individuals override this together with BatchSize
+    virtual auto Evaluate(Operon::Span<Operon::RandomGenerator> rngs, Operon::Span<Individual> individuals, Operon::Span<Operon::Scalar> buf) const -> void
+    {
+        for (size_t i = 0; i < individuals.size(); ++i) {
+            individuals[i].Fitness = (*this)(rngs[i], individuals[i], buf);
+        }
+    }
+
+    // preferred number of individuals per call to Evaluate
+    [[nodiscard]] virtual auto BatchSize() const -> size_t { return 1; }
+
+    // predicted cost of evaluating the individual, used to balance the work across threads:
+    // nodes x training rows x expected tree evaluations (the observed average, or one per local optimization
+    // iteration before any evaluation) for trees with coefficients, one evaluation otherwise
+    [[nodiscard]] virtual auto Cost(Individual const& ind) const -> double
+    {
+        auto const& tree = ind.Genotype;
+        auto evaluations { 1.0 };
+        if (tree.CoefficientsCount() > 0 && iterations_ > 0) {
+            auto const calls = CallCount.load();
+            evaluations = calls > 0
+                ? std::max(1.0, static_cast<double>(TotalEvaluations()) / static_cast<double>(calls))
+                : static_cast<double>(iterations_ + 1);
+        }
+        return static_cast<double>(tree.Length()) * static_cast<double>(problem_.get().TrainingRange().Size()) * evaluations;
+    }
+
+    // the budget counts the evaluations of trees on the training data (residuals and jacobians); the calls answered by a
+    // cache (see CachedEvaluator and SemanticCachedEvaluator) do not count towards it, they are reported by the cache
     auto TotalEvaluations() const -> size_t { return ResidualEvaluations + JacobianEvaluations; }
 
     void SetLocalOptimizationIterations(size_t value) { iterations_ = value; }
@@ -105,6 +211,18 @@ struct EvaluatorBase : public OperatorBase<Operon::Vector<Operon::Scalar>, Indiv
         CallCount = 0;
     }
 
+    // restores the counters (e.g. from a checkpoint); evaluators whose counters follow the ones of the evaluators they
+    // wrap pass them on, otherwise their next call would overwrite the restored values
+    virtual auto RestoreCounters(size_t residual, size_t jacobian, size_t calls) const -> void
+    {
+        ResidualEvaluations = residual;
+        JacobianEvaluations = jacobian;
+        CallCount = calls;
+    }
+
+    // appends the caches of this evaluator and of the evaluators it wraps (outermost first), for the checkpoints
+    virtual auto Caches(std::vector<std::reference_wrapper<FitnessCache>>& /*caches*/) const -> void { }
+
     private:
     Operon::Span<Operon::Individual const> population_;
     std::reference_wrapper<Problem> problem_;
@@ -156,10 +274,74 @@ public:
     auto
     operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
 
+    // when the error metric is decomposable and linear scaling is disabled, the fitness is updated
+    // incrementally by evaluating the individual only on the added and evicted rows
+    // - the coefficients are not tuned again on the new window, even with local optimization enabled
+    // - the fitness is recomputed in full at least once per turnover of the window, which bounds the accumulated rounding error
+    auto
+    Update(Operon::RandomGenerator& random, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+    // when batched optimization is enabled, the coefficients of the whole group are tuned
+    // together by a lockstep Levenberg-Marquardt solver (see BatchedLevenbergMarquardt)
+    // - the solver does not support row subsampling or variable projection, these fall back to one individual at a time
+    // - the evaluation budget is checked before each batch
+    auto Evaluate(Operon::Span<Operon::RandomGenerator> rngs, Operon::Span<Individual> individuals, Operon::Span<Operon::Scalar> buf) const -> void override;
+
+    // a batch size of zero disables the batched optimization
+    void SetBatchedOptimization(size_t batchSize) { batchSize_ = batchSize; }
+    [[nodiscard]] auto BatchedOptimization() const -> bool { return batchSize_ > 0; }
+    [[nodiscard]] auto BatchSize() const -> size_t override { return std::max({ batchSize_, dagSize_, size_t{1} }); }
+
+    // when dag evaluation is enabled, the fitness of a group of (at most `groupSize`) individuals is computed on a
+    // genotype dag, such that the subtrees they have in common are evaluated once (see GenotypeDag)
+    // - the coefficients are still optimized one individual at a time, unless the optimization is batched as well
+    // - only the evaluation is shared: the individuals keep their own genotypes
+    // (intended for converged populations with many duplicate subtrees, a group size of zero disables it)
+    void SetDagEvaluation(size_t groupSize) { dagSize_ = groupSize; }
+    [[nodiscard]] auto DagEvaluation() const -> bool { return dagSize_ > 0; }
+
+    // variable projection: the coefficients entering the output linearly (additive leaves) are solved
+    // by linear least squares and only the remaining ones are optimized iteratively
+    void SetVariableProjection(bool value) { projection_ = value; }
+    [[nodiscard]] auto VariableProjection() const -> bool { return projection_; }
+
+    // local optimization on a subset of the training rows, resampled for each individual
+    // (the fitness is still computed on the whole training range); a size of zero disables subsampling
+    // random: rows drawn uniformly without replacement, stratified: one row from each of `size` equal strata
+    // with a non-zero seed the subset is a function of the individual, otherwise it is drawn from the evaluator's random stream
+    enum class SubsampleMode : int { Random, Stratified };
+    void SetOptimizationSubsample(size_t size, SubsampleMode mode = SubsampleMode::Random, uint64_t seed = 0)
+    {
+        subsampleSize_ = size;
+        subsampleMode_ = mode;
+        subsampleSeed_ = seed;
+    }
+    [[nodiscard]] auto OptimizationSubsampleSize() const -> size_t { return subsampleSize_; }
+
+    // with the ceres backend, split the training range into residual blocks of `rows` rows which are evaluated
+    // in parallel on `threads` threads; the cost functions are cached and reused for trees of the same shape
+    // (intended for small populations on large datasets, a chunk size of zero disables the splitting)
+    void SetRowChunks(size_t rows, size_t threads = std::thread::hardware_concurrency());
+    [[nodiscard]] auto RowChunkSize() const -> size_t { return rowChunk_; }
+
 private:
+    auto ComputeFitness(Operon::RandomGenerator& random, Individual& ind, Operon::Span<Operon::Scalar> buf, bool optimize) const -> typename EvaluatorBase::ReturnType;
+    auto ComputeFitness(Operon::Span<Individual> individuals) const -> void; // on a genotype dag
+    auto Optimize(Operon::RandomGenerator& random, Individual& ind, MonotonicArena& arena) const -> void;
+    auto SampleRows(Operon::RandomGenerator& random, Individual const& ind, MonotonicArena& arena) const -> Operon::Span<size_t>;
+
     std::reference_wrapper<Interpreter> interpreter_;
     std::reference_wrapper<ErrorMetric const> error_;
     bool scaling_{false};
+    size_t batchSize_{0};
+    size_t dagSize_{0};
+    bool projection_{false};
+    size_t subsampleSize_{0};
+    SubsampleMode subsampleMode_{SubsampleMode::Random};
+    uint64_t subsampleSeed_{0};
+    size_t rowChunk_{0};
+    size_t rowChunkThreads_{1};
+    std::shared_ptr<CeresCostFunctionCache> costFunctionCache_;
 };
 
 class MultiEvaluator : public EvaluatorBase {
@@ -181,6 +363,13 @@ public:
         }
     }
 
+    auto Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void override
+    {
+        for (auto const& e : evaluators_) {
+            e.get().Prepare(subflow, pop);
+        }
+    }
+
     auto
     operator()(Operon::RandomGenerator& rng, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override
     {
@@ -202,10 +391,231 @@ public:
         return fit;
     }
 
+    auto
+    Update(Operon::RandomGenerator& rng, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override
+    {
+        // each child evaluator sees the remaining objectives starting with its own
+        auto const fitness = std::move(ind.Fitness);
+        Operon::Vector<Operon::Scalar> fit;
+        auto resEval{0UL};
+        auto jacEval{0UL};
+        auto eval{0UL};
+        for (auto const& ev : evaluators_) {
+            auto const offset = static_cast<std::ptrdiff_t>(std::min(fit.size(), fitness.size()));
+            ind.Fitness.assign(fitness.begin() + offset, fitness.end());
+            auto fitI = ev.get().Update(rng, ind, previous, buf);
+            std::copy(fitI.begin(), fitI.end(), std::back_inserter(fit));
+
+            resEval += ev.get().ResidualEvaluations;
+            jacEval += ev.get().JacobianEvaluations;
+            eval += ev.get().CallCount;
+        }
+        ResidualEvaluations = resEval;
+        JacobianEvaluations = jacEval;
+        CallCount = eval;
+        return fit;
+    }
+
+    [[nodiscard]] auto Cost(Individual const& ind) const -> double override
+    {
+        auto cost { 0.0 };
+        for (auto const& ev : evaluators_) {
+            cost += ev.get().Cost(ind);
+        }
+        return cost;
+    }
+
+    // the counters are the sums over the evaluators: the first one gets the restored totals, the others restart at zero
+    auto RestoreCounters(size_t residual, size_t jacobian, size_t calls) const -> void override
+    {
+        EvaluatorBase::RestoreCounters(residual, jacobian, calls);
+        for (size_t i = 0; i < evaluators_.size(); ++i) {
+            auto const first = i == 0;
+            evaluators_[i].get().RestoreCounters(first ? residual : 0, first ? jacobian : 0, first ? calls : 0);
+        }
+    }
+
+    auto Caches(std::vector<std::reference_wrapper<FitnessCache>>& caches) const -> void override
+    {
+        for (auto const& ev : evaluators_) {
+            ev.get().Caches(caches);
+        }
+    }
+
 private:
     std::vector<std::reference_wrapper<EvaluatorBase const>> evaluators_;
 };
 
+// looks up individuals in a fitness cache (by strict tree hash) before delegating to the wrapped evaluator
+// cache hits restore the cached fitness and optimized coefficients (like all cache hits, they do not count towards the
+// evaluation budget)
+class OPERON_EXPORT CachedEvaluator : public EvaluatorBase {
+public:
+    CachedEvaluator(Problem& problem, EvaluatorBase const& evaluator, FitnessCache& cache)
+        : EvaluatorBase(problem)
+        , evaluator_(evaluator)
+        , cache_(cache)
+    {
+        SetBudget(evaluator.Budget());
+        SetLocalOptimizationIterations(evaluator.LocalOptimizationIterations());
+    }
+
+    auto Prepare(Operon::Span<Operon::Individual const> pop) const -> void override
+    {
+        evaluator_.get().Prepare(pop);
+    }
+
+    auto Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void override
+    {
+        evaluator_.get().Prepare(subflow, pop);
+    }
+
+    auto
+    operator()(Operon::RandomGenerator& rng, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+    // the cached entries refer to the previous training range, so updates always go to the wrapped evaluator
+    auto
+    Update(Operon::RandomGenerator& rng, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+    [[nodiscard]] auto Cost(Individual const& ind) const -> double override { return evaluator_.get().Cost(ind); }
+
+    // the evaluations are counted by the wrapped evaluator (the calls answered by the cache included)
+    auto RestoreCounters(size_t residual, size_t jacobian, size_t calls) const -> void override
+    {
+        EvaluatorBase::RestoreCounters(residual, jacobian, calls);
+        evaluator_.get().RestoreCounters(residual, jacobian, calls);
+    }
+
+    auto Caches(std::vector<std::reference_wrapper<FitnessCache>>& caches) const -> void override
+    {
+        caches.push_back(cache_);
+        evaluator_.get().Caches(caches);
+    }
+
+    auto GetCache() const -> FitnessCache const& { return cache_; }
+    auto GetCache() -> FitnessCache& { return cache_; }
+
+private:
+    std::reference_wrapper<EvaluatorBase const> evaluator_;
+    std::reference_wrapper<FitnessCache> cache_;
+};
+
+// detects behaviourally duplicate individuals before their full evaluation, by their semantic fingerprint: the hash of
+// their outputs on a small fixed set of probe rows (evenly spaced over the training range), rounded to a relative
+// precision given by the resolution
+// - structurally different trees computing the same function (e.g. x + x and 2 * x) share a fingerprint; an individual
+//   whose fingerprint is already in the cache either inherits the cached fitness (Policy::Inherit) or gets the worst
+//   possible fitness (Policy::Reject), in both cases without running the wrapped evaluator or its local optimization
+// - the other individuals are evaluated by the wrapped evaluator and their fitness is stored under their fingerprint
+// the fingerprint is computed with the coefficients the individual has before local optimization; functions that only
+// agree on the probe rows are merged as well, so the probe set should not be too small
+// - the inherited fitness would not match the coefficients of the individual if the wrapped evaluator optimizes them
+//   (they are those of another tree), so Policy::Inherit requires a wrapped evaluator without local optimization: the
+//   constructor throws std::runtime_error otherwise
+// - like all cache hits, the hits do not count towards the evaluation budget (the fingerprints are not counted either)
+class OPERON_EXPORT SemanticCachedEvaluator : public EvaluatorBase {
+public:
+    enum class Policy : int { Inherit, Reject };
+
+    static constexpr size_t DefaultProbes { 32 };
+    static constexpr double DefaultResolution { 1e-5 };
+
+    SemanticCachedEvaluator(Problem& problem, Interpreter& interp, EvaluatorBase const& evaluator, FitnessCache& cache, Policy policy = Policy::Inherit, size_t probes = DefaultProbes, double resolution = DefaultResolution);
+
+    // the probe rows follow the training range, which may have changed since the last generation
+    auto Prepare(Operon::Span<Operon::Individual const> pop) const -> void override;
+    auto Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void override;
+
+    auto
+    operator()(Operon::RandomGenerator& rng, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+    // the cached entries refer to the previous training range, so updates always go to the wrapped evaluator
+    auto
+    Update(Operon::RandomGenerator& rng, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+    [[nodiscard]] auto Cost(Individual const& ind) const -> double override { return evaluator_.get().Cost(ind); }
+
+    [[nodiscard]] auto Fingerprint(Tree const& tree) const -> Operon::Hash;
+
+    [[nodiscard]] auto ProbeCount() const -> size_t { return probes_.Rows(); }
+
+    // the evaluations are counted by the wrapped evaluator
+    auto RestoreCounters(size_t residual, size_t jacobian, size_t calls) const -> void override
+    {
+        EvaluatorBase::RestoreCounters(residual, jacobian, calls);
+        evaluator_.get().RestoreCounters(residual, jacobian, calls);
+    }
+
+    auto Caches(std::vector<std::reference_wrapper<FitnessCache>>& caches) const -> void override
+    {
+        caches.push_back(cache_);
+        evaluator_.get().Caches(caches);
+    }
+
+    auto GetCache() const -> FitnessCache const& { return cache_; }
+    auto GetCache() -> FitnessCache& { return cache_; }
+
+private:
+    std::reference_wrapper<Interpreter const> interpreter_;
+    std::reference_wrapper<EvaluatorBase const> evaluator_;
+    std::reference_wrapper<FitnessCache> cache_;
+    Policy policy_;
+    size_t probeCount_;
+    double resolution_;
+
+    auto UpdateProbes() const -> void;
+
+    mutable Dataset probes_; // the probe rows of the training range below
+    mutable Range probeRange_;
+};
+
+// multi-objective evaluator that runs the interpreter once per individual: all prediction-based objectives
+// are derived from a single streaming pass over the predictions (metrics without FromStatistics support
+// are computed directly on the predictions); structural objectives are computed directly from the tree
+class OPERON_EXPORT FusedEvaluator : public EvaluatorBase {
+public:
+    enum class Structure : int { Length, Depth, VisitationLength };
+
+    FusedEvaluator(Problem& problem, Interpreter& interp, bool linearScaling = true)
+        : EvaluatorBase(problem)
+        , interpreter_(interp)
+        , scaling_(linearScaling)
+    {
+    }
+
+    // adds an objective computed from the predictions on the training range
+    auto Add(ErrorMetric const& metric) -> FusedEvaluator&
+    {
+        objectives_.push_back({ &metric, Structure::Length, 1 });
+        return *this;
+    }
+
+    // adds a structural objective, multiplied by the given scale (e.g. 1 / maximum length)
+    auto Add(Structure structure, Operon::Scalar scale = 1) -> FusedEvaluator&
+    {
+        objectives_.push_back({ nullptr, structure, scale });
+        return *this;
+    }
+
+    [[nodiscard]] auto ObjectiveCount() const -> size_t { return objectives_.size(); }
+
+    auto GetInterpreter() const -> Interpreter const& { return interpreter_; }
+
+    auto
+    operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
+
+private:
+    struct Objective {
+        ErrorMetric const* Metric; // nullptr for structural objectives
+        Structure Struct;
+        Operon::Scalar Scale;
+    };
+
+    std::reference_wrapper<Interpreter> interpreter_;
+    std::vector<Objective> objectives_;
+    bool scaling_ { false };
+};
+
 // a couple of useful user-defined evaluators (mostly to avoid calling lambdas from python)
 // TODO: think about a better design
 class LengthEvaluator : public UserDefinedEvaluator {
@@ -239,8 +649,12 @@ public:
     operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType override;
 
     auto Prepare(Operon::Span<Operon::Individual const> pop) const -> void override;
+    // the population is hashed in parallel before the subtrees are counted
+    auto Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void override;
 
 private:
+    auto Count(Operon::Span<Operon::Individual const> pop) const -> void;
+
     mutable robin_hood::unordered_flat_map<size_t, size_t> divmap_;
     mutable double total_{0}; // total count
     Operon::HashMode hashmode_;
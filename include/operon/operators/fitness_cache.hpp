@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_FITNESS_CACHE_HPP
+#define OPERON_FITNESS_CACHE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <robin_hood.h>
+#include <utility>
+#include <vector>
+
+#include "operon/core/range.hpp"
+#include "operon/core/types.hpp"
+#include "operon/operon_export.hpp"
+
+namespace Operon {
+
+// bounded concurrent map from strict tree hashes (or semantic fingerprints) to evaluation results
+// the key space is split into independently locked shards; each shard evicts its oldest entry when full
+class OPERON_EXPORT FitnessCache {
+public:
+    static constexpr size_t DefaultCapacity = 1UL << 16U;
+    static constexpr size_t DefaultShards = 64;
+
+    struct Entry {
+        Operon::Vector<Operon::Scalar> Fitness;
+        std::vector<Operon::Scalar> Coefficients; // coefficients after local optimization
+        Range TrainingRange;                      // entries computed on a different training range are stale
+    };
+
+    // the contents of the cache (e.g. for a checkpoint): the entries of each shard from the oldest to the newest,
+    // such that inserting them in this order into a cache of the same capacity and shard count evicts them in the
+    // same order again
+    struct State {
+        std::vector<std::pair<Operon::Hash, Entry>> Entries;
+        size_t Hits { 0 };
+        size_t Misses { 0 };
+    };
+
+    explicit FitnessCache(size_t capacity = DefaultCapacity, size_t shards = DefaultShards);
+
+    // returns true and fills the entry if the key is present and was computed on the given range
+    auto Find(Operon::Hash key, Range range, Entry& entry) const -> bool;
+    auto Insert(Operon::Hash key, Entry entry) -> void;
+    auto Clear() -> void;
+
+    [[nodiscard]] auto GetState() const -> State;
+    auto SetState(State const& state) -> void; // replaces the contents
+
+    [[nodiscard]] auto Capacity() const -> size_t { return shards_.size() * shardCapacity_; }
+    [[nodiscard]] auto Size() const -> size_t;
+
+    [[nodiscard]] auto Hits() const -> size_t { return hits_; }
+    [[nodiscard]] auto Misses() const -> size_t { return misses_; }
+    [[nodiscard]] auto HitRate() const -> double
+    {
+        auto const total = Hits() + Misses();
+        return total == 0 ? 0.0 : static_cast<double>(Hits()) / static_cast<double>(total);
+    }
+    auto ResetStatistics() -> void
+    {
+        hits_ = 0;
+        misses_ = 0;
+    }
+
+private:
+    struct Shard {
+        mutable std::mutex Mutex;
+        robin_hood::unordered_flat_map<Operon::Hash, Entry> Map;
+        std::vector<Operon::Hash> Keys; // insertion order ring used for eviction
+        size_t Next { 0 };
+    };
+
+    [[nodiscard]] auto GetShard(Operon::Hash key) const -> Shard& { return *shards_[key % shards_.size()]; }
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    size_t shardCapacity_;
+    mutable std::atomic_ulong hits_ { 0 };
+    mutable std::atomic_ulong misses_ { 0 };
+};
+
+} // namespace Operon
+
+#endif
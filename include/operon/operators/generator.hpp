@@ -4,6 +4,9 @@
 #ifndef OPERON_GENERATOR_HPP
 #define OPERON_GENERATOR_HPP
 
+#include <stdexcept>
+
+#include "operon/core/metrics.hpp"
 #include "operon/core/operator.hpp"
 #include "operon/operators/crossover.hpp"
 #include "operon/operators/evaluator.hpp"
@@ -42,14 +45,75 @@ public:
         return (*base)(random, pCrossover, pMutation, buf);
     };
 
+    // the same, but the child is written into the given individual, so that the storage of its genotype can be reused
+    // (e.g. an offspring slot of the previous generation); returns false if no child was produced
+    virtual auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool
+    {
+        auto result = (*this)(random, pCrossover, pMutation, buf);
+        if (result.has_value()) {
+            child = std::move(result.value());
+        }
+        return result.has_value();
+    }
+
+    // generators which do not need the fitness of a child in order to produce it can leave its evaluation to the caller,
+    // who can then evaluate all the offspring of a generation together (see CostScheduler)
+    [[nodiscard]] virtual auto DefersEvaluation() const -> bool { return false; }
+
+    // writes the child into the given individual without evaluating it; returns false if no child was produced
+    // (only available when DefersEvaluation() is true)
+    virtual auto Generate(Operon::RandomGenerator& /*random*/, double /*pCrossover*/, double /*pMutation*/, Individual& /*child*/) const -> bool
+    {
+        throw std::runtime_error("OffspringGeneratorBase: this generator does not defer the evaluation of its offspring");
+    }
+
     virtual auto Prepare(Operon::Span<Individual const> pop) const -> void
     {
         this->FemaleSelector().Prepare(pop);
         this->MaleSelector().Prepare(pop);
         this->Evaluator().Prepare(pop);
     }
+
+    // the same, the evaluator can prepare itself in parallel as tasks of the subflow
+    virtual auto Prepare(tf::Subflow& subflow, Operon::Span<Individual const> pop) const -> void
+    {
+        this->FemaleSelector().Prepare(pop);
+        this->MaleSelector().Prepare(pop);
+        this->Evaluator().Prepare(subflow, pop);
+    }
+
     [[nodiscard]] virtual auto Terminate() const -> bool { return evaluator_.get().BudgetExhausted(); }
 
+protected:
+    // produces the genotype of the child from its parents (the second one only takes part in crossover), reusing the
+    // storage of the child's genotype; the operators record what they changed, such that the evaluators only rehash
+    // that part of the child (see Tree::Rehash)
+    auto Vary(Operon::RandomGenerator& random, Tree const& first, Tree const* second, bool doMutation, Tree& child) const -> void
+    {
+        if (second != nullptr) {
+            Crossover()(random, first, *second, child);
+        } else {
+            child.Nodes().assign(first.Nodes().begin(), first.Nodes().end());
+            child.SetHashState(first.GetHashState());
+        }
+        if (doMutation) {
+            child = Mutator()(random, std::move(child));
+        }
+    }
+
+    // timed selection (see Metrics::Histogram::SelectionTime)
+    auto SelectFemale(Operon::RandomGenerator& random) const -> size_t
+    {
+        Metrics::ScopedTimer timer(Metrics::Histogram::SelectionTime);
+        return FemaleSelector()(random);
+    }
+
+    auto SelectMale(Operon::RandomGenerator& random) const -> size_t
+    {
+        Metrics::ScopedTimer timer(Metrics::Histogram::SelectionTime);
+        return MaleSelector()(random);
+    }
+
 private:
     std::reference_wrapper<EvaluatorBase> evaluator_;
     std::reference_wrapper<CrossoverBase> crossover_;
@@ -66,6 +130,10 @@ public:
     }
 
     auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual> override;
+    auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool override;
+
+    [[nodiscard]] auto DefersEvaluation() const -> bool override { return true; }
+    auto Generate(Operon::RandomGenerator& random, double pCrossover, double pMutation, Individual& child) const -> bool override;
 };
 
 class OPERON_EXPORT BroodOffspringGenerator : public OffspringGeneratorBase {
@@ -77,6 +145,7 @@ public:
     }
 
     auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual> override;
+    auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool override;
 
     void BroodSize(size_t value) { broodSize_ = value; }
     [[nodiscard]] auto BroodSize() const -> size_t { return broodSize_; }
@@ -96,6 +165,7 @@ public:
     }
 
     auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual> override;
+    auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool override;
 
     void PolygenicSize(size_t value) { broodSize_ = value; }
     [[nodiscard]] auto PolygenicSize() const -> size_t { return broodSize_; }
@@ -114,6 +184,7 @@ public:
     }
 
     auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual> override;
+    auto operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool override;
 
     void MaxSelectionPressure(size_t value) { maxSelectionPressure_ = value; }
     auto MaxSelectionPressure() const -> size_t { return maxSelectionPressure_; }
@@ -127,6 +198,12 @@ public:
         lastEvaluations_ = this->Evaluator().TotalEvaluations();
     }
 
+    void Prepare(tf::Subflow& subflow, const Operon::Span<const Individual> pop) const override
+    {
+        OffspringGeneratorBase::Prepare(subflow, pop);
+        lastEvaluations_ = this->Evaluator().TotalEvaluations();
+    }
+
     auto SelectionPressure() const -> double
     {
         auto n = this->FemaleSelector().Population().size();
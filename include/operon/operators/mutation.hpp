@@ -4,6 +4,7 @@
 #ifndef OPERON_MUTATION_HPP
 #define OPERON_MUTATION_HPP
 
+#include <iterator>
 #include <utility>
 
 #include "operon/core/operator.hpp"
@@ -24,12 +25,15 @@ template<typename Dist>
 struct OPERON_EXPORT OnePointMutation : public MutatorBase {
     auto operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree override
     {
+        auto const state = tree.GetHashState();
         auto& nodes = tree.Nodes();
         // sample a random leaf
         auto it = Operon::Random::Sample(random, nodes.begin(), nodes.end(), [](auto const& n) { return n.IsLeaf(); });
         EXPECT(it < nodes.end());
         it->Value += Dist(params_)(random);
 
+        auto const i = static_cast<size_t>(std::distance(nodes.begin(), it));
+        tree.SetHashState(state).Edited(i, i + 1);
         return tree;
     }
 
@@ -4,9 +4,14 @@
 #ifndef OPERON_OPERATORS_NONDOMINATED_SORTER_HPP
 #define OPERON_OPERATORS_NONDOMINATED_SORTER_HPP
 
+#include <memory>
+
 #include "operon/core/types.hpp"
 #include "operon/operon_export.hpp"
 
+// forward declaration
+namespace tf { class Executor; }
+
 namespace Operon {
 struct Individual;
 
@@ -72,5 +77,28 @@ struct OPERON_EXPORT RankIntersectSorter : public NondominatedSorterBase {
     auto Sort(Operon::Span<Operon::Individual const> pop, Operon::Scalar eps) const -> NondominatedSorterBase::Result override;
 };
 
+// RankIntersectSorter on its own thread pool (threads = 0 uses all the hardware threads), returning the same fronts
+// - the intersections of the intermediate objectives are done in parallel, over chunks of the sorted individuals
+// - sorting the next objective overlaps with the intersections of the current one
+// - the rank updates of the last objective remain sequential
+// the pool is separate from the caller's executor, so the sorter can be called from within a task
+class OPERON_EXPORT ParallelRankIntersectSorter : public NondominatedSorterBase {
+public:
+    static constexpr size_t ChunksPerWorker { 4 };
+
+    explicit ParallelRankIntersectSorter(size_t threads = 0);
+    ~ParallelRankIntersectSorter();
+
+    ParallelRankIntersectSorter(ParallelRankIntersectSorter const&) = delete;
+    ParallelRankIntersectSorter(ParallelRankIntersectSorter&&) noexcept;
+    auto operator=(ParallelRankIntersectSorter const&) -> ParallelRankIntersectSorter& = delete;
+    auto operator=(ParallelRankIntersectSorter&&) noexcept -> ParallelRankIntersectSorter&;
+
+    auto Sort(Operon::Span<Operon::Individual const> pop, Operon::Scalar eps) const -> NondominatedSorterBase::Result override;
+
+private:
+    std::unique_ptr<tf::Executor> executor_;
+};
+
 } // namespace Operon
 #endif
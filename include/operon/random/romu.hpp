@@ -4,6 +4,7 @@
 #ifndef OPERON_RANDOM_ROMU_HPP // NOLINT
 #define OPERON_RANDOM_ROMU_HPP // NOLINT
  // NOLINT
+#include <array> // NOLINT
 #include <cstddef> // NOLINT
 #include <cstdint> // NOLINT
 #include <limits> // NOLINT
@@ -61,6 +62,10 @@ namespace Random { // NOLINT
             return xp; // NOLINT
         } // NOLINT
  // NOLINT
+        // access to the internal state (e.g. for checkpointing) // NOLINT
+        using state_type = std::array<uint64_t, 3>; // NOLINT
+        inline auto State() const noexcept -> state_type { return { state.x, state.y, state.z }; } // NOLINT
+        inline void SetState(state_type const& s) noexcept { state = { s[0], s[1], s[2] }; } // NOLINT
  // NOLINT
     private: // NOLINT
         struct state { // NOLINT
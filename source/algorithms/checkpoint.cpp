@@ -0,0 +1,283 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <fmt/core.h>
+
+#include "operon/algorithms/checkpoint.hpp"
+#include "operon/core/node.hpp"
+#include "operon/core/tree.hpp"
+
+namespace Operon {
+
+namespace {
+    constexpr uint64_t Magic { 0x54504b434e52504fULL }; // "OPRNCKPT"
+    constexpr uint32_t Version { 2 };
+
+    struct Writer {
+        std::vector<std::byte>& Bytes; // NOLINT
+
+        template <typename T>
+        auto operator()(T const& value) -> void
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            auto const* p = reinterpret_cast<std::byte const*>(&value); // NOLINT
+            Bytes.insert(Bytes.end(), p, p + sizeof(T)); // NOLINT
+        }
+
+        auto operator()(Individual const& ind) -> void
+        {
+            (*this)(static_cast<uint64_t>(ind.Fitness.size()));
+            for (auto v : ind.Fitness) { (*this)(v); }
+            (*this)(static_cast<uint64_t>(ind.Rank));
+            (*this)(ind.Distance);
+            auto const& nodes = ind.Genotype.Nodes();
+            (*this)(static_cast<uint64_t>(nodes.size()));
+            for (auto const& n : nodes) {
+                (*this)(n.HashValue);
+                (*this)(n.CalculatedHashValue);
+                (*this)(n.Value);
+                (*this)(static_cast<uint32_t>(n.Type));
+                (*this)(n.Arity);
+                (*this)(static_cast<uint8_t>(n.Optimize));
+                (*this)(static_cast<uint8_t>(n.IsEnabled));
+            }
+        }
+
+        auto operator()(FitnessCache::State const& cache) -> void
+        {
+            (*this)(static_cast<uint64_t>(cache.Hits));
+            (*this)(static_cast<uint64_t>(cache.Misses));
+            (*this)(static_cast<uint64_t>(cache.Entries.size()));
+            for (auto const& [key, entry] : cache.Entries) {
+                (*this)(key);
+                (*this)(static_cast<uint64_t>(entry.Fitness.size()));
+                for (auto v : entry.Fitness) { (*this)(v); }
+                (*this)(static_cast<uint64_t>(entry.Coefficients.size()));
+                for (auto v : entry.Coefficients) { (*this)(v); }
+                (*this)(static_cast<uint64_t>(entry.TrainingRange.Start()));
+                (*this)(static_cast<uint64_t>(entry.TrainingRange.End()));
+            }
+        }
+    };
+
+    struct Reader {
+        Operon::Span<std::byte const> Bytes;
+        size_t Position{0};
+
+        template <typename T>
+        auto Read() -> T
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            if (Position + sizeof(T) > Bytes.size()) {
+                throw std::runtime_error("Checkpoint: unexpected end of data");
+            }
+            T value;
+            std::memcpy(&value, Bytes.data() + Position, sizeof(T)); // NOLINT
+            Position += sizeof(T);
+            return value;
+        }
+
+        // guards the allocations against corrupted sizes
+        auto Count(size_t elementSize) -> size_t
+        {
+            auto n = Read<uint64_t>();
+            if (n > (Bytes.size() - Position) / elementSize) {
+                throw std::runtime_error("Checkpoint: invalid element count");
+            }
+            return n;
+        }
+
+        auto ReadIndividual() -> Individual
+        {
+            Individual ind(Count(sizeof(Operon::Scalar)));
+            for (auto& v : ind.Fitness) { v = Read<Operon::Scalar>(); }
+            ind.Rank = Read<uint64_t>();
+            ind.Distance = Read<Operon::Scalar>();
+            auto const n = Count(sizeof(Operon::Hash));
+            Operon::Vector<Node> nodes;
+            nodes.reserve(n);
+            for (size_t i = 0; i < n; ++i) {
+                auto hash = Read<Operon::Hash>();
+                auto calculatedHash = Read<Operon::Hash>();
+                auto value = Read<Operon::Scalar>();
+                auto type = static_cast<NodeType>(Read<uint32_t>());
+                Node node(type, hash);
+                node.CalculatedHashValue = calculatedHash;
+                node.Value = value;
+                node.Arity = Read<decltype(Node::Arity)>();
+                node.Optimize = Read<uint8_t>() != 0;
+                node.IsEnabled = Read<uint8_t>() != 0;
+                nodes.push_back(node);
+            }
+            if (!nodes.empty()) {
+                ind.Genotype = Tree(std::move(nodes)).UpdateNodes();
+            }
+            return ind;
+        }
+
+        auto ReadCache() -> FitnessCache::State
+        {
+            FitnessCache::State cache;
+            cache.Hits = Read<uint64_t>();
+            cache.Misses = Read<uint64_t>();
+            // each entry takes at least a key, two counts and the range
+            constexpr size_t minEntrySize { 5 * sizeof(uint64_t) };
+            cache.Entries.resize(Count(minEntrySize));
+            for (auto& [key, entry] : cache.Entries) {
+                key = Read<Operon::Hash>();
+                entry.Fitness.resize(Count(sizeof(Operon::Scalar)));
+                for (auto& v : entry.Fitness) { v = Read<Operon::Scalar>(); }
+                entry.Coefficients.resize(Count(sizeof(Operon::Scalar)));
+                for (auto& v : entry.Coefficients) { v = Read<Operon::Scalar>(); }
+                auto const start = Read<uint64_t>();
+                auto const end = Read<uint64_t>();
+                if (start > end) {
+                    throw std::runtime_error("Checkpoint: invalid range");
+                }
+                entry.TrainingRange = Range { start, end };
+            }
+            return cache;
+        }
+    };
+} // namespace
+
+auto Checkpoint::Serialize() const -> std::vector<std::byte>
+{
+    std::vector<std::byte> bytes;
+    Writer write { bytes };
+
+    write(Magic);
+    write(Version);
+    write(static_cast<uint32_t>(sizeof(Operon::Scalar)));
+
+    write(static_cast<uint64_t>(Config.Generations));
+    write(static_cast<uint64_t>(Config.Evaluations));
+    write(static_cast<uint64_t>(Config.Iterations));
+    write(static_cast<uint64_t>(Config.PopulationSize));
+    write(static_cast<uint64_t>(Config.PoolSize));
+    write(static_cast<uint64_t>(Config.Seed));
+    write(static_cast<uint64_t>(Config.TimeLimit));
+    write(Config.CrossoverProbability);
+    write(Config.MutationProbability);
+    write(Config.Epsilon);
+
+    write(static_cast<uint64_t>(Generation));
+    write(static_cast<uint64_t>(Start));
+    write(Random);
+    write(static_cast<uint64_t>(Rngs.size()));
+    for (auto const& s : Rngs) { write(s); }
+
+    write(static_cast<uint64_t>(ResidualEvaluations));
+    write(static_cast<uint64_t>(JacobianEvaluations));
+    write(static_cast<uint64_t>(CallCount));
+
+    write(static_cast<uint64_t>(Individuals.size()));
+    for (auto const& ind : Individuals) { write(ind); }
+    write(static_cast<uint64_t>(Best.size()));
+    for (auto const& ind : Best) { write(ind); }
+    write(static_cast<uint64_t>(Caches.size()));
+    for (auto const& cache : Caches) { write(cache); }
+    return bytes;
+}
+
+auto Checkpoint::Deserialize(Operon::Span<std::byte const> bytes) -> Checkpoint
+{
+    Reader read { bytes };
+    if (read.Read<uint64_t>() != Magic) {
+        throw std::runtime_error("Checkpoint: not a checkpoint");
+    }
+    if (auto v = read.Read<uint32_t>(); v != Version) {
+        throw std::runtime_error(fmt::format("Checkpoint: unsupported version {}", v));
+    }
+    if (read.Read<uint32_t>() != sizeof(Operon::Scalar)) {
+        throw std::runtime_error("Checkpoint: scalar type mismatch");
+    }
+
+    Checkpoint cp;
+    cp.Config.Generations = read.Read<uint64_t>();
+    cp.Config.Evaluations = read.Read<uint64_t>();
+    cp.Config.Iterations = read.Read<uint64_t>();
+    cp.Config.PopulationSize = read.Read<uint64_t>();
+    cp.Config.PoolSize = read.Read<uint64_t>();
+    cp.Config.Seed = read.Read<uint64_t>();
+    cp.Config.TimeLimit = read.Read<uint64_t>();
+    cp.Config.CrossoverProbability = read.Read<double>();
+    cp.Config.MutationProbability = read.Read<double>();
+    cp.Config.Epsilon = read.Read<double>();
+
+    cp.Generation = read.Read<uint64_t>();
+    cp.Start = read.Read<uint64_t>();
+    cp.Random = read.Read<RandomState>();
+    cp.Rngs.resize(read.Count(sizeof(RandomState)));
+    for (auto& s : cp.Rngs) { s = read.Read<RandomState>(); }
+
+    cp.ResidualEvaluations = read.Read<uint64_t>();
+    cp.JacobianEvaluations = read.Read<uint64_t>();
+    cp.CallCount = read.Read<uint64_t>();
+
+    // each individual takes at least three 64-bit counts
+    constexpr size_t minIndividualSize { 3 * sizeof(uint64_t) };
+    cp.Individuals.resize(read.Count(minIndividualSize));
+    for (auto& ind : cp.Individuals) { ind = read.ReadIndividual(); }
+    cp.Best.resize(read.Count(minIndividualSize));
+    for (auto& ind : cp.Best) { ind = read.ReadIndividual(); }
+    // each cache takes at least three 64-bit counts
+    constexpr size_t minCacheSize { 3 * sizeof(uint64_t) };
+    cp.Caches.resize(read.Count(minCacheSize));
+    for (auto& cache : cp.Caches) { cache = read.ReadCache(); }
+    return cp;
+}
+
+auto Checkpoint::Save(std::string const& path) const -> void
+{
+    auto const bytes = Serialize();
+    // write to a temporary file first so that an interrupted write never destroys the previous checkpoint
+    auto const tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<char const*>(bytes.data()), static_cast<std::streamsize>(bytes.size())); // NOLINT
+        if (!out) {
+            throw std::runtime_error(fmt::format("Checkpoint: unable to write {}", tmp));
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error(fmt::format("Checkpoint: unable to rename {} to {}", tmp, path));
+    }
+}
+
+auto Checkpoint::Load(std::string const& path) -> Checkpoint
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error(fmt::format("Checkpoint: unable to open {}", path));
+    }
+    std::vector<char> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return Deserialize({ reinterpret_cast<std::byte const*>(data.data()), data.size() }); // NOLINT
+}
+
+auto CheckpointWriter::Write(Checkpoint const& checkpoint) -> bool
+{
+    std::lock_guard lock(mutex_);
+    // the background writes may complete out of order
+    if (any_ && checkpoint.Generation < written_) {
+        return true;
+    }
+    try {
+        checkpoint.Save(path_);
+    } catch (std::exception const& e) {
+        error_ = e.what();
+        return false;
+    }
+    written_ = checkpoint.Generation;
+    any_ = true;
+    return true;
+}
+
+} // namespace Operon
@@ -4,13 +4,21 @@
 #include <algorithm>                         // for max, min_element
 #include <atomic>                            // for atomic_bool
 #include <chrono>                            // for steady_clock
+#include <cmath>                             // for isfinite
+#include <functional>                        // for reference_wrapper
+#include <iterator>                          // for back_inserter
+#include <limits>                            // for numeric_limits
 #include <memory>                            // for allocator, allocator_tra...
 #include <optional>                          // for optional
+#include <stdexcept>                         // for runtime_error
 #include <taskflow/taskflow.hpp>             // for taskflow, subflow
+#include <utility>                           // for exchange
 #include <vector>                            // for vector, vector::size_type
 
 #include "operon/algorithms/gp.hpp"
+#include "operon/algorithms/scheduler.hpp"   // for CostScheduler, UpdatePopulation
 #include "operon/core/contracts.hpp"         // for ENSURE
+#include "operon/core/metrics.hpp"           // for ScopedTimer, Add
 #include "operon/core/operator.hpp"          // for OperatorBase
 #include "operon/core/problem.hpp"           // for Problem
 #include "operon/core/range.hpp"             // for Range
@@ -19,94 +27,272 @@
 #include "operon/operators/reinserter.hpp"   // for ReinserterBase
 
 namespace Operon {
-auto GeneticProgrammingAlgorithm::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> void
+auto GeneticProgrammingAlgorithm::DataChanged(tf::Executor& executor, Operon::RandomGenerator& random, Range previous) -> void
 {
-    const auto& config = GetConfig();
-    const auto& treeInit = GetTreeInitializer();
-    const auto& coeffInit = GetCoefficientInitializer();
-    const auto& generator = GetGenerator();
-    const auto& reinserter = GetReinserter();
-    const auto& problem = GetProblem();
-
-    auto t0 = std::chrono::steady_clock::now();
-    auto elapsed = [t0]() {
-        auto t1 = std::chrono::steady_clock::now();
-        constexpr double ms{1e3};
-        return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()) / ms;
-    };
+    if (!initialized_) {
+        return; // nothing to update, the population will be initialized by the next call to Run
+    }
 
-    // random seeds for each thread
-    size_t s = std::max(config.PopulationSize, config.PoolSize);
-    std::vector<Operon::RandomGenerator> rngs;
-    for (size_t i = 0; i < s; ++i) {
-        rngs.emplace_back(random());
+    UpdatePopulation(executor, GetGenerator().Evaluator(), parents_, random, previous);
+}
+
+auto GeneticProgrammingAlgorithm::Snapshot(Operon::RandomGenerator const& random) const -> Checkpoint
+{
+    auto const& evaluator = GetGenerator().Evaluator();
+    Checkpoint cp;
+    cp.Config = GetConfig();
+    cp.Generation = generation_;
+    cp.Start = start_;
+    cp.Random = random.State();
+    std::transform(rngs_.begin(), rngs_.end(), std::back_inserter(cp.Rngs), [](auto const& rng) { return rng.State(); });
+    cp.ResidualEvaluations = evaluator.ResidualEvaluations;
+    cp.JacobianEvaluations = evaluator.JacobianEvaluations;
+    cp.CallCount = evaluator.CallCount;
+    std::vector<std::reference_wrapper<FitnessCache>> caches;
+    evaluator.Caches(caches);
+    std::transform(caches.begin(), caches.end(), std::back_inserter(cp.Caches), [](auto const& cache) { return cache.get().GetState(); });
+    cp.Individuals.assign(individuals_.begin(), individuals_.end());
+    return cp;
+}
+
+auto GeneticProgrammingAlgorithm::Restore(Checkpoint const& checkpoint, Operon::RandomGenerator& random) -> void
+{
+    auto const& config = GetConfig();
+    if (checkpoint.Config.PopulationSize != config.PopulationSize || checkpoint.Config.PoolSize != config.PoolSize
+        || checkpoint.Individuals.size() != individuals_.size() || checkpoint.Rngs.size() != std::max(config.PopulationSize, config.PoolSize)) {
+        throw std::runtime_error("GeneticProgrammingAlgorithm: the checkpoint does not match the configuration");
     }
+    auto const& evaluator = GetGenerator().Evaluator();
+    std::vector<std::reference_wrapper<FitnessCache>> caches;
+    evaluator.Caches(caches);
+    if (checkpoint.Caches.size() != caches.size()) {
+        throw std::runtime_error("GeneticProgrammingAlgorithm: the checkpoint does not match the caches of the evaluator");
+    }
+    std::copy(checkpoint.Individuals.begin(), checkpoint.Individuals.end(), individuals_.begin());
+    generation_ = checkpoint.Generation;
+    start_ = checkpoint.Start;
+    random.SetState(checkpoint.Random);
+    rngs_.clear();
+    for (auto const& state : checkpoint.Rngs) {
+        rngs_.emplace_back(0).SetState(state);
+    }
+    evaluator.RestoreCounters(checkpoint.ResidualEvaluations, checkpoint.JacobianEvaluations, checkpoint.CallCount);
+    for (size_t i = 0; i < caches.size(); ++i) {
+        caches[i].get().SetState(checkpoint.Caches[i]);
+    }
+    initialized_ = true;
+    restored_ = true;
+}
+
+struct GeneticProgrammingAlgorithm::RunState {
+    tf::Taskflow Taskflow;
+    std::function<void()> Report;
+    std::chrono::steady_clock::time_point Start;
+    std::vector<Operon::Vector<Operon::Scalar>> Slots; // per-worker buffers for the evaluation
+    CostScheduler Scheduler;
+    std::vector<uint8_t> Produced;
+    std::vector<size_t> Children;
+};
 
-    auto idx = 0;
-    auto const& evaluator = generator.Evaluator();
+GeneticProgrammingAlgorithm::GeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator, ReinserterBase const& reinserter)
+    : problem_(problem)
+    , config_(config)
+    , treeInit_(treeInit)
+    , coeffInit_(coeffInit)
+    , generator_(generator)
+    , reinserter_(reinserter)
+    , arena_(config.UseNodeArena ? std::make_unique<NodeArena>() : nullptr)
+    , individuals_(config.PopulationSize + config.PoolSize)
+    , parents_(individuals_.data(), config.PopulationSize)
+    , offspring_(individuals_.data() + config.PopulationSize, config.PoolSize)
+{
+}
+
+GeneticProgrammingAlgorithm::~GeneticProgrammingAlgorithm() = default;
 
-    // we want to allocate all the memory that will be necessary for evaluation (e.g. for storing model responses)
-    // in one go and use it throughout the generations in order to minimize the memory pressure
-    auto trainSize = problem.TrainingRange().Size();
+// the task graph refers to the algorithm it was built for, so it is not moved along
+GeneticProgrammingAlgorithm::GeneticProgrammingAlgorithm(GeneticProgrammingAlgorithm&& other) noexcept
+    : problem_(other.problem_)
+    , config_(other.config_)
+    , treeInit_(other.treeInit_)
+    , coeffInit_(other.coeffInit_)
+    , generator_(other.generator_)
+    , reinserter_(other.reinserter_)
+    , arena_(std::move(other.arena_))
+    , individuals_(std::move(other.individuals_))
+    , parents_(other.parents_)
+    , offspring_(other.offspring_)
+    , generation_(other.generation_)
+    , initialized_(other.initialized_)
+    , rngs_(std::move(other.rngs_))
+    , start_(other.start_)
+    , restored_(other.restored_)
+    , checkpoint_(other.checkpoint_)
+{
+    other.run_.reset();
+}
 
+auto GeneticProgrammingAlgorithm::TaskGraph(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> tf::Taskflow&
+{
     ENSURE(executor.num_workers() > 0);
-    std::vector<Operon::Vector<Operon::Scalar>> slots(executor.num_workers());
+    if (!run_) {
+        run_ = std::make_unique<RunState>();
+    }
+    auto& state = *run_;
+    state.Taskflow.clear();
+    state.Report = std::move(report);
 
-    tf::Taskflow taskflow;
+    // the tasks only refer to the algorithm, its run state and the arguments, since they outlive this call
+    auto elapsed = [&state]() {
+        auto t1 = std::chrono::steady_clock::now();
+        constexpr double ms{1e3};
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t1 - state.Start).count()) / ms;
+    };
 
-    auto stop = [&]() {
-        return generator.Terminate() || generation_ == config.Generations || elapsed() > static_cast<double>(config.TimeLimit);
+    // when resuming (see DataChanged) the generation limit applies to the generations performed by this run,
+    // or by the interrupted run when continuing from a checkpoint
+    auto stop = [this, elapsed]() {
+        auto const& config = GetConfig();
+        return GetGenerator().Terminate() || generation_ - start_ == config.Generations || elapsed() > static_cast<double>(config.TimeLimit);
     };
 
+    // the buffers of the workers are allocated once and reused throughout the generations in order to minimize the
+    // memory pressure
+    auto evaluate = [this, &state, &executor](size_t k, Operon::Span<Individual> pop) {
+        auto& slot = state.Slots[executor.this_worker_id()];
+        auto const trainSize = GetProblem().TrainingRange().Size();
+        if (slot.size() < trainSize) {
+            slot.resize(trainSize);
+        }
+        state.Scheduler.Evaluate(k, GetGenerator().Evaluator(), pop, rngs_, slot);
+    };
+
+    auto progress = [&state]() { if (state.Report) { std::invoke(state.Report); } };
+
+    auto& taskflow = state.Taskflow;
+
     // while loop control flow
     auto [init, cond, body, back, done] = taskflow.emplace(
-        [&](tf::Subflow& subflow) {
-            auto init = subflow.for_each_index(size_t{0}, parents_.size(), size_t{1}, [&](size_t i) {
-                parents_[i].Genotype = treeInit(rngs[i]);
-                coeffInit(rngs[i], parents_[i].Genotype);
-            }).name("initialize population");
-            auto prepareEval = subflow.emplace([&]() { evaluator.Prepare(parents_); }).name("prepare evaluator");
-            auto eval = subflow.for_each_index(size_t{0}, parents_.size(), size_t{1}, [&](size_t i) {
-                auto id = executor.this_worker_id();
-                // make sure the worker has a large enough buffer
-                if (slots[id].size() < trainSize) {
-                    slots[id].resize(trainSize);
+        [this, &state, &executor, &random, progress, evaluate](tf::Subflow& subflow) {
+            auto const& config = GetConfig();
+            state.Start = std::chrono::steady_clock::now();
+            state.Slots.resize(executor.num_workers());
+            state.Produced.assign(offspring_.size(), 0);
+
+            // random seeds for each thread (when continuing from a checkpoint they are restored instead, see Restore)
+            if (!restored_) {
+                size_t s = std::max(config.PopulationSize, config.PoolSize);
+                rngs_.clear();
+                for (size_t i = 0; i < s; ++i) {
+                    rngs_.emplace_back(random());
                 }
-                parents_[i].Fitness = evaluator(rngs[i], parents_[i], slots[id]);
+                start_ = generation_;
+            }
+            restored_ = false;
+
+            if (initialized_) {
+                // resume from the current population
+                subflow.emplace(progress).name("report progress");
+                return;
+            }
+            auto init = subflow.for_each_index(size_t{0}, parents_.size(), size_t{1}, [this](size_t i) {
+                parents_[i].Genotype = GetTreeInitializer()(rngs_[i]);
+                GetCoefficientInitializer()(rngs_[i], parents_[i].Genotype);
+            }).name("initialize population");
+            auto prepareEval = subflow.emplace([this](tf::Subflow& sf) { GetGenerator().Evaluator().Prepare(sf, parents_); }).name("prepare evaluator");
+            // the population is evaluated in chunks of balanced predicted cost, the most expensive ones first
+            auto schedule = subflow.emplace([this, &state, &executor]() { state.Scheduler.Plan(GetGenerator().Evaluator(), parents_, executor.num_workers()); }).name("schedule evaluation");
+            auto eval = subflow.emplace([this, &state, evaluate](tf::Subflow& sf) {
+                sf.for_each_index(size_t{0}, state.Scheduler.Chunks(), size_t{1}, [this, evaluate](size_t k) { evaluate(k, parents_); });
             }).name("evaluate population");
-            auto reportProgress = subflow.emplace([&](){ if (report) { std::invoke(report); } }).name("report progress");
+            auto reportProgress = subflow.emplace([this, progress](){ initialized_ = true; progress(); }).name("report progress");
             init.precede(prepareEval);
-            prepareEval.precede(eval);
+            prepareEval.precede(schedule);
+            schedule.precede(eval);
             eval.precede(reportProgress);
         }, // init
         stop, // loop condition
-        [&](tf::Subflow& subflow) {
-            auto keepElite = subflow.emplace([&]() {
-                offspring_[0] = *std::min_element(parents_.begin(), parents_.end(), [&](const auto& lhs, const auto& rhs) { return lhs[idx] < rhs[idx]; });
+        [this, &state, &executor, &random, stop, progress, evaluate](tf::Subflow& subflow) {
+            // when the generator defers the evaluation, the offspring are evaluated together once they have all been produced
+            auto const deferred = GetGenerator().DefersEvaluation();
+            auto const idx = 0;
+
+            // the elite is swapped into the first offspring slot once the parents are no longer needed for selection;
+            // the vacated parent slot gets the worst possible fitness so that the reinserter discards it
+            auto keepElite = subflow.emplace([this, idx]() {
+                auto elite = std::min_element(parents_.begin(), parents_.end(), [&](const auto& lhs, const auto& rhs) { return lhs[idx] < rhs[idx]; });
+                std::swap(offspring_[0], *elite);
+                elite->Fitness.assign(offspring_[0].Size(), std::numeric_limits<Operon::Scalar>::max());
             }).name("keep elite");
-            auto prepareGenerator = subflow.emplace([&]() { generator.Prepare(parents_); }).name("prepare generator");
-            auto generateOffspring = subflow.for_each_index(size_t{1}, offspring_.size(), size_t{1}, [&](size_t i) {
-                auto buf = Operon::Span<Operon::Scalar>(slots[executor.this_worker_id()]);
+            // with a node arena, the genotypes of the population are packed back to back into its other buffer
+            auto packGenotypes = subflow.emplace([this]() { if (arena_) { arena_->Pack(individuals_); } }).name("pack genotypes");
+            auto prepareGenerator = subflow.emplace([this](tf::Subflow& sf) { GetGenerator().Prepare(sf, parents_); }).name("prepare generator");
+            auto generateOffspring = subflow.for_each_index(size_t{1}, offspring_.size(), size_t{1}, [this, &state, &executor, deferred, stop](size_t i) {
+                auto const& config = GetConfig();
+                auto const& generator = GetGenerator();
+                auto buf = Operon::Span<Operon::Scalar>(state.Slots[executor.this_worker_id()]);
                 while (!stop()) {
-                    if (auto result = generator(rngs[i], config.CrossoverProbability, config.MutationProbability, buf); result.has_value()) {
-                        offspring_[i] = std::move(result.value());
+                    Metrics::Add(Metrics::Counter::GeneratorAttempts);
+                    // the child is written into its slot, reusing the storage of the previous occupant
+                    if (deferred ? generator.Generate(rngs_[i], config.CrossoverProbability, config.MutationProbability, offspring_[i])
+                                 : generator(rngs_[i], config.CrossoverProbability, config.MutationProbability, buf, offspring_[i])) {
+                        state.Produced[i] = 1;
                         return;
                     }
                 }
             }).name("generate offspring");
-            auto reinsert = subflow.emplace([&]() { reinserter(random, parents_, offspring_); }).name("reinsert");
-            auto incrementGeneration = subflow.emplace([&]() { ++generation_; }).name("increment generation");
-            auto reportProgress = subflow.emplace([&](){ if (report) { std::invoke(report); } }).name("report progress");
+            // the offspring produced by a deferring generator are evaluated in chunks of balanced predicted cost
+            // (children left unevaluated because the budget ran out are not produced as far as reinsertion is concerned)
+            auto evaluateOffspring = subflow.emplace([this, &state, &executor, deferred, evaluate](tf::Subflow& sf) {
+                if (!deferred) { return; }
+                state.Children.clear();
+                for (size_t i = 0; i < state.Produced.size(); ++i) {
+                    if (state.Produced[i] != 0) { state.Children.push_back(i); }
+                }
+                state.Scheduler.Plan(GetGenerator().Evaluator(), offspring_, state.Children, executor.num_workers());
+                sf.for_each_index(size_t{0}, state.Scheduler.Chunks(), size_t{1}, [this, &state, evaluate](size_t k) {
+                    evaluate(k, offspring_);
+                    for (auto i : state.Scheduler.Chunk(k)) {
+                        if (!state.Scheduler.Evaluated(i)) { state.Produced[i] = 0; continue; }
+                        for (auto& v : offspring_[i].Fitness) {
+                            if (!std::isfinite(v)) { v = std::numeric_limits<Operon::Scalar>::max(); }
+                        }
+                    }
+                });
+            }).name("evaluate offspring");
+            auto reinsert = subflow.emplace([this, &state, &random]() {
+                Metrics::ScopedTimer timer(Metrics::Histogram::ReinsertionTime);
+                // only the elite and the produced children take part: the latter are moved to the front of the pool
+                // (slots left empty because the run was stopped keep their previous occupant, which is not reinserted)
+                size_t n = 1;
+                for (size_t i = 1; i < offspring_.size(); ++i) {
+                    if (std::exchange(state.Produced[i], 0) == 0) { continue; }
+                    if (n != i) { std::swap(offspring_[n], offspring_[i]); }
+                    ++n;
+                }
+                GetReinserter()(random, parents_, offspring_.first(n));
+            }).name("reinsert");
+            auto incrementGeneration = subflow.emplace([this]() { ++generation_; }).name("increment generation");
+            auto reportProgress = subflow.emplace(progress).name("report progress");
+            auto saveCheckpoint = subflow.emplace([this, &executor, &random]() {
+                if (checkpoint_ == nullptr || !checkpoint_->Due(generation_)) { return; }
+                // the state is copied here, while the serialization and the file output happen in the background
+                auto checkpoint = std::make_shared<Checkpoint>(Snapshot(random));
+                executor.silent_async([writer = checkpoint_, checkpoint]() { writer->Write(*checkpoint); });
+            }).name("checkpoint");
 
             // set-up subflow graph
-            keepElite.precede(prepareGenerator);
+            packGenotypes.precede(prepareGenerator);
             prepareGenerator.precede(generateOffspring);
-            generateOffspring.precede(reinsert);
+            generateOffspring.precede(evaluateOffspring);
+            evaluateOffspring.precede(keepElite);
+            keepElite.precede(reinsert);
             reinsert.precede(incrementGeneration);
             incrementGeneration.precede(reportProgress);
+            reportProgress.precede(saveCheckpoint);
         }, // loop body (evolutionary main loop)
-        [&]() { return 0; }, // jump back to the next iteration
-        [&]() { /* all done */ }  // work done, report last gen and stop
+        []() { return 0; }, // jump back to the next iteration
+        []() { /* all done */ }  // work done, report last gen and stop
     ); // evolutionary loop
 
     init.name("init");
@@ -121,7 +307,12 @@ auto GeneticProgrammingAlgorithm::Run(tf::Executor& executor, Operon::RandomGene
     body.precede(back);
     back.precede(cond);
 
-    executor.run(taskflow);
+    return taskflow;
+}
+
+auto GeneticProgrammingAlgorithm::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> void
+{
+    executor.run(TaskGraph(executor, random, std::move(report)));
     executor.wait_for_all();
 }
 
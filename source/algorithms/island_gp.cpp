@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>                         // for min, max_element, all_of
+#include <chrono>                            // for steady_clock
+#include <fmt/format.h>                      // for format
+#include <taskflow/taskflow.hpp>             // for Executor, Taskflow
+#include <thread>                            // for thread
+#include <vector>                            // for vector
+
+#include "operon/algorithms/island_gp.hpp"
+#include "operon/core/contracts.hpp"         // for EXPECT
+#include "operon/core/problem.hpp"           // for Problem
+
+namespace Operon {
+
+IslandGeneticProgrammingAlgorithm::IslandGeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, MigrationConfig migration,
+    TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit,
+    std::vector<std::reference_wrapper<OffspringGeneratorBase const>> const& generators, ReinserterBase const& reinserter,
+    ComparisonCallback comp)
+    : problem_(problem)
+    , config_(config)
+    , migration_(migration)
+    , comp_(std::move(comp))
+{
+    EXPECT(migration_.Islands > 0);
+    EXPECT(migration_.Interval > 0);
+    EXPECT(generators.size() == migration_.Islands);
+
+    // the islands keep references to their config, so both vectors must not reallocate
+    configs_.reserve(migration_.Islands);
+    islands_.reserve(migration_.Islands);
+    for (size_t i = 0; i < migration_.Islands; ++i) {
+        configs_.push_back(config);
+        islands_.emplace_back(problem, configs_.back(), treeInit, coeffInit, generators[i].get(), reinserter);
+    }
+}
+
+auto IslandGeneticProgrammingAlgorithm::Best() const -> Individual const&
+{
+    Individual const* best { nullptr };
+    for (auto const& island : islands_) {
+        for (auto const& ind : island.Parents()) {
+            if (best == nullptr || comp_(ind, *best)) {
+                best = &ind;
+            }
+        }
+    }
+    ENSURE(best != nullptr);
+    return *best;
+}
+
+auto IslandGeneticProgrammingAlgorithm::Migrate(Operon::RandomGenerator& random) -> void
+{
+    auto const n = islands_.size();
+    if (n < 2) {
+        return;
+    }
+
+    // all emigrants are collected before any immigrant is integrated, so that an individual moves at most once per step
+    std::vector<Operon::Vector<Individual>> inbox(n);
+    for (size_t i = 0; i < n; ++i) {
+        auto pop = islands_[i].Parents();
+        auto const emigrants = SelectEmigrants(random, pop, migration_.Emigration, comp_, migration_.Migrants);
+        for (auto t : MigrationTargets(random, migration_.Topology, i, n)) {
+            for (auto e : emigrants) {
+                inbox[t].push_back(pop[e]);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        auto pop = islands_[i].Parents();
+        auto& immigrants = inbox[i];
+        auto const replaced = SelectReplaced(random, pop, migration_.Immigration, comp_, immigrants.size());
+        for (size_t j = 0; j < replaced.size(); ++j) {
+            pop[replaced[j]] = std::move(immigrants[j]);
+        }
+    }
+}
+
+auto IslandGeneticProgrammingAlgorithm::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> void
+{
+    auto const& config = GetConfig();
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsed = [t0]() {
+        auto t1 = std::chrono::steady_clock::now();
+        return static_cast<size_t>(std::chrono::duration_cast<std::chrono::seconds>(t1 - t0).count());
+    };
+
+    std::vector<Operon::RandomGenerator> rngs;
+    for (size_t i = 0; i < islands_.size(); ++i) {
+        rngs.emplace_back(random());
+    }
+
+    // when resuming the generation limit applies to the generations performed by this call
+    auto const start = generation_;
+    auto stop = [&]() {
+        auto terminated = std::all_of(islands_.begin(), islands_.end(), [](auto const& island) { return island.GetGenerator().Terminate(); });
+        return terminated || generation_ - start >= config.Generations || elapsed() >= config.TimeLimit;
+    };
+
+    // the task graphs of the islands are the modules of a single taskflow, executed once per epoch: the end of the
+    // epoch is the only barrier
+    tf::Taskflow taskflow;
+    for (size_t i = 0; i < islands_.size(); ++i) {
+        taskflow.composed_of(islands_[i].TaskGraph(executor, rngs[i])).name(fmt::format("island {}", i));
+    }
+    taskflow.name("Islands");
+
+    auto epoch = [&](size_t generations) {
+        auto const timeLimit = config.TimeLimit - std::min(elapsed(), config.TimeLimit);
+        for (auto& c : configs_) {
+            c.Generations = generations;
+            c.TimeLimit = timeLimit;
+        }
+        executor.run(taskflow).wait();
+        auto it = std::max_element(islands_.begin(), islands_.end(), [](auto const& a, auto const& b) { return a.Generation() < b.Generation(); });
+        generation_ = it->Generation();
+    };
+
+    epoch(0); // initializes the populations (does nothing when resuming)
+    if (report) { std::invoke(report); }
+
+    while (!stop()) {
+        epoch(std::min(migration_.Interval, config.Generations - (generation_ - start)));
+        Migrate(random);
+        if (report) { std::invoke(report); }
+    }
+}
+
+auto IslandGeneticProgrammingAlgorithm::Run(Operon::RandomGenerator& random, std::function<void()> report, size_t threads) -> void {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    tf::Executor executor(threads);
+    Run(executor, random, std::move(report));
+}
+} // namespace Operon
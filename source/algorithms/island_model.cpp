@@ -0,0 +1,392 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <fmt/core.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define OPERON_HAVE_PROCESS_ISLANDS
+#endif
+
+#include "operon/algorithms/island_model.hpp"
+#include "operon/core/contracts.hpp"
+#include "operon/random/random.hpp"
+
+namespace Operon {
+
+namespace {
+    constexpr size_t CacheLineSize = 64;
+    constexpr std::chrono::milliseconds PollInterval { 1 }; // between checks for terminated islands
+
+    // sequence numbers are shared between processes, so they must not rely on a lock
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    struct InboxHeader {
+        alignas(CacheLineSize) std::atomic<uint64_t> Enqueue;
+        alignas(CacheLineSize) std::atomic<uint64_t> Dequeue;
+    };
+
+    struct SlotHeader {
+        std::atomic<uint64_t> Sequence;
+        uint32_t Length;
+        uint32_t Objectives;
+    };
+
+    constexpr auto RoundUp(size_t n, size_t m) -> size_t { return (n + m - 1) / m * m; }
+
+    auto FitnessOffset() -> size_t { return sizeof(SlotHeader); }
+    auto NodesOffset(MigrationConfig const& config) -> size_t
+    {
+        return RoundUp(FitnessOffset() + config.MaxObjectives * sizeof(Operon::Scalar), alignof(PackedNode));
+    }
+} // namespace
+
+MigrationChannel::MigrationChannel(MigrationConfig const& config)
+    : config_(config)
+    , inboxes_(config.Islands + 1) // the last inbox belongs to the parent process
+    , slotBytes_(RoundUp(NodesOffset(config) + config.MaxLength * sizeof(PackedNode), CacheLineSize))
+    , inboxBytes_(sizeof(InboxHeader) + config.Capacity * slotBytes_)
+    , size_(inboxes_ * inboxBytes_)
+    , data_(nullptr)
+{
+    EXPECT(config.Islands > 0);
+    EXPECT(config.Capacity > 0);
+    EXPECT(config.MaxLength > 0);
+    EXPECT(config.MaxObjectives > 0);
+
+#if defined(OPERON_HAVE_PROCESS_ISLANDS)
+    // the segment is unlinked right away: it stays alive as long as this process and its children have it mapped
+    auto const name = fmt::format("/operon-islands-{}-{}", ::getpid(), reinterpret_cast<uintptr_t>(this)); // NOLINT
+    auto fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR); // NOLINT
+    if (fd == -1) {
+        throw std::runtime_error(fmt::format("MigrationChannel: unable to create shared memory segment {}", name));
+    }
+    ::shm_unlink(name.c_str());
+    if (::ftruncate(fd, static_cast<off_t>(size_)) == -1) {
+        ::close(fd);
+        throw std::runtime_error(fmt::format("MigrationChannel: unable to resize shared memory segment to {} bytes", size_));
+    }
+    auto* ptr = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (ptr == MAP_FAILED) { // NOLINT
+        throw std::runtime_error("MigrationChannel: unable to map shared memory segment");
+    }
+    data_ = static_cast<std::byte*>(ptr);
+#else
+    throw std::runtime_error("MigrationChannel: shared memory islands are not supported on this platform");
+#endif
+
+    for (size_t i = 0; i < inboxes_; ++i) {
+        auto* header = new (data_ + i * inboxBytes_) InboxHeader; // NOLINT
+        header->Enqueue.store(0, std::memory_order_relaxed);
+        header->Dequeue.store(0, std::memory_order_relaxed);
+        for (size_t j = 0; j < config_.Capacity; ++j) {
+            auto* slot = new (Slot(i, j)) SlotHeader;
+            slot->Sequence.store(j, std::memory_order_relaxed);
+        }
+    }
+}
+
+MigrationChannel::~MigrationChannel()
+{
+#if defined(OPERON_HAVE_PROCESS_ISLANDS)
+    if (data_ != nullptr) {
+        ::munmap(data_, size_);
+    }
+#endif
+}
+
+auto MigrationChannel::Slot(size_t inbox, size_t index) const -> std::byte*
+{
+    return data_ + inbox * inboxBytes_ + sizeof(InboxHeader) + index * slotBytes_; // NOLINT
+}
+
+// bounded queue after D. Vyukov: each slot carries a sequence number telling producers and consumers whose turn it is
+auto MigrationChannel::Send(size_t inbox, Individual const& individual) -> bool
+{
+    EXPECT(inbox < inboxes_);
+    auto const& nodes = individual.Genotype.Nodes();
+    if (nodes.empty() || nodes.size() > config_.MaxLength || individual.Size() > config_.MaxObjectives) {
+        return false;
+    }
+
+    auto* header = reinterpret_cast<InboxHeader*>(data_ + inbox * inboxBytes_); // NOLINT
+    auto const capacity = config_.Capacity;
+    auto pos = header->Enqueue.load(std::memory_order_relaxed);
+    SlotHeader* slot {};
+    for (;;) {
+        slot = reinterpret_cast<SlotHeader*>(Slot(inbox, pos % capacity)); // NOLINT
+        auto seq = slot->Sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos);
+        if (diff == 0) {
+            if (header->Enqueue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = header->Enqueue.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto* bytes = reinterpret_cast<std::byte*>(slot); // NOLINT
+    slot->Length = static_cast<uint32_t>(nodes.size());
+    slot->Objectives = static_cast<uint32_t>(individual.Size());
+    std::memcpy(bytes + FitnessOffset(), individual.Fitness.data(), individual.Size() * sizeof(Operon::Scalar)); // NOLINT
+    auto* packed = reinterpret_cast<PackedNode*>(bytes + NodesOffset(config_)); // NOLINT
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        packed[i] = PackedNode(nodes[i]); // NOLINT
+    }
+    slot->Sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+auto MigrationChannel::Receive(size_t inbox, Individual& individual) -> bool
+{
+    EXPECT(inbox < inboxes_);
+    auto* header = reinterpret_cast<InboxHeader*>(data_ + inbox * inboxBytes_); // NOLINT
+    auto const capacity = config_.Capacity;
+    auto pos = header->Dequeue.load(std::memory_order_relaxed);
+    SlotHeader* slot {};
+    for (;;) {
+        slot = reinterpret_cast<SlotHeader*>(Slot(inbox, pos % capacity)); // NOLINT
+        auto seq = slot->Sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<int64_t>(seq) - static_cast<int64_t>(pos + 1);
+        if (diff == 0) {
+            if (header->Dequeue.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // empty
+        } else {
+            pos = header->Dequeue.load(std::memory_order_relaxed);
+        }
+    }
+
+    auto const* bytes = reinterpret_cast<std::byte const*>(slot); // NOLINT
+    auto const* fitness = reinterpret_cast<Operon::Scalar const*>(bytes + FitnessOffset()); // NOLINT
+    individual.Fitness.assign(fitness, fitness + slot->Objectives); // NOLINT
+    auto const* packed = reinterpret_cast<PackedNode const*>(bytes + NodesOffset(config_)); // NOLINT
+    Operon::Vector<Node> nodes;
+    nodes.reserve(slot->Length);
+    for (size_t i = 0; i < slot->Length; ++i) {
+        nodes.push_back(packed[i].Unpack()); // NOLINT
+    }
+    individual.Genotype = Tree(std::move(nodes)).UpdateNodes();
+    slot->Sequence.store(pos + capacity, std::memory_order_release);
+    return true;
+}
+
+auto MigrationChannel::Recover(size_t inbox) -> size_t
+{
+    EXPECT(inbox < inboxes_);
+    auto* header = reinterpret_cast<InboxHeader*>(data_ + inbox * inboxBytes_); // NOLINT
+    auto const capacity = config_.Capacity;
+    auto const end = header->Enqueue.load(std::memory_order_acquire);
+    auto pos = header->Dequeue.load(std::memory_order_relaxed);
+    size_t skipped = 0;
+    for (; pos < end; ++pos, ++skipped) {
+        auto* slot = reinterpret_cast<SlotHeader*>(Slot(inbox, pos % capacity)); // NOLINT
+        if (slot->Sequence.load(std::memory_order_acquire) != pos) {
+            break; // published, the migrant is there for Receive
+        }
+        slot->Sequence.store(pos + capacity, std::memory_order_release);
+    }
+    header->Dequeue.store(pos, std::memory_order_relaxed);
+    return skipped;
+}
+
+auto MigrationTargets(Operon::RandomGenerator& random, MigrationTopology topology, size_t island, size_t islands) -> std::vector<size_t>
+{
+    std::vector<size_t> targets;
+    if (islands < 2) {
+        return targets;
+    }
+    switch (topology) {
+    case MigrationTopology::Ring: {
+        targets.push_back((island + 1) % islands);
+        break;
+    }
+    case MigrationTopology::Random: {
+        auto t = std::uniform_int_distribution<size_t>(0, islands - 2)(random);
+        targets.push_back(t < island ? t : t + 1);
+        break;
+    }
+    case MigrationTopology::Complete: {
+        for (size_t t = 0; t < islands; ++t) {
+            if (t != island) {
+                targets.push_back(t);
+            }
+        }
+        break;
+    }
+    }
+    return targets;
+}
+
+auto SelectEmigrants(Operon::RandomGenerator& random, Operon::Span<Individual const> population, MigrationPolicy policy, ComparisonCallback const& comp, size_t count) -> std::vector<size_t>
+{
+    std::vector<size_t> indices(population.size());
+    std::iota(indices.begin(), indices.end(), 0UL);
+    auto const k = std::min(count, population.size());
+    std::vector<size_t> emigrants;
+    emigrants.reserve(k);
+    if (policy == MigrationPolicy::Best) {
+        std::partial_sort(indices.begin(), indices.begin() + static_cast<int64_t>(k), indices.end(), [&](auto i, auto j) { return comp(population[i], population[j]); });
+        emigrants.assign(indices.begin(), indices.begin() + static_cast<int64_t>(k));
+    } else {
+        Operon::Random::Sample(random, indices.begin(), indices.end(), std::back_inserter(emigrants), k);
+    }
+    return emigrants;
+}
+
+auto SelectReplaced(Operon::RandomGenerator& random, Operon::Span<Individual const> population, MigrationPolicy policy, ComparisonCallback const& comp, size_t count) -> std::vector<size_t>
+{
+    std::vector<size_t> indices(population.size());
+    std::iota(indices.begin(), indices.end(), 0UL);
+    auto const m = std::min(count, population.size());
+    std::vector<size_t> replaced;
+    replaced.reserve(m);
+    if (policy == MigrationPolicy::Best) {
+        std::partial_sort(indices.begin(), indices.begin() + static_cast<int64_t>(m), indices.end(), [&](auto i, auto j) { return comp(population[j], population[i]); });
+        replaced.assign(indices.begin(), indices.begin() + static_cast<int64_t>(m));
+    } else {
+        Operon::Random::Sample(random, indices.begin(), indices.end(), std::back_inserter(replaced), m);
+    }
+    return replaced;
+}
+
+auto Migrator::operator()(Operon::RandomGenerator& random, Operon::Span<Individual> population, size_t generation) const -> size_t
+{
+    auto& channel = channel_.get();
+    auto const& config = channel.Config();
+    auto const islands = config.Islands;
+
+    if (islands < 2 || population.empty() || generation == 0 || generation % config.Interval != 0) {
+        return 0;
+    }
+
+    // emigration
+    auto const emigrants = SelectEmigrants(random, population, config.Emigration, comp_, config.Migrants);
+    for (auto t : MigrationTargets(random, config.Topology, island_, islands)) {
+        for (auto i : emigrants) {
+            channel.Send(t, population[i]);
+        }
+    }
+
+    // immigration
+    Operon::Vector<Individual> immigrants;
+    Individual immigrant;
+    while (immigrants.size() < population.size() && channel.Receive(island_, immigrant)) {
+        if (immigrant.Size() == population.front().Size()) {
+            immigrants.push_back(std::move(immigrant));
+        }
+    }
+    if (immigrants.empty()) {
+        return 0;
+    }
+
+    auto const replaced = SelectReplaced(random, population, config.Immigration, comp_, immigrants.size());
+
+    // the replaced individual's rank and distance are kept until the algorithm recomputes them
+    for (size_t i = 0; i < replaced.size(); ++i) {
+        auto& ind = population[replaced[i]];
+        ind.Genotype = std::move(immigrants[i].Genotype);
+        ind.Fitness = std::move(immigrants[i].Fitness);
+    }
+    return replaced.size();
+}
+
+auto Migrator::Submit(Individual const& individual) const -> bool
+{
+    auto& channel = channel_.get();
+    return channel.Send(channel.Inboxes() - 1, individual);
+}
+
+auto IslandModel::Run(IslandCallback const& island) -> std::vector<int>
+{
+    results_.clear();
+    MigrationChannel channel(config_);
+    std::vector<int> status(config_.Islands, -1);
+
+    auto collect = [&]() {
+        Individual ind;
+        while (channel.Receive(channel.Inboxes() - 1, ind)) {
+            results_.push_back(std::move(ind));
+        }
+    };
+
+#if defined(OPERON_HAVE_PROCESS_ISLANDS)
+    std::vector<pid_t> pids(config_.Islands, -1);
+    for (size_t i = 0; i < config_.Islands; ++i) {
+        auto pid = ::fork();
+        if (pid == -1) {
+            // do not leave the islands started so far running on their own
+            for (size_t j = 0; j < i; ++j) {
+                ::kill(pids[j], SIGKILL);
+                while (::waitpid(pids[j], nullptr, 0) == -1 && errno == EINTR) { }
+            }
+            throw std::runtime_error(fmt::format("IslandModel: unable to start island {}", i));
+        }
+        if (pid == 0) {
+            int code = EXIT_FAILURE;
+            try {
+                Migrator migrator(channel, i, comp_);
+                code = island(i, migrator);
+            } catch (std::exception const& e) {
+                fmt::print(stderr, "island {}: {}\n", i, e.what());
+            }
+            ::_exit(code); // do not run the parent's destructors or atexit handlers
+        }
+        pids[i] = pid;
+    }
+
+    // a crashed island does not bring the others down: they keep evolving, and its inbox simply stops being drained.
+    // if it dies while sending, the inbox it was sending to stays blocked (see MigrationChannel) until the end of the run,
+    // which for an island inbox means no more immigrants; the result inbox is recovered below once every island is done
+    // only the island processes are waited for, the host's other children are left alone
+    size_t running = config_.Islands;
+    while (running > 0) {
+        for (size_t i = 0; i < pids.size(); ++i) {
+            if (pids[i] == -1) {
+                continue;
+            }
+            int wstatus {};
+            auto pid = ::waitpid(pids[i], &wstatus, WNOHANG);
+            if (pid == 0 || (pid == -1 && errno == EINTR)) {
+                continue; // still running
+            }
+            status[i] = pid == pids[i] && WIFEXITED(wstatus) ? WEXITSTATUS(wstatus) : -1; // NOLINT
+            pids[i] = -1;
+            --running;
+        }
+        collect(); // keep the result inbox from filling up
+        if (running > 0) {
+            std::this_thread::sleep_for(PollInterval);
+        }
+    }
+#endif
+    collect();
+    while (channel.Recover(channel.Inboxes() - 1) > 0) {
+        collect();
+    }
+    return status;
+}
+
+} // namespace Operon
@@ -5,15 +5,20 @@
 #include <atomic>                                    // for atomic_bool
 #include <chrono>                                    // for steady_clock
 #include <cmath>                                     // for isfinite
+#include <functional>                                // for reference_wrapper
 #include <iterator>                                  // for move_iterator, back_inse...
 #include <limits>                                    // for numeric_limits
 #include <memory>                                    // for allocator, allocator_tra...
 #include <optional>                                  // for optional
+#include <stdexcept>                                 // for runtime_error
 #include <taskflow/taskflow.hpp>                     // for taskflow, subflow
+#include <utility>                                   // for exchange
 #include <vector>                                    // for vector, vector::size_type
 
 #include "operon/algorithms/nsga2.hpp"
+#include "operon/algorithms/scheduler.hpp"           // for CostScheduler, UpdatePopulation
 #include "operon/core/contracts.hpp"                 // for ENSURE
+#include "operon/core/metrics.hpp"                   // for ScopedTimer, Add
 #include "operon/core/operator.hpp"                  // for OperatorBase
 #include "operon/core/problem.hpp"                   // for Problem
 #include "operon/core/range.hpp"                     // for Range
@@ -24,73 +29,80 @@
 
 namespace Operon {
 
-auto NSGA2::UpdateDistance(Operon::Span<Individual> pop) -> void
+auto NSGA2::Sort(tf::Subflow& subflow, Operon::Span<Individual> pop) -> void
 {
-    // assign distance. each front is sorted for each objective
-    size_t m = pop.front().Fitness.size();
-    auto inf = std::numeric_limits<Operon::Scalar>::max();
-    for (size_t i = 0; i < fronts_.size(); ++i) {
-        auto& front = fronts_[i];
-        for (size_t obj = 0; obj < m; ++obj) {
-            SingleObjectiveComparison comp(obj);
-            std::stable_sort(front.begin(), front.end(), [&](auto a, auto b) { return comp(pop[a], pop[b]); });
-            auto min = pop.front()[obj];
-            auto max = pop.back()[obj];
-            for (size_t j = 0; j < front.size(); ++j) {
-                auto idx = front[j];
-
-                pop[idx].Rank = i;
-                if (obj == 0) {
-                    pop[idx].Distance = 0;
-                }
+    ranking_.SetEpsilon(static_cast<Operon::Scalar>(GetConfig().Epsilon));
+    auto sort = ranking_.Sort(subflow, pop);
+    // update the best front
+    auto best = subflow.emplace([this, pop]() {
+        auto const& front = ranking_.Fronts().front();
+        best_.clear();
+        std::transform(front.begin(), front.end(), std::back_inserter(best_), [&](auto i) { return pop[i]; });
+    }).name("update best front");
+    sort.precede(best);
+}
 
-                auto mPrev = j > 0 ? pop[j - 1][obj] : inf;
-                auto mNext = j < front.size() - 1 ? pop[j + 1][obj] : inf;
-                auto distance = (mNext - mPrev) / (max - min);
-                if (!std::isfinite(distance)) {
-                    distance = 0;
-                }
-                pop[idx].Distance += distance;
-            }
-        }
+auto NSGA2::DataChanged(tf::Executor& executor, Operon::RandomGenerator& random, Range previous) -> void
+{
+    if (!initialized_) {
+        return; // nothing to update, the population will be initialized by the next call to Run
     }
+
+    UpdatePopulation(executor, GetGenerator().Evaluator(), parents_, random, previous);
+
+    tf::Taskflow taskflow;
+    taskflow.emplace([&](tf::Subflow& subflow) { Sort(subflow, parents_); });
+    executor.run(taskflow).wait();
 }
 
-auto NSGA2::Sort(Operon::Span<Individual> pop) -> void
+auto NSGA2::Snapshot(Operon::RandomGenerator const& random) const -> Checkpoint
 {
-    auto eps = static_cast<Operon::Scalar>(GetConfig().Epsilon);
-
-    Operon::Less less;
-    Operon::Equal eq;
-
-    // sort the population lexicographically
-    std::stable_sort(pop.begin(), pop.end(), [&](auto const& lhs, auto const& rhs) { return less(lhs.Fitness, rhs.Fitness, eps); });
-    // mark the duplicates for stable_partition
-    for(auto i = pop.begin(); i < pop.end(); ) {
-        i->Rank = 0;
-        auto j = i + 1;
-        for (; j < pop.end() && eq(i->Fitness, j->Fitness, eps); ++j) {
-            j->Rank = 1;
-        }
-        i = j;
+    auto const& evaluator = GetGenerator().Evaluator();
+    Checkpoint cp;
+    cp.Config = GetConfig();
+    cp.Generation = generation_;
+    cp.Start = start_;
+    cp.Random = random.State();
+    std::transform(rngs_.begin(), rngs_.end(), std::back_inserter(cp.Rngs), [](auto const& rng) { return rng.State(); });
+    cp.ResidualEvaluations = evaluator.ResidualEvaluations;
+    cp.JacobianEvaluations = evaluator.JacobianEvaluations;
+    cp.CallCount = evaluator.CallCount;
+    std::vector<std::reference_wrapper<FitnessCache>> caches;
+    evaluator.Caches(caches);
+    std::transform(caches.begin(), caches.end(), std::back_inserter(cp.Caches), [](auto const& cache) { return cache.get().GetState(); });
+    cp.Individuals.assign(individuals_.begin(), individuals_.end());
+    cp.Best.assign(best_.begin(), best_.end());
+    return cp;
+}
+
+auto NSGA2::Restore(Checkpoint const& checkpoint, Operon::RandomGenerator& random) -> void
+{
+    auto const& config = GetConfig();
+    if (checkpoint.Config.PopulationSize != config.PopulationSize || checkpoint.Config.PoolSize != config.PoolSize
+        || checkpoint.Individuals.size() != individuals_.size() || checkpoint.Rngs.size() != std::max(config.PopulationSize, config.PoolSize)) {
+        throw std::runtime_error("NSGA2: the checkpoint does not match the configuration");
     }
-    auto r = std::stable_partition(pop.begin(), pop.end(), [](auto const& ind) { return !ind.Rank; });
-    Operon::Span<Operon::Individual const> uniq(pop.begin(), r);
-    fronts_ = sorter_(uniq);
-    // sort the fronts for consistency between sorting algos
-    for (auto& f : fronts_) {
-        std::stable_sort(f.begin(), f.end());
+    auto const& evaluator = GetGenerator().Evaluator();
+    std::vector<std::reference_wrapper<FitnessCache>> caches;
+    evaluator.Caches(caches);
+    if (checkpoint.Caches.size() != caches.size()) {
+        throw std::runtime_error("NSGA2: the checkpoint does not match the caches of the evaluator");
     }
-    // banish the duplicates into the last front
-    if (r < pop.end()) {
-        std::vector<size_t> last(pop.size() - uniq.size());
-        std::iota(last.begin(), last.end(), uniq.size());
-        fronts_.push_back(last);
+    std::copy(checkpoint.Individuals.begin(), checkpoint.Individuals.end(), individuals_.begin());
+    best_.assign(checkpoint.Best.begin(), checkpoint.Best.end());
+    generation_ = checkpoint.Generation;
+    start_ = checkpoint.Start;
+    random.SetState(checkpoint.Random);
+    rngs_.clear();
+    for (auto const& state : checkpoint.Rngs) {
+        rngs_.emplace_back(0).SetState(state);
     }
-
-    UpdateDistance(pop); // calculate crowding distance
-    best_.clear();
-    std::transform(fronts_.front().begin(), fronts_.front().end(), std::back_inserter(best_), [&](auto i) { return pop[i]; }); // update best front
+    evaluator.RestoreCounters(checkpoint.ResidualEvaluations, checkpoint.JacobianEvaluations, checkpoint.CallCount);
+    for (size_t i = 0; i < caches.size(); ++i) {
+        caches[i].get().SetState(checkpoint.Caches[i]);
+    }
+    initialized_ = true;
+    restored_ = true;
 }
 
 auto NSGA2::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> void
@@ -109,12 +121,17 @@ auto NSGA2::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::fu
         return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()) / ms;
     };
 
-    // random seeds for each thread
-    size_t s = std::max(config.PopulationSize, config.PoolSize);
-    std::vector<Operon::RandomGenerator> rngs;
-    for (size_t i = 0; i < s; ++i) {
-        rngs.emplace_back(random());
+    // random seeds for each thread (when continuing from a checkpoint they are restored instead, see Restore)
+    if (!restored_) {
+        size_t s = std::max(config.PopulationSize, config.PoolSize);
+        rngs_.clear();
+        for (size_t i = 0; i < s; ++i) {
+            rngs_.emplace_back(random());
+        }
+        start_ = generation_;
     }
+    restored_ = false;
+    auto& rngs = rngs_;
 
     auto const& evaluator = generator.Evaluator();
 
@@ -124,60 +141,131 @@ auto NSGA2::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::fu
 
     ENSURE(executor.num_workers() > 0);
     std::vector<Operon::Vector<Operon::Scalar>> slots(executor.num_workers());
+    CostScheduler scheduler;
+    // when the generator defers the evaluation, the offspring are evaluated together once they have all been produced
+    auto const deferred = generator.DefersEvaluation();
+    std::vector<uint8_t> produced(offspring_.size(), 0);
+    std::vector<size_t> children;
+    Operon::Span<Individual> candidates; // the parents followed by the produced children
 
     tf::Taskflow taskflow;
 
+    // when resuming (see DataChanged) the generation limit applies to the generations performed by this call,
+    // or by the interrupted call when continuing from a checkpoint
+    auto const start = start_;
     auto stop = [&]() {
-        return generator.Terminate() || generation_ == config.Generations || elapsed() > static_cast<double>(config.TimeLimit);
+        return generator.Terminate() || generation_ - start == config.Generations || elapsed() > static_cast<double>(config.TimeLimit);
     };
 
     // while loop control flow
     auto [init, cond, body, back, done] = taskflow.emplace(
         [&](tf::Subflow& subflow) {
+            if (initialized_) {
+                // resume from the current population
+                subflow.emplace([&](){ if (report) { std::invoke(report); } }).name("report progress");
+                return;
+            }
             auto init = subflow.for_each_index(size_t{0}, parents_.size(), size_t{1}, [&](size_t i) {
                 parents_[i].Genotype = treeInit(rngs[i]);
                 coeffInit(rngs[i], parents_[i].Genotype);
             }).name("initialize population");
-            auto prepareEval = subflow.emplace([&]() { evaluator.Prepare(parents_); }).name("prepare evaluator");
-            auto eval = subflow.for_each_index(size_t{0}, parents_.size(), size_t{1}, [&](size_t i) {
-                auto id = executor.this_worker_id();
-                // make sure the worker has a large enough buffer
-                if (slots[id].size() < trainSize) {
-                    slots[id].resize(trainSize);
-                }
-                parents_[i].Fitness = evaluator(rngs[i], parents_[i], slots[id]);
+            auto prepareEval = subflow.emplace([&](tf::Subflow& sf) { evaluator.Prepare(sf, parents_); }).name("prepare evaluator");
+            // the population is evaluated in chunks of balanced predicted cost, the most expensive ones first
+            auto schedule = subflow.emplace([&]() { scheduler.Plan(evaluator, parents_, executor.num_workers()); }).name("schedule evaluation");
+            auto eval = subflow.emplace([&](tf::Subflow& sf) {
+                sf.for_each_index(size_t{0}, scheduler.Chunks(), size_t{1}, [&](size_t k) {
+                    auto id = executor.this_worker_id();
+                    // make sure the worker has a large enough buffer
+                    if (slots[id].size() < trainSize) {
+                        slots[id].resize(trainSize);
+                    }
+                    scheduler.Evaluate(k, evaluator, parents_, rngs, slots[id]);
+                });
             }).name("evaluate population");
-            auto nonDominatedSort = subflow.emplace([&]() { Sort(parents_); }).name("non-dominated sort");
-            auto reportProgress = subflow.emplace([&]() { if (report) { std::invoke(report); } }).name("report progress");
+            auto nonDominatedSort = subflow.emplace([&](tf::Subflow& sf) { Sort(sf, parents_); }).name("non-dominated sort");
+            auto reportProgress = subflow.emplace([&]() { initialized_ = true; if (report) { std::invoke(report); } }).name("report progress");
             init.precede(prepareEval);
-            prepareEval.precede(eval);
+            prepareEval.precede(schedule);
+            schedule.precede(eval);
             eval.precede(nonDominatedSort);
             nonDominatedSort.precede(reportProgress);
         }, // init
         stop, // loop condition
         [&](tf::Subflow& subflow) {
-            auto prepareGenerator = subflow.emplace([&]() { generator.Prepare(parents_); }).name("prepare generator");
+            // with a node arena, the genotypes of the population are packed back to back into its other buffer
+            auto packGenotypes = subflow.emplace([&]() { if (arena_) { arena_->Pack(individuals_); } }).name("pack genotypes");
+            auto prepareGenerator = subflow.emplace([&](tf::Subflow& sf) { generator.Prepare(sf, parents_); }).name("prepare generator");
             auto generateOffspring = subflow.for_each_index(size_t{0}, offspring_.size(), size_t{1}, [&](size_t i) {
                 auto buf = Operon::Span<Operon::Scalar>(slots[executor.this_worker_id()]);
                 while (!stop()) {
-                    if (auto result = generator(rngs[i], config.CrossoverProbability, config.MutationProbability, buf); result.has_value()) {
-                        offspring_[i] = std::move(result.value());
+                    Metrics::Add(Metrics::Counter::GeneratorAttempts);
+                    // the child is written into its slot, reusing the storage of the previous occupant
+                    if (deferred ? generator.Generate(rngs[i], config.CrossoverProbability, config.MutationProbability, offspring_[i])
+                                 : generator(rngs[i], config.CrossoverProbability, config.MutationProbability, buf, offspring_[i])) {
                         ENSURE(offspring_[i].Genotype.Length() > 0);
+                        produced[i] = 1;
                         return;
                     }
                 }
             }).name("generate offspring");
-            auto nonDominatedSort = subflow.emplace([&]() { Sort(individuals_); }).name("non-dominated sort");
-            auto reinsert = subflow.emplace([&]() { reinserter.Sort(individuals_); }).name("reinsert");
+            // the offspring produced by a deferring generator are evaluated in chunks of balanced predicted cost
+            // (children left unevaluated because the budget ran out are not produced as far as reinsertion is concerned)
+            auto evaluateOffspring = subflow.emplace([&](tf::Subflow& sf) {
+                if (!deferred) { return; }
+                children.clear();
+                for (size_t i = 0; i < produced.size(); ++i) {
+                    if (produced[i] != 0) { children.push_back(i); }
+                }
+                scheduler.Plan(evaluator, offspring_, children, executor.num_workers());
+                sf.for_each_index(size_t{0}, scheduler.Chunks(), size_t{1}, [&](size_t k) {
+                    auto id = executor.this_worker_id();
+                    // make sure the worker has a large enough buffer
+                    if (slots[id].size() < trainSize) {
+                        slots[id].resize(trainSize);
+                    }
+                    scheduler.Evaluate(k, evaluator, offspring_, rngs, slots[id]);
+                    for (auto i : scheduler.Chunk(k)) {
+                        if (!scheduler.Evaluated(i)) { produced[i] = 0; continue; }
+                        for (auto& v : offspring_[i].Fitness) {
+                            if (!std::isfinite(v)) { v = std::numeric_limits<Operon::Scalar>::max(); }
+                        }
+                    }
+                });
+            }).name("evaluate offspring");
+            auto nonDominatedSort = subflow.emplace([&](tf::Subflow& sf) {
+                // only the parents and the produced children take part: the latter are moved right after the parents
+                // (slots left empty because the run was stopped keep their previous occupant, which is not reinserted)
+                auto n = parents_.size();
+                for (size_t i = 0; i < offspring_.size(); ++i) {
+                    if (std::exchange(produced[i], 0) == 0) { continue; }
+                    if (n != parents_.size() + i) { std::swap(individuals_[n], offspring_[i]); }
+                    ++n;
+                }
+                candidates = Operon::Span<Individual>(individuals_).first(n);
+                Sort(sf, candidates);
+            }).name("non-dominated sort");
+            auto reinsert = subflow.emplace([&]() {
+                Metrics::ScopedTimer timer(Metrics::Histogram::ReinsertionTime);
+                reinserter.Sort(candidates);
+            }).name("reinsert");
             auto incrementGeneration = subflow.emplace([&]() { ++generation_; }).name("increment generation");
             auto reportProgress = subflow.emplace([&]() { if (report) { std::invoke(report); } }).name("report progress");
+            auto saveCheckpoint = subflow.emplace([&]() {
+                if (checkpoint_ == nullptr || !checkpoint_->Due(generation_)) { return; }
+                // the state is copied here, while the serialization and the file output happen in the background
+                auto checkpoint = std::make_shared<Checkpoint>(Snapshot(random));
+                executor.silent_async([writer = checkpoint_, checkpoint]() { writer->Write(*checkpoint); });
+            }).name("checkpoint");
 
             // set-up subflow graph
+            packGenotypes.precede(prepareGenerator);
             prepareGenerator.precede(generateOffspring);
-            generateOffspring.precede(nonDominatedSort);
+            generateOffspring.precede(evaluateOffspring);
+            evaluateOffspring.precede(nonDominatedSort);
             nonDominatedSort.precede(reinsert);
             reinsert.precede(incrementGeneration);
             incrementGeneration.precede(reportProgress);
+            reportProgress.precede(saveCheckpoint);
         }, // loop body (evolutionary main loop)
         [&]() { return 0; }, // jump back to the next iteration
         [&]() { /* done nothing to do */ } // work done, report last gen and stop
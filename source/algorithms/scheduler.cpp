@@ -0,0 +1,180 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>                         // for sort, min, max
+#include <chrono>                            // for steady_clock
+#include <functional>                        // for greater
+#include <limits>                            // for numeric_limits
+#include <numeric>                           // for iota
+#include <queue>                             // for priority_queue
+#include <taskflow/taskflow.hpp>             // for Executor, Taskflow
+#include <utility>                           // for pair
+
+#include "operon/algorithms/scheduler.hpp"
+#include "operon/core/contracts.hpp"         // for ENSURE
+#include "operon/core/metrics.hpp"           // for Record, Enabled
+#include "operon/core/problem.hpp"           // for Problem
+#include "operon/operators/evaluator.hpp"    // for EvaluatorBase
+
+namespace Operon {
+
+namespace {
+    // times a group of evaluations and records the time per unit of predicted cost
+    template <typename F>
+    auto Measure(double cost, F&& f) -> void
+    {
+        if (!Metrics::Enabled() || !(cost > 0)) {
+            std::forward<F>(f)();
+            return;
+        }
+        auto const t0 = std::chrono::steady_clock::now();
+        std::forward<F>(f)();
+        auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        constexpr double psPerNs { 1e3 };
+        Metrics::Record(Metrics::Histogram::CostRatio, static_cast<uint64_t>(static_cast<double>(elapsed) * psPerNs / cost));
+    }
+} // namespace
+
+auto CostScheduler::Plan(EvaluatorBase const& evaluator, Operon::Span<Individual const> pop, size_t workers) -> void
+{
+    std::vector<size_t> items(pop.size());
+    std::iota(items.begin(), items.end(), size_t { 0 });
+    Plan(evaluator, pop, items, workers);
+}
+
+auto CostScheduler::Plan(EvaluatorBase const& evaluator, Operon::Span<Individual const> pop, Operon::Span<size_t const> items, size_t workers) -> void
+{
+    auto const n = items.size();
+    costs_.assign(pop.size(), 0.0);
+    evaluated_.assign(pop.size(), 0);
+    for (auto i : items) {
+        costs_[i] = evaluator.Cost(pop[i]);
+    }
+
+    std::vector<size_t> idx(items.begin(), items.end());
+    std::sort(idx.begin(), idx.end(), [&](auto a, auto b) { return costs_[a] > costs_[b] || (costs_[a] == costs_[b] && a < b); });
+
+    auto const chunks = std::min(n, std::max(workers, size_t { 1 }) * std::max(chunksPerWorker_, size_t { 1 }));
+    std::vector<std::vector<size_t>> bins(chunks);
+    std::vector<double> loads(chunks, 0.0);
+
+    // min-heap of (load, chunk)
+    using Bin = std::pair<double, size_t>;
+    std::priority_queue<Bin, std::vector<Bin>, std::greater<>> heap;
+    for (size_t k = 0; k < chunks; ++k) {
+        heap.emplace(0.0, k);
+    }
+    for (auto i : idx) {
+        auto [load, k] = heap.top();
+        heap.pop();
+        bins[k].push_back(i);
+        loads[k] = load + costs_[i];
+        heap.emplace(loads[k], k);
+    }
+
+    std::vector<size_t> byLoad(chunks);
+    std::iota(byLoad.begin(), byLoad.end(), size_t { 0 });
+    std::stable_sort(byLoad.begin(), byLoad.end(), [&](auto a, auto b) { return loads[a] > loads[b]; });
+
+    order_.clear();
+    order_.reserve(n);
+    offsets_.assign(1, 0);
+    for (auto k : byLoad) {
+        order_.insert(order_.end(), bins[k].begin(), bins[k].end());
+        offsets_.push_back(order_.size());
+    }
+}
+
+auto CostScheduler::Evaluate(size_t chunk, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::Span<Operon::RandomGenerator> rngs, Operon::Span<Operon::Scalar> buf) -> void
+{
+    auto const items = Chunk(chunk);
+    auto const batchSize = std::max(evaluator.BatchSize(), size_t { 1 });
+
+    // the individuals left over when the budget runs out
+    auto skip = [&](Operon::Span<size_t const> rest) {
+        for (auto i : rest) {
+            std::fill(pop[i].Fitness.begin(), pop[i].Fitness.end(), std::numeric_limits<Operon::Scalar>::max());
+        }
+    };
+
+    if (batchSize == 1) {
+        for (size_t j = 0; j < items.size(); ++j) {
+            if (evaluator.BudgetExhausted()) {
+                skip(items.subspan(j));
+                return;
+            }
+            auto const i = items[j];
+            Measure(costs_[i], [&]() { evaluator.Evaluate(rngs.subspan(i, 1), pop.subspan(i, 1), buf); });
+            evaluated_[i] = 1;
+        }
+        return;
+    }
+
+    // the batched evaluators expect contiguous individuals, so each group and its random generators
+    // are moved into buffers and back
+    Operon::Vector<Individual> group;
+    Operon::Vector<Operon::RandomGenerator> groupRngs;
+    group.reserve(batchSize);
+    groupRngs.reserve(batchSize);
+    for (size_t j = 0; j < items.size(); j += batchSize) {
+        if (evaluator.BudgetExhausted()) {
+            skip(items.subspan(j));
+            return;
+        }
+        auto const groupItems = items.subspan(j, std::min(batchSize, items.size() - j));
+        auto cost { 0.0 };
+        group.clear();
+        groupRngs.clear();
+        for (auto i : groupItems) {
+            group.push_back(std::move(pop[i]));
+            groupRngs.push_back(std::move(rngs[i]));
+            cost += costs_[i];
+        }
+        Measure(cost, [&]() { evaluator.Evaluate(groupRngs, group, buf); });
+        for (size_t k = 0; k < groupItems.size(); ++k) {
+            pop[groupItems[k]] = std::move(group[k]);
+            rngs[groupItems[k]] = std::move(groupRngs[k]);
+            evaluated_[groupItems[k]] = 1;
+        }
+    }
+}
+
+auto CostScheduler::Update(size_t chunk, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::Span<Operon::RandomGenerator> rngs, Range previous, Operon::Span<Operon::Scalar> buf) const -> void
+{
+    for (auto i : Chunk(chunk)) {
+        Measure(costs_[i], [&]() { pop[i].Fitness = evaluator.Update(rngs[i], pop[i], previous, buf); });
+    }
+}
+
+auto UpdatePopulation(tf::Executor& executor, EvaluatorBase const& evaluator, Operon::Span<Individual> pop, Operon::RandomGenerator& random, Range previous) -> void
+{
+    auto const trainSize = evaluator.GetProblem().TrainingRange().Size();
+
+    std::vector<Operon::RandomGenerator> rngs;
+    for (size_t i = 0; i < pop.size(); ++i) {
+        rngs.emplace_back(random());
+    }
+
+    ENSURE(executor.num_workers() > 0);
+    std::vector<Operon::Vector<Operon::Scalar>> slots(executor.num_workers());
+    CostScheduler scheduler;
+
+    tf::Taskflow taskflow;
+    auto prepareEval = taskflow.emplace([&](tf::Subflow& subflow) { evaluator.Prepare(subflow, pop); });
+    auto schedule = taskflow.emplace([&]() { scheduler.Plan(evaluator, pop, executor.num_workers()); });
+    auto update = taskflow.emplace([&](tf::Subflow& subflow) {
+        subflow.for_each_index(size_t{0}, scheduler.Chunks(), size_t{1}, [&](size_t k) {
+            auto id = executor.this_worker_id();
+            // make sure the worker has a large enough buffer
+            if (slots[id].size() < trainSize) {
+                slots[id].resize(trainSize);
+            }
+            scheduler.Update(k, evaluator, pop, rngs, previous, slots[id]);
+        });
+    });
+    prepareEval.precede(schedule);
+    schedule.precede(update);
+    executor.run(taskflow).wait();
+}
+
+} // namespace Operon
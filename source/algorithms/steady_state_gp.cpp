@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>                         // for max, min
+#include <chrono>                            // for steady_clock
+#include <cmath>                             // for isfinite
+#include <limits>                            // for numeric_limits
+#include <random>                            // for uniform_int_distribution
+#include <taskflow/taskflow.hpp>             // for taskflow, subflow
+#include <vector>                            // for vector
+
+#include "operon/algorithms/steady_state_gp.hpp"
+#include "operon/algorithms/scheduler.hpp"   // for CostScheduler
+#include "operon/core/contracts.hpp"         // for ENSURE
+#include "operon/core/metrics.hpp"           // for ScopedTimer, Add
+#include "operon/core/problem.hpp"           // for Problem
+#include "operon/core/tree.hpp"              // for Tree
+#include "operon/operators/initializer.hpp"  // for CoefficientInitializerBase
+
+namespace Operon {
+
+namespace {
+    // non-finite qualities are mapped to the worst possible value so that they never win a comparison
+    auto Quality(Individual const& ind) -> Operon::Scalar
+    {
+        auto const q = ind[0];
+        return std::isfinite(q) ? q : std::numeric_limits<Operon::Scalar>::max();
+    }
+} // namespace
+
+SteadyStateGeneticProgrammingAlgorithm::SteadyStateGeneticProgrammingAlgorithm(Problem const& problem, GeneticAlgorithmConfig const& config, TreeInitializerBase const& treeInit, CoefficientInitializerBase const& coeffInit, OffspringGeneratorBase const& generator)
+    : problem_(problem)
+    , config_(config)
+    , treeInit_(treeInit)
+    , coeffInit_(coeffInit)
+    , generator_(generator)
+    , individuals_(config.PopulationSize)
+    , quality_(std::make_unique<std::atomic<Operon::Scalar>[]>(config.PopulationSize)) // NOLINT
+    , locks_(std::make_unique<std::mutex[]>(config.PopulationSize)) // NOLINT
+{
+}
+
+auto SteadyStateGeneticProgrammingAlgorithm::Select(Operon::RandomGenerator& random) const -> size_t
+{
+    Metrics::ScopedTimer timer(Metrics::Histogram::SelectionTime);
+    std::uniform_int_distribution<size_t> uniform(0, individuals_.size() - 1);
+    auto best = uniform(random);
+    for (size_t i = 1; i < selectionSize_; ++i) {
+        auto curr = uniform(random);
+        if (quality_[curr].load(std::memory_order_relaxed) < quality_[best].load(std::memory_order_relaxed)) {
+            best = curr;
+        }
+    }
+    return best;
+}
+
+auto SteadyStateGeneticProgrammingAlgorithm::Victim(Operon::RandomGenerator& random) const -> size_t
+{
+    auto const n = individuals_.size();
+    auto worst = size_t{0};
+    if (replacement_ == Replacement::Worst) {
+        for (size_t i = 1; i < n; ++i) {
+            if (quality_[worst].load(std::memory_order_relaxed) < quality_[i].load(std::memory_order_relaxed)) {
+                worst = i;
+            }
+        }
+        return worst;
+    }
+    std::uniform_int_distribution<size_t> uniform(0, n - 1);
+    worst = uniform(random);
+    for (size_t i = 1; i < replacementSize_; ++i) {
+        auto curr = uniform(random);
+        if (quality_[worst].load(std::memory_order_relaxed) < quality_[curr].load(std::memory_order_relaxed)) {
+            worst = curr;
+        }
+    }
+    return worst;
+}
+
+auto SteadyStateGeneticProgrammingAlgorithm::Insert(Operon::RandomGenerator& random, Individual& child) -> bool
+{
+    Metrics::ScopedTimer timer(Metrics::Histogram::ReinsertionTime);
+    auto const q = Quality(child);
+    auto const victim = Victim(random);
+
+    std::shared_lock barrier(barrier_);
+    std::lock_guard lock(locks_[victim]);
+    // the slot may have been replaced since the victim was chosen, so compare again under the lock
+    if (!(q < quality_[victim].load(std::memory_order_relaxed))) {
+        return false;
+    }
+    std::swap(individuals_[victim], child);
+    quality_[victim].store(q, std::memory_order_relaxed);
+    ++inserted_;
+    return true;
+}
+
+auto SteadyStateGeneticProgrammingAlgorithm::Run(tf::Executor& executor, Operon::RandomGenerator& random, std::function<void()> report) -> void
+{
+    const auto& config = GetConfig();
+    const auto& treeInit = GetTreeInitializer();
+    const auto& coeffInit = GetCoefficientInitializer();
+    const auto& generator = GetGenerator();
+    const auto& problem = GetProblem();
+
+    EXPECT(config.PoolSize > 0);
+    EXPECT(!individuals_.empty());
+
+    auto t0 = std::chrono::steady_clock::now();
+    auto elapsed = [t0]() {
+        auto t1 = std::chrono::steady_clock::now();
+        constexpr double ms{1e3};
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count()) / ms;
+    };
+
+    ENSURE(executor.num_workers() > 0);
+    auto const workers = executor.num_workers();
+
+    // random seeds for each individual (initialization) and for each worker (main loop)
+    size_t s = std::max(individuals_.size(), workers);
+    std::vector<Operon::RandomGenerator> rngs;
+    for (size_t i = 0; i < s; ++i) {
+        rngs.emplace_back(random());
+    }
+
+    auto const& evaluator = generator.Evaluator();
+    auto const& crossover = generator.Crossover();
+    auto const& mutator = generator.Mutator();
+
+    auto trainSize = problem.TrainingRange().Size();
+    std::vector<Operon::Vector<Operon::Scalar>> slots(workers);
+    CostScheduler scheduler;
+
+    // when resuming the generation limit applies to the generations performed by this call
+    auto const start = generation_.load();
+    auto stop = [&]() {
+        return generator.Terminate() || generation_ - start >= config.Generations || elapsed() > static_cast<double>(config.TimeLimit);
+    };
+
+    auto synchronize = [&]() {
+        for (size_t i = 0; i < individuals_.size(); ++i) {
+            quality_[i].store(Quality(individuals_[i]), std::memory_order_relaxed);
+        }
+    };
+
+    // copy the genotype of a parent into a buffer of the worker, guarding against a concurrent replacement of its slot
+    auto copy = [&](size_t i, Tree& tree) {
+        std::lock_guard lock(locks_[i]);
+        auto const& nodes = individuals_[i].Genotype.Nodes();
+        tree.Nodes().assign(nodes.begin(), nodes.end());
+    };
+
+    // the generation boundary: insertions are paused and the report callback may inspect or modify the population
+    auto advance = [&]() {
+        std::unique_lock barrier(barrier_);
+        for (size_t i = 0; i < individuals_.size(); ++i) { locks_[i].lock(); }
+        ++generation_;
+        if (report) { std::invoke(report); }
+        synchronize();
+        for (size_t i = 0; i < individuals_.size(); ++i) { locks_[i].unlock(); }
+    };
+
+    produced_ = 0;
+    tf::Taskflow taskflow;
+
+    auto init = taskflow.emplace([&](tf::Subflow& subflow) {
+        if (initialized_) {
+            synchronize();
+            if (report) { std::invoke(report); }
+            return;
+        }
+        auto initialize = subflow.for_each_index(size_t{0}, individuals_.size(), size_t{1}, [&](size_t i) {
+            individuals_[i].Genotype = treeInit(rngs[i]);
+            coeffInit(rngs[i], individuals_[i].Genotype);
+        }).name("initialize population");
+        auto prepareEval = subflow.emplace([&](tf::Subflow& sf) { evaluator.Prepare(sf, individuals_); }).name("prepare evaluator");
+        // the population is evaluated in chunks of balanced predicted cost, the most expensive ones first
+        auto schedule = subflow.emplace([&]() { scheduler.Plan(evaluator, individuals_, executor.num_workers()); }).name("schedule evaluation");
+        auto eval = subflow.emplace([&](tf::Subflow& sf) {
+            sf.for_each_index(size_t{0}, scheduler.Chunks(), size_t{1}, [&](size_t k) {
+                auto id = executor.this_worker_id();
+                // make sure the worker has a large enough buffer
+                if (slots[id].size() < trainSize) {
+                    slots[id].resize(trainSize);
+                }
+                scheduler.Evaluate(k, evaluator, individuals_, rngs, slots[id]);
+            });
+        }).name("evaluate population");
+        auto reportProgress = subflow.emplace([&]() {
+            synchronize();
+            initialized_ = true;
+            if (report) { std::invoke(report); }
+        }).name("report progress");
+        initialize.precede(prepareEval);
+        prepareEval.precede(schedule);
+        schedule.precede(eval);
+        eval.precede(reportProgress);
+    }).name("init");
+
+    auto evolve = taskflow.for_each_index(size_t{0}, workers, size_t{1}, [&](size_t w) {
+        auto& rng = rngs[w];
+        auto id = executor.this_worker_id();
+        if (slots[id].size() < trainSize) {
+            slots[id].resize(trainSize);
+        }
+        auto buf = Operon::Span<Operon::Scalar>(slots[id]);
+
+        // the parents and the child are buffers of the worker, whose storage is reused across iterations
+        Tree first;
+        Tree second;
+        Individual child(0);
+
+        while (!stop()) {
+            Metrics::Add(Metrics::Counter::GeneratorAttempts);
+            bool doCrossover = std::bernoulli_distribution(config.CrossoverProbability)(rng);
+            bool doMutation = std::bernoulli_distribution(config.MutationProbability)(rng);
+            if (!(doCrossover || doMutation)) {
+                continue;
+            }
+
+            copy(Select(rng), first);
+            if (doCrossover) {
+                copy(Select(rng), second);
+                crossover(rng, first, second, child.Genotype);
+            } else {
+                Swap(child.Genotype, first);
+            }
+            if (doMutation) {
+                child.Genotype = mutator(rng, std::move(child.Genotype));
+            }
+            child.Fitness = evaluator(rng, child, buf);
+            for (auto& v : child.Fitness) {
+                if (!std::isfinite(v)) { v = std::numeric_limits<Operon::Scalar>::max(); }
+            }
+            Insert(rng, child);
+
+            if (++produced_ % config.PoolSize == 0) {
+                advance();
+            }
+        }
+    }).name("steady-state loop");
+
+    init.precede(evolve);
+    taskflow.name("steady-state GP");
+
+    executor.run(taskflow);
+    executor.wait_for_all();
+}
+
+auto SteadyStateGeneticProgrammingAlgorithm::Run(Operon::RandomGenerator& random, std::function<void()> report, size_t threads) -> void {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    tf::Executor executor(threads);
+    Run(executor, random, std::move(report));
+}
+} // namespace Operon
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>
+#include <new>
+#include <numeric>
+
+#include "operon/core/arena.hpp"
+#include "operon/core/contracts.hpp"
+#include "operon/core/metrics.hpp"
+
+namespace Operon {
+
+MonotonicArena::MonotonicArena(size_t initialSize)
+{
+    blocks_.push_back(NewBlock(std::max(initialSize, Alignment)));
+}
+
+MonotonicArena::~MonotonicArena()
+{
+    for (auto const& b : blocks_) {
+        ::operator delete(b.Data, std::align_val_t { Alignment });
+    }
+}
+
+auto MonotonicArena::NewBlock(size_t size) -> Block
+{
+    ++upstream_;
+    Metrics::Add(Metrics::Counter::ArenaAllocations);
+    return { static_cast<std::byte*>(::operator new(size, std::align_val_t { Alignment })), size };
+}
+
+auto MonotonicArena::AllocateSlow(size_t bytes, size_t alignment) -> void*
+{
+    // try the blocks that were left behind by a rewind before requesting a new one
+    while (current_ + 1 < blocks_.size()) {
+        ++current_;
+        offset_ = 0;
+        if (bytes <= blocks_[current_].Size) {
+            offset_ = bytes;
+            return blocks_[current_].Data;
+        }
+    }
+    blocks_.push_back(NewBlock(std::max(2 * blocks_.back().Size, bytes + alignment)));
+    current_ = blocks_.size() - 1;
+    offset_ = bytes;
+    return blocks_.back().Data;
+}
+
+auto MonotonicArena::Reset() -> void
+{
+    current_ = 0;
+    offset_ = 0;
+    if (blocks_.size() > 1) {
+        auto const size = Capacity();
+        for (auto const& b : blocks_) {
+            ::operator delete(b.Data, std::align_val_t { Alignment });
+        }
+        blocks_.clear();
+        blocks_.push_back(NewBlock(size));
+    }
+}
+
+auto MonotonicArena::Capacity() const -> size_t
+{
+    return std::accumulate(blocks_.begin(), blocks_.end(), size_t { 0 }, [](auto s, auto const& b) { return s + b.Size; });
+}
+
+auto MonotonicArena::ThreadLocal() -> MonotonicArena&
+{
+    thread_local MonotonicArena arena;
+    return arena;
+}
+
+} // namespace Operon
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: MIT
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
+#include <atomic>
 #include <vstat/vstat.hpp>
 #include <aria-csv/parser.hpp>
 #include <fast_float/fast_float.h>
@@ -26,8 +27,15 @@ namespace {
         std::sort(vars.begin(), vars.end(), [](auto &a, auto &b) { return a.Hash < b.Hash; });
         return vars;
     };
+
+    std::atomic<uint64_t> Versions { 0 }; // NOLINT
 } // namespace
 
+auto Dataset::NextVersion() -> uint64_t
+{
+    return ++Versions;
+}
+
 auto Dataset::ReadCsv(std::string const& path, bool hasHeader) -> Dataset::Matrix
 {
     std::ifstream f(path);
@@ -90,20 +98,20 @@ Dataset::Dataset(std::vector<std::vector<Operon::Scalar>> const& vals)
 
 Dataset::Dataset(std::string const& path, bool hasHeader)
     : values_(ReadCsv(path, hasHeader))
-    , map_(values_.data(), values_.rows(), values_.cols())
+    , map_(values_.data(), values_.rows(), values_.cols(), Stride(values_.rows()))
 {
 }
 
 Dataset::Dataset(Matrix vals)
     : variables_(DefaultVariables(static_cast<size_t>(vals.cols())))
     , values_(std::move(vals))
-    , map_(values_.data(), values_.rows(), values_.cols())
+    , map_(values_.data(), values_.rows(), values_.cols(), Stride(values_.rows()))
 {
 }
 
 Dataset::Dataset(Matrix::Scalar const* data, Eigen::Index rows, Eigen::Index cols) // NOLINT
     : variables_(DefaultVariables(static_cast<size_t>(cols)))
-    , map_(data, rows, cols)
+    , map_(data, rows, cols, Stride(rows))
 {
 }
 
@@ -122,6 +130,7 @@ void Dataset::SetVariableNames(std::vector<std::string> const& names)
     }
 
     std::sort(variables_.begin(), variables_.end(), [&](auto& a, auto& b) { return a.Hash < b.Hash; });
+    version_ = NextVersion();
 }
 
 auto Dataset::VariableNames() -> std::vector<std::string>
@@ -165,46 +174,127 @@ auto Dataset::GetVariable(Operon::Hash hashValue) const noexcept -> std::optiona
 void Dataset::Shuffle(Operon::RandomGenerator& random)
 {
     if (IsView()) { throw std::runtime_error("Cannot shuffle. Dataset does not own the data.\n"); }
-    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm(values_.rows());
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm(map_.rows());
     perm.setIdentity();
     // generate a random permutation
     Operon::Span<decltype(perm)::IndicesType::Scalar> idx(perm.indices().data(), perm.indices().size());
     std::shuffle(idx.begin(), idx.end(), random);
-    values_.matrix().applyOnTheLeft(perm); // permute rows
+    values_.topRows(map_.rows()).matrix().applyOnTheLeft(perm); // permute rows
+    version_ = NextVersion();
 }
 
 void Dataset::Normalize(size_t i, Range range)
 {
     if (IsView()) { throw std::runtime_error("Cannot normalize. Dataset does not own the data.\n"); }
-    EXPECT(range.Start() + range.Size() <= static_cast<size_t>(values_.rows()));
+    EXPECT(range.Start() + range.Size() <= Rows());
     auto j     = static_cast<Eigen::Index>(i);
     auto start = static_cast<Eigen::Index>(range.Start());
     auto size  = static_cast<Eigen::Index>(range.Size());
     auto seg   = values_.col(j).segment(start, size);
     auto min   = seg.minCoeff();
     auto max   = seg.maxCoeff();
-    values_.col(j) = (values_.col(j).array() - min) / (max - min);
+    auto col   = values_.col(j).head(map_.rows());
+    col = (col - min) / (max - min);
+    version_ = NextVersion();
 }
 
 void Dataset::PermuteRows(std::vector<Eigen::Index> const& indices) {
     if (IsView()) { throw std::runtime_error("Cannot shuffle. Dataset does not own the data.\n"); }
-    ENSURE(values_.rows() == indices.size());
-    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm(values_.rows());
+    ENSURE(Rows() == indices.size());
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic> perm(map_.rows());
     std::copy(indices.begin(), indices.end(), perm.indices().begin());
-    values_.matrix().applyOnTheLeft(perm); // permute rows
+    values_.topRows(map_.rows()).matrix().applyOnTheLeft(perm); // permute rows
+    version_ = NextVersion();
 };
 
 // standardize column i using mean and stddev calculated over the specified range
 void Dataset::Standardize(size_t i, Range range)
 {
     if (IsView()) { throw std::runtime_error("Cannot standardize. Dataset does not own the data.\n"); }
-    EXPECT(range.Start() + range.Size() <= static_cast<size_t>(values_.rows()));
+    EXPECT(range.Start() + range.Size() <= Rows());
     auto j = static_cast<Eigen::Index>(i);
     auto start = static_cast<Eigen::Index>(range.Start());
     auto n = static_cast<Eigen::Index>(range.Size());
     auto seg = values_.col(j).segment(start, n);
     auto stats = vstat::univariate::accumulate<Matrix::Scalar>(seg.data(), seg.size());
     auto stddev = std::sqrt(stats.variance);
-    values_.col(j) = (values_.col(j).array() - stats.mean) / stddev;
+    auto col = values_.col(j).head(map_.rows());
+    col = (col - stats.mean) / stddev;
+    version_ = NextVersion();
+}
+
+void Dataset::Reserve(size_t rows)
+{
+    if (IsView()) { throw std::runtime_error("Cannot reserve. Dataset does not own the data.\n"); }
+    if (rows <= Capacity()) {
+        return;
+    }
+    auto const nrow = map_.rows();
+    auto const ncol = map_.cols();
+    Matrix values(static_cast<Eigen::Index>(rows), ncol);
+    values.topRows(nrow) = values_.topRows(nrow);
+    values_.swap(values);
+    new (&map_) Map(values_.data(), nrow, ncol, Stride(values_.rows())); // we use placement new (no allocation)
+    version_ = NextVersion();
+}
+
+auto Dataset::Subset(Operon::Span<size_t const> rows) const -> Dataset
+{
+    Dataset subset(Matrix(static_cast<Eigen::Index>(rows.size()), map_.cols()));
+    Subset(rows, subset);
+    return subset;
+}
+
+void Dataset::Subset(Operon::Span<size_t const> rows, Dataset& subset) const
+{
+    if (subset.IsView()) { throw std::runtime_error("Cannot write the subset. Dataset does not own the data.\n"); }
+    auto const nrow = static_cast<Eigen::Index>(rows.size());
+    auto const ncol = map_.cols();
+    if (subset.values_.rows() < nrow || subset.values_.cols() != ncol) {
+        subset.values_.resize(std::max(nrow, subset.values_.rows()), ncol);
+    }
+    for (Eigen::Index j = 0; j < ncol; ++j) {
+        auto const* src = map_.col(j).data();
+        auto* dst = subset.values_.col(j).data();
+        for (size_t i = 0; i < rows.size(); ++i) {
+            EXPECT(rows[i] < Rows());
+            dst[i] = src[rows[i]];
+        }
+    }
+    subset.variables_ = variables_;
+    new (&subset.map_) Map(subset.values_.data(), nrow, ncol, Stride(subset.values_.rows())); // we use placement new (no allocation)
+    subset.version_ = NextVersion();
+}
+
+void Dataset::AppendRows(Eigen::Ref<Matrix const> rows)
+{
+    if (IsView()) { throw std::runtime_error("Cannot append. Dataset does not own the data.\n"); }
+    if (rows.cols() != map_.cols()) {
+        throw std::runtime_error(fmt::format("The number of columns ({}) does not match the number of dataset columns ({}).\n", rows.cols(), map_.cols()));
+    }
+    auto const nrow = map_.rows();
+    auto const ncol = map_.cols();
+    auto const size = static_cast<size_t>(nrow + rows.rows());
+    if (size > Capacity()) {
+        Reserve(std::max(size, 2 * Capacity())); // geometric growth
+    }
+    values_.block(nrow, 0, rows.rows(), ncol) = rows;
+    new (&map_) Map(values_.data(), static_cast<Eigen::Index>(size), ncol, Stride(values_.rows())); // we use placement new (no allocation)
+    version_ = NextVersion();
+}
+
+void Dataset::AppendRows(std::vector<std::vector<Operon::Scalar>> const& cols)
+{
+    if (cols.size() != Cols()) {
+        throw std::runtime_error(fmt::format("The number of columns ({}) does not match the number of dataset columns ({}).\n", cols.size(), Cols()));
+    }
+    auto const nrow = cols.empty() ? 0 : static_cast<Eigen::Index>(cols.front().size());
+    Matrix rows(nrow, static_cast<Eigen::Index>(cols.size()));
+    for (Eigen::Index i = 0; i < rows.cols(); ++i) {
+        auto const& col = cols[static_cast<size_t>(i)];
+        ENSURE(static_cast<Eigen::Index>(col.size()) == nrow);
+        rows.col(i) = Eigen::Map<Eigen::Array<Operon::Scalar, Eigen::Dynamic, 1> const>(col.data(), nrow);
+    }
+    AppendRows(rows);
 }
 } // namespace Operon
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>
+#include <iterator>
+
+#include "operon/core/contracts.hpp"
+#include "operon/core/genotype_dag.hpp"
+
+namespace Operon {
+
+auto GenotypeDag::Insert(Tree const& tree) -> Id
+{
+    EXPECT(!tree.Empty());
+    // the copy is hashed so that the caller's hash values are not overwritten
+    scratch_.Nodes().assign(tree.Nodes().begin(), tree.Nodes().end());
+    scratch_.SetHashState(tree.GetHashState());
+    [[maybe_unused]] auto const& hashed = scratch_.Rehash(Operon::HashMode::Strict);
+    return Intern(scratch_, scratch_.Length() - 1);
+}
+
+auto GenotypeDag::Intern(Tree const& tree, size_t i) -> Id
+{
+    auto const& n = tree[i];
+    if (auto it = index_.find(n.CalculatedHashValue); it != index_.end()) {
+        ++vertices_[it->second].References;
+        return it->second;
+    }
+
+    // the children are interned first, such that they precede the new vertex; their ids are collected on the
+    // stack because the recursive calls append to the child array
+    if (!n.IsLeaf()) {
+        for (auto it = tree.Children(i); it.HasNext(); ++it) {
+            stack_.push_back(Intern(tree, it.Index()));
+        }
+    }
+    auto const id = static_cast<Id>(vertices_.size());
+    vertices_.push_back({ n, children_.size(), 1 });
+    children_.insert(children_.end(), stack_.end() - n.Arity, stack_.end());
+    stack_.resize(stack_.size() - n.Arity);
+    index_.insert({ n.CalculatedHashValue, id });
+    ++live_;
+    return id;
+}
+
+auto GenotypeDag::Release(Id id) -> void
+{
+    stack_.push_back(id);
+    while (!stack_.empty()) {
+        auto const v = stack_.back();
+        stack_.pop_back();
+        auto& vertex = vertices_[v];
+        EXPECT(vertex.References > 0);
+        if (--vertex.References > 0) {
+            continue;
+        }
+        index_.erase(vertex.Symbol.CalculatedHashValue);
+        --live_;
+        auto children = Children(v);
+        stack_.insert(stack_.end(), children.begin(), children.end());
+    }
+}
+
+auto GenotypeDag::Materialize(Id id) const -> Tree
+{
+    EXPECT(IsLive(id));
+    Operon::Vector<Node> nodes;
+    // postfix order: the last child comes first (see SubtreeIterator)
+    auto emit = [&](auto&& self, Id v) -> void {
+        auto children = Children(v);
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+            self(self, *it);
+        }
+        nodes.push_back(vertices_[v].Symbol);
+    };
+    emit(emit, id);
+    return Tree(std::move(nodes)).UpdateNodes();
+}
+
+auto GenotypeDag::Compact(Operon::Span<Id> roots) -> void
+{
+    std::vector<Id> ids(vertices_.size());
+    std::vector<Vertex> vertices;
+    std::vector<Id> children;
+    vertices.reserve(live_);
+    children.reserve(children_.size());
+
+    for (size_t v = 0; v < vertices_.size(); ++v) {
+        auto const& vertex = vertices_[v];
+        if (vertex.References == 0) {
+            continue;
+        }
+        ids[v] = static_cast<Id>(vertices.size());
+        auto const c = Children(static_cast<Id>(v));
+        vertices.push_back({ vertex.Symbol, children.size(), vertex.References });
+        std::transform(c.begin(), c.end(), std::back_inserter(children), [&](auto j) { return ids[j]; });
+    }
+
+    for (auto& [hash, id] : index_) {
+        id = ids[id];
+    }
+    for (auto& root : roots) {
+        EXPECT(IsLive(root));
+        root = ids[root];
+    }
+    vertices_.swap(vertices);
+    children_.swap(children);
+}
+
+auto GenotypeDag::Clear() -> void
+{
+    vertices_.clear();
+    children_.clear();
+    index_.clear();
+    live_ = 0;
+}
+
+} // namespace Operon
@@ -0,0 +1,24 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <taskflow/taskflow.hpp>
+
+#include "operon/core/individual.hpp"
+
+namespace Operon {
+
+auto HashPopulation(tf::Subflow& subflow, Operon::Span<Individual const> pop, Operon::HashMode mode) -> tf::Task
+{
+    return subflow.for_each_index(size_t { 0 }, pop.size(), size_t { 1 }, [pop, mode](size_t i) {
+        [[maybe_unused]] auto const& tree = pop[i].Genotype.Rehash(mode);
+    }).name("hash population");
+}
+
+auto HashPopulation(tf::Executor& executor, Operon::Span<Individual const> pop, Operon::HashMode mode) -> void
+{
+    tf::Taskflow taskflow;
+    taskflow.emplace([&](tf::Subflow& subflow) { HashPopulation(subflow, pop, mode); });
+    executor.run(taskflow).wait();
+}
+
+} // namespace Operon
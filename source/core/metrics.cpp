@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <mutex>
+#include <vector>
+
+#include "operon/core/metrics.hpp"
+
+namespace Operon::Metrics {
+
+namespace {
+    // each thread writes only its own metrics, so a relaxed load/store pair is enough (no read-modify-write)
+    struct alignas(64) ThreadMetrics { // NOLINT
+        std::array<std::atomic<uint64_t>, CounterCount> Counters {};
+        std::array<std::array<std::atomic<uint64_t>, Buckets::Count>, HistogramCount> Values {};
+        std::array<std::atomic<uint64_t>, HistogramCount> Sums {};
+    };
+
+    inline auto Bump(std::atomic<uint64_t>& value, uint64_t increment) noexcept -> void
+    {
+        value.store(value.load(std::memory_order_relaxed) + increment, std::memory_order_relaxed);
+    }
+
+    auto Accumulate(Snapshot& snapshot, ThreadMetrics const& metrics) -> void
+    {
+        for (size_t i = 0; i < CounterCount; ++i) {
+            snapshot.Counters[i] += metrics.Counters[i].load(std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < HistogramCount; ++i) {
+            auto& h = snapshot.Histograms[i];
+            for (size_t j = 0; j < Buckets::Count; ++j) {
+                auto const v = metrics.Values[i][j].load(std::memory_order_relaxed);
+                h.Values[j] += v;
+                h.Count += v;
+            }
+            h.Sum += metrics.Sums[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    struct Registry {
+        std::mutex Mutex;
+        std::vector<ThreadMetrics const*> Live;
+        Snapshot Retired;  // metrics of the threads that have exited
+        Snapshot Baseline; // state at the last call to Reset
+
+        auto Raw() -> Snapshot
+        {
+            auto snapshot = Retired;
+            for (auto const* m : Live) {
+                Accumulate(snapshot, *m);
+            }
+            return snapshot;
+        }
+    };
+
+    auto GetRegistry() -> Registry&
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    struct ThreadMetricsHolder {
+        ThreadMetrics Metrics;
+
+        ThreadMetricsHolder()
+        {
+            auto& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+            registry.Live.push_back(&Metrics);
+        }
+
+        ~ThreadMetricsHolder()
+        {
+            auto& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.Mutex);
+            Accumulate(registry.Retired, Metrics);
+            registry.Live.erase(std::remove(registry.Live.begin(), registry.Live.end(), &Metrics), registry.Live.end());
+        }
+
+        ThreadMetricsHolder(ThreadMetricsHolder const&) = delete;
+        ThreadMetricsHolder(ThreadMetricsHolder&&) = delete;
+        auto operator=(ThreadMetricsHolder const&) -> ThreadMetricsHolder& = delete;
+        auto operator=(ThreadMetricsHolder&&) -> ThreadMetricsHolder& = delete;
+    };
+
+    auto Local() -> ThreadMetrics&
+    {
+        thread_local ThreadMetricsHolder holder;
+        return holder.Metrics;
+    }
+
+    std::atomic_bool enabled { true }; // NOLINT
+} // namespace
+
+auto Name(Counter counter) -> std::string_view
+{
+    constexpr std::array<std::string_view, CounterCount> names {
+        "evaluations", "node_rows", "local_optimization_iterations", "generator_attempts", "arena_allocations"
+    };
+    return names[static_cast<size_t>(counter)];
+}
+
+auto Name(Histogram histogram) -> std::string_view
+{
+    constexpr std::array<std::string_view, HistogramCount> names {
+        "evaluation_latency", "selection_time", "reinsertion_time", "cost_ratio"
+    };
+    return names[static_cast<size_t>(histogram)];
+}
+
+auto HistogramSnapshot::Mean() const -> double
+{
+    return Count == 0 ? 0.0 : static_cast<double>(Sum) / static_cast<double>(Count);
+}
+
+auto HistogramSnapshot::Quantile(double q) const -> double
+{
+    if (Count == 0) {
+        return 0.0;
+    }
+    auto const rank = std::max(uint64_t { 1 }, static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(Count))));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < Buckets::Count; ++i) {
+        seen += Values[i];
+        if (seen >= rank) {
+            return (static_cast<double>(Buckets::LowerBound(i)) + static_cast<double>(Buckets::UpperBound(i))) / 2;
+        }
+    }
+    return Max();
+}
+
+auto HistogramSnapshot::Max() const -> double
+{
+    for (auto i = Buckets::Count; i > 0; --i) {
+        if (Values[i - 1] > 0) {
+            return static_cast<double>(Buckets::UpperBound(i - 1));
+        }
+    }
+    return 0.0;
+}
+
+auto Snapshot::operator-(Snapshot const& other) const -> Snapshot
+{
+    auto sub = [](uint64_t a, uint64_t b) { return a > b ? a - b : 0; };
+    Snapshot result;
+    for (size_t i = 0; i < CounterCount; ++i) {
+        result.Counters[i] = sub(Counters[i], other.Counters[i]);
+    }
+    for (size_t i = 0; i < HistogramCount; ++i) {
+        auto const& a = Histograms[i];
+        auto const& b = other.Histograms[i];
+        auto& h = result.Histograms[i];
+        for (size_t j = 0; j < Buckets::Count; ++j) {
+            h.Values[j] = sub(a.Values[j], b.Values[j]);
+        }
+        h.Count = sub(a.Count, b.Count);
+        h.Sum = sub(a.Sum, b.Sum);
+    }
+    return result;
+}
+
+auto Enabled() noexcept -> bool
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+auto SetEnabled(bool value) noexcept -> void
+{
+    enabled.store(value, std::memory_order_relaxed);
+}
+
+auto Add(Counter counter, uint64_t value) noexcept -> void
+{
+    if (Enabled()) {
+        Bump(Local().Counters[static_cast<size_t>(counter)], value);
+    }
+}
+
+auto Record(Histogram histogram, uint64_t value) noexcept -> void
+{
+    if (Enabled()) {
+        auto& m = Local();
+        auto const h = static_cast<size_t>(histogram);
+        Bump(m.Values[h][Buckets::Index(value)], 1);
+        Bump(m.Sums[h], value);
+    }
+}
+
+auto Collect() -> Snapshot
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    return registry.Raw() - registry.Baseline;
+}
+
+auto Reset() -> void
+{
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.Mutex);
+    registry.Baseline = registry.Raw();
+}
+
+} // namespace Operon::Metrics
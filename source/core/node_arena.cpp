@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <new>
+
+#include "operon/core/node_arena.hpp"
+
+namespace Operon {
+
+namespace {
+    // every block of nodes is preceded by the arena it was allocated from (null for the heap), so that it can be
+    // released without knowing where it comes from
+    struct alignas(alignof(std::max_align_t)) Header {
+        NodeArena const* Arena;
+    };
+    static_assert(alignof(Node) <= sizeof(Header));
+
+    constexpr auto BlockSize(size_t n) -> size_t
+    {
+        constexpr auto align { sizeof(Header) };
+        return sizeof(Header) + (n * sizeof(Node) + align - 1) / align * align;
+    }
+
+    auto GetHeader(Node const* p) -> Header const*
+    {
+        return reinterpret_cast<Header const*>(reinterpret_cast<std::byte const*>(p) - sizeof(Header)); // NOLINT
+    }
+
+    auto Place(std::byte* block, NodeArena const* arena) -> Node*
+    {
+        ::new (block) Header { arena };
+        return reinterpret_cast<Node*>(block + sizeof(Header)); // NOLINT
+    }
+
+    // the arena packing a population on this thread
+    thread_local NodeArena* packing { nullptr };
+} // namespace
+
+namespace detail {
+    auto AllocateNodes(size_t n) -> Node*
+    {
+        if (packing != nullptr) {
+            return packing->Allocate(n);
+        }
+        return Place(static_cast<std::byte*>(::operator new(BlockSize(n))), nullptr);
+    }
+
+    auto DeallocateNodes(Node* p) noexcept -> void
+    {
+        if (p == nullptr || GetHeader(p)->Arena != nullptr) {
+            return; // the arena's buffers are reused by Pack
+        }
+        ::operator delete(const_cast<Header*>(GetHeader(p))); // NOLINT
+    }
+} // namespace detail
+
+NodeArena::~NodeArena()
+{
+    for (auto& b : buffers_) {
+        ::operator delete(b.Data);
+    }
+}
+
+auto NodeArena::Stored(Operon::Vector<Node> const& nodes) noexcept -> bool
+{
+    return nodes.capacity() > 0 && GetHeader(nodes.data())->Arena != nullptr;
+}
+
+auto NodeArena::Allocate(size_t n) -> Node*
+{
+    auto& b = buffers_[active_];
+    auto const size = BlockSize(n);
+    if (b.Used + size > b.Capacity) {
+        return Place(static_cast<std::byte*>(::operator new(size)), nullptr); // not expected, Pack reserves enough
+    }
+    auto* block = b.Data + b.Used; // NOLINT
+    b.Used += size;
+    return Place(block, this);
+}
+
+auto NodeArena::Pack(Operon::Span<Individual> pop) -> void
+{
+    size_t demand { 0 };
+    for (auto const& ind : pop) {
+        demand += BlockSize(ind.Genotype.Length());
+    }
+
+    // nothing is stored in the other buffer since the previous Pack
+    active_ = 1 - active_;
+    auto& b = buffers_[active_];
+    if (b.Capacity < demand) {
+        // some headroom, such that a slowly growing population does not reallocate every time
+        auto const capacity = demand + demand / 4;
+        ::operator delete(b.Data);
+        b.Data = nullptr;
+        b.Capacity = 0;
+        b.Data = static_cast<std::byte*>(::operator new(capacity));
+        b.Capacity = capacity;
+        ++reallocations_;
+    }
+    b.Used = 0;
+
+    // the node vectors allocated on this thread meanwhile are placed in the active buffer, in the order of the population
+    struct Scope {
+        explicit Scope(NodeArena* arena) { packing = arena; }
+        ~Scope() { packing = nullptr; }
+        Scope(Scope const&) = delete;
+        Scope(Scope&&) = delete;
+        auto operator=(Scope const&) -> Scope& = delete;
+        auto operator=(Scope&&) -> Scope& = delete;
+    } scope(this);
+
+    for (auto& ind : pop) {
+        if (ind.Genotype.Empty()) {
+            continue;
+        }
+        auto const state = ind.Genotype.GetHashState(); // only the storage changes
+        auto& nodes = ind.Genotype.Nodes();
+        Operon::Vector<Node> packed(nodes.begin(), nodes.end());
+        nodes.swap(packed);
+        ind.Genotype.SetHashState(state);
+    }
+}
+
+} // namespace Operon
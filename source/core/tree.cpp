@@ -2,6 +2,9 @@
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
 #include <numeric>
 
 #include "operon/core/tree.hpp"
@@ -38,8 +41,89 @@ auto Tree::UpdateNodes() -> Tree&
     return *this;
 }
 
+auto Tree::UpdateNodes(size_t begin, size_t end, size_t replaced) -> Tree&
+{
+    EXPECT(begin < end && end <= nodes_.size() && replaced > 0);
+    using Signed = std::make_signed_t<size_t>;
+    auto const delta = static_cast<Signed>(end - begin) - static_cast<Signed>(replaced);
+
+    // the new subtree
+    for (size_t i = begin; i < end; ++i) {
+        auto& s = nodes_[i];
+        s.Depth = 1;
+        s.Length = s.Arity;
+        if (s.IsLeaf()) {
+            continue;
+        }
+        auto j = i - 1;
+        for (size_t k = 0; k < s.Arity; ++k) {
+            auto& p = nodes_[j];
+            s.Length = static_cast<uint16_t>(s.Length + p.Length);
+            s.Depth = std::max(s.Depth, p.Depth);
+            p.Parent = static_cast<uint16_t>(i);
+            j -= p.Length + 1;
+        }
+        ++s.Depth;
+    }
+
+    // the nodes behind the edit still have their old lengths and parent indices: the ancestors of the edit are the ones
+    // whose (old) span includes the beginning of the replaced subtree, the other ones only moved by delta positions
+    auto const root = nodes_.size() - 1;
+    size_t parent = root + 1;
+    for (size_t i = end; i < nodes_.size(); ++i) {
+        auto& s = nodes_[i];
+        if (i < root) {
+            s.Parent = static_cast<uint16_t>(static_cast<Signed>(s.Parent) + delta);
+        }
+        if (static_cast<Signed>(i) - delta - s.Length > static_cast<Signed>(begin)) {
+            continue;
+        }
+        parent = std::min(parent, i);
+        s.Length = static_cast<uint16_t>(static_cast<Signed>(s.Length) + delta);
+        s.Depth = 1;
+        auto j = i - 1;
+        for (size_t k = 0; k < s.Arity; ++k) {
+            auto& p = nodes_[j];
+            s.Depth = std::max(s.Depth, p.Depth);
+            p.Parent = static_cast<uint16_t>(i);
+            j -= p.Length + 1;
+        }
+        ++s.Depth;
+    }
+
+    // the new subtree and the previous edit (mapped to the new positions) have to be rehashed
+    if (hashState_.Mode) {
+        auto& h = hashState_;
+        if (h.EditBegin == h.EditEnd) {
+            h.EditBegin = begin;
+            h.EditEnd = end;
+        } else {
+            auto const replacedEnd = begin + replaced;
+            auto shift = [delta](size_t i) { return static_cast<size_t>(static_cast<Signed>(i) + delta); };
+            auto const b = h.EditBegin < begin ? h.EditBegin : (h.EditBegin >= replacedEnd ? shift(h.EditBegin) : begin);
+            auto const e = h.EditEnd <= begin ? h.EditEnd : (h.EditEnd > replacedEnd ? shift(h.EditEnd) : end);
+            h.EditBegin = std::min(b, begin);
+            h.EditEnd = std::max(e, end);
+        }
+    }
+
+    // the levels only change inside the new subtree
+    if (end == nodes_.size()) {
+        nodes_.back().Parent = 0;
+        nodes_.back().Level = 1;
+    } else {
+        nodes_[end - 1].Level = static_cast<uint16_t>(nodes_[parent].Level + 1);
+    }
+    for (auto i = end - 1; i > begin; --i) {
+        auto& s = nodes_[i - 1];
+        s.Level = static_cast<uint16_t>(nodes_[s.Parent].Level + 1);
+    }
+    return *this;
+}
+
 auto Tree::Reduce() -> Tree&
 {
+    hashState_ = {};
     bool reduced = false;
     for (size_t i = 0; i < nodes_.size(); ++i) {
         auto& s = nodes_[i];
@@ -70,6 +154,7 @@ auto Tree::Reduce() -> Tree&
 // - this method assumes node hashes are computed, usually it is preceded by a call to tree.Hash()
 auto Tree::Sort() -> Tree&
 {
+    hashState_ = {};
     // preallocate memory to reduce fragmentation
     Operon::Vector<Operon::Node> sorted = nodes_;
 
@@ -135,8 +220,21 @@ auto Tree::GetCoefficients() const -> std::vector<Operon::Scalar>
     return coefficients;
 }
 
+void Tree::GetCoefficients(Operon::Span<Operon::Scalar> coefficients) const
+{
+    size_t idx = 0;
+    for (auto const& s : nodes_) {
+        if (s.Optimize) {
+            coefficients[idx++] = s.Value;
+        }
+    }
+}
+
 void Tree::SetCoefficients(Operon::Span<Operon::Scalar const> coefficients)
 {
+    if (hashState_.Mode == Operon::HashMode::Strict) {
+        hashState_ = {}; // the coefficients are part of the strict hash values
+    }
     size_t idx = 0;
     for (auto& s : nodes_) {
         if (s.Optimize) {
@@ -155,18 +253,16 @@ auto Tree::VisitationLength() const noexcept -> size_t
     return std::transform_reduce(nodes_.begin(), nodes_.end(), 0UL, std::plus<> {}, [](const auto& node) { return node.Length + 1; });
 }
 
-auto Tree::Hash(Operon::HashMode mode) const -> Tree const&
-{
-    std::vector<size_t> childIndices;
-    childIndices.reserve(nodes_.size());
-
-    std::vector<Operon::Hash> hashes;
-    hashes.reserve(nodes_.size());
-
-    Operon::Hasher hasher;
+namespace {
+    // hashes node i from its own hash value and the calculated hash values of its children, which must be up to date
+    // (the scratch buffers are reused across calls so that hashing does not allocate in steady state)
+    auto HashNode(Operon::Span<Node const> nodes, size_t i, Operon::HashMode mode) -> void
+    {
+        thread_local std::vector<size_t> childIndices;
+        thread_local std::vector<Operon::Hash> hashes;
 
-    for (size_t i = 0; i < nodes_.size(); ++i) {
-        auto const& n = nodes_[i];
+        Operon::Hasher hasher;
+        auto const& n = nodes[i];
 
         if (n.IsLeaf()) {
             n.CalculatedHashValue = n.HashValue;
@@ -179,27 +275,84 @@ auto Tree::Hash(Operon::HashMode mode) const -> Tree const&
                 std::memcpy(ptr + s1, &n.Value, s2);
                 n.CalculatedHashValue = hasher(key.data(), key.size());
             }
-            continue;
+            return;
         }
 
-        for (auto it = Children(i); it.HasNext(); ++it) {
-            childIndices.push_back(it.Index());
+        childIndices.clear();
+        for (size_t k = 0, j = i - 1; k < n.Arity; ++k, j -= nodes[j].Length + 1UL) {
+            childIndices.push_back(j);
         }
 
-        auto begin = childIndices.begin();
-        auto end = begin + n.Arity;
-
         if (n.IsCommutative()) {
-            std::stable_sort(begin, end, [&](auto a, auto b) { return nodes_[a] < nodes_[b]; });
+            // stable insertion sort: same order as std::stable_sort, without its temporary buffer
+            auto less = [&](auto a, auto b) { return nodes[a] < nodes[b]; };
+            for (auto it = childIndices.begin(); it != childIndices.end(); ++it) {
+                std::rotate(std::upper_bound(childIndices.begin(), it, *it, less), it, it + 1);
+            }
         }
-        std::transform(begin, end, std::back_inserter(hashes), [&](auto j) { return nodes_[j].CalculatedHashValue; });
+
+        hashes.clear();
+        std::transform(childIndices.begin(), childIndices.end(), std::back_inserter(hashes), [&](auto j) { return nodes[j].CalculatedHashValue; });
         hashes.push_back(n.HashValue);
 
         n.CalculatedHashValue = hasher(reinterpret_cast<uint8_t*>(hashes.data()), sizeof(Operon::Hash) * hashes.size()); // NOLINT
-        childIndices.clear();
-        hashes.clear();
     }
+} // namespace
 
+auto Tree::Hash(Operon::HashMode mode) const -> Tree const&
+{
+    for (size_t i = 0; i < nodes_.size(); ++i) {
+        HashNode(nodes_, i, mode);
+    }
+    hashState_ = { mode };
+    return *this;
+}
+
+auto Tree::Hash(Operon::HashMode mode, size_t begin, size_t end) const -> Tree const&
+{
+    EXPECT(begin <= end && end <= nodes_.size());
+    if (nodes_.empty()) {
+        return *this;
+    }
+    for (auto i = begin; i < end; ++i) {
+        HashNode(nodes_, i, mode);
+    }
+    // the ancestors of the range are the ancestors of its last node
+    auto const root = nodes_.size() - 1;
+    for (auto i = std::max(end, size_t { 1 }) - 1; i < root;) {
+        i = nodes_[i].Parent;
+        HashNode(nodes_, i, mode);
+    }
+    hashState_ = { mode };
+    return *this;
+}
+
+auto Tree::Rehash(Operon::HashMode mode) const -> Tree const&
+{
+    if (hashState_.Mode != mode) {
+        return Hash(mode);
+    }
+    if (hashState_.EditBegin == hashState_.EditEnd) {
+        return *this;
+    }
+    return Hash(mode, hashState_.EditBegin, hashState_.EditEnd);
+}
+
+auto Tree::Edited(size_t begin, size_t end) -> Tree&
+{
+    EXPECT(begin <= end && end <= nodes_.size());
+    auto& h = hashState_;
+    if (!h.Mode || begin == end) {
+        return *this;
+    }
+    // the ancestors of a range are rehashed together with it, so the union of two edits is their hull
+    if (h.EditBegin == h.EditEnd) {
+        h.EditBegin = begin;
+        h.EditEnd = end;
+    } else {
+        h.EditBegin = std::min(h.EditBegin, begin);
+        h.EditEnd = std::max(h.EditEnd, end);
+    }
     return *this;
 }
 
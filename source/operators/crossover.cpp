@@ -22,7 +22,9 @@ static auto SelectRandomBranch(Operon::RandomGenerator& random, Tree const& tree
 
     auto const& nodes = tree.Nodes();
 
-    std::vector<size_t> candidates(nodes.size());
+    // the candidate buffer is reused across calls, it only grows up to the largest tree seen by this thread
+    thread_local std::vector<size_t> candidates;
+    candidates.resize(std::max(candidates.size(), nodes.size()));
     auto head = candidates.begin();
     auto tail = candidates.rbegin();
 
@@ -44,12 +46,15 @@ static auto SelectRandomBranch(Operon::RandomGenerator& random, Tree const& tree
         }
     }
 
+    if (head == candidates.begin() && tail == candidates.rbegin()) {
+        return 0;
+    }
+
     // check if we have any function node candidates at all and if the bernoulli trial succeeds
-    if (tail > candidates.rbegin() && std::bernoulli_distribution(internalProb)(random)) {
+    if (tail > candidates.rbegin() && (head == candidates.begin() || std::bernoulli_distribution(internalProb)(random))) {
         return *Operon::Random::Sample(random, candidates.rbegin(), tail);
     }
     return *Operon::Random::Sample(random, candidates.begin(), head);
-   
 }
 
 auto SubtreeCrossover::FindCompatibleSwapLocations(Operon::RandomGenerator& random, Tree const& lhs, Tree const& rhs) const -> std::pair<size_t, size_t>
@@ -72,14 +77,19 @@ auto SubtreeCrossover::FindCompatibleSwapLocations(Operon::RandomGenerator& rand
 }
 
 auto SubtreeCrossover::operator()(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs) const -> Tree
+{
+    Tree child;
+    (*this)(random, lhs, rhs, child);
+    return child;
+}
+
+auto SubtreeCrossover::operator()(Operon::RandomGenerator& random, const Tree& lhs, const Tree& rhs, Tree& child) const -> void
 {
     auto [i, j] = FindCompatibleSwapLocations(random, lhs, rhs);
 
-    auto child = Cross(lhs, rhs, i, j);
+    Cross(lhs, rhs, i, j, child);
 
     ENSURE(child.Depth() <= std::max(maxDepth_, lhs.Depth()));
     ENSURE(child.Length() <= std::max(maxLength_, lhs.Length()));
-
-    return child;
 }
 } // namespace Operon
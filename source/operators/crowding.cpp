@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>                         // for sort, copy_n, stable_partition
+#include <iterator>                          // for distance
+#include <limits>                            // for numeric_limits
+#include <numeric>                           // for iota
+#include <taskflow/taskflow.hpp>             // for Subflow, Executor
+#include <taskflow/algorithm/sort.hpp>       // for Subflow::sort
+
+#include "operon/core/comparison.hpp"        // for Equal, Less
+#include "operon/core/contracts.hpp"         // for EXPECT
+#include "operon/operators/crowding.hpp"
+
+namespace Operon {
+
+auto CrowdingSorter::Load(Operon::Span<Individual const> pop, size_t i) -> void
+{
+    auto const& fit = pop[i].Fitness;
+    EXPECT(fit.size() == m_);
+    std::copy_n(fit.begin(), m_, objectives_.begin() + static_cast<int64_t>(i * m_));
+    order_[i] = i;
+}
+
+auto CrowdingSorter::Deduplicate() -> void
+{
+    // the sorted order is split into runs of fitness vectors equal (within eps) to the first one of the run, which is
+    // kept while the following ones are duplicates
+    Operon::Equal eq;
+    auto const n = order_.size();
+    duplicate_.assign(n, 0);
+    for (size_t i = 0; i < n;) {
+        auto const* x = objectives_.data() + order_[i] * m_;
+        auto j = i + 1;
+        for (; j < n; ++j) {
+            auto const* y = objectives_.data() + order_[j] * m_;
+            if (!eq(x, x + m_, y, y + m_, eps_)) { break; }
+            duplicate_[order_[j]] = 1;
+        }
+        i = j;
+    }
+    auto const u = std::stable_partition(order_.begin(), order_.end(), [&](auto i) { return duplicate_[i] == 0; });
+    unique_ = static_cast<size_t>(std::distance(order_.begin(), u));
+}
+
+auto CrowdingSorter::Rank(Operon::Span<Individual const> pop) -> void
+{
+    fronts_ = sorter_(pop.subspan(0, unique_));
+    // sort the fronts for consistency between sorting algos
+    for (auto& f : fronts_) {
+        std::sort(f.begin(), f.end());
+    }
+    // banish the duplicates into the last front
+    if (unique_ < pop.size()) {
+        std::vector<size_t> last(pop.size() - unique_);
+        std::iota(last.begin(), last.end(), unique_);
+        fronts_.push_back(std::move(last));
+    }
+}
+
+auto CrowdingSorter::Crowding(Operon::Span<Individual> pop, size_t front) const -> void
+{
+    auto const& f = fronts_[front];
+    auto constexpr inf = std::numeric_limits<Operon::Scalar>::max();
+    for (auto i : f) {
+        pop[i].Rank = front;
+        pop[i].Distance = 0;
+    }
+
+    std::vector<size_t> idx(f.begin(), f.end());
+    for (size_t obj = 0; obj < m_; ++obj) {
+        std::sort(idx.begin(), idx.end(), [&](auto a, auto b) {
+            auto x = Objective(a, obj);
+            auto y = Objective(b, obj);
+            return x < y || (x == y && a < b);
+        });
+        auto const min = Objective(idx.front(), obj);
+        auto const max = Objective(idx.back(), obj);
+        pop[idx.front()].Distance = inf;
+        pop[idx.back()].Distance = inf;
+        if (!(max > min)) {
+            continue; // all the individuals in the front are equal along this objective
+        }
+        for (size_t j = 1; j + 1 < idx.size(); ++j) {
+            auto& d = pop[idx[j]].Distance;
+            if (d < inf) {
+                d = std::min(inf, d + (Objective(idx[j + 1], obj) - Objective(idx[j - 1], obj)) / (max - min));
+            }
+        }
+    }
+}
+
+auto CrowdingSorter::Sort(tf::Subflow& subflow, Operon::Span<Individual> pop) -> tf::Task
+{
+    if (pop.empty()) {
+        fronts_.clear();
+        return subflow.emplace([]() {});
+    }
+    auto const n = pop.size();
+    m_ = pop.front().Size();
+    objectives_.resize(n * m_);
+    scratch_.resize(n * m_);
+    order_.resize(n);
+    buffer_.resize(n);
+
+    auto load = subflow.for_each_index(size_t { 0 }, n, size_t { 1 }, [this, pop](size_t i) { Load(pop, i); }).name("load objectives");
+    auto lexsort = subflow.emplace([this](tf::Subflow& sf) {
+        auto const eps = eps_;
+        sf.sort(order_.begin(), order_.end(), [this, eps](auto a, auto b) {
+            auto const* x = objectives_.data() + a * m_;
+            auto const* y = objectives_.data() + b * m_;
+            Operon::Less less;
+            if (less(x, x + m_, y, y + m_, eps)) { return true; }
+            if (less(y, y + m_, x, x + m_, eps)) { return false; }
+            return a < b;
+        });
+    }).name("lexicographical sort");
+    auto dedup = subflow.emplace([this]() { Deduplicate(); }).name("find duplicates");
+    auto gather = subflow.for_each_index(size_t { 0 }, n, size_t { 1 }, [this, pop](size_t i) {
+        auto const k = order_[i];
+        buffer_[i] = std::move(pop[k]);
+        std::copy_n(objectives_.begin() + static_cast<int64_t>(k * m_), m_, scratch_.begin() + static_cast<int64_t>(i * m_));
+    }).name("permute");
+    auto scatter = subflow.for_each_index(size_t { 0 }, n, size_t { 1 }, [this, pop](size_t i) {
+        pop[i] = std::move(buffer_[i]);
+    }).name("move back");
+    auto rank = subflow.emplace([this, pop]() {
+        std::swap(objectives_, scratch_);
+        Rank(pop);
+    }).name("non-dominated sort");
+    auto crowding = subflow.emplace([this, pop](tf::Subflow& sf) {
+        sf.for_each_index(size_t { 0 }, fronts_.size(), size_t { 1 }, [this, pop](size_t i) { Crowding(pop, i); });
+    }).name("crowding distance");
+
+    load.precede(lexsort);
+    lexsort.precede(dedup);
+    dedup.precede(gather);
+    gather.precede(scatter);
+    scatter.precede(rank);
+    rank.precede(crowding);
+    return crowding;
+}
+
+auto CrowdingSorter::Sort(tf::Executor& executor, Operon::Span<Individual> pop) -> void
+{
+    tf::Taskflow taskflow;
+    taskflow.emplace([&](tf::Subflow& subflow) { Sort(subflow, pop); });
+    executor.run(taskflow).wait();
+}
+
+} // namespace Operon
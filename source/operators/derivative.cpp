@@ -0,0 +1,406 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <fmt/format.h>
+#include <robin_hood.h>
+#include <stdexcept>
+
+#include "operon/operators/derivative.hpp"
+
+namespace Operon {
+
+namespace {
+    // a derivative expression under construction, in postfix order
+    // - Source holds the index (in the original tree) of each copied coefficient node, or -1
+    // - an empty fragment stands for the constant zero
+    struct Fragment {
+        Operon::Vector<Node> Nodes;
+        std::vector<int64_t> Source;
+
+        [[nodiscard]] auto IsZero() const -> bool { return Nodes.empty(); }
+        [[nodiscard]] auto IsOne() const -> bool
+        {
+            return Nodes.size() == 1 && Nodes.front().IsConstant() && !Nodes.front().Optimize && Nodes.front().Value == Operon::Scalar { 1 };
+        }
+    };
+
+    auto Constant(Operon::Scalar value) -> Fragment
+    {
+        auto node = Node::Constant(value);
+        node.Optimize = false;
+        return { { node }, { -1 } };
+    }
+
+    // the arguments are given in natural order; in postfix order the first argument comes right before its parent
+    auto Make(NodeType type, std::vector<Fragment> const& args) -> Fragment
+    {
+        Fragment f;
+        for (auto it = args.rbegin(); it != args.rend(); ++it) {
+            f.Nodes.insert(f.Nodes.end(), it->Nodes.begin(), it->Nodes.end());
+            f.Source.insert(f.Source.end(), it->Source.begin(), it->Source.end());
+        }
+        Node node(type);
+        node.Arity = static_cast<uint16_t>(args.size());
+        f.Nodes.push_back(node);
+        f.Source.push_back(-1);
+        return f;
+    }
+
+    auto Add(std::vector<Fragment> args) -> Fragment
+    {
+        args.erase(std::remove_if(args.begin(), args.end(), [](auto const& a) { return a.IsZero(); }), args.end());
+        if (args.size() < 2) {
+            return args.empty() ? Fragment {} : args.front();
+        }
+        return Make(NodeType::Add, args);
+    }
+
+    auto Mul(std::vector<Fragment> args) -> Fragment
+    {
+        if (std::any_of(args.begin(), args.end(), [](auto const& a) { return a.IsZero(); })) {
+            return {};
+        }
+        args.erase(std::remove_if(args.begin(), args.end(), [](auto const& a) { return a.IsOne(); }), args.end());
+        if (args.size() < 2) {
+            return args.empty() ? Constant(1) : args.front();
+        }
+        return Make(NodeType::Mul, args);
+    }
+
+    auto Neg(Fragment const& a) -> Fragment
+    {
+        return a.IsZero() ? a : Make(NodeType::Sub, { a });
+    }
+
+    auto Sub(Fragment const& a, Fragment const& b) -> Fragment
+    {
+        if (b.IsZero()) { return a; }
+        if (a.IsZero()) { return Neg(b); }
+        return Make(NodeType::Sub, { a, b });
+    }
+
+    // div(a, b1, ..., bn) = a / (b1 * ... * bn)
+    auto Div(std::vector<Fragment> const& args) -> Fragment
+    {
+        return args.front().IsZero() ? Fragment {} : Make(NodeType::Div, args);
+    }
+
+    auto Call(NodeType type, Fragment const& a) -> Fragment
+    {
+        return Make(type, { a });
+    }
+
+    class Differentiator {
+    public:
+        explicit Differentiator(Tree const& tree)
+            : tree_(tree)
+            , nodes_(tree_.Nodes())
+        {
+            tree_.Hash(Operon::HashMode::Relaxed); // the copy is hashed so that the caller's hash values are not overwritten
+        }
+
+        // the partial derivative of the subtree rooted at i with respect to the coefficient node p
+        auto operator()(size_t i, size_t p) -> Fragment // NOLINT
+        {
+            auto const& n = nodes_[i];
+            if (p > i || p + n.Length < i) {
+                return {};
+            }
+            if (i == p) {
+                if (n.IsConstant()) {
+                    return Constant(1);
+                }
+                if (n.IsVariable()) {
+                    auto v = n;
+                    v.Value = 1;
+                    v.Optimize = false;
+                    return { { v }, { -1 } };
+                }
+                return {};
+            }
+
+            // identical subtrees have identical derivatives up to a shift of the source indices
+            auto const offset = p - (i - n.Length);
+            auto const key = n.CalculatedHashValue ^ (offset * 0x9E3779B97F4A7C15UL); // NOLINT
+            for (auto const& [j, o, f] : memo_[key]) {
+                if (o == offset && Same(i, j)) {
+                    auto g = f;
+                    auto const shift = static_cast<int64_t>(i) - static_cast<int64_t>(j);
+                    for (auto& s : g.Source) {
+                        if (s >= 0) { s += shift; }
+                    }
+                    return g;
+                }
+            }
+            auto f = Derive(i, p);
+            memo_[key].push_back({ i, offset, f }); // the recursion may have rehashed the map
+            return f;
+        }
+
+        // a copy of the primal subtree rooted at i
+        auto Copy(size_t i) const -> Fragment
+        {
+            Fragment f;
+            auto const first = i - nodes_[i].Length;
+            f.Nodes.assign(nodes_.begin() + static_cast<int64_t>(first), nodes_.begin() + static_cast<int64_t>(i) + 1);
+            f.Source.resize(f.Nodes.size(), -1);
+            for (auto j = first; j <= i; ++j) {
+                if (nodes_[j].Optimize) { f.Source[j - first] = static_cast<int64_t>(j); }
+            }
+            return f;
+        }
+
+    private:
+        struct Entry {
+            size_t Index;
+            size_t Offset;
+            Fragment Derivative;
+        };
+
+        // structural identity, including the values of the nodes that are not optimized
+        [[nodiscard]] auto Same(size_t i, size_t j) const -> bool
+        {
+            if (nodes_[i].Length != nodes_[j].Length) {
+                return false;
+            }
+            for (size_t k = 0; k <= nodes_[i].Length; ++k) {
+                auto const& a = nodes_[i - k];
+                auto const& b = nodes_[j - k];
+                if (a.HashValue != b.HashValue || a.Arity != b.Arity || a.Optimize != b.Optimize || (!a.Optimize && a.Value != b.Value)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        auto Derive(size_t i, size_t p) -> Fragment // NOLINT
+        {
+            auto const& n = nodes_[i];
+            std::vector<size_t> children;
+            for (size_t k = 0, j = i - 1; k < n.Arity; ++k, j -= nodes_[j].Length + 1) {
+                children.push_back(j);
+            }
+            std::vector<Fragment> d;
+            for (auto c : children) {
+                d.push_back((*this)(c, p));
+            }
+            auto const& c = children.front();
+            auto const& dc = d.front();
+
+            switch (n.Type) {
+            case NodeType::Add: {
+                return Add(d);
+            }
+            case NodeType::Sub: {
+                if (n.Arity == 1) {
+                    return Neg(dc);
+                }
+                return Sub(dc, Add({ d.begin() + 1, d.end() }));
+            }
+            case NodeType::Mul: {
+                std::vector<Fragment> terms;
+                for (size_t k = 0; k < children.size(); ++k) {
+                    if (d[k].IsZero()) {
+                        continue;
+                    }
+                    std::vector<Fragment> factors { d[k] };
+                    for (size_t l = 0; l < children.size(); ++l) {
+                        if (l != k) { factors.push_back(Copy(children[l])); }
+                    }
+                    terms.push_back(Mul(factors));
+                }
+                return Add(terms);
+            }
+            case NodeType::Div: {
+                // d(1/a) = -(1/a)^2 da
+                if (n.Arity == 1) {
+                    return Neg(Mul({ Call(NodeType::Square, Copy(i)), dc }));
+                }
+                // f = a / (b1 * ... * bn) => df = da / (b1 * ... * bn) - f * sum(dbk / bk)
+                std::vector<Fragment> args { dc };
+                std::vector<Fragment> terms;
+                for (size_t k = 1; k < children.size(); ++k) {
+                    args.push_back(Copy(children[k]));
+                    if (!d[k].IsZero()) {
+                        terms.push_back(Div({ d[k], Copy(children[k]) }));
+                    }
+                }
+                auto rhs = Add(terms);
+                return Sub(Div(args), rhs.IsZero() ? rhs : Mul({ Copy(i), rhs }));
+            }
+            case NodeType::Aq: {
+                // aq(a, b) = a / sqrt(1 + b^2) => d aq = aq(da, b) - aq(a, b) * b * db / (1 + b^2)
+                auto const& b = children[1];
+                auto lhs = dc.IsZero() ? dc : Make(NodeType::Aq, { dc, Copy(b) });
+                auto rhs = d[1].IsZero() ? d[1] : Div({ Mul({ Copy(i), Copy(b), d[1] }), Add({ Constant(1), Call(NodeType::Square, Copy(b)) }) });
+                return Sub(lhs, rhs);
+            }
+            case NodeType::Pow: {
+                // d a^b = b * a^(b-1) * da + a^b * log(a) * db
+                auto const& b = children[1];
+                auto lhs = dc.IsZero() ? dc : Mul({ Copy(b), Make(NodeType::Pow, { Copy(c), Sub(Copy(b), Constant(1)) }), dc });
+                auto rhs = d[1].IsZero() ? d[1] : Mul({ Copy(i), Call(NodeType::Log, Copy(c)), d[1] });
+                return Add({ lhs, rhs });
+            }
+            default: {
+                break;
+            }
+            }
+
+            // unary functions: chain rule
+            if (dc.IsZero()) {
+                return {};
+            }
+            Fragment df;
+            switch (n.Type) {
+            case NodeType::Abs: {
+                df = Div({ Copy(c), Copy(i) });
+                break;
+            }
+            case NodeType::Acos: {
+                df = Neg(Div({ Constant(1), Call(NodeType::Sqrt, Sub(Constant(1), Call(NodeType::Square, Copy(c)))) }));
+                break;
+            }
+            case NodeType::Asin: {
+                df = Div({ Constant(1), Call(NodeType::Sqrt, Sub(Constant(1), Call(NodeType::Square, Copy(c)))) });
+                break;
+            }
+            case NodeType::Atan: {
+                df = Div({ Constant(1), Add({ Constant(1), Call(NodeType::Square, Copy(c)) }) });
+                break;
+            }
+            case NodeType::Cbrt: {
+                df = Div({ Constant(1), Constant(3), Call(NodeType::Square, Copy(i)) });
+                break;
+            }
+            case NodeType::Ceil:
+            case NodeType::Floor: {
+                break;
+            }
+            case NodeType::Cos: {
+                df = Neg(Call(NodeType::Sin, Copy(c)));
+                break;
+            }
+            case NodeType::Cosh: {
+                df = Call(NodeType::Sinh, Copy(c));
+                break;
+            }
+            case NodeType::Exp: {
+                df = Copy(i);
+                break;
+            }
+            case NodeType::Log:
+            case NodeType::Logabs: {
+                df = Div({ Constant(1), Copy(c) });
+                break;
+            }
+            case NodeType::Log1p: {
+                df = Div({ Constant(1), Add({ Constant(1), Copy(c) }) });
+                break;
+            }
+            case NodeType::Sin: {
+                df = Call(NodeType::Cos, Copy(c));
+                break;
+            }
+            case NodeType::Sinh: {
+                df = Call(NodeType::Cosh, Copy(c));
+                break;
+            }
+            case NodeType::Sqrt: {
+                df = Div({ Constant(0.5), Copy(i) });
+                break;
+            }
+            case NodeType::Sqrtabs: {
+                df = Div({ Copy(c), Constant(2), Call(NodeType::Abs, Copy(c)), Copy(i) });
+                break;
+            }
+            case NodeType::Tan: {
+                df = Add({ Constant(1), Call(NodeType::Square, Copy(i)) });
+                break;
+            }
+            case NodeType::Tanh: {
+                df = Sub(Constant(1), Call(NodeType::Square, Copy(i)));
+                break;
+            }
+            case NodeType::Square: {
+                df = Mul({ Constant(2), Copy(c) });
+                break;
+            }
+            default: {
+                throw std::runtime_error(fmt::format("Cannot differentiate symbol {}\n", n.Name()));
+            }
+            }
+            return Mul({ df, dc });
+        }
+
+        Tree tree_;
+        Operon::Vector<Node> const& nodes_;
+        robin_hood::unordered_flat_map<Operon::Hash, std::vector<Entry>> memo_;
+    };
+
+    auto HasDerivative(Node const& node) -> bool
+    {
+        return !(node.Type == NodeType::Fmin || node.Type == NodeType::Fmax || node.Type == NodeType::Dynamic);
+    }
+} // namespace
+
+SymbolicDerivative::SymbolicDerivative(Tree const& tree)
+{
+    auto const& nodes = tree.Nodes();
+    differentiable_ = std::all_of(nodes.begin(), nodes.end(), HasDerivative);
+    if (!differentiable_) {
+        return;
+    }
+
+    std::vector<size_t> coefficient(nodes.size());
+    for (size_t i = 0, idx = 0; i < nodes.size(); ++i) {
+        coefficient[i] = idx;
+        idx += static_cast<size_t>(nodes[i].Optimize);
+    }
+
+    Differentiator derive(tree);
+    // derivative trees with the same relaxed hash are candidates for sharing
+    robin_hood::unordered_flat_map<Operon::Hash, std::vector<size_t>> unique;
+
+    for (size_t p = 0; p < nodes.size(); ++p) {
+        if (!nodes[p].Optimize) {
+            continue;
+        }
+        auto f = derive(nodes.size() - 1, p);
+        if (f.IsZero()) {
+            columns_.push_back(Zero);
+            continue;
+        }
+        if (f.Nodes.size() > std::numeric_limits<uint16_t>::max()) {
+            // the derivative does not fit into the node representation
+            differentiable_ = false;
+            return;
+        }
+
+        std::vector<size_t> params;
+        for (size_t k = 0; k < f.Nodes.size(); ++k) {
+            if (f.Nodes[k].Optimize) { params.push_back(coefficient[static_cast<size_t>(f.Source[k])]); }
+        }
+        Tree t(std::move(f.Nodes));
+        t.UpdateNodes().Hash(Operon::HashMode::Relaxed);
+
+        auto& candidates = unique[t.HashValue()];
+        auto it = std::find_if(candidates.begin(), candidates.end(), [&](auto k) {
+            auto const& u = derivatives_[k].Nodes();
+            auto const& v = t.Nodes();
+            return parameters_[k] == params && std::equal(u.begin(), u.end(), v.begin(), v.end(), [](auto const& a, auto const& b) {
+                return a.HashValue == b.HashValue && a.Arity == b.Arity && a.Optimize == b.Optimize && (a.Optimize || a.Value == b.Value);
+            });
+        });
+        if (it != candidates.end()) {
+            columns_.push_back(*it);
+            continue;
+        }
+        candidates.push_back(derivatives_.size());
+        columns_.push_back(derivatives_.size());
+        derivatives_.push_back(std::move(t));
+        parameters_.push_back(std::move(params));
+    }
+}
+
+} // namespace Operon
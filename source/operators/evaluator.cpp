@@ -1,14 +1,24 @@
 // SPDX-License-Identifier: MIT
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
+#include <chrono>
+#include <robin_hood.h>
+#include <stdexcept>
+#include <taskflow/taskflow.hpp>
+
+#include "operon/core/arena.hpp"
 #include "operon/core/distance.hpp"
+#include "operon/core/metrics.hpp"
+#include "operon/hash/hash.hpp"
 #include "operon/operators/evaluator.hpp"
 #include "operon/error_metrics/mean_squared_error.hpp"
 #include "operon/error_metrics/normalized_mean_squared_error.hpp"
 #include "operon/error_metrics/r2_score.hpp"
 #include "operon/error_metrics/correlation_coefficient.hpp"
 #include "operon/error_metrics/mean_absolute_error.hpp"
+#include "operon/nnls/batched_lm.hpp"
 #include "operon/nnls/nnls.hpp"
+#include "operon/nnls/variable_projection.hpp"
 
 namespace Operon {
     auto MSE::operator()(Operon::Span<Operon::Scalar const> estimated, Operon::Span<Operon::Scalar const> target) const noexcept -> double
@@ -73,6 +83,31 @@ namespace Operon {
         return -(r * r);
     }
 
+    auto NMSE::FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double>
+    {
+        constexpr double eps{1e-12};
+        auto varY = stats.VarianceY();
+        if (std::abs(varY) < eps) {
+            return varY;
+        }
+        return stats.SSE / stats.Count / varY;
+    }
+
+    auto R2::FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double>
+    {
+        constexpr double eps{1e-12};
+        if (stats.M2Y < eps) {
+            return -std::numeric_limits<double>::lowest();
+        }
+        return -(1.0 - stats.SSE / stats.M2Y);
+    }
+
+    auto C2::FromStatistics(PredictionStatistics const& stats) const noexcept -> std::optional<double>
+    {
+        auto r = stats.Correlation();
+        return -(r * r);
+    }
+
     template<typename T, std::enable_if_t<std::is_arithmetic_v<T>, bool> = true>
     auto FitLeastSquaresImpl(Operon::Span<T const> estimated, Operon::Span<T const> target) -> std::pair<double, double> {
         auto stats = vstat::bivariate::accumulate<T>(estimated.data(), target.data(), estimated.size());
@@ -92,23 +127,165 @@ namespace Operon {
         return FitLeastSquaresImpl<double>(estimated, target);
     }
 
+    namespace {
+        // residual blocks over row chunks for the ceres backend (see Evaluator::SetRowChunks)
+        struct RowChunks {
+            size_t Size { 0 };
+            size_t Threads { 1 };
+            CeresCostFunctionCache* Cache { nullptr };
+        };
+
+        // tunes the coefficients of the tree with nonlinear least squares on the given rows and updates the evaluator counters
+        auto OptimizeCoefficients(EvaluatorBase const& evaluator, Interpreter const& interpreter, Tree& genotype, Dataset const& dataset, Range range, Operon::Span<Operon::Scalar const> targetValues, MonotonicArena& arena, bool projection = false, [[maybe_unused]] RowChunks chunks = {}) -> void
+        {
+            auto const nodeRows = genotype.Length() * range.Size();
+            if (projection) {
+                // the optimizer writes back the coefficients only if the cost decreased
+                VariableProjectionOptimizer opt(interpreter, genotype, dataset);
+                auto summary = opt.Optimize(targetValues, range, evaluator.LocalOptimizationIterations());
+                evaluator.ResidualEvaluations += summary.FunctionEvaluations;
+                evaluator.JacobianEvaluations += summary.JacobianEvaluations;
+                Metrics::Add(Metrics::Counter::LocalOptimizationIterations, static_cast<uint64_t>(summary.Iterations));
+                Metrics::Add(Metrics::Counter::NodeRows, nodeRows * static_cast<uint64_t>(summary.FunctionEvaluations + summary.JacobianEvaluations));
+                return;
+            }
+#if defined(HAVE_CERES)
+            NonlinearLeastSquaresOptimizer<OptimizerType::CERES> opt(interpreter, genotype, dataset);
+            opt.SetRowChunks(chunks.Size, chunks.Threads);
+            opt.SetCostFunctionCache(chunks.Cache);
+#else
+            NonlinearLeastSquaresOptimizer<OptimizerType::EIGEN> opt(interpreter, genotype, dataset);
+#endif
+            auto coeff = arena.Allocate<Operon::Scalar>(genotype.CoefficientsCount());
+            genotype.GetCoefficients(coeff);
+            auto summary = opt.Optimize(targetValues, range, evaluator.LocalOptimizationIterations());
+            evaluator.ResidualEvaluations += summary.FunctionEvaluations;
+            evaluator.JacobianEvaluations += summary.JacobianEvaluations;
+            Metrics::Add(Metrics::Counter::LocalOptimizationIterations, static_cast<uint64_t>(summary.Iterations));
+            Metrics::Add(Metrics::Counter::NodeRows, nodeRows * static_cast<uint64_t>(summary.FunctionEvaluations + summary.JacobianEvaluations));
+
+            // the optimizer writes its solution into the tree, the original coefficients are restored if it failed
+            if (!summary.Success) {
+                genotype.SetCoefficients(coeff);
+            }
+        }
+
+        // n evenly spaced rows of the range (the middle row of each of n equal parts)
+        auto ProbeRows(Range range, size_t n) -> std::vector<size_t>
+        {
+            n = std::min(n, range.Size());
+            std::vector<size_t> rows(n);
+            for (size_t k = 0; k < n; ++k) {
+                rows[k] = range.Start() + (2 * k + 1) * range.Size() / (2 * n);
+            }
+            return rows;
+        }
+    } // namespace
+
     auto
-    Evaluator::operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    Evaluator::operator()(Operon::RandomGenerator& random, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
     {
         ++CallCount;
+        Metrics::ScopedTimer timer(Metrics::Histogram::EvaluationLatency);
+        Metrics::Add(Metrics::Counter::Evaluations);
+        return ComputeFitness(random, ind, buf, /*optimize=*/LocalOptimizationIterations() > 0);
+    }
+
+    auto
+    Evaluator::Evaluate(Operon::Span<Operon::RandomGenerator> rngs, Operon::Span<Individual> individuals, Operon::Span<Operon::Scalar> buf) const -> void
+    {
+        auto const iter = LocalOptimizationIterations();
+        // the batched solver always fits all the coefficients on the whole training range
+        auto const subsampled = subsampleSize_ > 0 && subsampleSize_ < GetProblem().TrainingRange().Size();
+        auto const batched = BatchedOptimization() && iter > 0 && individuals.size() > 1 && !subsampled && !projection_;
+        auto const shared = DagEvaluation() && individuals.size() > 1;
+        if (!batched && !shared) {
+            EvaluatorBase::Evaluate(rngs, individuals, buf);
+            return;
+        }
+
+        auto const& problem = GetProblem();
+        auto const trainingRange = problem.TrainingRange();
+        auto targetValues = problem.GetDataset().GetValues(problem.TargetVariable()).subspan(trainingRange.Start(), trainingRange.Size());
+
+        auto const t0 = std::chrono::steady_clock::now();
+        for (size_t i = 0; batched && i < individuals.size(); i += batchSize_) {
+            // the budget is checked before each batch, once it is exhausted the remaining individuals are not optimized
+            if (BudgetExhausted()) {
+                break;
+            }
+            auto batch = individuals.subspan(i, std::min(batchSize_, individuals.size() - i));
+
+            ArenaScope scope;
+            auto& arena = scope.Arena();
+            auto trees = arena.Allocate<Tree*>(batch.size());
+            auto summaries = arena.Allocate<OptimizerSummary>(batch.size());
+            std::transform(batch.begin(), batch.end(), trees.begin(), [](auto& ind) { return &ind.Genotype; });
+
+            BatchedLevenbergMarquardt lm(interpreter_.get(), problem.GetDataset(), targetValues, trainingRange);
+            lm.Optimize(trees, iter, summaries);
+
+            for (size_t j = 0; j < batch.size(); ++j) {
+                auto const& summary = summaries[j];
+                auto const nodeRows = batch[j].Genotype.Length() * trainingRange.Size();
+                ResidualEvaluations += summary.FunctionEvaluations;
+                JacobianEvaluations += summary.JacobianEvaluations;
+                Metrics::Add(Metrics::Counter::LocalOptimizationIterations, static_cast<uint64_t>(summary.Iterations));
+                Metrics::Add(Metrics::Counter::NodeRows, nodeRows * static_cast<uint64_t>(summary.FunctionEvaluations + summary.JacobianEvaluations));
+            }
+        }
+
+        if (!batched && iter > 0) {
+            for (size_t i = 0; i < individuals.size(); ++i) {
+                // as above, the individuals left over when the budget runs out are not optimized
+                if (BudgetExhausted()) {
+                    break;
+                }
+                ArenaScope scope;
+                Optimize(rngs[i], individuals[i], scope.Arena());
+            }
+        }
+
+        CallCount += individuals.size();
+        Metrics::Add(Metrics::Counter::Evaluations, individuals.size());
+        if (shared) {
+            ComputeFitness(individuals);
+        } else {
+            for (size_t i = 0; i < individuals.size(); ++i) {
+                individuals[i].Fitness = ComputeFitness(rngs[i], individuals[i], buf, /*optimize=*/false);
+            }
+        }
+
+        // the group is evaluated as a whole, so we record the average latency per individual
+        if (Metrics::Enabled()) {
+            auto const elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+            auto const latency = static_cast<uint64_t>(elapsed) / individuals.size();
+            for (size_t i = 0; i < individuals.size(); ++i) {
+                Metrics::Record(Metrics::Histogram::EvaluationLatency, latency);
+            }
+        }
+    }
+
+    auto
+    Evaluator::ComputeFitness(Operon::RandomGenerator& random, Individual& ind, Operon::Span<Operon::Scalar> buf, bool optimize) const -> typename EvaluatorBase::ReturnType
+    {
         auto const& problem = GetProblem();
         auto const& dataset = problem.GetDataset();
         auto& genotype = ind.Genotype;
+        auto const nodeRows = genotype.Length() * problem.TrainingRange().Size();
+
+        // all temporaries of this evaluation live in the worker's arena, which is reset when we are done
+        ArenaScope scope;
+        auto& arena = scope.Arena();
 
         auto trainingRange = problem.TrainingRange();
         auto targetValues = dataset.GetValues(problem.TargetVariable()).subspan(trainingRange.Start(), trainingRange.Size());
 
         auto computeFitness = [&]() {
             ++ResidualEvaluations;
-            Operon::Vector<Operon::Scalar> estimatedValues;
+            Metrics::Add(Metrics::Counter::NodeRows, nodeRows);
             if (buf.size() < trainingRange.Size()) {
-                estimatedValues.resize(trainingRange.Size());
-                buf = Operon::Span<Operon::Scalar>(estimatedValues.data(), estimatedValues.size());
+                buf = arena.Allocate<Operon::Scalar>(trainingRange.Size());
             }
             GetInterpreter().template Evaluate<Operon::Scalar>(genotype, dataset, trainingRange, buf);
 
@@ -119,25 +296,177 @@ namespace Operon {
             return error_(buf, targetValues);
         };
 
-        auto const iter = LocalOptimizationIterations();
+        if (optimize) {
+            Optimize(random, ind, arena);
+        }
+
+        auto fit = Operon::Vector<Operon::Scalar> { static_cast<Operon::Scalar>(computeFitness()) };
+        for (auto& v : fit) {
+            if (!std::isfinite(v)) {
+                v = std::numeric_limits<Operon::Scalar>::max();
+            }
+        }
+        return fit;
+    }
+
+    auto
+    Evaluator::Optimize(Operon::RandomGenerator& random, Individual& ind, MonotonicArena& arena) const -> void
+    {
+        auto const& problem = GetProblem();
+        auto const& dataset = problem.GetDataset();
+        auto const trainingRange = problem.TrainingRange();
+        if (subsampleSize_ > 0 && subsampleSize_ < trainingRange.Size()) {
+            // optimize on a subset of the training rows, the fitness is still computed on the whole range
+            auto rows = SampleRows(random, ind, arena);
+            thread_local Dataset subset { Dataset::Matrix {} }; // reused across evaluations
+            dataset.Subset(rows, subset);
+            auto subsetTarget = subset.GetValues(problem.TargetVariable());
+            // the subset is temporary, so its cost functions are not cached
+            OptimizeCoefficients(*this, interpreter_.get(), ind.Genotype, subset, Range { 0, rows.size() }, subsetTarget, arena, projection_, { rowChunk_, rowChunkThreads_, nullptr });
+        } else {
+            auto targetValues = dataset.GetValues(problem.TargetVariable()).subspan(trainingRange.Start(), trainingRange.Size());
+            OptimizeCoefficients(*this, interpreter_.get(), ind.Genotype, dataset, trainingRange, targetValues, arena, projection_, { rowChunk_, rowChunkThreads_, costFunctionCache_.get() });
+        }
+    }
+
+    auto
+    Evaluator::ComputeFitness(Operon::Span<Individual> individuals) const -> void
+    {
+        auto const& problem = GetProblem();
+        auto const& dataset = problem.GetDataset();
+        auto const trainingRange = problem.TrainingRange();
+        auto const rows = trainingRange.Size();
+        auto targetValues = dataset.GetValues(problem.TargetVariable()).subspan(trainingRange.Start(), rows);
+
+        // the identical subtrees of the group are interned once, so each of them is evaluated once
+        thread_local GenotypeDag dag; // reused across groups
+        dag.Clear();
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+        auto roots = arena.Allocate<GenotypeDag::Id>(individuals.size());
+        std::transform(individuals.begin(), individuals.end(), roots.begin(), [&](auto const& ind) { return dag.Insert(ind.Genotype); });
+        auto estimated = arena.Allocate<Operon::Scalar>(individuals.size() * rows);
+        GetInterpreter().template Evaluate<Operon::Scalar>(dag, roots, dataset, trainingRange, estimated);
+        ResidualEvaluations += individuals.size();
+        Metrics::Add(Metrics::Counter::NodeRows, dag.Size() * rows);
+
+        for (size_t i = 0; i < individuals.size(); ++i) {
+            auto est = estimated.subspan(i * rows, rows);
+            if (scaling_) {
+                auto [a, b] = FitLeastSquaresImpl<Operon::Scalar>(est, targetValues);
+                std::transform(est.begin(), est.end(), est.begin(), [a=a,b=b](auto x) { return a * x + b; });
+            }
+            auto f = static_cast<Operon::Scalar>(error_(est, targetValues));
+            individuals[i].Fitness = Operon::Vector<Operon::Scalar> { std::isfinite(f) ? f : std::numeric_limits<Operon::Scalar>::max() };
+        }
+    }
 
-        if (iter > 0) {
+    auto
+    Evaluator::SetRowChunks(size_t rows, size_t threads) -> void
+    {
+        rowChunk_ = rows;
+        rowChunkThreads_ = std::max(threads, size_t { 1 });
 #if defined(HAVE_CERES)
-            NonlinearLeastSquaresOptimizer<OptimizerType::CERES> opt(interpreter_.get(), genotype, dataset);
-#else
-            NonlinearLeastSquaresOptimizer<OptimizerType::EIGEN> opt(interpreter_.get(), genotype, dataset);
+        if (rowChunk_ > 0 && !costFunctionCache_) {
+            costFunctionCache_ = std::make_shared<CeresCostFunctionCache>();
+        }
 #endif
-            auto coeff = genotype.GetCoefficients();
-            auto summary = opt.Optimize(targetValues, trainingRange, iter);
-            ResidualEvaluations += summary.FunctionEvaluations;
-            JacobianEvaluations += summary.JacobianEvaluations;
+    }
 
-            if (summary.Success) {
-                genotype.SetCoefficients(coeff);
+    auto
+    Evaluator::SampleRows(Operon::RandomGenerator& random, Individual const& ind, MonotonicArena& arena) const -> Operon::Span<size_t>
+    {
+        auto const range = GetProblem().TrainingRange();
+        auto const n = range.Size();
+        auto const k = std::min(subsampleSize_, n);
+
+        // with a fixed seed the subset only depends on the structure of the individual, otherwise it is drawn from the caller's stream
+        // (the structure is hashed from the node symbols, the genotype's cached hash values must not be overwritten)
+        auto structure = [&]() {
+            auto const& nodes = ind.Genotype.Nodes();
+            auto symbols = arena.Allocate<Operon::Hash>(nodes.size());
+            std::transform(nodes.begin(), nodes.end(), symbols.begin(), [](auto const& n) { return n.HashValue ^ n.Arity; });
+            return Hasher{}(reinterpret_cast<uint8_t const*>(symbols.data()), symbols.size() * sizeof(Operon::Hash)); // NOLINT
+        };
+        Operon::RandomGenerator rng(subsampleSeed_ != 0 ? subsampleSeed_ ^ structure() : random());
+
+        auto rows = arena.Allocate<size_t>(k);
+        if (subsampleMode_ == SubsampleMode::Stratified) {
+            // one row from each of k equally sized strata of the training range
+            std::uniform_real_distribution<double> dist(0, 1);
+            auto const width = static_cast<double>(n) / static_cast<double>(k);
+            for (size_t i = 0; i < k; ++i) {
+                auto const offset = static_cast<size_t>((static_cast<double>(i) + dist(rng)) * width);
+                rows[i] = range.Start() + std::min(offset, n - 1);
+            }
+        } else {
+            // Floyd's algorithm: k distinct rows in O(k)
+            robin_hood::unordered_flat_set<size_t> selected;
+            selected.reserve(k);
+            size_t idx = 0;
+            for (auto j = n - k; j < n; ++j) {
+                auto t = std::uniform_int_distribution<size_t>(0, j)(rng);
+                if (!selected.insert(t).second) {
+                    selected.insert(j);
+                    t = j;
+                }
+                rows[idx++] = range.Start() + t;
             }
+            std::sort(rows.begin(), rows.end()); // preserve the memory access pattern
         }
+        return rows;
+    }
 
-        auto fit = Operon::Vector<Operon::Scalar> { static_cast<Operon::Scalar>(computeFitness()) };
+    auto
+    Evaluator::Update(Operon::RandomGenerator& random, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        auto const& problem = GetProblem();
+        auto const& dataset = problem.GetDataset();
+        auto const& error = error_.get();
+        auto const current = problem.TrainingRange();
+
+        // the incremental update is only possible if the previous fitness value is valid and the window moved forward
+        // (with linear scaling the scaling terms depend on the whole range, so a full evaluation is necessary)
+        auto const overlap = previous.Start() <= current.Start() && previous.End() <= current.End() && current.Start() < previous.End();
+        if (!error.Decomposable() || scaling_ || !overlap || ind.Fitness.empty() || !(ind[0] < std::numeric_limits<Operon::Scalar>::max())) {
+            return (*this)(random, ind, buf);
+        }
+
+        // the running sum is recovered from the rounded fitness value at each step, so its error grows with the number of
+        // updates: the fitness is re-anchored on a full evaluation whenever the end of the window crosses a multiple of the
+        // largest power of two not above its size (at least once per turnover of a sliding window, and each time a growing
+        // window has doubled). neither path tunes the coefficients, the fitness is the one of the current coefficients
+        auto block = size_t { 1 };
+        while (block <= current.Size() / 2) {
+            block *= 2;
+        }
+        if (previous.End() / block != current.End() / block) {
+            return ComputeFitness(random, ind, buf, /*optimize=*/false);
+        }
+
+        auto targetValues = dataset.GetValues(problem.TargetVariable());
+        ArenaScope scope;
+
+        // returns the sum of f(e) over the given range, where the metric is g(mean(f(e)))
+        auto partialSum = [&](Range range) {
+            if (range.Size() == 0) {
+                return 0.0;
+            }
+            ++ResidualEvaluations;
+            auto est = buf.size() < range.Size() ? scope.Arena().Allocate<Operon::Scalar>(range.Size()) : buf;
+            est = est.subspan(0, range.Size());
+            GetInterpreter().template Evaluate<Operon::Scalar>(ind.Genotype, dataset, range, est);
+            return error.ToMean(error(est, targetValues.subspan(range.Start(), range.Size()))) * static_cast<double>(range.Size());
+        };
+
+        auto const evicted = partialSum(Range { previous.Start(), current.Start() });
+        auto const added = partialSum(Range { previous.End(), current.End() });
+        auto const sum = error.ToMean(ind[0]) * static_cast<double>(previous.Size()) - evicted + added;
+        if (sum < 0) {
+            return ComputeFitness(random, ind, buf, /*optimize=*/false); // cancellation, the sum is no longer usable
+        }
+
+        auto fit = Operon::Vector<Operon::Scalar> { static_cast<Operon::Scalar>(error.FromMean(sum / static_cast<double>(current.Size()))) };
         for (auto& v : fit) {
             if (!std::isfinite(v)) {
                 v = std::numeric_limits<Operon::Scalar>::max();
@@ -146,11 +475,242 @@ namespace Operon {
         return fit;
     }
 
+    auto
+    FusedEvaluator::operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        ++CallCount;
+        Metrics::ScopedTimer timer(Metrics::Histogram::EvaluationLatency);
+        Metrics::Add(Metrics::Counter::Evaluations);
+
+        auto const& problem = GetProblem();
+        auto const& dataset = problem.GetDataset();
+        auto& genotype = ind.Genotype;
+        auto const trainingRange = problem.TrainingRange();
+        auto const nodeRows = genotype.Length() * trainingRange.Size();
+        auto const targetValues = dataset.GetValues(problem.TargetVariable()).subspan(trainingRange.Start(), trainingRange.Size());
+
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+
+        auto const predictive = std::any_of(objectives_.begin(), objectives_.end(), [](auto const& obj) { return obj.Metric != nullptr; });
+
+        PredictionStatistics stats;
+        if (predictive) {
+            if (LocalOptimizationIterations() > 0) {
+                OptimizeCoefficients(*this, interpreter_.get(), genotype, dataset, trainingRange, targetValues, arena);
+            }
+
+            // a single interpreter run serves all the objectives
+            ++ResidualEvaluations;
+            Metrics::Add(Metrics::Counter::NodeRows, nodeRows);
+            if (buf.size() < trainingRange.Size()) {
+                buf = arena.Allocate<Operon::Scalar>(trainingRange.Size());
+            }
+            buf = buf.subspan(0, trainingRange.Size());
+            GetInterpreter().template Evaluate<Operon::Scalar>(genotype, dataset, trainingRange, buf);
+
+            if (scaling_) {
+                auto [a, b] = FitLeastSquaresImpl<Operon::Scalar>(buf, targetValues);
+                std::transform(buf.begin(), buf.end(), buf.begin(), [a=a,b=b](auto x) { return a * x + b; });
+            }
+            for (size_t i = 0; i < buf.size(); ++i) {
+                stats(buf[i], targetValues[i]);
+            }
+        }
+
+        Operon::Vector<Operon::Scalar> fit(objectives_.size());
+        for (size_t i = 0; i < objectives_.size(); ++i) {
+            auto const& [metric, structure, scale] = objectives_[i];
+            double value{0};
+            if (metric != nullptr) {
+                auto const v = metric->FromStatistics(stats);
+                value = v ? *v : (*metric)(buf, targetValues);
+            } else {
+                switch (structure) {
+                case Structure::Length:
+                    value = static_cast<double>(genotype.Length());
+                    break;
+                case Structure::Depth:
+                    value = static_cast<double>(genotype.Depth());
+                    break;
+                case Structure::VisitationLength:
+                    value = static_cast<double>(genotype.VisitationLength());
+                    break;
+                }
+                value *= scale;
+            }
+            fit[i] = static_cast<Operon::Scalar>(value);
+            if (!std::isfinite(fit[i])) {
+                fit[i] = std::numeric_limits<Operon::Scalar>::max();
+            }
+        }
+        return fit;
+    }
+
+    auto
+    CachedEvaluator::operator()(Operon::RandomGenerator& rng, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        ++CallCount;
+        auto const range = GetProblem().TrainingRange();
+        auto const key = ind.Genotype.Rehash(Operon::HashMode::Strict).HashValue();
+
+        FitnessCache::Entry entry;
+        if (cache_.get().Find(key, range, entry)) {
+            if (!entry.Coefficients.empty()) {
+                ind.Genotype.SetCoefficients(entry.Coefficients);
+            }
+            return entry.Fitness;
+        }
+
+        auto const& evaluator = evaluator_.get();
+        auto fit = evaluator(rng, ind, buf);
+        cache_.get().Insert(key, { fit, ind.Genotype.GetCoefficients(), range });
+
+        ResidualEvaluations = evaluator.ResidualEvaluations.load();
+        JacobianEvaluations = evaluator.JacobianEvaluations.load();
+        return fit;
+    }
+
+    auto
+    CachedEvaluator::Update(Operon::RandomGenerator& rng, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        auto const& evaluator = evaluator_.get();
+        auto fit = evaluator.Update(rng, ind, previous, buf);
+        ResidualEvaluations = evaluator.ResidualEvaluations.load();
+        JacobianEvaluations = evaluator.JacobianEvaluations.load();
+        return fit;
+    }
+
+    SemanticCachedEvaluator::SemanticCachedEvaluator(Problem& problem, Interpreter& interp, EvaluatorBase const& evaluator, FitnessCache& cache, Policy policy, size_t probes, double resolution)
+        : EvaluatorBase(problem)
+        , interpreter_(interp)
+        , evaluator_(evaluator)
+        , cache_(cache)
+        , policy_(policy)
+        , probeCount_(probes)
+        , resolution_(resolution)
+        , probes_(problem.GetDataset().Subset(ProbeRows(problem.TrainingRange(), probes)))
+        , probeRange_(problem.TrainingRange())
+    {
+        EXPECT(probes > 0 && resolution > 0);
+        if (policy == Policy::Inherit && evaluator.LocalOptimizationIterations() > 0) {
+            throw std::runtime_error("SemanticCachedEvaluator: Policy::Inherit requires an evaluator without local optimization");
+        }
+        SetBudget(evaluator.Budget());
+        SetLocalOptimizationIterations(evaluator.LocalOptimizationIterations());
+    }
+
+    auto SemanticCachedEvaluator::UpdateProbes() const -> void
+    {
+        auto const& problem = GetProblem();
+        if (problem.TrainingRange().Bounds() != probeRange_.Bounds()) {
+            probeRange_ = problem.TrainingRange();
+            auto probes = problem.GetDataset().Subset(ProbeRows(probeRange_, probeCount_));
+            probes_.Swap(probes);
+        }
+    }
+
+    auto SemanticCachedEvaluator::Prepare(Operon::Span<Operon::Individual const> pop) const -> void
+    {
+        UpdateProbes();
+        evaluator_.get().Prepare(pop);
+    }
+
+    auto SemanticCachedEvaluator::Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void
+    {
+        UpdateProbes();
+        evaluator_.get().Prepare(subflow, pop);
+    }
+
+    auto SemanticCachedEvaluator::Fingerprint(Tree const& tree) const -> Operon::Hash
+    {
+        auto const n = probes_.Rows();
+        ArenaScope scope;
+        auto& arena = scope.Arena();
+        auto values = arena.Allocate<Operon::Scalar>(n);
+        interpreter_.get().template Evaluate<Operon::Scalar>(tree, probes_, Range { 0, n }, values);
+
+        // each value is reduced to its binary exponent and its mantissa rounded to the resolution, such that the
+        // fingerprint does not depend on the scale of the outputs; values smaller than the resolution count as zero
+        auto keys = arena.Allocate<int64_t>(2 * n);
+        for (size_t i = 0; i < n; ++i) {
+            auto const v = static_cast<double>(values[i]);
+            int e { 0 };
+            auto m { 0.0 };
+            if (std::isnan(v)) {
+                e = std::numeric_limits<int>::max();
+            } else if (std::isinf(v)) {
+                e = std::numeric_limits<int>::min();
+                m = v > 0 ? 1 : -1;
+            } else if (std::abs(v) >= resolution_) {
+                m = std::frexp(v, &e);
+            }
+            keys[2 * i] = e;
+            keys[2 * i + 1] = std::llround(m / resolution_);
+        }
+        return Hasher{}(reinterpret_cast<uint8_t const*>(keys.data()), keys.size_bytes()); // NOLINT
+    }
+
+    auto
+    SemanticCachedEvaluator::operator()(Operon::RandomGenerator& rng, Individual& ind, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        ++CallCount;
+        auto const& evaluator = evaluator_.get();
+        auto evaluate = [&]() {
+            auto fit = evaluator(rng, ind, buf);
+            ResidualEvaluations = evaluator.ResidualEvaluations.load();
+            JacobianEvaluations = evaluator.JacobianEvaluations.load();
+            return fit;
+        };
+
+        // the constructor rejects this combination, the iterations must not have been changed since
+        EXPECT(policy_ == Policy::Reject || evaluator.LocalOptimizationIterations() == 0);
+
+        auto const range = GetProblem().TrainingRange();
+        auto const key = Fingerprint(ind.Genotype);
+
+        FitnessCache::Entry entry;
+        if (cache_.get().Find(key, range, entry)) {
+            if (policy_ == Policy::Reject) {
+                entry.Fitness.assign(entry.Fitness.size(), std::numeric_limits<Operon::Scalar>::max());
+            }
+            return entry.Fitness;
+        }
+
+        auto fit = evaluate();
+        // the coefficients are not stored: they belong to a tree that is only equivalent to the ones matching it later
+        cache_.get().Insert(key, { fit, {}, range });
+        return fit;
+    }
+
+    auto
+    SemanticCachedEvaluator::Update(Operon::RandomGenerator& rng, Individual& ind, Range previous, Operon::Span<Operon::Scalar> buf) const -> typename EvaluatorBase::ReturnType
+    {
+        auto const& evaluator = evaluator_.get();
+        auto fit = evaluator.Update(rng, ind, previous, buf);
+        ResidualEvaluations = evaluator.ResidualEvaluations.load();
+        JacobianEvaluations = evaluator.JacobianEvaluations.load();
+        return fit;
+    }
+
     auto DiversityEvaluator::Prepare(Operon::Span<Operon::Individual const> pop) const -> void {
+        for (auto const& ind : pop) {
+            [[maybe_unused]] auto const& tree = ind.Genotype.Rehash(hashmode_);
+        }
+        Count(pop);
+    }
+
+    auto DiversityEvaluator::Prepare(tf::Subflow& subflow, Operon::Span<Operon::Individual const> pop) const -> void {
+        auto hash = HashPopulation(subflow, pop, hashmode_);
+        auto count = subflow.emplace([this, pop]() { Count(pop); }).name("count subtrees");
+        hash.precede(count);
+    }
+
+    auto DiversityEvaluator::Count(Operon::Span<Operon::Individual const> pop) const -> void {
         divmap_.clear();
         total_ = 0;
         for (auto const& ind : pop) {
-            auto const& nodes = ind.Genotype.Hash(hashmode_).Nodes();
+            auto const& nodes = ind.Genotype.Nodes();
             for (auto const& node : nodes) {
                 auto [it, _] = divmap_.insert({ node.CalculatedHashValue, 0 });
                 ++it->second;
@@ -167,7 +727,8 @@ namespace Operon {
     auto
     DiversityEvaluator::operator()(Operon::RandomGenerator& /*random*/, Individual& ind, Operon::Span<Operon::Scalar>  /*buf*/) const -> typename EvaluatorBase::ReturnType
     {
-        auto const& nodes = ind.Genotype.Nodes();
+        // the offspring carry the hash values of their parents, except for the nodes changed by variation
+        auto const& nodes = ind.Genotype.Rehash(hashmode_).Nodes();
         auto sum = std::transform_reduce(nodes.begin(), nodes.end(), Operon::Scalar{0}, std::plus{}, [&](auto const& n) { auto it = divmap_.find(n.CalculatedHashValue); return it == divmap_.end() ? 0 : it->second; });
         return { sum / static_cast<Operon::Scalar>(total_) };
     }
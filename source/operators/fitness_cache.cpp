@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <algorithm>
+
+#include "operon/core/contracts.hpp"
+#include "operon/operators/fitness_cache.hpp"
+
+namespace Operon {
+
+FitnessCache::FitnessCache(size_t capacity, size_t shards)
+    : shardCapacity_(std::max(size_t { 1 }, capacity / std::max(size_t { 1 }, shards)))
+{
+    EXPECT(shards > 0);
+    shards_.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        auto shard = std::make_unique<Shard>();
+        shard->Map.reserve(shardCapacity_);
+        shard->Keys.reserve(shardCapacity_);
+        shards_.push_back(std::move(shard));
+    }
+}
+
+auto FitnessCache::Find(Operon::Hash key, Range range, Entry& entry) const -> bool
+{
+    auto& shard = GetShard(key);
+    {
+        std::lock_guard<std::mutex> lock(shard.Mutex);
+        auto it = shard.Map.find(key);
+        if (it != shard.Map.end() && it->second.TrainingRange.Bounds() == range.Bounds()) {
+            entry = it->second;
+            ++hits_;
+            return true;
+        }
+    }
+    ++misses_;
+    return false;
+}
+
+auto FitnessCache::Insert(Operon::Hash key, Entry entry) -> void
+{
+    auto& shard = GetShard(key);
+    std::lock_guard<std::mutex> lock(shard.Mutex);
+    auto it = shard.Map.find(key);
+    if (it != shard.Map.end()) {
+        it->second = std::move(entry);
+        return;
+    }
+    if (shard.Keys.size() < shardCapacity_) {
+        shard.Keys.push_back(key);
+    } else {
+        // evict the oldest entry in this shard
+        shard.Map.erase(shard.Keys[shard.Next]);
+        shard.Keys[shard.Next] = key;
+        shard.Next = (shard.Next + 1) % shardCapacity_;
+    }
+    shard.Map.emplace(key, std::move(entry));
+}
+
+auto FitnessCache::Clear() -> void
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+        shard->Map.clear();
+        shard->Keys.clear();
+        shard->Next = 0;
+    }
+}
+
+auto FitnessCache::GetState() const -> State
+{
+    State state;
+    for (auto const& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+        // the ring starts at the oldest entry once it is full (Next is zero before)
+        auto const n = shard->Keys.size();
+        for (size_t i = 0; i < n; ++i) {
+            auto const key = shard->Keys[(shard->Next + i) % n];
+            state.Entries.emplace_back(key, shard->Map.at(key));
+        }
+    }
+    state.Hits = hits_;
+    state.Misses = misses_;
+    return state;
+}
+
+auto FitnessCache::SetState(State const& state) -> void
+{
+    Clear();
+    for (auto const& [key, entry] : state.Entries) {
+        Insert(key, entry);
+    }
+    hits_ = state.Hits;
+    misses_ = state.Misses;
+}
+
+auto FitnessCache::Size() const -> size_t
+{
+    size_t size = 0;
+    for (auto const& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard->Mutex);
+        size += shard->Map.size();
+    }
+    return size;
+}
+
+} // namespace Operon
@@ -6,34 +6,40 @@
 namespace Operon {
     auto BasicOffspringGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual>
     {
-        std::uniform_real_distribution<double> uniformReal;
-        bool doCrossover = std::bernoulli_distribution(pCrossover)(random);
-        bool doMutation = std::bernoulli_distribution(pMutation)(random);
-
-        if (!(doCrossover || doMutation)) {
+        Individual child(0);
+        if (!(*this)(random, pCrossover, pMutation, buf, child)) {
             return std::nullopt;
         }
+        return std::make_optional(std::move(child));
+    }
 
-        auto population = this->FemaleSelector().Population();
-
-        auto first = this->FemaleSelector()(random);
-        Individual child;
-
-        if (doCrossover) {
-            auto second = this->MaleSelector()(random);
-            child.Genotype = this->Crossover()(random, population[first].Genotype, population[second].Genotype);
-        }
-
-        if (doMutation) {
-            child.Genotype = doCrossover
-                ? this->Mutator()(random, std::move(child.Genotype))
-                : this->Mutator()(random, population[first].Genotype);
+    auto BasicOffspringGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool
+    {
+        if (!Generate(random, pCrossover, pMutation, child)) {
+            return false;
         }
 
         child.Fitness = this->Evaluator()(random, child, buf);
         for (auto& v : child.Fitness) {
             if (!std::isfinite(v)) { v = std::numeric_limits<Operon::Scalar>::max(); }
         }
-        return std::make_optional(child);
+        return true;
+    }
+
+    auto BasicOffspringGenerator::Generate(Operon::RandomGenerator& random, double pCrossover, double pMutation, Individual& child) const -> bool
+    {
+        bool doCrossover = std::bernoulli_distribution(pCrossover)(random);
+        bool doMutation = std::bernoulli_distribution(pMutation)(random);
+
+        if (!(doCrossover || doMutation)) {
+            return false;
+        }
+
+        auto population = this->FemaleSelector().Population();
+
+        auto first = SelectFemale(random);
+        auto const* second = doCrossover ? &population[SelectMale(random)].Genotype : nullptr;
+        Vary(random, population[first].Genotype, second, doMutation, child.Genotype);
+        return true;
     }
 } // namespace Operon
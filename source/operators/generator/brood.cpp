@@ -1,57 +1,60 @@
 // SPDX-License-Identifier: MIT
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
+#include "operon/core/node_arena.hpp"
 #include "operon/operators/generator.hpp"
 #include "operon/operators/non_dominated_sorter.hpp"
 
 namespace Operon {
     auto BroodOffspringGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual>
     {
-        std::uniform_real_distribution<double> uniformReal;
+        Individual child(0);
+        if (!(*this)(random, pCrossover, pMutation, buf, child)) {
+            return std::nullopt;
+        }
+        return std::make_optional(std::move(child));
+    }
 
+    auto BroodOffspringGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool
+    {
         auto population = this->FemaleSelector().Population();
 
-        auto first = FemaleSelector()(random);
-        auto second = MaleSelector()(random);
+        auto first = SelectFemale(random);
+        auto second = SelectMale(random);
+
+        // the brood is kept by each thread, so the storage of its genotypes is reused across calls
+        thread_local std::vector<Individual> offspring;
+        offspring.resize(broodSize_);
 
         // assuming the basic generator never fails
-        auto makeOffspring = [&]() {
-            Individual child(population[first].Fitness.size());
+        for (auto& ind : offspring) {
             bool doCrossover = std::bernoulli_distribution(pCrossover)(random);
             bool doMutation = std::bernoulli_distribution(pMutation)(random);
+            Vary(random, population[first].Genotype, doCrossover ? &population[second].Genotype : nullptr, doMutation, ind.Genotype);
 
-            if (doCrossover) {
-                child.Genotype = Crossover()(random, population[first].Genotype, population[second].Genotype);
-            }
-
-            if (doMutation) {
-                child.Genotype = doCrossover
-                    ? Mutator()(random, std::move(child.Genotype))
-                    : Mutator()(random, population[first].Genotype);
-            }
-
-            auto f = Evaluator()(random, child, buf);
-            for (size_t i = 0; i < f.size(); ++i) {
-                child[i] = std::isfinite(f[i]) ? f[i] : std::numeric_limits<Operon::Scalar>::max();
+            ind.Fitness = Evaluator()(random, ind, buf);
+            for (auto& v : ind.Fitness) {
+                if (!std::isfinite(v)) { v = std::numeric_limits<Operon::Scalar>::max(); }
             }
-            return child;
-        };
-
-        std::vector<Individual> offspring;
-        offspring.reserve(broodSize_);
-        for (size_t i = 0; i < broodSize_; ++i) {
-            offspring.push_back(makeOffspring());
         }
         SingleObjectiveComparison comp{0};
         RankIntersectSorter sorter;
 
+        auto best = offspring.begin();
         if (population[first].Size() > 1) {
             std::stable_sort(offspring.begin(), offspring.end(), LexicographicalComparison{});
             auto fronts = sorter(offspring);
-            auto best = *std::min_element(fronts[0].begin(), fronts[0].end(), [&](auto i, auto j) { return comp(offspring[i], offspring[j]); });
-            return std::make_optional(offspring[best]);
+            best += static_cast<std::ptrdiff_t>(*std::min_element(fronts[0].begin(), fronts[0].end(), [&](auto i, auto j) { return comp(offspring[i], offspring[j]); }));
+        } else {
+            best = std::min_element(offspring.begin(), offspring.end(), comp);
+        }
+        // the caller's individual takes the place of the best child in the brood, unless its genotype belongs to a
+        // packed population (see NodeArena): the brood outlives the next packing, so the best child is copied instead
+        if (NodeArena::Stored(child.Genotype.Nodes())) {
+            child = *best;
+        } else {
+            std::swap(child, *best);
         }
-        auto best = *std::min_element(offspring.begin(), offspring.end(), comp);
-        return std::make_optional(best);
+        return true;
     }
 } // namespace Operon
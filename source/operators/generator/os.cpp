@@ -7,52 +7,48 @@
 namespace Operon {
 
     auto OffspringSelectionGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf) const -> std::optional<Individual>
+    {
+        Individual child(0);
+        if (!(*this)(random, pCrossover, pMutation, buf, child)) {
+            return std::nullopt;
+        }
+        return std::make_optional(std::move(child));
+    }
+
+    auto OffspringSelectionGenerator::operator()(Operon::RandomGenerator& random, double pCrossover, double pMutation, Operon::Span<Operon::Scalar> buf, Individual& child) const -> bool
     {
         std::uniform_real_distribution<double> uniformReal;
         bool doCrossover = uniformReal(random) < pCrossover;
         bool doMutation = uniformReal(random) < pMutation;
 
         if (!(doCrossover || doMutation)) {
-            return std::nullopt;
+            return false;
         }
 
         auto population = FemaleSelector().Population();
 
-        size_t first = FemaleSelector()(random);
-
-
-        std::optional<Individual> p1{ population[first] };
-        std::optional<Individual> p2;
-
-        Individual child(p1.value().Fitness.size());
-
-        if (doCrossover) {
-            auto second = MaleSelector()(random);
-            child.Genotype = Crossover()(random, population[first].Genotype, population[second].Genotype);
-            p2 = population[second];
-        }
-
-        if (doMutation) {
-            child.Genotype = doCrossover
-                ? Mutator()(random, std::move(child.Genotype))
-                : Mutator()(random, population[first].Genotype);
-        }
+        // the parents are only referenced, the child is written into the caller's individual
+        auto const& p1 = population[SelectFemale(random)];
+        Individual const* p2 = doCrossover ? &population[SelectMale(random)] : nullptr;
+        Vary(random, p1.Genotype, p2 != nullptr ? &p2->Genotype : nullptr, doMutation, child.Genotype);
 
         child.Fitness = Evaluator()(random, child, buf);
-        bool accept{false};
-
-        if (p2.has_value()) {
-            Individual q(child.Size());
-            for (size_t i = 0; i < child.Size(); ++i) {
-                auto f1 = p1.value()[i];
-                auto f2 = p2.value()[i];
-                q[i] = std::max(f1, f2) - static_cast<Operon::Scalar>(comparisonFactor_) * std::abs(f1 - f2);
-                accept = Operon::ParetoDominance{}(child.Fitness, q.Fitness) != Dominance::Right;
+
+        // the child is rejected if the reference fitness dominates it
+        // with two parents the reference is max(f1, f2) - c * |f1 - f2| for each objective
+        auto const c = static_cast<Operon::Scalar>(comparisonFactor_);
+        bool better { false };
+        bool worse { false };
+        for (size_t i = 0; i < child.Size(); ++i) {
+            auto q = p1[i];
+            if (p2 != nullptr) {
+                auto f2 = (*p2)[i];
+                q = std::max(q, f2) - c * std::abs(q - f2);
             }
-        } else {
-            accept = Operon::ParetoDominance{}(child.Fitness, p1.value().Fitness) != Dominance::Right;
+            better |= child[i] < q;
+            worse |= q < child[i];
         }
-        return accept ? std::make_optional(child) : std::nullopt;
+        return !(worse && !better);
     }
 
 } // namespace Operon
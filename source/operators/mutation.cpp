@@ -11,6 +11,7 @@ namespace Operon {
 
 auto DiscretePointMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
     auto it = Operon::Random::Sample(random, nodes.begin(), nodes.end(), [](auto const& n) { return n.IsLeaf(); });
     ENSURE(it < nodes.end());
@@ -27,6 +28,8 @@ auto DiscretePointMutation::operator()(Operon::RandomGenerator& random, Tree tre
         }
     }
 
+    auto const i = static_cast<size_t>(std::distance(nodes.begin(), it));
+    tree.SetHashState(state).Edited(i, i + 1);
     return tree;
 }
 
@@ -48,22 +51,28 @@ auto MultiMutation::operator()(Operon::RandomGenerator& random, Tree tree) const
 
 auto ChangeVariableMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
     auto it = Operon::Random::Sample(random, nodes.begin(), nodes.end(), [](auto const& n) { return n.IsVariable(); });
     if (it == nodes.end()) {
+        tree.SetHashState(state);
         return tree; // no variables in the tree, nothing to do
     }
 
     it->HashValue = it->CalculatedHashValue = Sample(random, variables.begin(), variables.end())->Hash;
+    auto const i = static_cast<size_t>(std::distance(nodes.begin(), it));
+    tree.SetHashState(state).Edited(i, i + 1);
     return tree;
 }
 
 auto ChangeFunctionMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
 
     auto it = Operon::Random::Sample(random, nodes.begin(), nodes.end(), [](auto const& n) { return !n.IsLeaf(); });
     if (it == nodes.end()) {
+        tree.SetHashState(state);
         return tree; // no functions in the tree, nothing to do
     }
 
@@ -73,11 +82,14 @@ auto ChangeFunctionMutation::operator()(Operon::RandomGenerator& random, Tree tr
     auto n = pset_.SampleRandomSymbol(random, minArity, maxArity);
     it->Type = n.Type;
     it->HashValue = n.HashValue;
+    auto const i = static_cast<size_t>(std::distance(nodes.begin(), it));
+    tree.SetHashState(state).Edited(i, i + 1);
     return tree;
 }
 
 auto ReplaceSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
 
     auto i = std::uniform_int_distribution<size_t>(0, nodes.size() - 1)(random);
@@ -108,23 +120,34 @@ auto ReplaceSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tr
     std::copy(subtree.Nodes().begin(), subtree.Nodes().end(), std::back_inserter(mutated));
     std::copy(nodes.begin() + static_cast<Signed>(i + 1), nodes.end(), std::back_inserter(mutated));
 
-    return Tree(mutated).UpdateNodes();
+    auto const begin = i - nodes[i].Length;
+    Tree child(std::move(mutated));
+    child.SetHashState(state).UpdateNodes(begin, begin + subtree.Length(), oldLen);
+    return child;
 }
 
 auto RemoveSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
 
     if (nodes.size() == 1) {
+        tree.SetHashState(state);
         return tree; // nothing to remove
     }
 
     auto it = Operon::Random::Sample(random, nodes.begin(), nodes.end() - 1); // -1 because we don't want to remove the tree root
     auto const& p = nodes[it->Parent];
     if (p.Arity > pset_.MinimumArity(p.HashValue)) {
-        nodes[it->Parent].Arity--;
+        // the parent's subtree is the one that changed
+        auto const parent = size_t { it->Parent };
+        auto const length = size_t { p.Length } + 1;
+        auto const removed = size_t { it->Length } + 1;
+        nodes[parent].Arity--;
         nodes.erase(it - it->Length, it + 1);
-        tree.UpdateNodes();
+        tree.SetHashState(state).UpdateNodes(parent + 1 - length, parent + 1 - removed, length);
+    } else {
+        tree.SetHashState(state);
     }
     return tree;
 }
@@ -136,6 +159,7 @@ auto InsertSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tre
         return tree;
     }
 
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
     auto const& creator = creator_.get();
     auto const& pset = creator.GetPrimitiveSet();
@@ -147,6 +171,7 @@ auto InsertSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tre
     auto n = std::count_if(nodes.begin(), nodes.end(), test);
 
     if (n == 0) {
+        tree.SetHashState(state);
         return tree;
     }
 
@@ -181,15 +206,20 @@ auto InsertSubtreeMutation::operator()(Operon::RandomGenerator& random, Tree tre
     std::copy(subtree.Nodes().begin(), subtree.Nodes().end(), std::back_inserter(mutated));
     std::copy(nodes.begin() + static_cast<Signed>(i - nodes[i].Length), nodes.end(), std::back_inserter(mutated));
 
-    return Tree(mutated).UpdateNodes();
+    // the subtree of node i changed (it gained a child)
+    Tree child(std::move(mutated));
+    child.SetHashState(state).UpdateNodes(i - nodes[i].Length, i + subtree.Length() + 1, nodes[i].Length + 1U);
+    return child;
 }
 
 auto ShuffleSubtreesMutation::operator()(Operon::RandomGenerator& random, Tree tree) const -> Tree
 {
+    auto const state = tree.GetHashState();
     auto& nodes = tree.Nodes();
     auto nFunc = std::count_if(nodes.begin(), nodes.end(), [](const auto& node) { return !node.IsLeaf(); });
 
     if (nFunc == 0) {
+        tree.SetHashState(state);
         return tree;
     }
 
@@ -234,6 +264,6 @@ auto ShuffleSubtreesMutation::operator()(Operon::RandomGenerator& random, Tree t
         insertionPoint += buffer[k].Length + 1U;
     }
 
-    return tree.UpdateNodes();
+    return tree.SetHashState(state).UpdateNodes(i - nodes[i].Length, i + 1, nodes[i].Length + 1U);
 }
 } // namespace Operon
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: MIT
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
+#include <taskflow/taskflow.hpp>
+#include <thread>
+
 #include "operon/collections/bitset.hpp"
 #include "operon/core/individual.hpp"
 #include "operon/operators/non_dominated_sorter.hpp"
@@ -14,92 +17,224 @@ namespace detail {
     };
 } // namespace detail
 
+namespace {
+    using Bitset64 = Operon::Bitset<uint64_t>;
+
+    // the state of the rank intersect algorithm, shared by the sequential and the parallel sorter
+    class RankIntersect {
+    public:
+        explicit RankIntersect(size_t n)
+            : bs_(n)
+            , br_(n)
+            , rank_(n, 0)
+        {
+            Bitset64 b(n, Bitset64::OneBlock);
+            auto const nb = b.NumBlocks();
+            for (size_t i = 0; i < n; ++i) {
+                b.Reset(i);
+                bs_[i] = b;
+                br_[i] = { 0, nb - 1 };
+            }
+            rk_.emplace_back(n, Bitset64::OneBlock);
+        }
+
+        // intersects the dominance set of individual i with q, the individuals that come after it in an intermediate objective
+        // (only bs_[i] and br_[i] are modified, so different individuals can be processed concurrently)
+        auto Intersect(size_t i, Bitset64 const& q) -> void
+        {
+            if (!Tighten(i, q)) {
+                return;
+            }
+            auto [lo, hi] = br_[i];
+            auto* p = bs_[i].Data();
+            auto const* r = q.Data();
+            for (size_t j = lo; j <= hi; ++j) {
+                p[j] &= r[j];
+            }
+        }
+
+        // the last objective: the individuals dominated by i are moved to the next rank
+        auto Rank(size_t i, Bitset64 const& q) -> void
+        {
+            if (!Tighten(i, q)) {
+                return;
+            }
+            auto [lo, hi] = br_[i];
+            auto const n = rank_.size();
+            auto rnk = rank_[i];
+            if (rnk + 1UL == rk_.size()) {
+                rk_.emplace_back(n, Bitset64::ZeroBlock);
+            }
+            auto const* p = bs_[i].Data();
+            auto const* t = q.Data();
+            auto* r = rk_[rnk].Data();
+            auto* s = rk_[rnk + 1].Data();
+
+            for (size_t j = lo; j <= hi; ++j) {
+                auto v = p[j] & t[j] & r[j]; // obtain the dominance set
+                r[j] &= ~v; // remove dominated individuals from current rank set
+                s[j] |= v; // add the individuals to the next rank set
+
+                auto o = Bitset64::BlockSize * j;
+                while (v) {
+                    auto x = o + Bitset64::CountTrailingZeros(v);
+                    v &= (v - 1);
+                    ++rank_[x];
+                }
+            }
+        }
+
+        [[nodiscard]] auto Fronts() const -> NondominatedSorterBase::Result
+        {
+            std::vector<std::vector<size_t>> fronts;
+            fronts.resize(*std::max_element(rank_.begin(), rank_.end()) + 1);
+            for (size_t i = 0UL; i < rank_.size(); ++i) {
+                fronts[rank_[i]].push_back(i);
+            }
+            return fronts;
+        }
+
+    private:
+        // tightens the bounds of bs_[i] around the blocks that do not intersect q, returns false if they were already empty
+        auto Tighten(size_t i, Bitset64 const& q) -> bool
+        {
+            auto [lo, hi] = br_[i];
+            if (lo > hi) {
+                return false;
+            }
+            auto const* p = bs_[i].Data();
+            auto const* r = q.Data();
+            while (lo <= hi && !(p[lo] & r[lo])) {
+                ++lo;
+            } // NOLINT
+            while (lo <= hi && !(p[hi] & r[hi])) {
+                --hi;
+            } // NOLINT
+            br_[i] = { lo, hi };
+            return true;
+        }
+
+        std::vector<Bitset64> bs_; // vector of bitsets (one for each individual)
+        std::vector<std::pair<size_t, size_t>> br_; // vector of ranges keeping track of the first/last non-zero blocks
+        std::vector<Bitset64> rk_; // vector of sets keeping track of individuals whose rank was updated
+        std::vector<size_t> rank_;
+    };
+
+    // sorts the items by objective k, ties keep their order from the previous objective
+    auto SortObjective(Operon::Span<Operon::Individual const> pop, std::vector<detail::Item<Operon::Scalar>>& items, size_t k, Operon::Scalar eps) -> void
+    {
+        for (auto& item : items) {
+            item.Value = pop[item.Index][k];
+        }
+        std::stable_sort(items.begin(), items.end(), [eps](auto a, auto b) { return Operon::Less{}(a.Value, b.Value, eps); });
+    }
+} // namespace
+
 auto RankIntersectSorter::Sort(Operon::Span<Operon::Individual const> pop, Operon::Scalar eps) const -> NondominatedSorterBase::Result
 {
     size_t const n = pop.size();
     size_t const m = pop.front().Fitness.size();
 
-    using Bitset = Operon::Bitset<uint64_t>;
-
-    Bitset b(n, Bitset::OneBlock);
-    std::vector<Bitset> bs(n); // vector of bitsets (one for each individual)
-    std::vector<std::pair<size_t, size_t>> br(n); // vector of ranges keeping track of the first/last non-zero blocks
+    RankIntersect ri(n);
+    Bitset64 b(n, Bitset64::OneBlock);
     std::vector<detail::Item<Operon::Scalar>> items(n); // these items hold the values to be sorted along with their associated index
-
-    auto const nb = b.NumBlocks();
     for (size_t i = 0; i < n; ++i) {
         items[i].Index = i;
-        b.Reset(i);
-        bs[i] = b;
-        br[i] = { 0, nb - 1 };
     }
-    std::vector<Bitset> rk; // vector of sets keeping track of individuals whose rank was updated
-    rk.emplace_back(n, Bitset::OneBlock);
-
-    std::vector<size_t> rank(n, 0);
-
-    auto cmp = [eps](auto a, auto b) { return Operon::Less{}(a.Value, b.Value, eps); };
 
     for (size_t k = 1; k < m; ++k) {
-        for (auto& item : items) {
-            item.Value = pop[item.Index][k];
-        }
-        std::stable_sort(items.begin(), items.end(), cmp);
-        b.Fill(Bitset::OneBlock);
+        SortObjective(pop, items, k, eps);
+        b.Fill(Bitset64::OneBlock);
 
         for (auto [_, i] : items) {
             b.Reset(i);
-            auto [lo, hi] = br[i];
-            if (lo > hi) {
-                continue;
+            if (k < m - 1) {
+                ri.Intersect(i, b);
+            } else {
+                ri.Rank(i, b);
             }
+        }
+    }
+    return ri.Fronts();
+}
 
-            auto* p = bs[i].Data();
-            auto const* q = b.Data();
+ParallelRankIntersectSorter::ParallelRankIntersectSorter(size_t threads)
+    : executor_(std::make_unique<tf::Executor>(threads == 0 ? std::thread::hardware_concurrency() : threads))
+{
+}
 
-            // tighten the bounds around empty blocks
-            while (lo <= hi && !(p[lo] & q[lo])) {
-                ++lo;
-            } // NOLINT
-            while (lo <= hi && !(p[hi] & q[hi])) {
-                --hi;
-            } // NOLINT
-            br[i] = { lo, hi };
+ParallelRankIntersectSorter::~ParallelRankIntersectSorter() = default;
+ParallelRankIntersectSorter::ParallelRankIntersectSorter(ParallelRankIntersectSorter&&) noexcept = default;
+auto ParallelRankIntersectSorter::operator=(ParallelRankIntersectSorter&&) noexcept -> ParallelRankIntersectSorter& = default;
 
-            if (k < m - 1) {
-                // perform the set intersection
-                for (size_t j = lo; j <= hi; ++j) {
-                    p[j] &= q[j];
-                }
-            } else {
-                auto rnk = rank[i];
-                if (rnk + 1UL == rk.size()) {
-                    rk.emplace_back(n, Bitset::ZeroBlock);
-                }
-                auto* r = rk[rnk].Data();
-                auto* s = rk[rnk + 1].Data();
-
-                for (size_t j = lo; j <= hi; ++j) {
-                    auto v = p[j] & q[j] & r[j]; // obtain the dominance set
-                    r[j] &= ~v; // remove dominated individuals from current rank set
-                    s[j] |= v; // add the individuals to the next rank set
-
-                    auto o = Bitset::BlockSize * j;
-                    while (v) {
-                        auto x = o + Bitset::CountTrailingZeros(v);
-                        v &= (v - 1);
-                        ++rank[x];
-                    }
-                }
+auto ParallelRankIntersectSorter::Sort(Operon::Span<Operon::Individual const> pop, Operon::Scalar eps) const -> NondominatedSorterBase::Result
+{
+    size_t const n = pop.size();
+    size_t const m = pop.front().Fitness.size();
+
+    RankIntersect ri(n);
+
+    // the order of objective k is a stable sort of the order of objective k-1, so the sorts are chained,
+    // but sorting objective k+1 overlaps with the intersections of objective k
+    std::vector<std::vector<detail::Item<Operon::Scalar>>> orders(m);
+    orders[0].resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        orders[0][i].Index = i;
+    }
+
+    // the intermediate objectives are split into chunks of consecutive positions, each chunk starting from
+    // the set of individuals that come after its first position
+    auto const chunks = std::max(size_t { 1 }, std::min(n, executor_->num_workers() * ChunksPerWorker));
+    auto const chunkSize = (n + chunks - 1) / chunks;
+    std::vector<Bitset64> seen(chunks, Bitset64(n, Bitset64::OneBlock));
+
+    tf::Taskflow taskflow;
+    std::vector<tf::Task> sorts;
+    std::vector<tf::Task> intersections;
+    for (size_t k = 1; k < m; ++k) {
+        sorts.push_back(taskflow.emplace([&, k]() {
+            orders[k] = orders[k - 1];
+            SortObjective(pop, orders[k], k, eps);
+        }).name("sort objective"));
+        if (k == m - 1) {
+            break;
+        }
+        intersections.push_back(taskflow.for_each_index(size_t { 0 }, chunks, size_t { 1 }, [&, k](size_t c) {
+            auto const& items = orders[k];
+            auto const start = std::min(n, c * chunkSize);
+            auto const end = std::min(n, start + chunkSize);
+            auto& b = seen[c];
+            b.Fill(Bitset64::OneBlock);
+            for (size_t p = 0; p < start; ++p) {
+                b.Reset(items[p].Index);
+            }
+            for (size_t p = start; p < end; ++p) {
+                auto i = items[p].Index;
+                b.Reset(i);
+                ri.Intersect(i, b);
             }
+        }).name("intersect objective"));
+    }
+    for (size_t k = 1; k < sorts.size(); ++k) {
+        sorts[k - 1].precede(sorts[k]);
+    }
+    for (size_t k = 0; k < intersections.size(); ++k) {
+        sorts[k].precede(intersections[k]);
+        if (k > 0) {
+            intersections[k - 1].precede(intersections[k]);
         }
     }
+    executor_->run(taskflow).wait();
 
-    std::vector<std::vector<size_t>> fronts;
-    fronts.resize(*std::max_element(rank.begin(), rank.end()) + 1);
-    for (size_t i = 0UL; i < n; ++i) {
-        fronts[rank[i]].push_back(i);
+    // the rank updates of the last objective depend on each other and stay sequential
+    if (m > 1) {
+        auto& b = seen.front();
+        b.Fill(Bitset64::OneBlock);
+        for (auto [_, i] : orders[m - 1]) {
+            b.Reset(i);
+            ri.Rank(i, b);
+        }
     }
-    return fronts;
+    return ri.Fronts();
 }
 } // namespace Operon
@@ -0,0 +1,192 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <cstdio>
+#include <doctest/doctest.h>
+#include <taskflow/taskflow.hpp>
+
+#include "operon/algorithms/checkpoint.hpp"
+#include "operon/algorithms/gp.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/reinserter.hpp"
+#include "operon/operators/selector.hpp"
+
+#include "fixture.hpp"
+
+namespace Operon::Test {
+
+TEST_CASE("Checkpoint")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation mutator { problem.InputVariables() };
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(5);
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    TournamentSelector selector(comp);
+    BasicOffspringGenerator generator(evaluator, crossover, mutator, selector, selector);
+    KeepBestReinserter reinserter(comp);
+
+    auto const config = RunConfig(8);
+
+    auto same = [](Tree const& lhs, Tree const& rhs) {
+        auto const& a = lhs.Nodes();
+        auto const& b = rhs.Nodes();
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](auto const& x, auto const& y) {
+            return x.Type == y.Type && x.HashValue == y.HashValue && x.Value == y.Value && x.Optimize == y.Optimize;
+        });
+    };
+
+    std::string const path = "operon-checkpoint-test.bin";
+    tf::Executor executor(4);
+
+    // the original run saves a checkpoint at generation 5
+    CheckpointWriter writer(path, 5);
+    GeneticProgrammingAlgorithm gp { problem, config, treeInit, coeffInit, generator, reinserter };
+    gp.SetCheckpointWriter(&writer);
+    Operon::RandomGenerator random(1234);
+    gp.Run(executor, random);
+    REQUIRE(writer.Error().empty());
+    REQUIRE(writer.Written() == 5);
+
+    SUBCASE("round trip")
+    {
+        auto cp = gp.Snapshot(random);
+        auto restored = Checkpoint::Deserialize(cp.Serialize());
+        CHECK(restored.Generation == cp.Generation);
+        CHECK(restored.Random == cp.Random);
+        CHECK(restored.Rngs == cp.Rngs);
+        REQUIRE(restored.Individuals.size() == cp.Individuals.size());
+        for (size_t i = 0; i < cp.Individuals.size(); ++i) {
+            CHECK(restored.Individuals[i].Fitness == cp.Individuals[i].Fitness);
+            CHECK(same(restored.Individuals[i].Genotype, cp.Individuals[i].Genotype));
+        }
+        auto bytes = cp.Serialize();
+        bytes.resize(bytes.size() / 2);
+        CHECK_THROWS(Checkpoint::Deserialize(bytes));
+    }
+
+    SUBCASE("restore")
+    {
+        // a fresh algorithm continues from generation 5 and ends up with the same population
+        evaluator.Reset();
+        GeneticProgrammingAlgorithm other { problem, config, treeInit, coeffInit, generator, reinserter };
+        Operon::RandomGenerator rng(0);
+        other.Restore(Checkpoint::Load(path), rng);
+        CHECK(other.Generation() == 5);
+        other.Run(executor, rng);
+        CHECK(other.Generation() == gp.Generation());
+
+        auto const a = gp.Parents();
+        auto const b = other.Parents();
+        for (size_t i = 0; i < a.size(); ++i) {
+            CHECK(a[i].Fitness == b[i].Fitness);
+            CHECK(same(a[i].Genotype, b[i].Genotype));
+        }
+    }
+    std::remove(path.c_str());
+}
+
+TEST_CASE("Checkpoint with cached evaluators")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation mutator { problem.InputVariables() };
+
+    Interpreter interpreter;
+    MSE mse;
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    TournamentSelector selector(comp);
+    KeepBestReinserter reinserter(comp);
+
+    auto const config = RunConfig(8);
+
+    // the caches change the course of the run (a semantic duplicate gets the worst fitness), so the continued run only
+    // ends up where the original one does if they are restored as well; with a single worker, the cache lookups happen
+    // in the same order in both runs
+    std::string const path = "operon-checkpoint-cache-test.bin";
+    tf::Executor executor(1);
+
+    struct Outcome {
+        std::vector<Individual> Parents;
+        size_t Evaluations;
+        size_t CallCount;
+        size_t Cached;
+        size_t Duplicates;
+    };
+
+    auto run = [&](CheckpointWriter* writer, Checkpoint const* checkpoint) {
+        Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+        evaluator.SetLocalOptimizationIterations(5);
+        FitnessCache cache;
+        CachedEvaluator cached(problem, evaluator, cache);
+        FitnessCache semanticCache;
+        SemanticCachedEvaluator semantic(problem, interpreter, cached, semanticCache, SemanticCachedEvaluator::Policy::Reject);
+
+        BasicOffspringGenerator generator(semantic, crossover, mutator, selector, selector);
+        GeneticProgrammingAlgorithm gp { problem, config, treeInit, coeffInit, generator, reinserter };
+        gp.SetCheckpointWriter(writer);
+        Operon::RandomGenerator random(1234);
+        if (checkpoint != nullptr) {
+            gp.Restore(*checkpoint, random);
+        }
+        gp.Run(executor, random);
+        return Outcome { { gp.Parents().begin(), gp.Parents().end() }, semantic.TotalEvaluations(), semantic.CallCount, cache.Size(), semanticCache.Hits() };
+    };
+
+    CheckpointWriter writer(path, 5);
+    auto const original = run(&writer, nullptr);
+    REQUIRE(writer.Error().empty());
+    REQUIRE(writer.Written() == 5);
+
+    auto const checkpoint = Checkpoint::Load(path);
+    REQUIRE(checkpoint.Caches.size() == 2);
+    CHECK(checkpoint.Caches[0].Entries.size() > 0);
+    CHECK(checkpoint.Caches[1].Entries.size() > 0);
+
+    auto const restored = run(nullptr, &checkpoint);
+    CHECK(restored.Evaluations == original.Evaluations);
+    CHECK(restored.CallCount == original.CallCount);
+    CHECK(restored.Cached == original.Cached);
+    CHECK(restored.Duplicates == original.Duplicates);
+    REQUIRE(restored.Parents.size() == original.Parents.size());
+    for (size_t i = 0; i < original.Parents.size(); ++i) {
+        CHECK(restored.Parents[i].Fitness == original.Parents[i].Fitness);
+        auto const& a = restored.Parents[i].Genotype.Nodes();
+        auto const& b = original.Parents[i].Genotype.Nodes();
+        CHECK(std::equal(a.begin(), a.end(), b.begin(), b.end(), [](auto const& x, auto const& y) {
+            return x.Type == y.Type && x.HashValue == y.HashValue && x.Value == y.Value && x.Optimize == y.Optimize;
+        }));
+    }
+    std::remove(path.c_str());
+}
+} // namespace Operon::Test
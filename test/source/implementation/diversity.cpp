@@ -4,12 +4,15 @@
 #include <algorithm>
 #include <doctest/doctest.h>
 #include <Eigen/Core>
+#include <taskflow/taskflow.hpp>
 
 #include "operon/analyzers/diversity.hpp"
 #include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
 #include "operon/core/pset.hpp"
 #include "operon/core/tree.hpp"
 #include "operon/operators/creator.hpp"
+#include "operon/operators/evaluator.hpp"
 #include "operon/operators/initializer.hpp"
 
 namespace Operon::Test {
@@ -50,4 +53,42 @@ TEST_CASE("diversity")
     diversityAnalyzer.Prepare(trees);
 }
 
+TEST_CASE("diversity evaluator")
+{
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic);
+    Operon::RandomGenerator rd(1234);
+
+    Eigen::Matrix<Operon::Scalar, -1, -1> values = decltype(values)::Random(10, 3);
+    Dataset ds(values);
+    std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+    Problem problem(ds, inputs, ds.Variables().back(), Range { 0, 10 }, Range { 0, 10 });
+    BalancedTreeCreator btc(grammar, inputs);
+
+    UniformTreeInitializer treeInit(btc);
+    treeInit.ParameterizeDistribution(size_t { 1 }, size_t { 50 });
+    UniformCoefficientInitializer coeffInit;
+
+    std::vector<Individual> pop(500);
+    for (auto& ind : pop) {
+        ind.Genotype = treeInit(rd);
+        coeffInit(rd, ind.Genotype);
+    }
+
+    // the parallel preparation hashes the population in subflow tasks, with the same result
+    DiversityEvaluator sequential(problem, Operon::HashMode::Relaxed);
+    DiversityEvaluator parallel(problem, Operon::HashMode::Relaxed);
+    sequential.Prepare(pop);
+
+    auto copy = pop;
+    tf::Executor executor;
+    tf::Taskflow taskflow;
+    taskflow.emplace([&](tf::Subflow& subflow) { parallel.Prepare(subflow, copy); });
+    executor.run(taskflow).wait();
+
+    for (auto i = 0UL; i < pop.size(); ++i) {
+        CHECK(sequential(rd, pop[i], {}) == parallel(rd, copy[i], {}));
+    }
+}
+
 } // namespace Operon::Test
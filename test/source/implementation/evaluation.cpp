@@ -6,8 +6,13 @@
 #include "operon/core/format.hpp"
 #include "operon/interpreter/interpreter.hpp"
 #include "operon/nnls/nnls.hpp"
+#include "operon/nnls/variable_projection.hpp"
+#include "operon/operators/derivative.hpp"
+#include "operon/operators/evaluator.hpp"
 #include "operon/parser/infix.hpp"
 
+#include "fixture.hpp"
+
 namespace Operon::Test {
 
 TEST_CASE("Evaluation correctness")
@@ -61,6 +66,499 @@ TEST_CASE("Evaluation correctness")
     }
 }
 
+TEST_CASE("Incremental evaluation")
+{
+    auto full = Dataset("./data/Poly-10.csv", /*hasHeader=*/true);
+    auto const n = full.Rows();
+    auto const w = n / 4;
+
+    // start with the first half of the data and append the rest in chunks
+    Dataset::Matrix head = full.Values().topRows(static_cast<Eigen::Index>(n / 2));
+    Dataset ds(head);
+    std::vector<std::string> names(full.Cols());
+    for (auto const& v : full.Variables()) {
+        names[v.Index] = v.Name;
+    }
+    ds.SetVariableNames(names);
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    std::vector<Variable> inputs;
+    std::copy_if(ds.Variables().begin(), ds.Variables().end(), std::back_inserter(inputs), [](auto const& v) { return v.Name != "Y"; });
+    Problem problem(ds, inputs, ds.GetVariable("Y").value(), Range { 0, 1 }, Range { 0, 1 });
+    problem.TrainingWindow(w);
+    CHECK(problem.TrainingRange().Size() == w);
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/false);
+
+    Individual ind;
+    ind.Genotype = InfixParser::Parse("X1 * X2 + X3", tmap, map);
+
+    Operon::RandomGenerator rng(1234);
+    Operon::Vector<Operon::Scalar> buf(n);
+
+    SUBCASE("without local optimization")
+    {
+        evaluator.SetLocalOptimizationIterations(0);
+        ind.Fitness = evaluator(rng, ind, buf);
+
+        auto const chunk = Eigen::Index { 50 };
+        for (auto i = static_cast<Eigen::Index>(n / 2); i < static_cast<Eigen::Index>(n); i += chunk) {
+            auto rows = std::min(chunk, static_cast<Eigen::Index>(n) - i);
+            problem.GetDataset().AppendRows(full.Values().middleRows(i, rows));
+            auto previous = problem.SlideTrainingWindow();
+            ind.Fitness = evaluator.Update(rng, ind, previous, buf);
+
+            auto expected = evaluator(rng, ind, buf);
+            CHECK(std::abs(ind[0] - expected[0]) < 1e-4);
+        }
+    }
+
+    SUBCASE("with local optimization")
+    {
+        // the coefficients are tuned on the first window only: the incremental path does not tune them again, so the
+        // updated fitness is compared to a full evaluation of the same coefficients
+        evaluator.SetLocalOptimizationIterations(10);
+        Evaluator reference(problem, interpreter, mse, /*linearScaling=*/false);
+        reference.SetLocalOptimizationIterations(0);
+
+        ind.Fitness = evaluator(rng, ind, buf);
+        auto const coefficients = ind.Genotype.GetCoefficients();
+
+        // many small slides, over which the window turns over twice
+        auto const chunk = Eigen::Index { 5 };
+        for (auto i = static_cast<Eigen::Index>(n / 2); i < static_cast<Eigen::Index>(n); i += chunk) {
+            auto rows = std::min(chunk, static_cast<Eigen::Index>(n) - i);
+            problem.GetDataset().AppendRows(full.Values().middleRows(i, rows));
+            auto previous = problem.SlideTrainingWindow();
+            ind.Fitness = evaluator.Update(rng, ind, previous, buf);
+            CHECK(ind.Genotype.GetCoefficients() == coefficients);
+
+            auto expected = reference(rng, ind, buf);
+            CHECK(std::abs(ind[0] - expected[0]) <= 1e-4 * std::max(Operon::Scalar { 1 }, expected[0]));
+        }
+    }
+    CHECK(problem.GetDataset().Rows() == n);
+    CHECK(problem.GetDataset().Capacity() >= n);
+    CHECK(problem.TrainingRange().End() == n);
+}
+
+TEST_CASE("Fitness cache")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(10);
+
+    FitnessCache cache(/*capacity=*/4, /*shards=*/1);
+    CachedEvaluator cached(problem, evaluator, cache);
+
+    Operon::RandomGenerator rng(1234);
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+
+    Individual ind;
+    ind.Genotype = InfixParser::Parse("2.5 * X1 * X2 + 0.5 * X3", tmap, map);
+    auto copy = ind;
+
+    auto f1 = cached(rng, ind, buf);
+    auto const evaluations = evaluator.TotalEvaluations();
+    auto f2 = cached(rng, copy, buf);
+
+    CHECK(f1 == f2);
+    CHECK(ind.Genotype.GetCoefficients() == copy.Genotype.GetCoefficients());
+    CHECK(evaluator.TotalEvaluations() == evaluations); // the hit does not count against the budget
+    CHECK(cache.Hits() == 1);
+    CHECK(cache.Misses() == 1);
+
+    // the cache is bounded
+    for (auto const* expr : { "X1", "X2", "X3", "X4", "X5" }) {
+        Individual other;
+        other.Genotype = InfixParser::Parse(expr, tmap, map);
+        cached(rng, other, buf);
+    }
+    CHECK(cache.Size() == cache.Capacity());
+}
+
+TEST_CASE("Semantic cache")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(0);
+
+    FitnessCache cache;
+    SemanticCachedEvaluator semantic(problem, interpreter, evaluator, cache);
+    CHECK(semantic.ProbeCount() == SemanticCachedEvaluator::DefaultProbes);
+
+    auto parse = [&](auto const* expr) {
+        Individual ind;
+        ind.Genotype = InfixParser::Parse(expr, tmap, map);
+        return ind;
+    };
+
+    // structurally different, behaviourally equal
+    auto a = parse("X1 * X2 + X1 * X2");
+    auto b = parse("2 * X2 * X1");
+    auto c = parse("X1 * X2 + X3");
+    CHECK(semantic.Fingerprint(a.Genotype) == semantic.Fingerprint(b.Genotype));
+    CHECK(semantic.Fingerprint(a.Genotype) != semantic.Fingerprint(c.Genotype));
+
+    Operon::RandomGenerator rng(1234);
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+
+    auto f1 = semantic(rng, a, buf);
+    auto const evaluations = evaluator.TotalEvaluations();
+    auto f2 = semantic(rng, b, buf);
+    CHECK(f1 == f2); // inherited
+    CHECK(evaluator.TotalEvaluations() == evaluations);
+    CHECK(cache.Hits() == 1);
+    CHECK(semantic.TotalEvaluations() == evaluations); // the hit does not count against the budget
+
+    semantic(rng, c, buf);
+    CHECK(cache.Misses() == 2);
+
+    // the duplicates can be rejected instead
+    SemanticCachedEvaluator rejecting(problem, interpreter, evaluator, cache, SemanticCachedEvaluator::Policy::Reject);
+    auto f3 = rejecting(rng, b, buf);
+    CHECK(f3.front() == std::numeric_limits<Operon::Scalar>::max());
+
+    // the fitness cannot be inherited from an evaluator that optimizes the coefficients, the duplicates can only be rejected
+    Evaluator optimizing(problem, interpreter, mse, /*linearScaling=*/true);
+    optimizing.SetLocalOptimizationIterations(10);
+    FitnessCache other;
+    CHECK_THROWS_AS(SemanticCachedEvaluator(problem, interpreter, optimizing, other), std::runtime_error);
+    SemanticCachedEvaluator optimizingRejecting(problem, interpreter, optimizing, other, SemanticCachedEvaluator::Policy::Reject);
+    optimizingRejecting(rng, a, buf);
+    auto f4 = optimizingRejecting(rng, b, buf);
+    CHECK(other.Hits() == 1);
+    CHECK(optimizing.CallCount == 1);
+    CHECK(f4.front() == std::numeric_limits<Operon::Scalar>::max());
+}
+
+TEST_CASE("Subsampled local optimization")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    // the subset keeps the variables of the original dataset
+    std::vector<size_t> rows { 3, 1, 4, 1, 5 };
+    auto subset = ds.Subset(rows);
+    CHECK(subset.Rows() == rows.size());
+    CHECK(subset.GetValues("X1")[2] == ds.GetValues("X1")[4]);
+
+    // writing into an existing dataset reuses its storage
+    auto const* data = subset.Values().data();
+    std::vector<size_t> fewer { 2, 0 };
+    ds.Subset(fewer, subset);
+    CHECK(subset.Rows() == fewer.size());
+    CHECK(subset.Values().data() == data);
+    CHECK(subset.GetValues("X1")[0] == ds.GetValues("X1")[2]);
+
+    Interpreter interpreter;
+    MSE mse;
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+
+    for (auto mode : { Evaluator::SubsampleMode::Random, Evaluator::SubsampleMode::Stratified }) {
+        Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+        evaluator.SetLocalOptimizationIterations(10);
+        evaluator.SetOptimizationSubsample(50, mode, /*seed=*/1234);
+
+        Evaluator reference(problem, interpreter, mse, /*linearScaling=*/true);
+        reference.SetLocalOptimizationIterations(0);
+
+        Individual ind;
+        ind.Genotype = InfixParser::Parse("2.5 * X1 * X2 + 0.5 * X3", tmap, map);
+        auto const hash = ind.Genotype.Hash(Operon::HashMode::Strict).HashValue();
+        auto copy = ind;
+
+        // with a fixed seed the subset depends only on the individual
+        Operon::RandomGenerator rng1(1);
+        Operon::RandomGenerator rng2(2);
+        auto f1 = evaluator(rng1, ind, buf);
+        auto f2 = evaluator(rng2, copy, buf);
+        CHECK(f1 == f2);
+        CHECK(ind.Genotype.HashValue() == hash); // the seed is derived without rehashing the genotype
+        CHECK(ind.Genotype.GetCoefficients() == copy.Genotype.GetCoefficients());
+
+        // the fitness is computed on the whole training range
+        auto f3 = reference(rng1, ind, buf);
+        CHECK(f1[0] == doctest::Approx(f3[0]));
+    }
+}
+
+TEST_CASE("Batched local optimization")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    std::vector<std::string> const expressions {
+        "2.5 * X1 * X2 + 0.5 * X3",
+        "1.5 * X1 + 0.2 * X2 * X3",
+        "0.1 * X4 * X5 + 0.7 * X6 + 0.3",
+        "3.0 * X7 * X8 - 1.0 * X9",
+        "0.5 * X1 * X2 + 0.5 * X3 * X4 + 0.5 * X5 * X6",
+        "2.0 * X10 + 1.0 * X1 * X9",
+        "1.0 * X2 * X7 + 1.0 * X3 * X8",
+        "0.25 * X5 + 0.25 * X6 * X10",
+    };
+    Operon::Vector<Individual> pop;
+    for (auto const& expr : expressions) {
+        pop.emplace_back().Genotype = InfixParser::Parse(expr, tmap, map);
+    }
+    std::vector<Operon::RandomGenerator> rngs;
+    for (size_t i = 0; i < pop.size(); ++i) {
+        rngs.emplace_back(i);
+    }
+
+    Interpreter interpreter;
+    MSE mse;
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+    constexpr size_t iterations { 10 };
+    constexpr size_t batchSize { 4 };
+
+    Evaluator batched(problem, interpreter, mse, /*linearScaling=*/true);
+    batched.SetLocalOptimizationIterations(iterations);
+    batched.SetBatchedOptimization(batchSize);
+
+    Evaluator unbatched(problem, interpreter, mse, /*linearScaling=*/true);
+    unbatched.SetLocalOptimizationIterations(iterations);
+
+    Evaluator reference(problem, interpreter, mse, /*linearScaling=*/true);
+    reference.SetLocalOptimizationIterations(0);
+
+    SUBCASE("agreement")
+    {
+        // the solvers take different steps, but within the iteration limit they reach practically the same fitness
+        auto copy = pop;
+        batched.Evaluate(rngs, pop, buf);
+        for (size_t i = 0; i < pop.size(); ++i) {
+            auto fit = unbatched(rngs[i], copy[i], buf);
+            CHECK(pop[i].Fitness[0] == doctest::Approx(fit[0]).epsilon(1e-2));
+            CHECK(pop[i].Fitness == reference(rngs[i], pop[i], buf)); // the coefficients were written back
+        }
+    }
+
+    SUBCASE("budget")
+    {
+        // the budget is exhausted by the first batch, the second one is evaluated without optimization
+        auto const original = pop;
+        batched.SetBudget(1);
+        batched.Evaluate(rngs, pop, buf);
+        for (size_t i = 0; i < pop.size(); ++i) {
+            auto const optimized = pop[i].Genotype.GetCoefficients() != original[i].Genotype.GetCoefficients();
+            CHECK(optimized == (i < batchSize));
+            CHECK(pop[i].Fitness == reference(rngs[i], pop[i], buf));
+        }
+    }
+}
+
+TEST_CASE("Dag evaluation")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    // the expressions share subtrees, and some of them are duplicates
+    std::vector<std::string> const expressions {
+        "2.5 * X1 * X2 + 0.5 * X3",
+        "2.5 * X1 * X2 + 0.5 * X4",
+        "2.5 * X1 * X2 + 0.5 * X3",
+        "sin(2.5 * X1 * X2) + 0.5 * X3",
+        "0.5 * X3",
+        "1.5 * X5 / (0.5 * X3)",
+    };
+    Operon::Vector<Individual> pop;
+    for (auto const& expr : expressions) {
+        pop.emplace_back().Genotype = InfixParser::Parse(expr, tmap, map);
+    }
+    std::vector<Operon::RandomGenerator> rngs;
+    for (size_t i = 0; i < pop.size(); ++i) {
+        rngs.emplace_back(i);
+    }
+
+    Interpreter interpreter;
+    MSE mse;
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+
+    Evaluator shared(problem, interpreter, mse, /*linearScaling=*/true);
+    shared.SetDagEvaluation(pop.size());
+    CHECK(shared.BatchSize() == pop.size());
+
+    Evaluator reference(problem, interpreter, mse, /*linearScaling=*/true);
+
+    auto check = [&](size_t iterations) {
+        shared.SetLocalOptimizationIterations(iterations);
+        reference.SetLocalOptimizationIterations(iterations);
+        auto copy = pop;
+        shared.Evaluate(rngs, pop, buf);
+        CHECK(shared.CallCount == pop.size());
+        for (size_t i = 0; i < pop.size(); ++i) {
+            auto fit = reference(rngs[i], copy[i], buf);
+            CHECK(pop[i].Fitness[0] == doctest::Approx(fit[0]));
+            CHECK(pop[i].Genotype.GetCoefficients() == copy[i].Genotype.GetCoefficients());
+        }
+    };
+
+    SUBCASE("without local optimization") { check(0); }
+    SUBCASE("with local optimization") { check(10); }
+
+    SUBCASE("budget")
+    {
+        // the budget is exhausted by the first local optimization, the other individuals are evaluated without it
+        auto const original = pop;
+        shared.SetLocalOptimizationIterations(10);
+        shared.SetBudget(1);
+        reference.SetLocalOptimizationIterations(0);
+        shared.Evaluate(rngs, pop, buf);
+        for (size_t i = 0; i < pop.size(); ++i) {
+            auto const optimized = pop[i].Genotype.GetCoefficients() != original[i].Genotype.GetCoefficients();
+            CHECK(optimized == (i == 0));
+            CHECK(pop[i].Fitness[0] == doctest::Approx(reference(rngs[i], pop[i], buf)[0]));
+        }
+    }
+}
+
+TEST_CASE("Dynamic symbols")
+{
+    auto ds = Dataset("./data/Poly-10.csv", /*hasHeader=*/true);
+    auto range = Range { 0, ds.Rows() };
+    auto const x = ds.GetVariable("X1").value();
+
+    // two user-defined unary symbols sharing one callable, which tells them apart by the hash of their node
+    constexpr Operon::Hash twice { 1001 };
+    constexpr Operon::Hash thrice { 1002 };
+    auto f = [](auto m, Operon::Span<Node const> nodes, size_t i, Operon::Range /*unused*/) {
+        using T = typename decltype(m)::element_type::Scalar;
+        m[i] = m[i - 1] * T(nodes[i].HashValue == twice ? 2 : 3);
+    };
+    Interpreter interpreter;
+    interpreter.GetDispatchTable().RegisterCallable(twice, f);
+    interpreter.GetDispatchTable().RegisterCallable(thrice, f);
+    CHECK(interpreter.GetDispatchTable().Find<Operon::Scalar, CompactNode>(twice) == nullptr);
+
+    auto make = [&](Operon::Hash hash) {
+        Node variable(NodeType::Variable, x.Hash);
+        variable.Value = 1;
+        Node dynamic(NodeType::Dynamic, hash);
+        dynamic.Arity = 1;
+        return Tree({ variable, dynamic }).UpdateNodes();
+    };
+    std::vector<Tree> const trees { make(twice), make(thrice) };
+
+    auto values = ds.GetValues(x.Hash);
+    for (auto k = 0UL; k < trees.size(); ++k) {
+        auto result = interpreter.Evaluate<Operon::Scalar>(trees[k], ds, range);
+        CHECK(std::equal(result.begin(), result.end(), values.begin(), [&](auto a, auto b) { return a == b * Operon::Scalar(k + 2); }));
+    }
+
+    GenotypeDag dag;
+    std::vector<GenotypeDag::Id> roots;
+    for (auto const& tree : trees) {
+        roots.push_back(dag.Insert(tree));
+    }
+    Operon::Vector<Operon::Scalar> result(roots.size() * range.Size());
+    interpreter.Evaluate<Operon::Scalar>(dag, roots, ds, range, result);
+    for (auto k = 0UL; k < trees.size(); ++k) {
+        auto expected = interpreter.Evaluate<Operon::Scalar>(trees[k], ds, range);
+        CHECK(std::equal(expected.begin(), expected.end(), result.begin() + static_cast<int64_t>(k * range.Size())));
+    }
+}
+
+TEST_CASE("Fused multi-objective evaluation")
+{
+    auto problem = Poly10();
+    auto const& ds = problem.GetDataset();
+
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto tmap = InfixParser::DefaultTokens();
+
+    Interpreter interpreter;
+    Operon::RandomGenerator rng(1234);
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+
+    MSE mse;
+    NMSE nmse;
+    RMSE rmse;
+    MAE mae;
+    R2 r2;
+    C2 c2;
+    std::vector<ErrorMetric const*> metrics { &mse, &nmse, &rmse, &mae, &r2, &c2 };
+
+    for (auto scaling : { false, true }) {
+        FusedEvaluator fused(problem, interpreter, scaling);
+        fused.SetLocalOptimizationIterations(0);
+
+        std::vector<std::unique_ptr<Evaluator>> evaluators;
+        MultiEvaluator multi(problem);
+        for (auto const* m : metrics) {
+            fused.Add(*m);
+            evaluators.push_back(std::make_unique<Evaluator>(problem, interpreter, *m, scaling));
+            evaluators.back()->SetLocalOptimizationIterations(0);
+            multi.Add(*evaluators.back());
+        }
+        fused.Add(FusedEvaluator::Structure::Length, 0.5);
+        LengthEvaluator length(problem, 2);
+        multi.Add(length);
+
+        for (auto const* expr : { "X1 * X2 + X3", "2.5 * X1 * X2 + 0.5 * X3 - X4", "sin(X1) / (1 + X5 * X5)" }) {
+            Individual ind;
+            ind.Genotype = InfixParser::Parse(expr, tmap, map);
+
+            auto expected = multi(rng, ind, buf);
+            auto actual = fused(rng, ind, buf);
+            REQUIRE(actual.size() == expected.size());
+            for (size_t i = 0; i < actual.size(); ++i) {
+                CHECK(actual[i] == doctest::Approx(expected[i]).epsilon(1e-4));
+            }
+        }
+        CHECK(fused.ResidualEvaluations == 3); // one interpreter run per individual
+    }
+}
+
 TEST_CASE("Numeric optimization")
 {
     auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
@@ -91,6 +589,38 @@ TEST_CASE("Numeric optimization")
         fmt::print("iterations: {}, initial cost: {}, final cost: {}\n", summary.Iterations, summary.InitialCost, summary.FinalCost);
     }
 
+    SUBCASE("ceres row chunks") {
+        auto single = tree;
+        NonlinearLeastSquaresOptimizer<OptimizerType::CERES> reference(interpreter, single, ds);
+        auto s1 = reference.Optimize(target, range, 10);
+
+        // the second tree has the same shape, so it reuses the cost functions of the first
+        CeresCostFunctionCache cache;
+        for (auto i = 0; i < 2; ++i) {
+            auto treeCopy = tree;
+            NonlinearLeastSquaresOptimizer<OptimizerType::CERES> optimizer(interpreter, treeCopy, ds);
+            optimizer.SetRowChunks(range.Size() / 8, 4);
+            optimizer.SetCostFunctionCache(&cache);
+            auto s2 = optimizer.Optimize(target, range, 10);
+            CHECK(s2.FinalCost == doctest::Approx(s1.FinalCost).epsilon(1e-3));
+        }
+        CHECK(cache.Misses() == 1);
+        CHECK(cache.Hits() == 1);
+
+        // the storage of the dataset moved, so the cached cost functions must not be reused
+        auto const version = ds.Version();
+        ds.Reserve(2 * ds.Capacity());
+        CHECK(ds.Version() != version);
+        auto treeCopy = tree;
+        NonlinearLeastSquaresOptimizer<OptimizerType::CERES> optimizer(interpreter, treeCopy, ds);
+        optimizer.SetRowChunks(range.Size() / 8, 4);
+        optimizer.SetCostFunctionCache(&cache);
+        auto s3 = optimizer.Optimize(target, range, 10);
+        CHECK(s3.FinalCost == doctest::Approx(s1.FinalCost).epsilon(1e-3));
+        CHECK(cache.Misses() == 2);
+        CHECK(cache.Hits() == 1);
+    }
+
     //SUBCASE("ceres numeric diff") {
     //    auto tree_copy = tree;
     //    NonlinearLeastSquaresOptimizer<OptimizerType::CERES> optimizer(interpreter, tree_copy, ds);
@@ -106,6 +636,118 @@ TEST_CASE("Numeric optimization")
     }
 }
 
+TEST_CASE("Variable projection")
+{
+    auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
+    auto range = Range { 0, ds.Rows() };
+
+    Interpreter interpreter;
+    auto const& X = ds.Values(); // NOLINT
+
+    auto tmap = InfixParser::DefaultTokens();
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+
+    Eigen::Array<Operon::Scalar, -1, 1> res = 2 * X.col(0) - 0.5 * X.col(1) + (0.3 * X.col(2)).exp() + 1;
+    Operon::Span<Operon::Scalar> target(res.data(), res.size());
+
+    SUBCASE("linear terms")
+    {
+        auto tree = InfixParser::Parse("X1 - X2 + exp(X3) + 1", tmap, map);
+        for (auto& node : tree.Nodes()) { node.Optimize = node.IsLeaf(); }
+        auto terms = FindLinearTerms(tree);
+        CHECK(terms.size() == 3); // X3 is under exp
+        auto negative = std::count_if(terms.begin(), terms.end(), [](auto const& t) { return t.Sign < 0; });
+        CHECK(negative == 1);
+    }
+
+    SUBCASE("optimization")
+    {
+        auto tree = InfixParser::Parse("X1 - X2 + exp(X3) + 1", tmap, map);
+        for (auto& node : tree.Nodes()) {
+            node.Optimize = node.IsLeaf();
+            if (node.IsVariable()) { node.Value = static_cast<Operon::Scalar>(0.1); }
+        }
+
+        auto copy = tree;
+        VariableProjectionOptimizer vp(interpreter, tree, ds);
+        auto s1 = vp.Optimize(target, range, 10);
+
+        NonlinearLeastSquaresOptimizer<OptimizerType::TINY> lm(interpreter, copy, ds);
+        auto s2 = lm.Optimize(target, range, 10);
+
+        CHECK(s1.Success);
+        CHECK(s1.FinalCost <= s2.FinalCost + 1e-3);
+    }
+}
+
+TEST_CASE("Symbolic derivatives")
+{
+    auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
+    auto range = Range { 0, 250 };
+
+    Interpreter interpreter;
+    auto tmap = InfixParser::DefaultTokens();
+    robin_hood::unordered_map<std::string, Operon::Hash> map;
+    for (auto v : ds.Variables()) {
+        map[v.Name] = v.Hash;
+    }
+    auto target = ds.GetValues("Y").subspan(range.Start(), range.Size());
+
+    auto jacobian = [&](Tree const& tree, bool symbolic) {
+        auto coeff = tree.GetCoefficients();
+        Eigen::Matrix<Operon::Scalar, -1, -1> jac(range.Size(), coeff.size());
+        if (symbolic) {
+            SymbolicCostFunction<Eigen::ColMajor> cf(interpreter, tree, ds, target, range);
+            REQUIRE(cf.IsDifferentiable());
+            cf(coeff.data(), nullptr, jac.data());
+        } else {
+            ResidualEvaluator re(interpreter, tree, ds, target, range);
+            TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor> cf(re);
+            cf(coeff.data(), nullptr, jac.data());
+        }
+        return jac;
+    };
+
+    for (auto const* expr : { "X1 * X2 + 2 * X3 - X4 / X5",
+             "exp(0.3 * X1) * sin(X2) - log(abs(X3) + 1)",
+             "square(X1) / (1 + tanh(X2 * X3))",
+             "sqrt(abs(X1 * X2)) + cos(X3) * X3 - 1 / (X4 * X4 + 1)" }) {
+        auto tree = InfixParser::Parse(expr, tmap, map);
+        for (auto& node : tree.Nodes()) { node.Optimize = node.IsLeaf(); }
+
+        auto j1 = jacobian(tree, /*symbolic=*/false);
+        auto j2 = jacobian(tree, /*symbolic=*/true);
+        auto err = ((j1 - j2).array().abs() / (1 + j1.array().abs())).maxCoeff();
+        CHECK(err < 1e-3);
+    }
+
+    SUBCASE("sharing")
+    {
+        // the derivatives with respect to the weights of the last two terms are both X1
+        auto tree = InfixParser::Parse("exp(X1) + exp(X1) + X1 + X1", tmap, map);
+        for (auto& node : tree.Nodes()) { node.Optimize = node.IsLeaf(); }
+        SymbolicDerivative derivative(tree);
+        CHECK(derivative.CoefficientsCount() == 4);
+        CHECK(derivative.Derivatives().size() == 3);
+    }
+
+    SUBCASE("optimization")
+    {
+        auto tree = InfixParser::Parse("X1 * X2 + exp(X3) * X4 - 1", tmap, map);
+        for (auto& node : tree.Nodes()) { node.Optimize = node.IsLeaf(); }
+        auto copy = tree;
+
+        NonlinearLeastSquaresOptimizer<OptimizerType::TINY> autodiff(interpreter, tree, ds);
+        auto s1 = autodiff.Optimize<DerivativeMethod::AUTODIFF>(target, range, 10);
+        NonlinearLeastSquaresOptimizer<OptimizerType::TINY> symbolic(interpreter, copy, ds);
+        auto s2 = symbolic.Optimize<DerivativeMethod::SYMBOLIC>(target, range, 10);
+        CHECK(s2.FinalCost == doctest::Approx(s1.FinalCost).epsilon(1e-3));
+    }
+}
+
 TEST_CASE("tiny bug")
 {
     auto ds = Dataset("../data/Pagie-1.csv", true);
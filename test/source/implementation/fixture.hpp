@@ -0,0 +1,44 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#ifndef OPERON_TEST_FIXTURE_HPP
+#define OPERON_TEST_FIXTURE_HPP
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "operon/algorithms/config.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
+
+namespace Operon::Test {
+
+// the Poly-10 problem: Y is the target, all the other variables are inputs
+inline auto Poly10(Range training = Range { 0, 250 }, Range test = Range { 250, 500 }) -> Problem
+{
+    auto ds = Dataset("./data/Poly-10.csv", /*hasHeader=*/true);
+    std::vector<Variable> inputs;
+    std::copy_if(ds.Variables().begin(), ds.Variables().end(), std::back_inserter(inputs), [](auto const& v) { return v.Name != "Y"; });
+    auto const target = ds.GetVariable("Y").value();
+    return { std::move(ds), inputs, target, training, test };
+}
+
+// a run of the given length which is not limited by the budget or the time
+inline auto RunConfig(size_t generations) -> GeneticAlgorithmConfig
+{
+    GeneticAlgorithmConfig config {};
+    config.Generations = generations;
+    config.Evaluations = 1'000'000;
+    config.PopulationSize = 100;
+    config.PoolSize = 100;
+    config.TimeLimit = 600;
+    config.CrossoverProbability = 1.0;
+    config.MutationProbability = 0.25;
+    return config;
+}
+
+} // namespace Operon::Test
+
+#endif
@@ -2,6 +2,8 @@
 // SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
 
 #include <doctest/doctest.h>
+#include <nanobench.h>
+#include <taskflow/taskflow.hpp>
 #include <unordered_set>
 #include <vstat/vstat.hpp>
 
@@ -10,10 +12,14 @@
 #include "operon/core/distance.hpp"
 #include "operon/core/operator.hpp"
 #include "operon/core/format.hpp"
+#include "operon/core/individual.hpp"
 #include "operon/core/pset.hpp"
 #include "operon/core/variable.hpp"
 #include "operon/hash/hash.hpp"
 #include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
 
 
 namespace Operon::Test {
@@ -163,4 +169,148 @@ TEST_CASE("Hash collisions") {
     auto s32 = static_cast<double>(set32.size());
     fmt::print("total nodes: {}, {:.3f}% unique, unique 64-bit hashes: {}, unique 32-bit hashes: {}, collision rate: {:.3f}%\n", totalNodes, s64/static_cast<double>(totalNodes) * 100, s64, s32, (1 - s32/s64) * 100);
 }
+
+TEST_CASE("Incremental hashing") {
+    constexpr size_t maxDepth { 1000 };
+    constexpr size_t maxLength { 200 };
+    Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(10, 10);
+    auto ds = Dataset(data);
+    std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic | NodeType::Log | NodeType::Exp);
+    for (auto t : { NodeType::Add, NodeType::Mul }) {
+        grammar.SetMinMaxArity(Node(t).HashValue, 1, 5);
+    }
+
+    BalancedTreeCreator btc { grammar, inputs, /* bias= */ 0.0 };
+    SubtreeCrossover cx { 0.9, maxDepth, maxLength };
+
+    // the incremental hashing should give the same result as the full one
+    auto check = [](Tree const& tree, Operon::HashMode mode) {
+        auto full = tree;
+        [[maybe_unused]] auto const& h = full.Hash(mode);
+        return std::equal(tree.Nodes().begin(), tree.Nodes().end(), full.Nodes().begin(), [](auto const& a, auto const& b) { return a.CalculatedHashValue == b.CalculatedHashValue; });
+    };
+
+    Operon::RandomGenerator random(1234);
+    std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength / 2);
+    std::vector<Tree> trees;
+    for (auto k = 0; k < 1000; ++k) { // NOLINT
+        auto lhs = btc(random, sizeDistribution(random), 1, maxDepth);
+        auto rhs = btc(random, sizeDistribution(random), 1, maxDepth);
+
+        for (auto mode : { Operon::HashMode::Strict, Operon::HashMode::Relaxed }) {
+            [[maybe_unused]] auto const& h1 = lhs.Hash(mode);
+            [[maybe_unused]] auto const& h2 = rhs.Hash(mode);
+
+            // crossover: only the ancestors of the swapped-in subtree change
+            auto [i, j] = cx.FindCompatibleSwapLocations(random, lhs, rhs);
+            auto child = SubtreeCrossover::Cross(lhs, rhs, i, j);
+            auto const root = i - lhs[i].Length + rhs[j].Length;
+            CHECK(check(child.Hash(mode, root, root + 1), mode));
+
+            // point mutation
+            auto mutant = lhs;
+            auto const p = std::uniform_int_distribution<size_t>(0, mutant.Length() - 1)(random);
+            mutant[p].Value += 1;
+            CHECK(check(mutant.Hash(mode, p, p + 1), mode));
+        }
+        trees.push_back(std::move(lhs));
+    }
+
+    // batch hashing
+    std::vector<Individual> pop(trees.size());
+    std::transform(trees.begin(), trees.end(), pop.begin(), [](auto const& t) { Individual ind; ind.Genotype = t; return ind; });
+    tf::Executor executor;
+    HashPopulation(executor, pop, Operon::HashMode::Strict);
+    CHECK(std::all_of(pop.begin(), pop.end(), [&](auto const& ind) { return check(ind.Genotype, Operon::HashMode::Strict); }));
+
+    // rehashing a child after crossover, all of it vs. only the ancestors of the swapped subtree
+    auto const& lhs = trees.front();
+    auto const& rhs = trees.back();
+    [[maybe_unused]] auto const& h1 = lhs.Hash(Operon::HashMode::Strict);
+    [[maybe_unused]] auto const& h2 = rhs.Hash(Operon::HashMode::Strict);
+    auto [i, j] = cx.FindCompatibleSwapLocations(random, lhs, rhs);
+    auto child = SubtreeCrossover::Cross(lhs, rhs, i, j);
+    auto const root = i - lhs[i].Length + rhs[j].Length;
+    fmt::print("child length: {}, ancestors of the swapped subtree: {}\n", child.Length(), child[root].Level - 1);
+
+    ankerl::nanobench::Bench b;
+    b.title("Hashing").relative(true).performanceCounters(true).minEpochIterations(10000);
+    b.run("full", [&]() { return child.Hash(Operon::HashMode::Strict).HashValue(); });
+    b.run("incremental", [&]() { return child.Hash(Operon::HashMode::Strict, root, root + 1).HashValue(); });
+}
+
+TEST_CASE("Incremental hashing after variation") {
+    constexpr size_t maxDepth { 1000 };
+    constexpr size_t maxLength { 200 };
+    Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(10, 10);
+    auto ds = Dataset(data);
+    std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic | NodeType::Log | NodeType::Exp);
+    for (auto t : { NodeType::Add, NodeType::Mul }) {
+        grammar.SetMinMaxArity(Node(t).HashValue, 1, 5);
+    }
+
+    BalancedTreeCreator btc { grammar, inputs, /* bias= */ 0.0 };
+    NormalCoefficientInitializer coeffInit;
+    SubtreeCrossover cx { 0.9, maxDepth, maxLength };
+
+    OnePointMutation<std::normal_distribution<Operon::Scalar>> onePoint;
+    onePoint.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+    DiscretePointMutation discretePoint;
+    discretePoint.Add(Operon::Scalar { 1 });
+    ChangeVariableMutation changeVariable { inputs };
+    ChangeFunctionMutation changeFunction { grammar };
+    ReplaceSubtreeMutation replaceSubtree { btc, coeffInit, maxDepth, maxLength };
+    InsertSubtreeMutation insertSubtree { btc, coeffInit, maxDepth, maxLength };
+    RemoveSubtreeMutation removeSubtree { grammar };
+    ShuffleSubtreesMutation shuffleSubtrees;
+    std::vector<std::reference_wrapper<MutatorBase const>> mutators { onePoint, discretePoint, changeVariable, changeFunction, replaceSubtree, insertSubtree, removeSubtree, shuffleSubtrees };
+
+    // the operators record their edits, after which rehashing the child gives the same result as hashing all of it
+    auto check = [](Tree const& tree, Operon::HashMode mode) {
+        auto full = Tree(tree.Nodes());
+        [[maybe_unused]] auto const& h = full.Hash(mode);
+        return std::equal(tree.Nodes().begin(), tree.Nodes().end(), full.Nodes().begin(), [](auto const& a, auto const& b) { return a.CalculatedHashValue == b.CalculatedHashValue; });
+    };
+
+    Operon::RandomGenerator random(1234);
+    std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength / 2);
+    for (auto k = 0; k < 1000; ++k) { // NOLINT
+        auto const lhs = btc(random, sizeDistribution(random), 1, maxDepth);
+        auto const rhs = btc(random, sizeDistribution(random), 1, maxDepth);
+
+        for (auto mode : { Operon::HashMode::Strict, Operon::HashMode::Relaxed }) {
+            [[maybe_unused]] auto const& h1 = lhs.Hash(mode);
+            [[maybe_unused]] auto const& h2 = rhs.Hash(mode);
+
+            Tree child;
+            cx(random, lhs, rhs, child);
+            CHECK(child.GetHashState().Mode == mode);
+            for (auto const& mutator : mutators) {
+                auto mutant = mutator(random, child);
+                CHECK(mutant.GetHashState().Mode == mode);
+                CHECK(check(mutant.Rehash(mode), mode));
+                CHECK(mutant.GetHashState().Clean());
+            }
+            // crossover followed by mutation, with both edits pending
+            for (auto const& mutator : mutators) {
+                Tree other;
+                cx(random, lhs, rhs, other);
+                auto mutant = mutator(random, std::move(other));
+                CHECK(check(mutant.Rehash(mode), mode));
+            }
+            CHECK(check(child.Rehash(mode), mode));
+
+            // new coefficients invalidate the strict hash values, which are then all recomputed
+            auto coefficients = child.GetCoefficients();
+            child.SetCoefficients(coefficients);
+            CHECK(child.GetHashState().Mode.has_value() == (mode == Operon::HashMode::Relaxed));
+        }
+    }
+}
 } // namespace Operon::Test
@@ -0,0 +1,206 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <chrono>
+#include <cstdlib>
+#include <doctest/doctest.h>
+#include <thread>
+
+#include <taskflow/taskflow.hpp>
+
+#include "operon/algorithms/island_gp.hpp"
+#include "operon/algorithms/island_model.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/core/pset.hpp"
+#include "operon/core/variable.hpp"
+#include "operon/hash/hash.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/reinserter.hpp"
+#include "operon/operators/selector.hpp"
+
+namespace Operon::Test {
+
+TEST_CASE("Migration channel")
+{
+    Operon::RandomGenerator rd(1234);
+    auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
+
+    auto target = "Y";
+    auto variables = ds.Variables();
+    std::vector<Variable> inputs;
+    std::copy_if(variables.begin(), variables.end(), std::back_inserter(inputs), [&](const auto& v) { return v.Name != target; });
+
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic);
+    auto btc = BalancedTreeCreator { grammar, inputs };
+
+    MigrationConfig config;
+    config.Islands = 1;
+    config.Capacity = 4;
+    config.MaxLength = 50;
+
+    MigrationChannel channel(config);
+
+    SUBCASE("round trip")
+    {
+        Individual ind(2);
+        ind.Genotype = btc(rd, 30, 1, 10);
+        ind[0] = 0.5;
+        ind[1] = 30;
+        REQUIRE(channel.Send(0, ind));
+
+        Individual other;
+        REQUIRE(channel.Receive(0, other));
+        CHECK(other.Fitness == ind.Fitness);
+        CHECK(other.Genotype.Length() == ind.Genotype.Length());
+        CHECK(other.Genotype.Hash(Operon::HashMode::Strict).HashValue() == ind.Genotype.Hash(Operon::HashMode::Strict).HashValue());
+        CHECK(!channel.Receive(0, other));
+    }
+
+    SUBCASE("capacity")
+    {
+        Individual ind;
+        ind.Genotype = btc(rd, 10, 1, 10);
+        for (size_t i = 0; i < config.Capacity; ++i) {
+            CHECK(channel.Send(0, ind));
+        }
+        CHECK(!channel.Send(0, ind)); // full
+        CHECK(channel.Recover(0) == 0); // nothing was abandoned, the migrants are kept
+        Individual other;
+        for (size_t i = 0; i < config.Capacity; ++i) {
+            CHECK(channel.Receive(0, other));
+        }
+        ind.Genotype = btc(rd, 100, 1, 10);
+        CHECK(!channel.Send(1, ind)); // too long
+    }
+}
+
+TEST_CASE("Island model")
+{
+    Operon::RandomGenerator rd(1234);
+    auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
+    std::vector<Variable> inputs;
+    std::copy_if(ds.Variables().begin(), ds.Variables().end(), std::back_inserter(inputs), [](auto const& v) { return v.Name != "Y"; });
+
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic);
+    auto btc = BalancedTreeCreator { grammar, inputs };
+
+    MigrationConfig config;
+    config.Islands = 4;
+    config.Interval = 1;
+    config.Topology = MigrationTopology::Ring;
+
+    constexpr int maxAttempts { 10000 };
+    constexpr std::chrono::milliseconds wait { 1 };
+
+    IslandModel model(config, SingleObjectiveComparison{});
+    auto status = model.Run([&](size_t island, Migrator const& migrator) {
+        // each island's population holds a single individual whose fitness is the island index
+        Operon::RandomGenerator random(island);
+        Operon::Vector<Individual> pop(1);
+        pop[0].Genotype = btc(random, 10, 1, 10);
+        pop[0][0] = static_cast<Operon::Scalar>(island);
+        // keep migrating until the neighbour's migrant has arrived
+        auto attempts { 0 };
+        for (; attempts < maxAttempts && migrator(random, pop, 1) == 0; ++attempts) {
+            std::this_thread::sleep_for(wait);
+        }
+        if (attempts == maxAttempts) {
+            return EXIT_FAILURE;
+        }
+        // report the received individual together with the receiving island
+        Individual result(2);
+        result.Genotype = pop[0].Genotype;
+        result[0] = pop[0][0];
+        result[1] = static_cast<Operon::Scalar>(island);
+        migrator.Submit(result);
+        return 0;
+    });
+
+    CHECK(std::all_of(status.begin(), status.end(), [](auto s) { return s == 0; }));
+    REQUIRE(model.Results().size() == config.Islands);
+    std::vector<bool> seen(config.Islands, false);
+    for (auto const& ind : model.Results()) {
+        REQUIRE(ind.Size() == 2);
+        auto const island = static_cast<size_t>(ind[1]);
+        REQUIRE(island < config.Islands);
+        seen[island] = true;
+        // in a ring, island i receives the individual of island i - 1
+        CHECK(static_cast<size_t>(ind[0]) == (island + config.Islands - 1) % config.Islands);
+        CHECK(ind.Genotype.Length() > 0);
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](auto s) { return s; }));
+}
+
+TEST_CASE("Island GP")
+{
+    auto ds = Dataset("../data/Poly-10.csv", /*hasHeader=*/true);
+    std::vector<Variable> inputs;
+    std::copy_if(ds.Variables().begin(), ds.Variables().end(), std::back_inserter(inputs), [](auto const& v) { return v.Name != "Y"; });
+    Problem problem(ds, inputs, ds.GetVariable("Y").value(), Range { 0, 250 }, Range { 250, 500 });
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation mutator { problem.InputVariables() };
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    KeepBestReinserter reinserter(comp);
+
+    MigrationConfig migration;
+    migration.Islands = 4;
+    migration.Interval = 5;
+    migration.Topology = MigrationTopology::Ring;
+
+    // each island needs its own selector, since the selector keeps a view of the island's population
+    std::vector<std::unique_ptr<TournamentSelector>> selectors;
+    std::vector<std::unique_ptr<BasicOffspringGenerator>> generators;
+    std::vector<std::reference_wrapper<OffspringGeneratorBase const>> refs;
+    for (size_t i = 0; i < migration.Islands; ++i) {
+        selectors.push_back(std::make_unique<TournamentSelector>(comp));
+        generators.push_back(std::make_unique<BasicOffspringGenerator>(evaluator, crossover, mutator, *selectors.back(), *selectors.back()));
+        refs.emplace_back(*generators.back());
+    }
+
+    GeneticAlgorithmConfig config {};
+    config.Generations = 20;
+    config.Evaluations = 1'000'000;
+    config.PopulationSize = 50;
+    config.PoolSize = 50;
+    config.TimeLimit = 60;
+    config.CrossoverProbability = 1.0;
+    config.MutationProbability = 0.25;
+
+    IslandGeneticProgrammingAlgorithm gp { problem, config, migration, treeInit, coeffInit, refs, reinserter, comp };
+
+    Operon::RandomGenerator random(1234);
+    tf::Executor executor(4);
+
+    size_t reports { 0 };
+    gp.Run(executor, random, [&]() { ++reports; });
+
+    CHECK(gp.Generation() == config.Generations);
+    CHECK(reports == config.Generations / migration.Interval + 1);
+    for (auto const& island : gp.Islands()) {
+        CHECK(island.Parents().size() == config.PopulationSize);
+        CHECK(island.Generation() == config.Generations);
+    }
+}
+} // namespace Operon::Test
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <doctest/doctest.h>
+#include <thread>
+#include <vector>
+
+#include "operon/core/metrics.hpp"
+
+namespace Operon::Test {
+
+TEST_CASE("Metrics histogram buckets")
+{
+    using Operon::Metrics::Buckets;
+    for (uint64_t v : { 0UL, 1UL, 15UL, 16UL, 17UL, 31UL, 32UL, 1000UL, 123456789UL, UINT64_MAX }) {
+        auto i = Buckets::Index(v);
+        CHECK(i < Buckets::Count);
+        CHECK(Buckets::LowerBound(i) <= v);
+        CHECK(v <= Buckets::UpperBound(i));
+    }
+}
+
+TEST_CASE("Metrics aggregation")
+{
+    namespace M = Operon::Metrics;
+    M::Reset();
+
+    constexpr size_t nthreads = 4;
+    constexpr size_t n = 1000;
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < nthreads; ++t) {
+        threads.emplace_back([&]() {
+            for (size_t i = 0; i < n; ++i) {
+                M::Add(M::Counter::GeneratorAttempts);
+                M::Record(M::Histogram::SelectionTime, i);
+            }
+        });
+    }
+    for (auto& t : threads) { t.join(); }
+
+    // the threads have exited, their metrics must have been retained
+    auto snapshot = M::Collect();
+    CHECK(snapshot[M::Counter::GeneratorAttempts] == nthreads * n);
+
+    auto const& h = snapshot[M::Histogram::SelectionTime];
+    CHECK(h.Count == nthreads * n);
+    CHECK(h.Mean() == doctest::Approx((n - 1) / 2.0));
+    auto const median = h.Quantile(0.5);
+    CHECK(std::abs(median - n / 2.0) < n / 2.0 / M::Buckets::SubBuckets);
+
+    M::Reset();
+    CHECK(M::Collect()[M::Counter::GeneratorAttempts] == 0);
+}
+
+} // namespace Operon::Test
@@ -47,4 +47,54 @@ TEST_CASE("InsertSubtreeMutation")
     fmt::print("{}\n", TreeFormatter::Format(child, ds));
 }
 
+TEST_CASE("Incremental UpdateNodes")
+{
+    constexpr size_t maxDepth { 1000 };
+    constexpr size_t maxLength { 200 };
+    Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(10, 10);
+    auto ds = Dataset(data);
+    std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+
+    PrimitiveSet grammar;
+    grammar.SetConfig(PrimitiveSet::Arithmetic | NodeType::Log | NodeType::Exp);
+    for (auto t : { NodeType::Add, NodeType::Mul }) {
+        grammar.SetMinMaxArity(Node(t).HashValue, 1, 5);
+    }
+
+    BalancedTreeCreator btc { grammar, inputs, /* bias= */ 0.0 };
+    UniformCoefficientInitializer cfi;
+
+    SubtreeCrossover cx { 0.9, maxDepth, maxLength };
+    InsertSubtreeMutation insert { btc, cfi, maxDepth, maxLength };
+    ReplaceSubtreeMutation replace { btc, cfi, maxDepth, maxLength };
+    RemoveSubtreeMutation remove { grammar };
+    ShuffleSubtreesMutation shuffle;
+
+    // the incremental update should give the same result as the full one
+    auto check = [](Tree const& tree) {
+        auto full = tree;
+        full.UpdateNodes();
+        for (size_t i = 0; i < tree.Length(); ++i) {
+            auto const& a = tree[i];
+            auto const& b = full[i];
+            if (std::tie(a.Length, a.Depth, a.Level, a.Parent) != std::tie(b.Length, b.Depth, b.Level, b.Parent)) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    Operon::RandomGenerator random(1234);
+    std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength / 2);
+    for (auto k = 0; k < 1000; ++k) { // NOLINT
+        auto lhs = btc(random, sizeDistribution(random), 1, maxDepth);
+        auto rhs = btc(random, sizeDistribution(random), 1, maxDepth);
+        CHECK(check(cx(random, lhs, rhs)));
+        CHECK(check(insert(random, lhs)));
+        CHECK(check(replace(random, lhs)));
+        CHECK(check(remove(random, lhs)));
+        CHECK(check(shuffle(random, lhs)));
+    }
+}
+
 }
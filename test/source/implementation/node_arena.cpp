@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <doctest/doctest.h>
+#include <taskflow/taskflow.hpp>
+
+#include "operon/algorithms/gp.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/node_arena.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/reinserter.hpp"
+#include "operon/operators/selector.hpp"
+
+#include "fixture.hpp"
+
+namespace Operon::Test {
+
+namespace {
+    auto Same(Tree const& lhs, Tree const& rhs) -> bool
+    {
+        auto const& a = lhs.Nodes();
+        auto const& b = rhs.Nodes();
+        return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](auto const& x, auto const& y) {
+            return x.Type == y.Type && x.HashValue == y.HashValue && x.Value == y.Value && x.Length == y.Length && x.Parent == y.Parent;
+        });
+    }
+} // namespace
+
+TEST_CASE("Node arena")
+{
+    auto ds = Dataset("./data/Poly-10.csv", /*hasHeader=*/true);
+    std::vector<Variable> inputs;
+    std::copy_if(ds.Variables().begin(), ds.Variables().end(), std::back_inserter(inputs), [](auto const& v) { return v.Name != "Y"; });
+    PrimitiveSet pset;
+    pset.SetConfig(PrimitiveSet::Arithmetic);
+    BalancedTreeCreator creator { pset, inputs };
+    Operon::RandomGenerator random(1234);
+    auto const tree = creator(random, 20, 1, 10);
+
+    NodeArena arena;
+
+    std::vector<Individual> pop(10);
+    for (auto& ind : pop) {
+        ind.Genotype = tree;
+    }
+
+    SUBCASE("pack")
+    {
+        CHECK(!NodeArena::Stored(pop.front().Genotype.Nodes()));
+        arena.Pack(pop);
+        // the genotypes are placed back to back in the active buffer, in the order of the population
+        for (size_t i = 0; i < pop.size(); ++i) {
+            auto const& nodes = pop[i].Genotype.Nodes();
+            CHECK(arena.Owns(nodes.data()));
+            CHECK(NodeArena::Stored(nodes));
+            CHECK(Same(pop[i].Genotype, tree));
+            if (i > 0) { CHECK(pop[i - 1].Genotype.Nodes().data() < nodes.data()); }
+        }
+        CHECK(arena.Used() >= pop.size() * tree.Length() * sizeof(Node));
+
+        // the next pack moves them to the other buffer, which is reused afterwards
+        arena.Pack(pop);
+        CHECK(arena.Owns(pop.front().Genotype.Nodes().data()));
+        auto const reallocations = arena.Reallocations();
+        for (auto i = 0; i < 10; ++i) {
+            arena.Pack(pop);
+        }
+        CHECK(arena.Reallocations() == reallocations);
+        CHECK(Same(pop.back().Genotype, tree));
+    }
+
+    SUBCASE("ownership")
+    {
+        arena.Pack(pop);
+        auto& t = pop.front().Genotype;
+
+        // a copy is allocated on the heap
+        Tree copy(t); // NOLINT
+        CHECK(!NodeArena::Stored(copy.Nodes()));
+
+        // trees are swapped and moved without copying their nodes
+        Tree other = creator(random, 10, 1, 10);
+        auto const* data = t.Nodes().data();
+        Swap(t, other);
+        CHECK(other.Nodes().data() == data);
+        Swap(t, other);
+        CHECK(t.Nodes().data() == data);
+
+        // a child written into a packed genotype reuses its storage when it fits, otherwise it goes to the heap
+        t.Nodes().assign(tree.Nodes().begin(), tree.Nodes().begin() + 1);
+        CHECK(t.Nodes().data() == data);
+        t.Nodes().assign(copy.Nodes().begin(), copy.Nodes().end());
+        t.Nodes().push_back(copy.Nodes().back());
+        CHECK(!NodeArena::Stored(t.Nodes()));
+        arena.Pack(pop);
+        CHECK(arena.Owns(t.Nodes().data()));
+    }
+}
+
+TEST_CASE("GP with node arena")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation changeVar { problem.InputVariables() };
+    ReplaceSubtreeMutation replaceSubtree { creator, coeffInit, 10, 20 };
+    MultiMutation mutator;
+    mutator.Add(changeVar, 1.0);
+    mutator.Add(replaceSubtree, 1.0);
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(5);
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    TournamentSelector selector(comp);
+    KeepBestReinserter reinserter(comp);
+    BasicOffspringGenerator basic(evaluator, crossover, mutator, selector, selector);
+    BroodOffspringGenerator brood(evaluator, crossover, mutator, selector, selector);
+    brood.BroodSize(4);
+
+    auto const config = RunConfig(10);
+
+    tf::Executor executor(4);
+
+    // the storage of the genotypes does not change the course of the run
+    auto check = [&](OffspringGeneratorBase const& generator) {
+        auto heapConfig = config;
+        evaluator.Reset();
+        GeneticProgrammingAlgorithm gp { problem, heapConfig, treeInit, coeffInit, generator, reinserter };
+        Operon::RandomGenerator r1(1234);
+        gp.Run(executor, r1);
+        CHECK(gp.Arena() == nullptr);
+
+        auto arenaConfig = config;
+        arenaConfig.UseNodeArena = true;
+        evaluator.Reset();
+        GeneticProgrammingAlgorithm other { problem, arenaConfig, treeInit, coeffInit, generator, reinserter };
+        Operon::RandomGenerator r2(1234);
+        other.Run(executor, r2);
+        REQUIRE(other.Arena() != nullptr);
+        CHECK(other.Arena()->Used() > 0);
+
+        auto const a = gp.Parents();
+        auto const b = other.Parents();
+        for (size_t i = 0; i < a.size(); ++i) {
+            CHECK(a[i].Fitness == b[i].Fitness);
+            CHECK(Same(a[i].Genotype, b[i].Genotype));
+        }
+    };
+
+    SUBCASE("basic generator") { check(basic); }
+    SUBCASE("brood generator") { check(brood); }
+}
+} // namespace Operon::Test
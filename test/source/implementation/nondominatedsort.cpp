@@ -11,6 +11,7 @@
 #include "operon/core/pset.hpp"
 #include "operon/interpreter/interpreter.hpp"
 #include "operon/operators/creator.hpp"
+#include "operon/operators/crowding.hpp"
 #include "operon/operators/evaluator.hpp"
 #include "operon/operators/non_dominated_sorter.hpp"
 
@@ -414,4 +415,89 @@ TEST_CASE("non-dominated sort" * doctest::test_suite("[implementation]"))
     }
 }
 
+TEST_CASE("crowding sorter" * doctest::test_suite("[implementation]"))
+{
+    Operon::RandomGenerator rd(1234);
+    // a coarse grid produces many duplicates
+    std::uniform_int_distribution<int> dist(0, 30);
+    tf::Executor executor(4);
+    RankIntersectSorter rs;
+    CrowdingSorter crowding(rs);
+
+    for (size_t m : { 2, 3 }) {
+        std::vector<Individual> pop(2000);
+        for (auto& ind : pop) {
+            ind.Fitness.resize(m);
+            for (auto& v : ind.Fitness) { v = static_cast<Operon::Scalar>(dist(rd)) / 10; }
+        }
+        crowding.Sort(executor, pop);
+        auto const& fronts = crowding.Fronts();
+
+        size_t count { 0 };
+        for (size_t i = 0; i < fronts.size(); ++i) {
+            for (auto k : fronts[i]) {
+                CHECK(pop[k].Rank == i);
+                CHECK(pop[k].Distance >= 0);
+            }
+            count += fronts[i].size();
+        }
+        CHECK(count == pop.size());
+
+        // the unique individuals are sorted lexicographically and the following front dominates none of them
+        auto const unique = pop.size() - fronts.back().size();
+        for (size_t i = 1; i < unique; ++i) {
+            CHECK(Operon::Less{}(pop[i - 1].Fitness, pop[i].Fitness));
+        }
+        for (size_t i = 0; i + 2 < fronts.size(); ++i) {
+            for (auto a : fronts[i]) {
+                for (auto b : fronts[i + 1]) { CHECK_FALSE(ParetoComparison{}(pop[b], pop[a])); }
+            }
+        }
+    }
+
+    // with eps > 0, the fitness vectors within eps of each other are duplicates, wherever they fall on a grid of size eps
+    CrowdingSorter coarse(rs, Operon::Scalar { 0.05 });
+    auto fitness = [](double x, double y) { return Operon::Vector<Operon::Scalar> { static_cast<Operon::Scalar>(x), static_cast<Operon::Scalar>(y) }; };
+    std::vector<Individual> pop(3);
+    pop[0].Fitness = fitness(0.5, 0.0);
+    pop[1].Fitness = fitness(0.31, 1.0);
+    pop[2].Fitness = fitness(0.29, 1.0);
+    coarse.Sort(executor, pop);
+    auto const& fronts = coarse.Fronts();
+    REQUIRE(fronts.size() == 2);
+    CHECK(fronts.back().size() == 1);
+    CHECK(pop[0].Fitness == fitness(0.31, 1.0)); // equal to the other one within eps, the tie is broken by position
+    CHECK(pop[1].Fitness == fitness(0.5, 0.0));
+    CHECK(pop[2].Fitness == fitness(0.29, 1.0));
+}
+
+TEST_CASE("parallel rank intersect sorter" * doctest::test_suite("[implementation]"))
+{
+    Operon::RandomGenerator rd(1234);
+    std::uniform_real_distribution<Operon::Scalar> real(0, 1);
+    std::uniform_int_distribution<int> grid(0, 10); // many ties across objectives
+
+    RankIntersectSorter rs;
+    ParallelRankIntersectSorter prs(4);
+
+    for (size_t m : { 2, 3, 4, 6 }) {
+        for (size_t n : { 1, 100, 5000 }) {
+            for (auto ties : { false, true }) {
+                std::vector<Individual> pop(n);
+                for (auto& ind : pop) {
+                    ind.Fitness.resize(m);
+                    for (auto& v : ind.Fitness) { v = ties ? static_cast<Operon::Scalar>(grid(rd)) : real(rd); }
+                }
+                // the sorters expect the population to be sorted lexicographically
+                std::stable_sort(pop.begin(), pop.end(), [](auto const& a, auto const& b) { return Operon::Less{}(a.Fitness, b.Fitness); });
+
+                auto expected = rs(pop);
+                auto fronts = prs(pop);
+                CHECK(fronts == expected);
+                CHECK(prs(pop, /*eps=*/1e-1) == rs(pop, /*eps=*/1e-1));
+            }
+        }
+    }
+}
+
 } // namespace Operon::Test
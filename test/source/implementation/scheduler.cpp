@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <doctest/doctest.h>
+#include <taskflow/taskflow.hpp>
+
+#include "operon/algorithms/gp.hpp"
+#include "operon/algorithms/scheduler.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/metrics.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/reinserter.hpp"
+#include "operon/operators/selector.hpp"
+
+#include "fixture.hpp"
+
+namespace Operon::Test {
+
+TEST_CASE("Cost scheduler")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    Interpreter interpreter;
+    MSE error;
+    Evaluator evaluator(problem, interpreter, error, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(5);
+
+    Operon::RandomGenerator random(1234);
+    std::uniform_int_distribution<size_t> length(1, 100);
+    std::vector<Individual> pop(1000);
+    std::vector<Operon::RandomGenerator> rngs;
+    std::vector<Operon::RandomGenerator> rngsCopy;
+    for (auto& ind : pop) {
+        ind.Genotype = creator(random, length(random), 1, 10);
+        auto seed = random();
+        rngs.emplace_back(seed);
+        rngsCopy.emplace_back(seed);
+    }
+
+    constexpr size_t workers { 4 };
+    CostScheduler scheduler;
+    scheduler.Plan(evaluator, pop, workers);
+    REQUIRE(scheduler.Chunks() == workers * CostScheduler::DefaultChunksPerWorker);
+
+    // every individual is scheduled exactly once and the chunks are balanced
+    std::vector<size_t> seen(pop.size(), 0);
+    std::vector<double> loads;
+    for (size_t k = 0; k < scheduler.Chunks(); ++k) {
+        auto load { 0.0 };
+        for (auto i : scheduler.Chunk(k)) {
+            ++seen[i];
+            load += scheduler.Cost(i);
+        }
+        loads.push_back(load);
+    }
+    CHECK(std::all_of(seen.begin(), seen.end(), [](auto c) { return c == 1; }));
+    CHECK(std::is_sorted(loads.rbegin(), loads.rend()));
+    CHECK(loads.back() > 0.9 * loads.front());
+
+    // the scheduled evaluation gives the same fitness as evaluating the individuals in order
+    auto copy = pop;
+    Operon::Vector<Operon::Scalar> buf(problem.TrainingRange().Size());
+    for (size_t i = 0; i < copy.size(); ++i) {
+        copy[i].Fitness = evaluator(rngsCopy[i], copy[i], buf);
+    }
+    Metrics::Reset();
+    for (size_t k = 0; k < scheduler.Chunks(); ++k) {
+        scheduler.Evaluate(k, evaluator, pop, rngs, buf);
+    }
+    for (size_t i = 0; i < pop.size(); ++i) {
+        CHECK(pop[i].Fitness == copy[i].Fitness);
+    }
+
+    auto const ratio = Metrics::Collect()[Metrics::Histogram::CostRatio];
+    CHECK(ratio.Count == pop.size());
+}
+
+TEST_CASE("Cost scheduler groups")
+{
+    // the fitness is a draw from the random generator that was passed in, so we can tell which one was used
+    struct DrawEvaluator : public EvaluatorBase {
+        using EvaluatorBase::EvaluatorBase;
+
+        auto operator()(Operon::RandomGenerator& random, Individual& /*ind*/, Operon::Span<Operon::Scalar> /*buf*/) const -> ReturnType override
+        {
+            return { static_cast<Operon::Scalar>(random() % 1000) };
+        }
+
+        [[nodiscard]] auto BatchSize() const -> size_t override { return 8; }
+    };
+
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    DrawEvaluator evaluator(problem);
+
+    Operon::RandomGenerator random(1234);
+    std::uniform_int_distribution<size_t> length(1, 100);
+    std::vector<Individual> pop(100, Individual(0));
+    std::vector<Operon::RandomGenerator> rngs;
+    std::vector<Operon::RandomGenerator> rngsCopy;
+    for (auto& ind : pop) {
+        ind.Genotype = creator(random, length(random), 1, 10);
+        auto seed = random();
+        rngs.emplace_back(seed);
+        rngsCopy.emplace_back(seed);
+    }
+
+    // only every other individual is scheduled, each one is evaluated with its own random generator
+    std::vector<size_t> items;
+    for (size_t i = 1; i < pop.size(); i += 2) {
+        items.push_back(i);
+    }
+    CostScheduler scheduler;
+    scheduler.Plan(evaluator, pop, items, /*workers=*/2);
+    Operon::Vector<Operon::Scalar> buf;
+    for (size_t k = 0; k < scheduler.Chunks(); ++k) {
+        scheduler.Evaluate(k, evaluator, pop, rngs, buf);
+    }
+    for (size_t i = 0; i < pop.size(); ++i) {
+        if (i % 2 == 0) {
+            CHECK(pop[i].Fitness.empty());
+        } else {
+            CHECK(pop[i].Fitness == Operon::Vector<Operon::Scalar> { static_cast<Operon::Scalar>(rngsCopy[i]() % 1000) });
+            CHECK(rngs[i]() == rngsCopy[i]()); // the generators are returned in their advanced state
+        }
+    }
+}
+
+TEST_CASE("Cost scheduler budget")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation changeVar { problem.InputVariables() };
+    ChangeFunctionMutation changeFunc { problem.GetPrimitiveSet() };
+    MultiMutation mutator;
+    mutator.Add(changeVar, 1.0);
+    mutator.Add(changeFunc, 1.0);
+
+    constexpr size_t iterations { 5 };
+    constexpr size_t budget { 5000 };
+    Interpreter interpreter;
+    MSE error;
+    Evaluator evaluator(problem, interpreter, error, /*linearScaling=*/true);
+    evaluator.SetLocalOptimizationIterations(iterations);
+    evaluator.SetBudget(budget);
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    TournamentSelector selector(comp);
+    KeepBestReinserter reinserter(comp);
+    // the basic generator defers the evaluation of the offspring to the scheduler
+    BasicOffspringGenerator generator(evaluator, crossover, mutator, selector, selector);
+    REQUIRE(generator.DefersEvaluation());
+
+    auto config = RunConfig(1000);
+    config.Evaluations = budget;
+
+    constexpr size_t workers { 4 };
+    tf::Executor executor(workers);
+    Operon::RandomGenerator random(1234);
+    GeneticProgrammingAlgorithm gp { problem, config, treeInit, coeffInit, generator, reinserter };
+    gp.Run(executor, random);
+
+    // each worker may start one more group after the budget ran out, each individual costing at most
+    // one residual and one jacobian evaluation per iteration plus the final residual evaluation
+    auto const slack = workers * evaluator.BatchSize() * (2 * (iterations + 1) + 1);
+    REQUIRE(slack < config.PoolSize * (2 * (iterations + 1) + 1));
+    CHECK(evaluator.BudgetExhausted());
+    CHECK(evaluator.TotalEvaluations() <= budget + slack);
+}
+} // namespace Operon::Test
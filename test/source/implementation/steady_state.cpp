@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <doctest/doctest.h>
+#include <taskflow/taskflow.hpp>
+
+#include "operon/algorithms/steady_state_gp.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/initializer.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/selector.hpp"
+
+#include "fixture.hpp"
+
+namespace Operon::Test {
+
+TEST_CASE("Steady-state GP")
+{
+    auto problem = Poly10();
+    problem.GetPrimitiveSet().SetConfig(PrimitiveSet::Arithmetic);
+
+    BalancedTreeCreator creator { problem.GetPrimitiveSet(), problem.InputVariables() };
+    UniformTreeInitializer treeInit(creator);
+    treeInit.ParameterizeDistribution(2, 20);
+    NormalCoefficientInitializer coeffInit;
+    coeffInit.ParameterizeDistribution(Operon::Scalar { 0 }, Operon::Scalar { 1 });
+
+    SubtreeCrossover crossover { 0.9, 10, 20 };
+    ChangeVariableMutation changeVar { problem.InputVariables() };
+    ChangeFunctionMutation changeFunc { problem.GetPrimitiveSet() };
+    MultiMutation mutator;
+    mutator.Add(changeVar, 1.0);
+    mutator.Add(changeFunc, 1.0);
+
+    Interpreter interpreter;
+    MSE mse;
+    Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+
+    auto comp = [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; };
+    TournamentSelector selector(comp);
+    BasicOffspringGenerator generator(evaluator, crossover, mutator, selector, selector);
+
+    GeneticAlgorithmConfig config {};
+    config.Generations = 10;
+    config.Evaluations = 1'000'000;
+    config.PopulationSize = 100;
+    config.PoolSize = 100;
+    config.TimeLimit = 60;
+    config.CrossoverProbability = 1.0;
+    config.MutationProbability = 0.25;
+
+    auto best = [](Operon::Span<Individual const> pop) {
+        return std::min_element(pop.begin(), pop.end(), [](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; })->operator[](0);
+    };
+
+    for (auto replacement : { SteadyStateGeneticProgrammingAlgorithm::Replacement::Worst, SteadyStateGeneticProgrammingAlgorithm::Replacement::Tournament }) {
+        SteadyStateGeneticProgrammingAlgorithm gp { problem, config, treeInit, coeffInit, generator };
+        gp.SetReplacement(replacement);
+
+        Operon::RandomGenerator random(1234);
+        tf::Executor executor(4);
+
+        std::vector<Operon::Scalar> history;
+        gp.Run(executor, random, [&]() { history.push_back(best(gp.Parents())); });
+
+        CHECK(gp.Generation() == config.Generations);
+        REQUIRE(history.size() == config.Generations + 1);
+        // the best individual is never replaced by a worse one
+        CHECK(std::is_sorted(history.rbegin(), history.rend()));
+    }
+}
+} // namespace Operon::Test
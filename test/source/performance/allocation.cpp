@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: MIT
+// SPDX-FileCopyrightText: Copyright 2019-2022 Heal Research
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <doctest/doctest.h>
+#include <new>
+
+#include "operon/core/arena.hpp"
+#include "operon/core/dataset.hpp"
+#include "operon/core/problem.hpp"
+#include "operon/core/pset.hpp"
+#include "operon/interpreter/interpreter.hpp"
+#include "operon/nnls/nnls.hpp"
+#include "operon/operators/creator.hpp"
+#include "operon/operators/crossover.hpp"
+#include "operon/operators/evaluator.hpp"
+#include "operon/operators/generator.hpp"
+#include "operon/operators/mutation.hpp"
+#include "operon/operators/selector.hpp"
+
+#include "nanobench.h"
+
+// count every heap allocation (this file is built into its own test executable, see test/CMakeLists.txt)
+// - with glibc the malloc family is replaced, which also counts the storage that Eigen (e.g. the solvers) and the C
+//   runtime get from malloc directly; the global operator new goes through malloc as well
+// - otherwise only the global operator new is replaced
+namespace {
+std::atomic_size_t allocationCount { 0 }; // NOLINT
+} // namespace
+
+#if defined(__GLIBC__)
+extern "C" {
+// NOLINTBEGIN
+auto __libc_malloc(std::size_t size) -> void*;
+auto __libc_calloc(std::size_t count, std::size_t size) -> void*;
+auto __libc_realloc(void* ptr, std::size_t size) -> void*;
+auto __libc_memalign(std::size_t alignment, std::size_t size) -> void*;
+auto __libc_free(void* ptr) -> void;
+
+auto malloc(std::size_t size) noexcept -> void* { ++allocationCount; return __libc_malloc(size); }
+auto calloc(std::size_t count, std::size_t size) noexcept -> void* { ++allocationCount; return __libc_calloc(count, size); }
+auto realloc(void* ptr, std::size_t size) noexcept -> void* { ++allocationCount; return __libc_realloc(ptr, size); }
+auto aligned_alloc(std::size_t alignment, std::size_t size) noexcept -> void* { ++allocationCount; return __libc_memalign(alignment, size); }
+auto memalign(std::size_t alignment, std::size_t size) noexcept -> void* { ++allocationCount; return __libc_memalign(alignment, size); }
+auto posix_memalign(void** ptr, std::size_t alignment, std::size_t size) noexcept -> int
+{
+    ++allocationCount;
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr == nullptr ? ENOMEM : 0;
+}
+auto free(void* ptr) noexcept -> void { __libc_free(ptr); }
+// NOLINTEND
+}
+#else
+auto operator new(std::size_t size) -> void*
+{
+    ++allocationCount;
+    if (auto* ptr = std::malloc(size)) { // NOLINT
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); } // NOLINT
+void operator delete(void* ptr, std::size_t /*unused*/) noexcept { std::free(ptr); } // NOLINT
+#endif
+
+namespace Operon::Test {
+    namespace nb = ankerl::nanobench;
+
+    TEST_CASE("Allocations per evaluation")
+    {
+        constexpr size_t n = 100;
+        constexpr size_t maxLength = 50;
+        constexpr size_t maxDepth = 1000;
+        constexpr size_t nrow = 1000;
+        constexpr size_t ncol = 10;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(nrow, ncol);
+        auto ds = Dataset(data);
+
+        auto variables = ds.Variables();
+        auto target = variables.back().Name;
+        std::vector<Variable> inputs;
+        std::copy_if(variables.begin(), variables.end(), std::back_inserter(inputs), [&](auto const& v) { return v.Name != target; });
+        Range range = { 0, ds.Rows() };
+
+        auto problem = Problem(ds).Inputs(inputs).Target(target).TrainingRange(range).TestRange(range);
+        problem.GetPrimitiveSet().SetConfig(Operon::PrimitiveSet::Arithmetic);
+
+        std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength);
+        auto creator = BalancedTreeCreator { problem.GetPrimitiveSet(), inputs };
+
+        std::vector<Tree> trees(n);
+        std::generate(trees.begin(), trees.end(), [&]() { return creator(rd, sizeDistribution(rd), 0, maxDepth); });
+
+        Interpreter interpreter;
+        auto targetValues = problem.TargetValues().subspan(range.Start(), range.Size());
+
+        SUBCASE("residuals and jacobian")
+        {
+            using CostFunction = TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor>;
+
+            auto const maxCoeff = std::max_element(trees.begin(), trees.end(), [](auto const& a, auto const& b) { return a.CoefficientsCount() < b.CoefficientsCount(); })->CoefficientsCount();
+            Operon::Vector<Operon::Scalar> params(maxCoeff);
+            Operon::Vector<Operon::Scalar> residuals(range.Size());
+            Operon::Vector<Operon::Scalar> jacobian(range.Size() * maxCoeff);
+
+            auto evaluate = [&](Tree const& tree) {
+                ResidualEvaluator re(interpreter, tree, ds, targetValues, range);
+                CostFunction cf(re);
+                tree.GetCoefficients({ params.data(), tree.CoefficientsCount() });
+                return cf.Evaluate(params.data(), residuals.data(), jacobian.data());
+            };
+
+            // warm up the arena
+            for (auto const& tree : trees) { evaluate(tree); }
+
+            auto const upstream = MonotonicArena::ThreadLocal().UpstreamAllocations();
+            auto const before = allocationCount.load();
+            for (auto const& tree : trees) { evaluate(tree); }
+            auto const after = allocationCount.load();
+
+            fmt::print("allocations per jacobian evaluation: {}\n", static_cast<double>(after - before) / n);
+            CHECK(after == before);
+            CHECK(MonotonicArena::ThreadLocal().UpstreamAllocations() == upstream);
+
+            nb::Bench b;
+            b.title("Jacobian evaluation").relative(true).minEpochIterations(10);
+            b.run("autodiff", [&]() { for (auto const& tree : trees) { evaluate(tree); } });
+        }
+
+        MSE mse;
+        Evaluator evaluator(problem, interpreter, mse, /*linearScaling=*/true);
+        evaluator.SetBudget(std::numeric_limits<size_t>::max());
+
+        std::vector<Individual> individuals(n);
+        for (size_t i = 0; i < n; ++i) { individuals[i].Genotype = trees[i]; }
+        Operon::Vector<Operon::Scalar> buf(range.Size());
+
+        auto evaluate = [&]() {
+            auto const before = allocationCount.load();
+            for (auto& ind : individuals) { ind.Fitness = evaluator(rd, ind, buf); }
+            return allocationCount.load() - before;
+        };
+
+        SUBCASE("evaluator")
+        {
+            evaluator.SetLocalOptimizationIterations(0);
+            evaluate(); // warm up the arena
+
+            auto const upstream = MonotonicArena::ThreadLocal().UpstreamAllocations();
+            auto const allocations = evaluate();
+            fmt::print("allocations per evaluation: {}\n", static_cast<double>(allocations) / n);
+
+            // the temporaries come from the arena, only the fitness vector returned by value is allocated
+            CHECK(allocations == n);
+            CHECK(MonotonicArena::ThreadLocal().UpstreamAllocations() == upstream);
+        }
+
+        SUBCASE("evaluator with local optimization")
+        {
+            evaluator.SetLocalOptimizationIterations(10);
+            evaluate(); // warm up the arena
+
+            auto const upstream = MonotonicArena::ThreadLocal().UpstreamAllocations();
+            auto const allocations = evaluate();
+
+            // the evaluator's own temporaries (residuals, jacobian, coefficients) still come from the arena, but the
+            // solvers (Eigen::LevenbergMarquardt, TinySolver, ceres) keep their state in storage of their own which is
+            // allocated by every optimization, so their allocations are only reported
+            fmt::print("allocations per evaluation with local optimization: {}\n", static_cast<double>(allocations) / n);
+            CHECK(MonotonicArena::ThreadLocal().UpstreamAllocations() == upstream);
+        }
+    }
+
+    TEST_CASE("Allocations per crossover")
+    {
+        constexpr size_t n = 1000;
+        constexpr size_t maxLength = 100;
+        constexpr size_t maxDepth = 1000;
+        constexpr size_t crossovers = 100'000;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(10, 10);
+        auto ds = Dataset(data);
+        std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+
+        PrimitiveSet pset(PrimitiveSet::Arithmetic);
+        std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength);
+        auto creator = BalancedTreeCreator { pset, inputs };
+
+        std::vector<Tree> trees(n);
+        std::generate(trees.begin(), trees.end(), [&]() { return creator(rd, sizeDistribution(rd), 0, maxDepth); });
+
+        SubtreeCrossover cx { 0.9, maxDepth, maxLength };
+        std::uniform_int_distribution<size_t> dist(0, n - 1);
+
+        // the child buffer grows to the largest child once, after which no crossover allocates
+        Tree child;
+        for (size_t i = 0; i < crossovers; ++i) { cx(rd, trees[dist(rd)], trees[dist(rd)], child); }
+        auto const before = allocationCount.load();
+        for (size_t i = 0; i < crossovers; ++i) { cx(rd, trees[dist(rd)], trees[dist(rd)], child); }
+        auto const after = allocationCount.load();
+        fmt::print("allocations per crossover: {}\n", static_cast<double>(after - before) / crossovers);
+        CHECK(after == before);
+
+        nb::Bench b;
+        b.title("Crossover").unit("crossover").relative(true).minEpochIterations(10);
+        b.batch(crossovers).run("new child", [&]() {
+            size_t length { 0 };
+            for (size_t i = 0; i < crossovers; ++i) { length += cx(rd, trees[dist(rd)], trees[dist(rd)]).Length(); }
+            return length;
+        });
+        b.batch(crossovers).run("child buffer", [&]() {
+            size_t length { 0 };
+            for (size_t i = 0; i < crossovers; ++i) { cx(rd, trees[dist(rd)], trees[dist(rd)], child); length += child.Length(); }
+            return length;
+        });
+    }
+
+    TEST_CASE("Allocations per offspring")
+    {
+        constexpr size_t n = 1000;
+        constexpr size_t maxLength = 100;
+        constexpr size_t maxDepth = 1000;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(10, 10);
+        auto ds = Dataset(data);
+        std::vector<Variable> inputs(ds.Variables().begin(), ds.Variables().end() - 1);
+        Range range = { 0, ds.Rows() };
+        auto problem = Problem(ds).Inputs(inputs).Target(ds.Variables().back().Name).TrainingRange(range).TestRange(range);
+
+        PrimitiveSet pset(PrimitiveSet::Arithmetic);
+        std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength);
+        auto creator = BalancedTreeCreator { pset, inputs };
+
+        LengthEvaluator evaluator(problem);
+        evaluator.SetBudget(std::numeric_limits<size_t>::max());
+        std::vector<Individual> parents(n);
+        for (auto& ind : parents) {
+            ind.Genotype = creator(rd, sizeDistribution(rd), 0, maxDepth);
+            ind.Fitness = evaluator(rd, ind, {});
+        }
+
+        SubtreeCrossover cx { 0.9, maxDepth, maxLength };
+        DiscretePointMutation mutator;
+        TournamentSelector selector([](auto const& lhs, auto const& rhs) { return lhs[0] < rhs[0]; });
+        BasicOffspringGenerator generator(evaluator, cx, mutator, selector, selector);
+        generator.Prepare(parents);
+
+        // with slots large enough for any child, only the fitness vector returned by the evaluator is allocated
+        // (once the scratch space of the crossover has been warmed up)
+        std::vector<Individual> offspring(n);
+        for (auto& ind : offspring) { generator(rd, /*pCrossover=*/1.0, /*pMutation=*/0.0, {}, ind); }
+        auto const longest = std::max_element(parents.begin(), parents.end(), [](auto const& a, auto const& b) { return a.Genotype.Length() < b.Genotype.Length(); })->Genotype.Length();
+        for (auto& ind : offspring) { ind.Genotype.Nodes().reserve(std::max(maxLength, longest)); }
+        auto const before = allocationCount.load();
+        for (auto& ind : offspring) { generator(rd, /*pCrossover=*/1.0, /*pMutation=*/0.0, {}, ind); }
+        auto const after = allocationCount.load();
+        fmt::print("allocations per offspring: {}\n", static_cast<double>(after - before) / n);
+        CHECK(after - before == n);
+    }
+} // namespace Operon::Test
@@ -11,9 +11,12 @@
 #include "operon/algorithms/config.hpp"
 #include "operon/algorithms/nsga2.hpp"
 #include "operon/core/dataset.hpp"
+#include "operon/core/genotype_dag.hpp"
 #include "operon/core/pset.hpp"
 #include "operon/interpreter/dispatch_table.hpp"
 #include "operon/interpreter/interpreter.hpp"
+#include "operon/nnls/batched_lm.hpp"
+#include "operon/nnls/nnls.hpp"
 #include "operon/operators/creator.hpp"
 #include "operon/operators/crossover.hpp"
 #include "operon/operators/evaluator.hpp"
@@ -237,6 +240,217 @@ namespace Operon::Test {
         test("mse + ls",  Operon::Evaluator(problem, interpreter, Operon::MSE{}, /*linearScaling=*/true));
     }
 
+    TEST_CASE("Batched local optimization")
+    {
+        constexpr size_t n = 512;
+        constexpr size_t maxLength = 20;
+        constexpr size_t maxDepth = 1000;
+        constexpr size_t nrow = 1000;
+        constexpr size_t ncol = 10;
+        constexpr size_t iterations = 10;
+        constexpr size_t batchSize = 64;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(nrow, ncol);
+        auto ds = Dataset(data);
+
+        auto variables = ds.Variables();
+        auto target = variables.back().Name;
+        std::vector<Variable> inputs;
+        std::copy_if(variables.begin(), variables.end(), std::back_inserter(inputs), [&](auto const& v) { return v.Name != target; });
+        Range range = { 0, ds.Rows() };
+
+        auto problem = Problem(ds).Inputs(inputs).Target(target).TrainingRange(range).TestRange(range);
+        problem.GetPrimitiveSet().SetConfig(Operon::PrimitiveSet::Arithmetic);
+
+        std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength);
+        auto creator = BalancedTreeCreator { problem.GetPrimitiveSet(), inputs };
+
+        std::vector<Tree> trees(n);
+        std::generate(trees.begin(), trees.end(), [&]() { return creator(rd, sizeDistribution(rd), 0, maxDepth); });
+
+        Interpreter interpreter;
+        auto targetValues = problem.TargetValues().subspan(range.Start(), range.Size());
+
+        auto sequential = [&](std::vector<Tree>& copies) {
+            double cost { 0 };
+            for (auto& tree : copies) {
+                NonlinearLeastSquaresOptimizer<OptimizerType::TINY> opt(interpreter, tree, ds);
+                auto summary = opt.Optimize(targetValues, range, iterations);
+                if (std::isfinite(summary.FinalCost)) { cost += summary.FinalCost; }
+            }
+            return cost;
+        };
+
+        auto batched = [&](std::vector<Tree>& copies) {
+            BatchedLevenbergMarquardt lm(interpreter, ds, targetValues, range);
+            std::vector<Tree*> ptrs(copies.size());
+            std::transform(copies.begin(), copies.end(), ptrs.begin(), [](auto& t) { return &t; });
+            std::vector<OptimizerSummary> summaries(copies.size());
+            double cost { 0 };
+            for (size_t i = 0; i < copies.size(); i += batchSize) {
+                auto const m = std::min(batchSize, copies.size() - i);
+                lm.Optimize({ ptrs.data() + i, m }, iterations, { summaries.data() + i, m });
+            }
+            for (auto const& s : summaries) {
+                if (std::isfinite(s.FinalCost)) { cost += s.FinalCost; }
+            }
+            return cost;
+        };
+
+        // both solvers should reach comparable solutions (trees with undefined outputs are skipped)
+        auto copies = trees;
+        auto const c1 = sequential(copies);
+        copies = trees;
+        auto const c2 = batched(copies);
+        fmt::print("total cost: sequential {}, batched {}\n", c1, c2);
+        CHECK(c2 <= c1 * 1.1);
+
+        nb::Bench b;
+        b.title("Local optimization").relative(true).minEpochIterations(5);
+        b.run("sequential tiny solver", [&]() { copies = trees; return sequential(copies); });
+        b.run("batched solver", [&]() { copies = trees; return batched(copies); });
+    }
+
+    TEST_CASE("Symbolic jacobian")
+    {
+        constexpr size_t n = 100;
+        constexpr size_t maxDepth = 1000;
+        constexpr size_t nrow = 1000;
+        constexpr size_t ncol = 10;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(nrow, ncol);
+        auto ds = Dataset(data);
+
+        auto variables = ds.Variables();
+        auto target = variables.back().Name;
+        std::vector<Variable> inputs;
+        std::copy_if(variables.begin(), variables.end(), std::back_inserter(inputs), [&](auto const& v) { return v.Name != target; });
+        Range range = { 0, ds.Rows() };
+
+        auto problem = Problem(ds).Inputs(inputs).Target(target).TrainingRange(range).TestRange(range);
+        problem.GetPrimitiveSet().SetConfig(Operon::PrimitiveSet::Arithmetic | NodeType::Exp | NodeType::Log | NodeType::Sin | NodeType::Cos | NodeType::Square);
+
+        auto creator = BalancedTreeCreator { problem.GetPrimitiveSet(), inputs };
+        Interpreter interpreter;
+        auto targetValues = problem.TargetValues().subspan(range.Start(), range.Size());
+
+        nb::Bench b;
+        b.title("Jacobian evaluation").relative(true).minEpochIterations(5);
+
+        // the number of coefficients grows with the tree length (every leaf is a coefficient)
+        for (size_t length : { 5UL, 10UL, 25UL, 50UL, 100UL }) {
+            std::vector<Tree> trees(n);
+            std::generate(trees.begin(), trees.end(), [&]() { return creator(rd, length, 0, maxDepth); });
+            auto const parameters = std::transform_reduce(trees.begin(), trees.end(), 0UL, std::plus<> {}, [](auto const& t) { return t.CoefficientsCount(); });
+
+            Eigen::Matrix<Operon::Scalar, -1, -1> jacobian(nrow, length);
+            auto evaluate = [&](auto const& cf, Tree const& tree) {
+                auto coeff = tree.GetCoefficients();
+                jacobian.resize(static_cast<Eigen::Index>(nrow), static_cast<Eigen::Index>(coeff.size()));
+                cf(coeff.data(), nullptr, jacobian.data());
+            };
+
+            b.batch(parameters).run(fmt::format("autodiff, length {}", length), [&]() {
+                for (auto const& tree : trees) {
+                    ResidualEvaluator re(interpreter, tree, ds, targetValues, range);
+                    TinyCostFunction<ResidualEvaluator, Operon::Dual, Operon::Scalar, Eigen::ColMajor> cf(re);
+                    evaluate(cf, tree);
+                }
+            });
+            b.batch(parameters).run(fmt::format("symbolic, length {}", length), [&]() {
+                for (auto const& tree : trees) {
+                    SymbolicCostFunction<Eigen::ColMajor> cf(interpreter, tree, ds, targetValues, range);
+                    evaluate(cf, tree);
+                }
+            });
+
+            // the derivative trees are built once per local optimization, the jacobian is evaluated once per iteration
+            std::vector<SymbolicCostFunction<Eigen::ColMajor>> prebuilt;
+            for (auto const& tree : trees) { prebuilt.emplace_back(interpreter, tree, ds, targetValues, range); }
+            b.batch(parameters).run(fmt::format("symbolic (prebuilt), length {}", length), [&]() {
+                for (size_t i = 0; i < trees.size(); ++i) { evaluate(prebuilt[i], trees[i]); }
+            });
+        }
+    }
+
+    TEST_CASE("Genotype DAG")
+    {
+        constexpr size_t n = 1000;
+        constexpr size_t parents = 50;
+        constexpr size_t maxLength = 100;
+        constexpr size_t maxDepth = 1000;
+        constexpr size_t nrow = 1000;
+        constexpr size_t ncol = 10;
+
+        Operon::RandomGenerator rd(1234);
+        Eigen::Matrix<Operon::Scalar, -1, -1> data = decltype(data)::Random(nrow, ncol);
+        auto ds = Dataset(data);
+
+        auto variables = ds.Variables();
+        std::vector<Variable> inputs(variables.begin(), variables.end() - 1);
+        Range range = { 0, ds.Rows() };
+
+        PrimitiveSet pset(PrimitiveSet::Arithmetic);
+        std::uniform_int_distribution<size_t> sizeDistribution(1, maxLength);
+        auto creator = BalancedTreeCreator { pset, inputs };
+
+        // a converged population is simulated by a few rounds of crossover among a small set of parents
+        std::vector<Tree> trees;
+        for (size_t i = 0; i < parents; ++i) { trees.push_back(creator(rd, sizeDistribution(rd), 0, maxDepth)); }
+        SubtreeCrossover crossover { 0.9, maxDepth, maxLength }; // NOLINT
+        std::uniform_int_distribution<size_t> pick(0, parents - 1);
+        while (trees.size() < n) {
+            trees.push_back(crossover(rd, trees[pick(rd)], trees[pick(rd)]));
+        }
+
+        // the hash values of the inserted trees are left as they are
+        std::vector<Operon::Hash> hashes;
+        for (auto const& tree : trees) { hashes.push_back(tree.Hash(Operon::HashMode::Relaxed).HashValue()); }
+
+        GenotypeDag dag;
+        std::vector<GenotypeDag::Id> roots;
+        for (auto const& tree : trees) { roots.push_back(dag.Insert(tree)); }
+        CHECK(std::equal(trees.begin(), trees.end(), hashes.begin(), [](auto const& t, auto h) { return t.HashValue() == h; }));
+
+        auto totalNodes = std::transform_reduce(trees.begin(), trees.end(), 0UL, std::plus<> {}, [](auto const& t) { return t.Length(); });
+        fmt::print("{} trees, {} nodes, {} unique vertices\n", n, totalNodes, dag.Size());
+        CHECK(dag.Size() < totalNodes);
+
+        Interpreter interpreter;
+        Operon::Vector<Operon::Scalar> result(n * range.Size());
+        interpreter.Evaluate<Operon::Scalar>(dag, roots, ds, range, result);
+
+        // the children of commutative symbols may be reordered, so the results are only approximately equal
+        auto close = [](auto x, auto y) { return x == y || (std::isnan(x) && std::isnan(y)) || std::abs(x - y) <= 1e-3 * std::max(Operon::Scalar{1}, std::abs(x)); }; // NOLINT
+        for (size_t i = 0; i < n; ++i) {
+            auto materialized = dag.Materialize(roots[i]);
+            CHECK(materialized.Length() == trees[i].Length());
+            CHECK(materialized.Hash(Operon::HashMode::Strict).HashValue() == trees[i].Hash(Operon::HashMode::Strict).HashValue());
+
+            auto a = interpreter.Evaluate<Operon::Scalar>(trees[i], ds, range);
+            auto b = Operon::Span<Operon::Scalar const>(result).subspan(i * range.Size(), range.Size());
+            CHECK(std::equal(a.begin(), a.end(), b.begin(), close));
+        }
+
+        Operon::Vector<Operon::Scalar> buf(range.Size());
+        nb::Bench b;
+        b.title("Genotype DAG").relative(true).performanceCounters(true).minEpochIterations(5);
+        b.batch(totalNodes * range.Size()).run("individual trees", [&]() {
+            for (auto const& tree : trees) { interpreter.Evaluate<Operon::Scalar>(tree, ds, range, buf); }
+        });
+        b.batch(totalNodes * range.Size()).run("genotype dag", [&]() {
+            interpreter.Evaluate<Operon::Scalar>(dag, roots, ds, range, result);
+        });
+
+        // releasing every genotype releases every vertex
+        for (auto r : roots) { dag.Release(r); }
+        CHECK(dag.Size() == 0);
+        dag.Compact({});
+        CHECK(dag.Vertices().empty());
+    }
+
     TEST_CASE("NSGA2")
     {
         auto ds = Dataset("/home/bogdb/projects/operon-archive/data/Friedman-I.csv", /*hasHeader=*/true);
@@ -12,6 +12,7 @@
 #include "operon/interpreter/dispatch_table.hpp"
 #include "operon/interpreter/interpreter.hpp"
 #include "operon/operators/creator.hpp"
+#include "operon/operators/crowding.hpp"
 #include "operon/operators/evaluator.hpp"
 #include "operon/operators/generator.hpp"
 #include "operon/operators/non_dominated_sorter.hpp"
@@ -149,6 +150,11 @@ TEST_CASE("non-dominated sort" * doctest::test_suite("[performance]"))
     }
 
     SUBCASE("point cloud RS") { Test("RS", bench, rs, rd, dist, ns, ms); }
+    SUBCASE("point cloud parallel RS")
+    {
+        ParallelRankIntersectSorter prs;
+        Test("PRS", bench, prs, rd, dist, ns, ms);
+    }
     SUBCASE("point cloud DS") { Test("DS", bench, ds, rd, dist, ns, ms); }
     SUBCASE("point cloud HS") { Test("HS", bench, hs, rd, dist, ns, ms); }
     SUBCASE("point cloud ENS-BS") { Test("ENS-BS", bench, ensBs, rd, dist, ns, ms); }
@@ -184,4 +190,63 @@ TEST_CASE("non-dominated sort" * doctest::test_suite("[performance]"))
         check_complexity(2, RankOrdinalSorter {});
     }
 }
+
+TEST_CASE("NSGA2 survival" * doctest::test_suite("[performance]"))
+{
+    Operon::RandomGenerator rd(Seed);
+    std::uniform_real_distribution<Operon::Scalar> dist(0, 1);
+    std::vector<size_t> ns { 10'000, 50'000, 100'000 };
+    std::vector<size_t> ms { 2, 3 };
+
+    RankIntersectSorter rs;
+    tf::Executor executor(std::thread::hardware_concurrency());
+
+    // the serial pipeline: lexicographic sort, duplicates by adjacent comparison, crowding distance by sorting the fronts
+    auto serial = [&](Operon::Span<Individual> pop) {
+        Operon::Less less;
+        Operon::Equal eq;
+        std::stable_sort(pop.begin(), pop.end(), [&](auto const& lhs, auto const& rhs) { return less(lhs.Fitness, rhs.Fitness); });
+        for (auto i = pop.begin(); i < pop.end();) {
+            i->Rank = 0;
+            auto j = i + 1;
+            for (; j < pop.end() && eq(i->Fitness, j->Fitness); ++j) { j->Rank = 1; }
+            i = j;
+        }
+        auto r = std::stable_partition(pop.begin(), pop.end(), [](auto const& ind) { return !ind.Rank; });
+        auto fronts = rs(Operon::Span<Individual const>(pop.begin(), r));
+        auto const m = pop.front().Size();
+        for (size_t i = 0; i < fronts.size(); ++i) {
+            auto& front = fronts[i];
+            for (auto k : front) { pop[k].Rank = i; pop[k].Distance = 0; }
+            for (size_t obj = 0; obj < m; ++obj) {
+                std::stable_sort(front.begin(), front.end(), [&](auto a, auto b) { return pop[a][obj] < pop[b][obj]; });
+                auto range = pop[front.back()][obj] - pop[front.front()][obj];
+                for (size_t j = 1; j + 1 < front.size(); ++j) {
+                    pop[front[j]].Distance += (pop[front[j + 1]][obj] - pop[front[j - 1]][obj]) / range;
+                }
+            }
+        }
+        return fronts.size();
+    };
+
+    nb::Bench bench;
+    bench.relative(true).minEpochIterations(3);
+
+    for (auto m : ms) {
+        for (auto n : ns) {
+            auto const pop = InitializePop(rd, dist, n, m);
+            std::vector<Individual> work;
+            bench.run(fmt::format("serial: n = {}, m = {}", n, m), [&]() {
+                work = pop;
+                return serial(work);
+            });
+            CrowdingSorter crowding(rs);
+            bench.run(fmt::format("parallel: n = {}, m = {}", n, m), [&]() {
+                work = pop;
+                crowding.Sort(executor, work);
+                return crowding.Fronts().size();
+            });
+        }
+    }
+}
 } // namespace Operon::Test